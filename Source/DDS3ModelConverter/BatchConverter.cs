@@ -0,0 +1,350 @@
+﻿using Newtonsoft.Json;
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Linq;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace DDS3ModelConverter
+{
+    /// <summary>
+    /// Runs many conversions in one process, so startup, static initialization and JIT are only paid for once.
+    /// Jobs come from a manifest, a glob or stdin and run in parallel. Each job and a final summary are reported as JSON lines.
+    /// </summary>
+    internal class BatchConverter
+    {
+        private const int BYTES_PER_MEGABYTE = 1024 * 1024;
+
+        private readonly string[] mArgs;
+        private readonly ProgramOptions.BatchOptions mOptions;
+        private readonly int mMaxParallelism;
+        private readonly long mMemoryLimit;
+        private readonly object mMemoryLock = new object();
+        private readonly object mReportLock = new object();
+        private TextWriter mReport;
+        private int mRunningJobCount;
+        private int mJobCount;
+        private int mFailedJobCount;
+        private long mInputSize;
+
+        public BatchConverter(string[] args, ProgramOptions options)
+        {
+            mArgs = args;
+            mOptions = options.Batch;
+            mMaxParallelism = mOptions.MaxParallelism > 0 ? mOptions.MaxParallelism : Environment.ProcessorCount;
+            mMemoryLimit = (long)mOptions.MemoryLimit * BYTES_PER_MEGABYTE;
+        }
+
+        /// <summary>
+        /// Runs all jobs, and returns the exit code of the process.
+        /// </summary>
+        public int Run()
+        {
+            // Conversions log to stdout, so they're moved to stderr to keep the report readable when it's written there
+            var stdout = Console.Out;
+            Console.SetOut(Console.Error);
+
+            if (mOptions.Glob != null && mOptions.OutputPattern == null)
+            {
+                Console.WriteLine("An output pattern is required when converting a glob");
+                return 1;
+            }
+
+            mReport = mOptions.Report != null ? new StreamWriter(mOptions.Report) : stdout;
+            try
+            {
+                // Conversions run for long, so don't wait for the thread pool to slowly add threads
+                ThreadPool.GetMinThreads(out var workerThreads, out var completionPortThreads);
+                ThreadPool.SetMinThreads(Math.Max(workerThreads, mMaxParallelism), completionPortThreads);
+
+                var stopwatch = Stopwatch.StartNew();
+                if (mOptions.Stdin)
+                {
+                    RunJobs(ReadStdinJobs());
+                }
+                else
+                {
+                    // Start with the largest inputs, so a large job doesn't end up running on its own at the end
+                    var jobs = mOptions.Manifest != null ? ReadManifestJobs() : ReadGlobJobs();
+                    RunJobs(jobs.OrderByDescending(x => x.InputSize).ToList());
+                }
+
+                stopwatch.Stop();
+                var seconds = Math.Max(stopwatch.Elapsed.TotalSeconds, double.Epsilon);
+                WriteReport(new
+                {
+                    type = "summary",
+                    jobs = mJobCount,
+                    failed = mFailedJobCount,
+                    seconds,
+                    jobsPerSecond = mJobCount / seconds,
+                    megabytesPerSecond = mInputSize / (double)BYTES_PER_MEGABYTE / seconds
+                });
+            }
+            finally
+            {
+                if (mOptions.Report != null)
+                    mReport.Dispose();
+            }
+
+            return mFailedJobCount == 0 ? 0 : 1;
+        }
+
+        private void RunJobs(IEnumerable<Job> jobs)
+        {
+            // Workers take one job at a time as they become idle, so jobs of very different sizes are still balanced
+            var partitioner = Partitioner.Create(jobs, EnumerablePartitionerOptions.NoBuffering);
+            Parallel.ForEach(partitioner, new ParallelOptions { MaxDegreeOfParallelism = mMaxParallelism }, x => RunJob(x));
+        }
+
+        private void RunJob(Job job)
+        {
+            var stopwatch = Stopwatch.StartNew();
+            var error = job.Error;
+            if (error == null)
+            {
+                WaitForMemory();
+                try
+                {
+                    Program.Options = job.Options;
+                    Program.RunConversion();
+                }
+                catch (Exception e)
+                {
+                    error = e.Message;
+                }
+                finally
+                {
+                    Program.Options = null;
+                    ReleaseMemory();
+                }
+            }
+
+            stopwatch.Stop();
+            Interlocked.Increment(ref mJobCount);
+            Interlocked.Add(ref mInputSize, job.InputSize);
+            if (error != null)
+                Interlocked.Increment(ref mFailedJobCount);
+
+            WriteReport(new
+            {
+                type = "job",
+                id = job.Id,
+                input = job.Options?.Input ?? job.Source,
+                output = job.Options?.Output,
+                status = error == null ? "ok" : "failed",
+                error,
+                milliseconds = stopwatch.Elapsed.TotalMilliseconds
+            });
+        }
+
+        /// <summary>
+        /// Waits until the memory in use leaves room for another job within the limit of all running jobs.
+        /// The memory of a single thread can't be capped, so the limit is enforced before a job starts instead.
+        /// </summary>
+        private void WaitForMemory()
+        {
+            lock (mMemoryLock)
+            {
+                if (mMemoryLimit > 0)
+                {
+                    var budget = mMemoryLimit * mMaxParallelism;
+                    while (mRunningJobCount > 0 && GC.GetTotalMemory(false) + mMemoryLimit > budget)
+                    {
+                        // Garbage of finished jobs may be all that's in the way
+                        if (GC.GetTotalMemory(true) + mMemoryLimit <= budget)
+                            break;
+
+                        Monitor.Wait(mMemoryLock);
+                    }
+                }
+
+                mRunningJobCount++;
+            }
+        }
+
+        private void ReleaseMemory()
+        {
+            lock (mMemoryLock)
+            {
+                mRunningJobCount--;
+                Monitor.PulseAll(mMemoryLock);
+            }
+        }
+
+        private void WriteReport(object entry)
+        {
+            var line = JsonConvert.SerializeObject(entry);
+            lock (mReportLock)
+            {
+                mReport.WriteLine(line);
+                mReport.Flush();
+            }
+        }
+
+        private IEnumerable<Job> ReadManifestJobs()
+        {
+            var lines = File.ReadAllLines(mOptions.Manifest);
+            var jobs = new List<Job>(lines.Length);
+            for (int i = 0; i < lines.Length; i++)
+            {
+                if (!IsComment(lines[i]))
+                    jobs.Add(CreateJob(i + 1, lines[i]));
+            }
+
+            return jobs;
+        }
+
+        private IEnumerable<Job> ReadStdinJobs()
+        {
+            // Jobs are read as workers need them, so the process stays up until the input is closed
+            var lineNumber = 0;
+            string line;
+            while ((line = Console.In.ReadLine()) != null)
+            {
+                lineNumber++;
+                if (!IsComment(line))
+                    yield return CreateJob(lineNumber, line);
+            }
+        }
+
+        private IEnumerable<Job> ReadGlobJobs()
+        {
+            var directoryPath = Path.GetDirectoryName(mOptions.Glob);
+            if (string.IsNullOrEmpty(directoryPath))
+                directoryPath = ".";
+
+            var searchOption = mOptions.Recursive ? SearchOption.AllDirectories : SearchOption.TopDirectoryOnly;
+            var id = 0;
+            foreach (var filePath in Directory.EnumerateFiles(directoryPath, Path.GetFileName(mOptions.Glob), searchOption))
+                yield return CreateGlobJob(++id, filePath, directoryPath);
+        }
+
+        private static Job CreateJob(int id, string line)
+        {
+            var job = new Job(id, line);
+            if (!Program.ParseArgs(SplitCommandLine(line)))
+                job.Error = "Invalid arguments";
+            else if (Program.Options.Batch.IsEnabled)
+                job.Error = "A job can't start another batch";
+            else
+                job.SetOptions(Program.Options);
+
+            return job;
+        }
+
+        private Job CreateGlobJob(int id, string filePath, string directoryPath)
+        {
+            var job = new Job(id, filePath);
+            try
+            {
+                // Every job gets its own copy of the options the batch was started with
+                if (!Program.ParseArgs(mArgs))
+                    throw new ArgumentException("Invalid arguments");
+
+                var options = Program.Options;
+                options.Batch = new ProgramOptions.BatchOptions();
+                options.Input = filePath;
+                options.Output = FormatOutputPath(filePath, directoryPath);
+                if (!Program.ResolveInputOutput(mArgs))
+                    throw new ArgumentException("Unsupported input format");
+
+                Directory.CreateDirectory(Path.GetDirectoryName(options.Output));
+                job.SetOptions(options);
+            }
+            catch (Exception e)
+            {
+                job.Error = e.Message;
+            }
+
+            return job;
+        }
+
+        private string FormatOutputPath(string filePath, string directoryPath)
+        {
+            var relativeDirectoryPath = Path.GetDirectoryName(filePath)
+                .Substring(directoryPath.Length)
+                .TrimStart(Path.DirectorySeparatorChar, Path.AltDirectorySeparatorChar);
+
+            return Path.GetFullPath(mOptions.OutputPattern
+                .Replace("{dir}", relativeDirectoryPath)
+                .Replace("{name}", Path.GetFileNameWithoutExtension(filePath))
+                .Replace("{ext}", Path.GetExtension(filePath).TrimStart('.')));
+        }
+
+        private static bool IsComment(string line)
+        {
+            return string.IsNullOrWhiteSpace(line) || line.TrimStart().StartsWith("#");
+        }
+
+        /// <summary>
+        /// Splits a command line into arguments at whitespace outside of double quotes.
+        /// </summary>
+        private static string[] SplitCommandLine(string line)
+        {
+            var args = new List<string>();
+            var arg = new StringBuilder();
+            var isQuoted = false;
+            var hasArg = false;
+            foreach (var c in line)
+            {
+                if (c == '"')
+                {
+                    isQuoted = !isQuoted;
+                    hasArg = true;
+                }
+                else if (char.IsWhiteSpace(c) && !isQuoted)
+                {
+                    if (hasArg)
+                    {
+                        args.Add(arg.ToString());
+                        arg.Clear();
+                        hasArg = false;
+                    }
+                }
+                else
+                {
+                    arg.Append(c);
+                    hasArg = true;
+                }
+            }
+
+            if (hasArg)
+                args.Add(arg.ToString());
+
+            return args.ToArray();
+        }
+
+        private class Job
+        {
+            public int Id { get; }
+
+            /// <summary>
+            /// The manifest line or file the job was created from.
+            /// </summary>
+            public string Source { get; }
+
+            public ProgramOptions Options { get; private set; }
+
+            public long InputSize { get; private set; }
+
+            public string Error { get; set; }
+
+            public Job(int id, string source)
+            {
+                Id = id;
+                Source = source;
+            }
+
+            public void SetOptions(ProgramOptions options)
+            {
+                Options = options;
+                InputSize = File.Exists(options.Input) ? new FileInfo(options.Input).Length : 0;
+            }
+        }
+    }
+}
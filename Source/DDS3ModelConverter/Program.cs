@@ -4,10 +4,15 @@ using DDS3ModelLibrary.IO;
 using DDS3ModelLibrary.Models;
 using DDS3ModelLibrary.Models.Conversion;
 using DDS3ModelLibrary.Models.Field;
+using DDS3ModelLibrary.Motions;
 using DDS3ModelLibrary.Motions.Conversion;
 using DDS3ModelLibrary.Textures;
+using DDS3ModelLibrary.Textures.Processing;
+using DDS3ModelLibrary.Utilities;
 using System;
+using System.Collections.Generic;
 using System.IO;
+using System.Linq;
 using TGE.SimpleCommandLine;
 
 namespace DDS3ModelConverter
@@ -33,23 +38,37 @@ namespace DDS3ModelConverter
         OBJ,
         DAE,
         FBX,
+        GLB,
         Folder
     }
 
+    public enum MeshMergeMode
+    {
+        None,
+        PerNode,
+        PerMaterial,
+        Model
+    }
+
     internal class Program
     {
         public static string About { get; } = SimpleCommandLineFormatter.Default.FormatAbout<ProgramOptions>(
             "TGE", "A model converter for DDS3 engine games.");
 
-        public static ProgramOptions Options { get; set; }
+        // Batch jobs run on several threads at once, each with its own options
+        [ThreadStatic]
+        private static ProgramOptions sOptions;
 
-        public static FbxModelExporterConfig FbxConfig { get; } =
-            new FbxModelExporterConfig()
-            {
-                ConvertBlendShapesToMeshes = true,
-                ExportMultipleUvLayers = true,
-                MergeMeshes = true
-            };
+        // The FBX exporter keeps state for the export in progress, so only one export can run at a time
+        private static readonly object sFbxExportLock = new object();
+
+        public static ProgramOptions Options
+        {
+            get => sOptions;
+            set => sOptions = value;
+        }
+
+        public static FbxModelExporterConfig FbxConfig => FbxSettings.Create();
 
         static void Main(string[] args)
         {
@@ -65,41 +84,17 @@ namespace DDS3ModelConverter
                 return;
             }
 
+            if (Options.Batch.IsEnabled)
+            {
+                Environment.ExitCode = new BatchConverter(args, Options).Run();
+                return;
+            }
+
 #if !DEBUG
             try
 #endif
             {
-                switch (Options.InputFormat)
-                {
-                    case InputFormat.PB:
-                        ConvertPB();
-                        break;
-                    case InputFormat.MB:
-                        ConvertMB();
-                        break;
-                    case InputFormat.F1:
-                        ConvertF1();
-                        break;
-                    case InputFormat.TB:
-                        {
-                            var textures = Resource.Load<TexturePack>(Options.Input);
-                            var outDirPath = GetDirectoryPath(Options.Output);
-                            for (int i = 0; i < textures.Count; i++)
-                            {
-                                Texture item = (Texture)textures[i];
-                                var name = $"texture_{i:D2}.png";
-                                item.GetBitmap().Save(Path.Combine(outDirPath, name));
-                            }
-                        }
-                        break;
-                    case InputFormat.OBJ:
-                    case InputFormat.DAE:
-                    case InputFormat.FBX:
-                        ConvertAssimpModel();
-                        break;
-                    default:
-                        break;
-                }
+                RunConversion();
             }
 #if !DEBUG
             catch ( Exception e )
@@ -112,6 +107,49 @@ namespace DDS3ModelConverter
             Console.WriteLine("Done");
         }
 
+        /// <summary>
+        /// Runs the conversion described by the options of the current thread.
+        /// </summary>
+        internal static void RunConversion()
+        {
+            switch (Options.InputFormat)
+            {
+                case InputFormat.PB when Options.OutputFormat == OutputFormat.GLB:
+                case InputFormat.MB when Options.OutputFormat == OutputFormat.GLB:
+                case InputFormat.F1 when Options.OutputFormat == OutputFormat.GLB:
+                    ConvertToGlb();
+                    break;
+                case InputFormat.PB:
+                    ConvertPB();
+                    break;
+                case InputFormat.MB:
+                    ConvertMB();
+                    break;
+                case InputFormat.F1:
+                    ConvertF1();
+                    break;
+                case InputFormat.TB:
+                    {
+                        var textures = Resource.Load<TexturePack>(Options.Input);
+                        var outDirPath = GetDirectoryPath(Options.Output);
+                        for (int i = 0; i < textures.Count; i++)
+                        {
+                            Texture item = (Texture)textures[i];
+                            var name = $"texture_{i:D2}.png";
+                            item.GetBitmap().Save(Path.Combine(outDirPath, name));
+                        }
+                    }
+                    break;
+                case InputFormat.OBJ:
+                case InputFormat.DAE:
+                case InputFormat.FBX:
+                    ConvertAssimpModel();
+                    break;
+                default:
+                    break;
+            }
+        }
+
         private static void ConvertPB()
         {
             var modelPack = new ModelPack(Options.Input);
@@ -135,9 +173,14 @@ namespace DDS3ModelConverter
                                 $"{Path.GetFileNameWithoutExtension(Options.Output)}_{i}.{Options.OutputFormat}";
 
                         if (Options.OutputFormat == OutputFormat.DAE || Options.OutputFormat == OutputFormat.FBX)
-                            FbxModelExporter.Instance.Export(modelPack.Models[i], modelOutfilePath, FbxConfig, modelPack.TexturePack);
-                        else
-                            AssimpModelExporter.Instance.Export(modelPack.Models[i], modelOutfilePath, modelPack.TexturePack);
+                        {
+                            // Motions are exported as animation stacks of the model file
+                            ExportFbx(modelPack.Models[i], modelOutfilePath, modelPack.TexturePack,
+                                Options.Assimp.OutputPbMotion ? modelPack.MotionPacks : null);
+                            continue;
+                        }
+
+                        AssimpModelExporter.Instance.Export(modelPack.Models[i], modelOutfilePath, modelPack.TexturePack);
 
                         if (Options.Assimp.OutputPbMotion)
                         {
@@ -178,7 +221,7 @@ namespace DDS3ModelConverter
                 case OutputFormat.DAE:
                 case OutputFormat.FBX:
                     if (Options.OutputFormat == OutputFormat.DAE || Options.OutputFormat == OutputFormat.FBX)
-                        FbxModelExporter.Instance.Export(model, Options.Output, FbxConfig, null);
+                        ExportFbx(model, Options.Output, null, null);
                     else
                         AssimpModelExporter.Instance.Export(model, Options.Output);
                     break;
@@ -196,9 +239,19 @@ namespace DDS3ModelConverter
                 case OutputFormat.F1:
                     fieldScene.Save(Options.Output);
                     break;
-                case OutputFormat.OBJ:
                 case OutputFormat.DAE:
                 case OutputFormat.FBX:
+                    if (Options.Field.ExportScene)
+                    {
+                        // Whole scene in one file, with models shared between objects exported once
+                        var textures = Options.Field.TextureInput != null ? Resource.Load<TexturePack>(Options.Field.TextureInput) : null;
+                        lock (sFbxExportLock)
+                            FbxModelExporter.Instance.Export(fieldScene, Options.Output, FbxConfig, textures);
+                        break;
+                    }
+
+                    goto case OutputFormat.OBJ;
+                case OutputFormat.OBJ:
                     {
                         var outDirPath = GetDirectoryPath(Options.Output);
                         foreach (var obj in fieldScene.Objects)
@@ -206,14 +259,79 @@ namespace DDS3ModelConverter
                             if (obj.ResourceType != FieldObjectResourceType.Model || obj.Resource == null)
                                 continue;
 
+                            // Objects can share the same model, so the placement is undone after exporting
                             var model = (Model)obj.Resource;
+                            var rootTransform = model.Nodes[0].Transform;
                             model.Nodes[0].Transform *= obj.Transform.Matrix;
 
                             var outFilePath = Path.Combine(outDirPath, obj.Name + Path.GetExtension(Options.Output));
                             if (Options.OutputFormat == OutputFormat.DAE || Options.OutputFormat == OutputFormat.FBX)
-                                FbxModelExporter.Instance.Export(model, outFilePath, FbxConfig, null);
+                                ExportFbx(model, outFilePath, null, null);
                             else
                                 AssimpModelExporter.Instance.Export(model, outFilePath);
+
+                            model.Nodes[0].Transform = rootTransform;
+                        }
+                    }
+                    break;
+                default:
+                    throw new Exception("Unsupported output format");
+            }
+        }
+
+        private static void ExportFbx(Model model, string path, TexturePack textures, IList<MotionPack> motionPacks)
+        {
+            lock (sFbxExportLock)
+            {
+                FbxModelExporter.Instance.Export(model, path, FbxConfig, textures, motionPacks);
+                foreach (var controller in FbxModelExporter.Instance.SkippedControllers)
+                    Console.WriteLine($"Skipped motion controller {controller}");
+            }
+        }
+
+        /// <summary>
+        /// Exports to GLB without touching the FBX exporter, so its native assembly is never loaded and the conversion also works with Mono.
+        /// </summary>
+        private static void ConvertToGlb()
+        {
+            var config = new GltfModelExporter.Config();
+
+            switch (Options.InputFormat)
+            {
+                case InputFormat.PB:
+                    {
+                        var modelPack = new ModelPack(Options.Input);
+                        for (int i = 0; i < modelPack.Models.Count; i++)
+                        {
+                            var modelOutfilePath = modelPack.Models.Count == 1 ?
+                                    Options.Output :
+                                    $"{Path.GetFileNameWithoutExtension(Options.Output)}_{i}.glb";
+
+                            GltfModelExporter.Instance.Export(modelPack.Models[i], modelOutfilePath, config, modelPack.TexturePack,
+                                Options.Assimp.OutputPbMotion ? modelPack.MotionPacks : null);
+                        }
+                    }
+                    break;
+                case InputFormat.MB:
+                    GltfModelExporter.Instance.Export(Resource.Load<Model>(Options.Input), Options.Output, config, null);
+                    break;
+                case InputFormat.F1:
+                    {
+                        var fieldScene = new FieldScene(Options.Input);
+                        var textures = Options.Field.TextureInput != null ? Resource.Load<TexturePack>(Options.Field.TextureInput) : null;
+                        var outDirPath = GetDirectoryPath(Options.Output);
+                        foreach (var obj in fieldScene.Objects)
+                        {
+                            if (obj.ResourceType != FieldObjectResourceType.Model || obj.Resource == null)
+                                continue;
+
+                            var model = (Model)obj.Resource;
+                            var rootTransform = model.Nodes[0].Transform;
+                            model.Nodes[0].Transform *= obj.Transform.Matrix;
+
+                            GltfModelExporter.Instance.Export(model, Path.Combine(outDirPath, obj.Name + ".glb"), config, textures);
+
+                            model.Nodes[0].Transform = rootTransform;
                         }
                     }
                     break;
@@ -231,6 +349,11 @@ namespace DDS3ModelConverter
             return outDirPath;
         }
 
+        private static ImportCache CreateImportCache()
+        {
+            return Options.ImportCache != null ? new ImportCache(Options.ImportCache) : null;
+        }
+
         private static void ConvertAssimpModel()
         {
             switch (Options.OutputFormat)
@@ -246,8 +369,12 @@ namespace DDS3ModelConverter
 
                         if (!Options.Assimp.TreatInputAsAnimation)
                         {
-                            modelPack.Replace(Options.Input, Options.TmxScale, Options.Model.EnableMaterialOverlays, Options.Model.WeightedMeshType,
-                                Options.Model.UnweightedMeshType, Options.Model.MeshWeightLimit, Options.Model.BatchVertexLimit);
+                            var importReport = modelPack.Replace(Options.Input, Options.TmxScale, Options.Model.EnableMaterialOverlays, Options.Model.WeightedMeshType,
+                                Options.Model.UnweightedMeshType, Options.Model.MeshWeightLimit, Options.Model.BatchVertexLimit, CreateImportCache(),
+                                Options.Model.MipMapCount, !Options.Model.SkipBatchOptimization, Options.Model.PrintStatistics);
+
+                            if (Options.Model.PrintStatistics)
+                                Console.WriteLine($"Model: {importReport}");
                         }
                         else
                         {
@@ -255,9 +382,24 @@ namespace DDS3ModelConverter
                         AssimpMotionImporter.Instance.Import(Options.Input,
                                                           new AssimpMotionImporter.Config
                                                           {
-                                                              NodeIndexResolver = n => modelPack.Models[Options.PackedModel.ReplaceMotionModelIndex].Nodes.FindIndex(x => x.Name == n)
+                                                              NodeIndexResolver = n => modelPack.Models[Options.PackedModel.ReplaceMotionModelIndex].Nodes.FindIndex(x => x.Name == n),
+                                                              Compression = null
                                                           });
 
+                            var motionPack = modelPack.MotionPacks[Options.PackedModel.ReplaceMotionPackIndex];
+                            var otherMotionsSize = motionPack.Motions.Where((x, i) => x != null && i != Options.PackedModel.ReplaceMotionIndex)
+                                                                     .Sum(x => KeyframeCompressor.GetSize(x));
+                            var report = KeyframeCompressor.Compress(newMotion, new KeyframeCompressionOptions
+                            {
+                                PositionTolerance = Options.Assimp.MotionPositionTolerance,
+                                RotationTolerance = Options.Assimp.MotionRotationTolerance,
+                                ScaleTolerance = Options.Assimp.MotionScaleTolerance
+                            });
+
+                            Console.WriteLine($"Motion: {report}");
+                            Console.WriteLine($"Motion pack {Options.PackedModel.ReplaceMotionPackIndex}: {otherMotionsSize + report.SizeBefore} -> " +
+                                              $"{otherMotionsSize + report.SizeAfter} bytes of keyframe data");
+
                             if (Options.PackedModel.ReplaceMotionIndex < 0 || (Options.PackedModel.ReplaceMotionIndex + 1) >
                                 modelPack.MotionPacks[Options.PackedModel.ReplaceMotionPackIndex].Motions.Count)
                             {
@@ -274,8 +416,12 @@ namespace DDS3ModelConverter
                         var model = new Model();
                         model.Nodes.Add(new Node { Name = "model" });
                         modelPack.Models.Add(model);
-                        modelPack.Replace(Options.Input, Options.TmxScale, Options.Model.EnableMaterialOverlays,
-                            Options.Model.WeightedMeshType, Options.Model.UnweightedMeshType, Options.Model.MeshWeightLimit, Options.Model.BatchVertexLimit);
+                        var importReport = modelPack.Replace(Options.Input, Options.TmxScale, Options.Model.EnableMaterialOverlays,
+                            Options.Model.WeightedMeshType, Options.Model.UnweightedMeshType, Options.Model.MeshWeightLimit, Options.Model.BatchVertexLimit,
+                            CreateImportCache(), Options.Model.MipMapCount, !Options.Model.SkipBatchOptimization, Options.Model.PrintStatistics);
+
+                        if (Options.Model.PrintStatistics)
+                            Console.WriteLine($"Model: {importReport}");
 
                         var lb = new LBFileSystem();
                         lb.Load(Options.Field.LbReplaceInput);
@@ -290,6 +436,13 @@ namespace DDS3ModelConverter
                         f1.Objects.Clear();
                         f1.Objects.Add(new FieldObject() { Id = 0, Name = "model", Transform = new FieldObjectTransform(), Resource = modelPack.Models[0] });
 
+                        // The texture pack only belongs to this field, so its textures can be packed and the texture coordinates rewritten
+                        if (Options.Field.BuildTextureAtlas && modelPack.TexturePack != null)
+                        {
+                            var atlasReport = new TextureAtlasBuilder().Build(f1, modelPack.TexturePack);
+                            Console.WriteLine($"Texture atlas: {atlasReport}");
+                        }
+
                         lb.AddFile(f1Handle, f1.Save(), true, ConflictPolicy.Replace);
 
                         if (modelPack.TexturePack != null)
@@ -306,87 +459,115 @@ namespace DDS3ModelConverter
             }
         }
 
-        static bool ParseArgs(string[] args)
+        internal static bool ParseArgs(string[] args)
         {
             try
             {
                 Options = SimpleCommandLineParser.Default.Parse<ProgramOptions>(args);
 
-                //-- Validate given input
-
-                if (string.IsNullOrEmpty(Options.Input))
-                {
-                    // Use first argument as input when not specified explicitly
-                    if (args.Length > 0)
-                        Options.Input = args[0];
-                    else
-                        return false;
-                }
+                // Batch runs resolve the inputs and outputs of each job themselves
+                if (Options.Batch.IsEnabled)
+                    return true;
 
-                if (Options.InputFormat == InputFormat.Unknown)
-                {
-                    // Guess input format based on extension
-                    var ext = Path.GetExtension(Options.Input);
-                    Options.InputFormat = (InputFormat)Enum.Parse(typeof(InputFormat), ext
-                        .TrimStart('.')
-                        .ToLower(), true);
-                }
+                return ResolveInputOutput(args);
+            }
+            catch (Exception e)
+            {
+                Console.WriteLine(e.Message);
+                return false;
+            }
+        }
 
-                if (string.IsNullOrEmpty(Options.Output))
-                {
-                    // Guess output format based on input format
-                    var ext = string.Empty;
-                    switch (Options.InputFormat)
-                    {
-                        case InputFormat.PB:
-                        case InputFormat.MB:
-                        case InputFormat.F1:
-                            ext = ".fbx";
-                            Options.OutputFormat = OutputFormat.FBX;
-                            break;
-                        case InputFormat.TB:
-                            ext = null;
-                            Options.OutputFormat = OutputFormat.Folder;
-                            break;
-                        case InputFormat.OBJ:
-                            ext = ".f1";
-                            Options.OutputFormat = OutputFormat.F1;
-                            break;
-                        case InputFormat.DAE:
-                        case InputFormat.FBX:
-                            ext = ".pb";
-                            Options.OutputFormat = OutputFormat.FBX;
-                            break;
-                        default:
-                            return false;
-                    }
+        /// <summary>
+        /// Fills in the input, output and formats the options don't specify.
+        /// </summary>
+        internal static bool ResolveInputOutput(string[] args)
+        {
+            //-- Validate given input
 
-                    var dirPath = Path.Combine(Path.GetDirectoryName(Options.Input), Path.GetFileNameWithoutExtension(Options.Input));
-                    if (ext != null)
-                        Options.Output = Path.Combine(dirPath, Path.GetFileNameWithoutExtension(Options.Input) + ext);
-                    else
-                        Options.Output = dirPath;
+            if (string.IsNullOrEmpty(Options.Input))
+            {
+                // Use first argument as input when not specified explicitly
+                if (args.Length > 0)
+                    Options.Input = args[0];
+                else
+                    return false;
+            }
 
-                    Directory.CreateDirectory(dirPath);
-                }
+            if (Options.InputFormat == InputFormat.Unknown)
+            {
+                // Guess input format based on extension
+                var ext = Path.GetExtension(Options.Input);
+                Options.InputFormat = (InputFormat)Enum.Parse(typeof(InputFormat), ext
+                    .TrimStart('.')
+                    .ToLower(), true);
+            }
 
-                if (Options.OutputFormat == OutputFormat.Unknown)
+            if (string.IsNullOrEmpty(Options.Output))
+            {
+                // Guess output format based on input format
+                var ext = string.Empty;
+                switch (Options.InputFormat)
                 {
-                    var ext = Path.GetExtension(Options.Output);
-                    if (string.IsNullOrEmpty(ext))
+                    case InputFormat.PB:
+                    case InputFormat.MB:
+                    case InputFormat.F1:
+                        ext = ".fbx";
+                        Options.OutputFormat = OutputFormat.FBX;
+                        break;
+                    case InputFormat.TB:
+                        ext = null;
                         Options.OutputFormat = OutputFormat.Folder;
-                    else
-                        Options.OutputFormat = (OutputFormat)Enum.Parse(typeof(OutputFormat), ext
-                            .TrimStart('.')
-                            .ToLower(), true);
+                        break;
+                    case InputFormat.OBJ:
+                        ext = ".f1";
+                        Options.OutputFormat = OutputFormat.F1;
+                        break;
+                    case InputFormat.DAE:
+                    case InputFormat.FBX:
+                        ext = ".pb";
+                        Options.OutputFormat = OutputFormat.FBX;
+                        break;
+                    default:
+                        return false;
                 }
 
-                return true;
+                var dirPath = Path.Combine(Path.GetDirectoryName(Options.Input), Path.GetFileNameWithoutExtension(Options.Input));
+                if (ext != null)
+                    Options.Output = Path.Combine(dirPath, Path.GetFileNameWithoutExtension(Options.Input) + ext);
+                else
+                    Options.Output = dirPath;
+
+                Directory.CreateDirectory(dirPath);
             }
-            catch (Exception e)
+
+            if (Options.OutputFormat == OutputFormat.Unknown)
             {
-                Console.WriteLine(e.Message);
-                return false;
+                var ext = Path.GetExtension(Options.Output);
+                if (string.IsNullOrEmpty(ext))
+                    Options.OutputFormat = OutputFormat.Folder;
+                else
+                    Options.OutputFormat = (OutputFormat)Enum.Parse(typeof(OutputFormat), ext
+                        .TrimStart('.')
+                        .ToLower(), true);
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Creates the FBX exporter settings apart from <see cref="Program"/>, as referencing them loads the native FBX exporter.
+        /// </summary>
+        private static class FbxSettings
+        {
+            public static FbxModelExporterConfig Create()
+            {
+                return new FbxModelExporterConfig()
+                {
+                    ConvertBlendShapesToMeshes = !Options.Assimp.ExportBlendShapes,
+                    ExportMultipleUvLayers = true,
+                    MergeMode = (FbxMeshMergeMode)Options.Assimp.MergeMode
+                };
             }
         }
     }
@@ -402,9 +583,12 @@ namespace DDS3ModelConverter
         [Option("o", "output", "filepath", "Specifies the path to the file to save the output to.")]
         public string Output { get; set; }
 
-        [Option("of", "output-format", "auto|pb|mb|f1|obj|dae|fbx", "Specifies the conversion output format.")]
+        [Option("of", "output-format", "auto|pb|mb|f1|obj|dae|fbx|glb", "Specifies the conversion output format.")]
         public OutputFormat OutputFormat { get; set; }
 
+        [Option("ic", "import-cache", "directory path", "Specifies the directory imported models and textures are cached in, so unchanged inputs are converted faster.")]
+        public string ImportCache { get; set; }
+
         [Group("ai")]
         public AssimpOptions Assimp { get; set; }
 
@@ -420,13 +604,31 @@ namespace DDS3ModelConverter
         [Group("f1")]
         public FieldOptions Field { get; set; }
 
+        [Group("bt")]
+        public BatchOptions Batch { get; set; }
+
         public class AssimpOptions
         {
             [Option("a", "input-anim", "When specified, the input is treated as an animation file, rather than a model file which affects the conversion process.")]
             public bool TreatInputAsAnimation { get; set; }
 
-            [Option("pbm", "output-pb-motion", "When specified, motions found within the given packed model file are exported when exporting a PB model obj/dae/fbx.")]
+            [Option("pbm", "output-pb-motion", "When specified, motions found within the given packed model file are exported when exporting a PB model obj/dae/fbx/glb.")]
             public bool OutputPbMotion { get; set; }
+
+            [Option("bs", "blend-shapes", "When specified, morphs are exported to dae/fbx as sparse blend shapes instead of a separate mesh per shape.")]
+            public bool ExportBlendShapes { get; set; }
+
+            [Option("mm", "merge-meshes", "none|pernode|permaterial|model", "Specifies which meshes are merged when exporting to dae/fbx. Merged meshes have one contiguous group per material.", DefaultValue = MeshMergeMode.Model)]
+            public MeshMergeMode MergeMode { get; set; }
+
+            [Option("mpt", "motion-position-tolerance", "decimal distance", "Specifies how far imported motion positions may deviate when removing redundant keys.", DefaultValue = 0.01f)]
+            public float MotionPositionTolerance { get; set; }
+
+            [Option("mrt", "motion-rotation-tolerance", "decimal degrees", "Specifies how far imported motion rotations may deviate when removing redundant keys.", DefaultValue = 0.1f)]
+            public float MotionRotationTolerance { get; set; }
+
+            [Option("mst", "motion-scale-tolerance", "decimal difference", "Specifies how far imported motion scales may deviate when removing redundant keys.", DefaultValue = 0.001f)]
+            public float MotionScaleTolerance { get; set; }
         }
         public class PackedModelOptions
         {
@@ -462,12 +664,59 @@ namespace DDS3ModelConverter
 
             [Option("vl", "batch-vertex-limit", "integer", "Specifies the max number of vertices to be used per batch.", DefaultValue = 24)]
             public int BatchVertexLimit { get; set; }
+
+            [Option("mip", "mipmap-count", "integer", "Specifies the number of mipmap levels generated for imported textures. -1 generates as many as the texture dimensions allow.", DefaultValue = 0)]
+            public int MipMapCount { get; set; }
+
+            [Option("nbo", "no-batch-optimization", "When specified, the triangles and vertices of imported batches are kept in their original order.")]
+            public bool SkipBatchOptimization { get; set; }
+
+            [Option("st", "statistics", "When specified, prints the batch statistics of imported models.")]
+            public bool PrintStatistics { get; set; }
         }
 
         public class FieldOptions
         {
             [Option("lbi", "lb-replace-input", "filepath", "Specifies the base field LB file to use for the conversion.")]
             public string LbReplaceInput { get; set; }
+
+            [Option("s", "scene", "When specified, the field is exported as a single dae/fbx scene in which objects using the same model instance a single copy of it.")]
+            public bool ExportScene { get; set; }
+
+            [Option("tbi", "texture-input", "filepath", "Specifies the texture pack used by the field models, which is exported once and shared by the whole scene.")]
+            public string TextureInput { get; set; }
+
+            [Option("ta", "texture-atlas", "When specified, small textures of an imported field model are packed into shared texture pages, and the atlas report is printed.")]
+            public bool BuildTextureAtlas { get; set; }
+        }
+
+        public class BatchOptions
+        {
+            [Option("m", "manifest", "filepath", "Specifies a file listing one conversion per line, each written as the arguments of a single conversion.")]
+            public string Manifest { get; set; }
+
+            [Option("g", "glob", "directory\\pattern", "Specifies the files to convert as a directory and a file name pattern, e.g. models\\*.PB.")]
+            public string Glob { get; set; }
+
+            [Option("r", "recursive", "When specified, the glob pattern also matches files in subdirectories.")]
+            public bool Recursive { get; set; }
+
+            [Option("o", "output-pattern", "path pattern", "Specifies the output path of each globbed file. {dir} is replaced with the directory relative to the glob directory, {name} with the file name and {ext} with the extension.")]
+            public string OutputPattern { get; set; }
+
+            [Option("s", "stdin", "When specified, keeps running and reads conversions from stdin, one per line, until the input ends.")]
+            public bool Stdin { get; set; }
+
+            [Option("j", "jobs", "integer", "Specifies the max number of conversions to run at the same time. Defaults to the number of processors.")]
+            public int MaxParallelism { get; set; }
+
+            [Option("ml", "memory-limit", "megabytes", "Specifies how much memory a single conversion may use. New conversions wait until the memory in use leaves room for them.")]
+            public int MemoryLimit { get; set; }
+
+            [Option("rp", "report", "filepath", "Specifies the file the JSON lines report is written to, instead of stdout.")]
+            public string Report { get; set; }
+
+            public bool IsEnabled => Manifest != null || Glob != null || Stdin;
         }
     }
 }
@@ -23,7 +23,7 @@
 
 // TODO: 
 // - cache converted node world transform
-// - export animations
+// - export morph controllers
 // - fix vertex colors in max
 // - add unique names to root bones to prevent name clashes?
 
@@ -49,6 +49,7 @@ namespace DDS3ModelLibrary::Models::Conversion
 		mConvertedNodes = gcnew List<IntPtr>();
 		mMaterialCache = gcnew Dictionary<int, IntPtr>();
 		mTextureCache = gcnew Dictionary<int, IntPtr>();
+		mSkippedControllers = gcnew List<String^>();
 	}
 
 	FbxModelExporter::~FbxModelExporter()
@@ -63,16 +64,89 @@ namespace DDS3ModelLibrary::Models::Conversion
 		mConvertedNodes->Clear();
 		mMaterialCache->Clear();
 		mTextureCache->Clear();
+		mSkippedControllers->Clear();
 	}
 
 	void FbxModelExporter::Export( Model^ model, String^ path, FbxModelExporterConfig^ config, TexturePack^ textures )
+	{
+		Export( model, path, config, textures, nullptr );
+	}
+
+	void FbxModelExporter::Export( Model^ model, String^ path, FbxModelExporterConfig^ config, TexturePack^ textures, IList<MotionPack^>^ motionPacks )
+	{
+		Reset();
+
+		mConfig = config;
+		mOutDir = System::IO::Path::GetDirectoryName( path );
+		SetupFbxIOSettings();
+
+		// Create scene for model
+		auto fScene = ConvertModelToFbxScene( model, textures );
+
+		// Animate the nodes of the scene
+		if ( motionPacks != nullptr )
+			ConvertMotionPacksToFbxAnimStacks( model, motionPacks, fScene );
+
+		// Export the scene to the file
+		ExportFbxScene( fScene, path );
+	}
+
+	void FbxModelExporter::Export( FieldScene^ scene, String^ path, FbxModelExporterConfig^ config, TexturePack^ textures )
 	{
 		Reset();
 
 		mConfig = config;
 		mOutDir = System::IO::Path::GetDirectoryName( path );
+		SetupFbxIOSettings();
+
+		auto fScene = CreateFbxScene();
+
+		// Textures are written once for the whole scene, materials of all models share the texture cache
+		if ( textures )
+			ExportTextures( textures );
+
+		// Models are read once per offset, so objects using the same model data reference the same instance
+		auto modelMeshNodes = gcnew Dictionary<Model^, List<IntPtr>^>();
+		for ( int i = 0; i < scene->Objects->Count; i++ )
+		{
+			auto obj = scene->Objects[ i ];
+			if ( obj->ResourceType != FieldObjectResourceType::Model || obj->Resource == nullptr )
+				continue;
+
+			auto model = (Model^)obj->Resource;
+			auto fObjectNode = FbxNode::Create( fScene, Utf8String( FormatObjectName( obj, i ) ).ToCStr() );
+			if ( obj->Transform != nullptr )
+			{
+				auto transform = obj->Transform->Matrix;
+				auto fTransform = ConvertNumericsMatrix4x4ToFbxAMatrix( transform );
+				auto fTranslation = fTransform.GetT();
+				auto fRotation = fTransform.GetR();
+				auto fScale = fTransform.GetS();
+				fObjectNode->LclTranslation.Set( FbxDouble3( fTranslation[ 0 ], fTranslation[ 1 ], fTranslation[ 2 ] ) );
+				fObjectNode->LclRotation.Set( FbxDouble3( fRotation[ 0 ], fRotation[ 1 ], fRotation[ 2 ] ) );
+				fObjectNode->LclScaling.Set( FbxDouble3( fScale[ 0 ], fScale[ 1 ], fScale[ 2 ] ) );
+			}
+
+			fScene->GetRootNode()->AddChild( fObjectNode );
+			fScene->GetPose( 0 )->Add( fObjectNode, fObjectNode->EvaluateGlobalTransform() );
+
+			List<IntPtr>^ meshNodes;
+			if ( modelMeshNodes->TryGetValue( model, meshNodes ) )
+			{
+				InstanceFbxMeshNodes( meshNodes, fScene, fObjectNode );
+			}
+			else
+			{
+				meshNodes = ConvertFieldModelToFbxMeshNodes( model, modelMeshNodes->Count, textures, fScene, fObjectNode );
+				modelMeshNodes->Add( model, meshNodes );
+			}
+		}
+
+		ExportFbxScene( fScene, path );
+	}
 
-		// Create IO settings
+	void FbxModelExporter::SetupFbxIOSettings()
+	{
 		auto fIos = FbxIOSettings::Create( mManager, IOSROOT );
 		fIos->SetBoolProp( EXP_FBX_MATERIAL, true );
 		fIos->SetBoolProp( EXP_FBX_TEXTURE, true );
@@ -82,17 +156,10 @@ namespace DDS3ModelLibrary::Models::Conversion
 		fIos->SetBoolProp( EXP_FBX_ANIMATION, true );
 		fIos->SetBoolProp( EXP_FBX_GLOBAL_SETTINGS, true );
 		mManager->SetIOSettings( fIos );
-
-		// Create scene for model
-		auto fScene = ConvertModelToFbxScene( model, textures );
-
-		// Export the scene to the file
-		ExportFbxScene( fScene, path );
 	}
 
-	FbxScene* FbxModelExporter::ConvertModelToFbxScene( Model^ model, TexturePack^ textures )
+	FbxScene* FbxModelExporter::CreateFbxScene()
 	{
-		// Create FBX scene
 		auto fScene = FbxScene::Create( mManager, "" );
 		if ( !fScene )
 			gcnew Exception( "Failed to create FBX scene" );
@@ -101,26 +168,35 @@ namespace DDS3ModelLibrary::Models::Conversion
 		fGlobalSettings.SetAxisSystem( FbxAxisSystem::DirectX );
 		fGlobalSettings.SetSystemUnit( FbxSystemUnit::m );
 
-		if ( textures )
+		// 3ds Max a bind pose. The name is taken from it as well.
+		auto fBindPose = FbxPose::Create( fScene, "BIND_POSES" );
+		fBindPose->SetIsBindPose( true );
+		fScene->AddPose( fBindPose );
+		return fScene;
+	}
+
+	void FbxModelExporter::ExportTextures( TexturePack^ textures )
+	{
+		for ( size_t i = 0; i < textures->Count; i++ )
 		{
-			// Export textures
-			for ( size_t i = 0; i < textures->Count; i++ )
-			{
-				auto textureName = FormatTextureName( textures, nullptr, i );
-				textures[ i ]->GetBitmap( 0, 0 )->Save(
-					System::IO::Path::Combine( mOutDir, textureName + ".png" ) );
-			}
+			auto textureName = FormatTextureName( textures, nullptr, i );
+			textures[ i ]->GetBitmap( 0, 0 )->Save(
+				System::IO::Path::Combine( mOutDir, textureName + ".png" ) );
 		}
+	}
+
+	FbxScene* FbxModelExporter::ConvertModelToFbxScene( Model^ model, TexturePack^ textures )
+	{
+		// Create FBX scene
+		auto fScene = CreateFbxScene();
+
+		if ( textures )
+			ExportTextures( textures );
 
 		// Convert materials
 		for ( size_t i = 0; i < model->Materials->Count; i++ )
 			ConvertMaterialToFbxSurfacePhong( fScene, model, model->Materials[ i ], textures, i );
 
-		// 3ds Max a bind pose. The name is taken from it as well.
-		auto fBindPose = FbxPose::Create( fScene, "BIND_POSES" );
-		fBindPose->SetIsBindPose( true );
-		fScene->AddPose( fBindPose );
-
 		// Create nodes first so all nodes are created while populating
 		BuildNodeToFbxNodeMapping( model, fScene );
 
@@ -142,38 +218,96 @@ namespace DDS3ModelLibrary::Models::Conversion
 		for ( size_t i = 0; i < meshes->Count; i++ )
 		{
 			auto mesh = meshes[ i ];
-			int faceCount = 0;
-			for ( size_t j = 0; j < mesh->Groups->Length; j++ )
-				faceCount += mesh->Groups[ j ].Triangles->Length;
-
 			auto fMeshNode = CreateFbxNodeForMesh( fScene, Utf8String( String::Format( "mesh_{0}", i ) ).ToCStr() );
-			auto work = gcnew MeshConversionContext();
-			work->Mesh = FbxMesh::Create( fMeshNode, "" );
-			fMeshNode->SetNodeAttribute( work->Mesh );
-			work->Mesh->InitControlPoints( mesh->Vertices->Length );
-			work->ControlPoints = work->Mesh->GetControlPoints();
-			work->ElementNormal = mesh->Normals ? CreateFbxMeshElementNormal( work->Mesh ) : nullptr;
-			work->ElementMaterial = CreateFbxElementMaterial( work->Mesh );
-			work->ElementColor = mesh->Colors ? CreateFbxMeshElementVertexColor( work->Mesh ) : nullptr;
-			work->ElementUV = mesh->UV1 ? CreateFbxMeshElementUV( work->Mesh, "UVChannel_1", 0 ) : nullptr;
-			work->ElementUV2 = mesh->UV2 ? CreateFbxMeshElementUV( work->Mesh, "UVChannel_2", 1 ) : nullptr;
+			auto work = CreateMeshConversionContext( fMeshNode, mesh, true );
+			ConvertProcessedMeshToFbxMesh( model, mesh, work, 0 );
+		}
 
+		return fScene;
+	}
+
+	MeshConversionContext^ FbxModelExporter::CreateMeshConversionContext( FbxNode* fMeshNode, GenericMesh^ mesh, bool skinned )
+	{
+		auto work = gcnew MeshConversionContext();
+		work->Mesh = FbxMesh::Create( fMeshNode, "" );
+		fMeshNode->SetNodeAttribute( work->Mesh );
+		work->Mesh->InitControlPoints( mesh->Vertices->Length );
+		work->ControlPoints = work->Mesh->GetControlPoints();
+		work->ElementNormal = mesh->Normals ? CreateFbxMeshElementNormal( work->Mesh ) : nullptr;
+		work->ElementMaterial = CreateFbxElementMaterial( work->Mesh );
+		work->ElementColor = mesh->Colors ? CreateFbxMeshElementVertexColor( work->Mesh ) : nullptr;
+		work->ElementUV = mesh->UV1 ? CreateFbxMeshElementUV( work->Mesh, "UVChannel_1", 0 ) : nullptr;
+		work->ElementUV2 = mesh->UV2 ? CreateFbxMeshElementUV( work->Mesh, "UVChannel_2", 1 ) : nullptr;
+
+		if ( skinned )
+		{
 			work->Skin = FbxSkin::Create( work->Mesh, "" );
 			work->Skin->SetSkinningType( FbxSkin::EType::eLinear );
 			work->Mesh->AddDeformer( work->Skin );
 			work->ClusterLookup = gcnew Dictionary<int, IntPtr>();
+		}
 
-			if ( mesh->BlendShapes )
-			{
-				work->BlendShape = FbxBlendShape::Create( work->Mesh, "" );
-				work->BlendShape->SetGeometry( work->Mesh );
-				work->Mesh->AddDeformer( work->BlendShape );
-			}
-			
-			ConvertProcessedMeshToFbxMesh( model, mesh, work, 0 );
+		if ( mesh->BlendShapes )
+		{
+			work->BlendShape = FbxBlendShape::Create( work->Mesh, "" );
+			work->BlendShape->SetGeometry( work->Mesh );
+			work->Mesh->AddDeformer( work->BlendShape );
 		}
 
-		return fScene;
+		return work;
+	}
+
+	List<IntPtr>^ FbxModelExporter::ConvertFieldModelToFbxMeshNodes( Model^ model, int modelIndex, TexturePack^ textures, FbxScene* fScene, FbxNode* fParentNode )
+	{
+		// Materials are converted per model, the material names are prefixed to keep them unique within the scene
+		mMaterialCache->Clear();
+		for ( int i = 0; i < model->Materials->Count; i++ )
+		{
+			ConvertMaterialToFbxSurfacePhong( fScene, model, model->Materials[ i ], textures, i );
+			auto fMaterial = (FbxSurfaceMaterial*)mMaterialCache[ i ].ToPointer();
+			fMaterial->SetName( Utf8String( String::Format( "model_{0}_{1}", modelIndex, FormatMaterialName( model, model->Materials[ i ] ) ) ).ToCStr() );
+		}
+
+		auto meshes = gcnew List<GenericMesh^>();
+		for ( int i = 0; i < model->Nodes->Count; i++ )
+			ProcessNodeMeshes( model, model->Nodes[ i ], meshes );
+
+		if ( mConfig->MergeMeshes && meshes->Count > 0 )
+			MergeMeshes( meshes, model );
+
+		if ( mConfig->ConvertBlendShapesToMeshes )
+			ConvertBlendShapesToMeshes( meshes, model );
+
+		// Meshes are already in model space, so they're placed directly under the object node without a skeleton
+		auto meshNodes = gcnew List<IntPtr>( meshes->Count );
+		for ( int i = 0; i < meshes->Count; i++ )
+		{
+			auto fMeshNode = FbxNode::Create( fScene, Utf8String( String::Format( "model_{0}_mesh_{1}", modelIndex, i ) ).ToCStr() );
+			fParentNode->AddChild( fMeshNode );
+			fScene->GetPose( 0 )->Add( fMeshNode, fMeshNode->EvaluateGlobalTransform() );
+
+			auto work = CreateMeshConversionContext( fMeshNode, meshes[ i ], false );
+			ConvertProcessedMeshToFbxMesh( model, meshes[ i ], work, 0 );
+			meshNodes->Add( (IntPtr)fMeshNode );
+		}
+
+		return meshNodes;
+	}
+
+	void FbxModelExporter::InstanceFbxMeshNodes( List<IntPtr>^ meshNodes, FbxScene* fScene, FbxNode* fParentNode )
+	{
+		for ( int i = 0; i < meshNodes->Count; i++ )
+		{
+			// The new node shares the mesh of the converted node, only the node and its material connections are added
+			auto fSourceNode = (FbxNode*)meshNodes[ i ].ToPointer();
+			auto fMeshNode = FbxNode::Create( fScene, fSourceNode->GetName() );
+			fMeshNode->SetNodeAttribute( fSourceNode->GetNodeAttribute() );
+			for ( int j = 0; j < fSourceNode->GetMaterialCount(); j++ )
+				fMeshNode->AddMaterial( fSourceNode->GetMaterial( j ) );
+
+			fParentNode->AddChild( fMeshNode );
+			fScene->GetPose( 0 )->Add( fMeshNode, fMeshNode->EvaluateGlobalTransform() );
+		}
 	}
 
 	void FbxModelExporter::ConvertBlendShapesToMeshes( List<GenericMesh^>^ meshes, Model^ model )
@@ -209,44 +343,101 @@ namespace DDS3ModelLibrary::Models::Conversion
 
 	void FbxModelExporter::MergeMeshes( List<GenericMesh^>^& meshes, Model^ model )
 	{
-		auto newMeshes = gcnew List<GenericMesh^>( 2 );
+		// Bucket the meshes by merge key, in order of first appearance. Meshes with blend shapes are kept as is.
+		auto keys = gcnew List<int>();
+		auto buckets = gcnew Dictionary<int, List<GenericMesh^>^>();
+		int indexCount = 0;
+		for ( int i = 0; i < meshes->Count; i++ )
+		{
+			auto mesh = meshes[ i ];
+			if ( mesh->BlendShapes ) continue;
+
+			int key = 0;
+			if ( mConfig->MergeMode == FbxMeshMergeMode::PerNode )
+				key = model->Nodes->IndexOf( mesh->ParentNode );
+			else if ( mConfig->MergeMode == FbxMeshMergeMode::PerMaterial )
+				key = mesh->Groups[ 0 ].MaterialIndex; // Unmerged meshes have a single group
 
+			List<GenericMesh^>^ bucket;
+			if ( !buckets->TryGetValue( key, bucket ) )
+			{
+				bucket = gcnew List<GenericMesh^>();
+				buckets->Add( key, bucket );
+				keys->Add( key );
+			}
+
+			bucket->Add( mesh );
+			for ( int j = 0; j < mesh->Groups->Length; j++ )
+				indexCount += mesh->Groups[ j ].Triangles->Length * 3;
+		}
+
+		// The indices of all merged meshes are stored in one buffer that is reused between exports
+		if ( !mIndexArena || mIndexArena->Length < indexCount )
+			mIndexArena = gcnew array<int>( Math::Max( indexCount, mIndexArena ? mIndexArena->Length * 2 : 0 ) );
+
+		auto newMeshes = gcnew List<GenericMesh^>( keys->Count + 1 );
+		int indexOffset = 0;
+		for ( int i = 0; i < keys->Count; i++ )
+		{
+			auto bucket = buckets[ keys[ i ] ];
+			auto parentNode = mConfig->MergeMode == FbxMeshMergeMode::PerNode ? bucket[ 0 ]->ParentNode : model->Nodes[ 0 ];
+			newMeshes->Add( MergeMeshGroup( bucket, parentNode, model, indexOffset ) );
+		}
+
+		// add blend shape meshes as-is
+		for ( int i = 0; i < meshes->Count; i++ )
+		{
+			if ( !meshes[ i ]->BlendShapes ) continue;
+			newMeshes->Add( meshes[ i ] );
+		}
+
+		meshes = newMeshes;
+	}
+
+	GenericMesh^ FbxModelExporter::MergeMeshGroup( List<GenericMesh^>^ meshes, Node^ parentNode, Model^ model, int% indexOffset )
+	{
 		// calculate vertex count
 		int vertexCount = 0;
-		int groupCount = 0;
 		bool usesNormals = false, usesColors = false, usesUV1 = false, 
 			usesUV2 = false, usesWeights = false;
-		for ( size_t i = 0; i < meshes->Count; i++ )
+		auto materialIndices = gcnew List<int>();
+		for ( int i = 0; i < meshes->Count; i++ )
 		{
-			if ( meshes[ i ]->BlendShapes ) continue;
-			vertexCount += meshes[ i ]->Vertices->Length;
-			groupCount += meshes[ i ]->Groups->Length;
-			if ( meshes[ i ]->Normals ) usesNormals = true;
-			if ( meshes[ i ]->Colors ) usesColors = true;
-			if ( meshes[ i ]->UV1 ) usesUV1 = true;
-			if ( meshes[ i ]->UV2 ) usesUV2 = true;
-			if ( meshes[ i ]->Weights ) usesWeights = true;
+			auto mesh = meshes[ i ];
+			vertexCount += mesh->Vertices->Length;
+			if ( mesh->Normals ) usesNormals = true;
+			if ( mesh->Colors ) usesColors = true;
+			if ( mesh->UV1 ) usesUV1 = true;
+			if ( mesh->UV2 ) usesUV2 = true;
+
+			// Rigid meshes of other nodes need weights to stay bound to their own node
+			if ( mesh->Weights || mesh->ParentNode != parentNode ) usesWeights = true;
+
+			for ( int j = 0; j < mesh->Groups->Length; j++ )
+			{
+				if ( !materialIndices->Contains( mesh->Groups[ j ].MaterialIndex ) )
+					materialIndices->Add( mesh->Groups[ j ].MaterialIndex );
+			}
 		}
 
-		// build merged mesh
+		// build merged mesh, the source arrays are only copied from so the model is left untouched
 		auto mergedMesh = gcnew GenericMesh();
-		mergedMesh->ParentNode = model->Nodes[ 0 ];
+		mergedMesh->ParentNode = parentNode;
 		mergedMesh->Vertices = gcnew array<Vector3>( vertexCount );
 		mergedMesh->Normals = usesNormals ? gcnew array<Vector3>( vertexCount ) : nullptr;
 		mergedMesh->Colors = usesColors ? gcnew array<Color>( vertexCount ) : nullptr;
 		mergedMesh->UV1 = usesUV1 ? gcnew array<Vector2>( vertexCount ) : nullptr;
 		mergedMesh->UV2 = usesUV2 ? gcnew array<Vector2>( vertexCount ) : nullptr;
 		mergedMesh->Weights = usesWeights ? gcnew array<array<NodeWeight>^>( vertexCount ) : nullptr;
-		mergedMesh->Groups = gcnew array<GenericPrimitiveGroup>( groupCount );
-		newMeshes->Add( mergedMesh );
+		mergedMesh->Groups = gcnew array<GenericPrimitiveGroup>( materialIndices->Count );
+		mergedMesh->Indices = mIndexArena;
 
-		// merge meshes
+		auto vertexOffsets = gcnew array<int>( meshes->Count );
 		int vertexOffset = 0;
-		int groupOffset = 0;
-		for ( size_t i = 0; i < meshes->Count; i++ )
+		for ( int i = 0; i < meshes->Count; i++ )
 		{
-			if ( meshes[ i ]->BlendShapes ) continue;
 			auto mesh = meshes[ i ];
+			vertexOffsets[ i ] = vertexOffset;
 
 			Array::Copy( mesh->Vertices, 0, mergedMesh->Vertices, vertexOffset, mesh->Vertices->Length );
 			if ( mesh->Normals ) Array::Copy( mesh->Normals, 0, mergedMesh->Normals, vertexOffset, mesh->Normals->Length );
@@ -259,40 +450,45 @@ namespace DDS3ModelLibrary::Models::Conversion
 			{
 				// generate weights
 				auto nodeIndex = model->Nodes->IndexOf( mesh->ParentNode );
-				for ( size_t i = 0; i < mesh->Vertices->Length; i++ )
+				for ( int j = 0; j < mesh->Vertices->Length; j++ )
 				{
-					auto weights = mergedMesh->Weights[ vertexOffset + i ] = gcnew array<NodeWeight>( 1 );
+					auto weights = mergedMesh->Weights[ vertexOffset + j ] = gcnew array<NodeWeight>( 1 );
 					weights[ 0 ].NodeIndex = nodeIndex;
 					weights[ 0 ].Weight = 1;
 				}
 			}
 
-			Array::Copy( mesh->Groups, 0, mergedMesh->Groups, groupOffset, mesh->Groups->Length );
-			for ( size_t j = 0; j < mesh->Groups->Length; j++ )
+			vertexOffset += mesh->Vertices->Length;
+		}
+
+		// coalesce the triangles of each material into one contiguous range
+		for ( int i = 0; i < materialIndices->Count; i++ )
+		{
+			auto% grp = mergedMesh->Groups[ i ];
+			grp.MaterialIndex = materialIndices[ i ];
+			grp.IndexStart = indexOffset;
+
+			for ( int j = 0; j < meshes->Count; j++ )
 			{
-				// adjust vertex indices
-				auto% grp = mergedMesh->Groups[ groupOffset + j ];
-				for ( size_t k = 0; k < grp.Triangles->Length; k++ )
+				auto mesh = meshes[ j ];
+				for ( int k = 0; k < mesh->Groups->Length; k++ )
 				{
-					grp.Triangles[ k ].A += vertexOffset;
-					grp.Triangles[ k ].B += vertexOffset;
-					grp.Triangles[ k ].C += vertexOffset;
+					if ( mesh->Groups[ k ].MaterialIndex != grp.MaterialIndex ) continue;
+
+					auto triangles = mesh->Groups[ k ].Triangles;
+					for ( int l = 0; l < triangles->Length; l++ )
+					{
+						mIndexArena[ indexOffset++ ] = vertexOffsets[ j ] + triangles[ l ].A;
+						mIndexArena[ indexOffset++ ] = vertexOffsets[ j ] + triangles[ l ].B;
+						mIndexArena[ indexOffset++ ] = vertexOffsets[ j ] + triangles[ l ].C;
+					}
 				}
 			}
 
-			vertexOffset += mesh->Vertices->Length;
-			groupOffset += mesh->Groups->Length;
+			grp.IndexCount = indexOffset - grp.IndexStart;
 		}
 
-		// add blend shape meshes as-is
-		for ( size_t i = 0; i < meshes->Count; i++ )
-		{
-			if ( !meshes[ i ]->BlendShapes ) continue;
-			newMeshes->Add( meshes[ i ] );
-		}
-
-		meshes->Clear();
-		meshes = newMeshes;
+		return mergedMesh;
 	}
 
 	FbxNode* FbxModelExporter::CreateFbxNodeForMesh( FbxScene* fScene, const char* name )
@@ -314,19 +510,24 @@ namespace DDS3ModelLibrary::Models::Conversion
 		if ( mesh->UV1 ) ConvertTexCoordsToFbxLayerElementUVDirectArray( work->ElementUV, mesh->UV1, vertexStart );
 		if ( mesh->UV2 ) ConvertTexCoordsToFbxLayerElementUVDirectArray( work->ElementUV2, mesh->UV2, vertexStart );
 
-		if ( mesh->Weights )
+		// Meshes without a skin are left in model space
+		if ( work->Skin )
 		{
-			ConvertNodeWeightsToFbxClusters( mesh->Weights, work->ClusterLookup, work->Mesh->GetScene(), work->Mesh->GetNode(), work->Skin, 
-				vertexStart, model, mesh );
-		}
-		else
-		{
-			// Add cluster that rigidly binds it to the parent node
-			AddRigidFbxClusterForParentNode( model, mesh, work->Skin, work->ClusterLookup, vertexStart );
+			if ( mesh->Weights )
+			{
+				ConvertNodeWeightsToFbxClusters( mesh->Weights, work->ClusterLookup, work->Mesh->GetScene(), work->Mesh->GetNode(), work->Skin, 
+					vertexStart, model, mesh );
+			}
+			else
+			{
+				// Add cluster that rigidly binds it to the parent node
+				AddRigidFbxClusterForParentNode( model, mesh, work->Skin, work->ClusterLookup, vertexStart );
+			}
 		}
 
 		if ( mesh->BlendShapes )
 		{
+			auto changedIndices = gcnew List<int>( mesh->Vertices->Length );
 			for ( size_t i = 0; i < mesh->BlendShapes->Length; i++ )
 			{
 				auto blendShape = mesh->BlendShapes[ i ];
@@ -337,7 +538,14 @@ namespace DDS3ModelLibrary::Models::Conversion
 
 				auto fShape = FbxShape::Create( work->Mesh, "" );
 				fChannel->AddTargetShape( fShape );
-				fShape->SetAbsoluteMode( true );				
+
+				if ( mConfig->SparseBlendShapes )
+				{
+					ConvertBlendShapeToSparseFbxShape( fShape, mesh, blendShape, vertexStart, changedIndices );
+					continue;
+				}
+
+				fShape->SetAbsoluteMode( true );
 
 				// Convert vertices
 				fShape->InitControlPoints( blendShape.Vertices->Length );
@@ -352,7 +560,6 @@ namespace DDS3ModelLibrary::Models::Conversion
 			}
 		}
 
-		int faceOffset = 0;
 		for ( size_t i = 0; i < mesh->Groups->Length; i++ )
 		{
 			auto grp = mesh->Groups[ i ];
@@ -367,9 +574,50 @@ namespace DDS3ModelLibrary::Models::Conversion
 			}
 
 			// Convert triangles
-			ConvertTrianglesToFbxPolygons( work->Mesh, grp.Triangles, vertexStart, materialIndex );
-			faceOffset += grp.Triangles->Length;
+			if ( grp.Triangles )
+				ConvertTrianglesToFbxPolygons( work->Mesh, grp.Triangles, vertexStart, materialIndex );
+			else
+				ConvertIndicesToFbxPolygons( work->Mesh, mesh->Indices, grp.IndexStart, grp.IndexCount, vertexStart, materialIndex );
+		}
+	}
+
+	void FbxModelExporter::ConvertBlendShapeToSparseFbxShape( FbxShape* fShape, GenericMesh^ mesh, GenericBlendShape blendShape, int vertexStart,
+		List<int>^ changedIndices )
+	{
+		// Morphs tend to move few vertices, so only the ones that differ from the base mesh are stored
+		auto epsilonSquared = mConfig->BlendShapeEpsilon * mConfig->BlendShapeEpsilon;
+		changedIndices->Clear();
+		for ( int i = 0; i < blendShape.Vertices->Length; i++ )
+		{
+			auto positionDelta = blendShape.Vertices[ i ] - mesh->Vertices[ i ];
+			auto normalDelta = blendShape.Normals[ i ] - mesh->Normals[ i ];
+			if ( positionDelta.LengthSquared() > epsilonSquared || normalDelta.LengthSquared() > epsilonSquared )
+				changedIndices->Add( i );
 		}
+
+		// In relative mode the control points and normals are deltas, applied to the base control points given by the indices
+		fShape->SetAbsoluteMode( false );
+		fShape->InitControlPoints( changedIndices->Count );
+		fShape->SetControlPointIndicesCount( changedIndices->Count );
+		fShape->InitNormals( changedIndices->Count );
+
+		auto fControlPoints = fShape->GetControlPoints();
+		auto fIndices = fShape->GetControlPointIndices();
+		FbxLayerElementArrayTemplate<FbxVector4>* fNormalsArray;
+		fShape->GetNormals( &fNormalsArray );
+		auto fNormals = (FbxVector4*)fNormalsArray->GetLocked();
+
+		for ( int i = 0; i < changedIndices->Count; i++ )
+		{
+			auto index = changedIndices[ i ];
+			auto positionDelta = blendShape.Vertices[ index ] - mesh->Vertices[ index ];
+			auto normalDelta = blendShape.Normals[ index ] - mesh->Normals[ index ];
+			fControlPoints[ i ] = FbxVector4( positionDelta.X, positionDelta.Y, positionDelta.Z );
+			fNormals[ i ] = FbxVector4( normalDelta.X, normalDelta.Y, normalDelta.Z, 0 );
+			fIndices[ i ] = vertexStart + index;
+		}
+
+		fNormalsArray->Release( (void**)&fNormals );
 	}
 
 	void FbxModelExporter::AddRigidFbxClusterForParentNode( Model^ model, GenericMesh^ mesh, 
@@ -466,6 +714,11 @@ namespace DDS3ModelLibrary::Models::Conversion
 		// Add to bind pose
 		fScene->GetPose( 0 )->Add( fNode, fNode->EvaluateGlobalTransform() );
 
+		ProcessNodeMeshes( model, node, meshes );
+	}
+
+	void FbxModelExporter::ProcessNodeMeshes( Model^ model, Node^ node, List<GenericMesh^>^ meshes )
+	{
 		if ( node->Geometry != nullptr )
 		{
 			if ( node->Geometry->Meshes != nullptr && node->Geometry->Meshes->Count > 0 )
@@ -482,6 +735,218 @@ namespace DDS3ModelLibrary::Models::Conversion
 			ProcessMeshList( model, node, node->DeprecatedMeshList2, meshes );
 	}
 
+	void FbxModelExporter::ConvertMotionPacksToFbxAnimStacks( Model^ model, IList<MotionPack^>^ motionPacks, FbxScene* fScene )
+	{
+		// Motions are played at 30 frames per second, with one key time unit per frame
+		fScene->GetGlobalSettings().SetTimeMode( FbxTime::EMode::eFrames30 );
+
+		for ( int i = 0; i < motionPacks->Count; i++ )
+		{
+			auto motionPack = motionPacks[ i ];
+			for ( int j = 0; j < motionPack->Motions->Count; j++ )
+			{
+				// Unused motion slots are null
+				auto motion = motionPack->Motions[ j ];
+				if ( motion == nullptr )
+					continue;
+
+				auto name = motionPacks->Count == 1 ? String::Format( "motion_{0}", j ) : String::Format( "mp_{0}_motion_{1}", i, j );
+				ConvertMotionToFbxAnimStack( model, motion, fScene, Utf8String( name ).ToCStr() );
+			}
+		}
+
+		if ( fScene->GetSrcObjectCount<FbxAnimStack>() > 0 )
+			fScene->SetCurrentAnimationStack( fScene->GetSrcObject<FbxAnimStack>( 0 ) );
+	}
+
+	void FbxModelExporter::ConvertMotionToFbxAnimStack( Model^ model, Motion^ motion, FbxScene* fScene, const char* name )
+	{
+		auto fAnimStack = FbxAnimStack::Create( fScene, name );
+		auto fAnimLayer = FbxAnimLayer::Create( fScene, "Base Layer" );
+		fAnimStack->AddMember( fAnimLayer );
+
+		FbxTime fStart, fStop;
+		fStart.SetFrame( 0, FbxTime::EMode::eFrames30 );
+		fStop.SetFrame( motion->Duration, FbxTime::EMode::eFrames30 );
+		fAnimStack->SetLocalTimeSpan( FbxTimeSpan( fStart, fStop ) );
+
+		// Buffers are shared by all controllers of the motion
+		auto maxKeyCount = 0;
+		for ( int i = 0; i < motion->Controllers->Count; i++ )
+			maxKeyCount = Math::Max( maxKeyCount, motion->Controllers[ i ]->Keys->Count );
+
+		auto times = gcnew array<int>( maxKeyCount );
+		auto values = gcnew array<Vector3>( maxKeyCount );
+
+		// The key columns are copied out of the keyframe lists, as their span views can't be used from C++/CLI
+		if ( !mKeyTimes || mKeyTimes->Length < maxKeyCount )
+		{
+			mKeyTimes = gcnew array<short>( maxKeyCount );
+			mKeyVectors = gcnew array<Vector3>( maxKeyCount );
+			mKeyRotations = gcnew array<Quaternion>( maxKeyCount );
+		}
+
+		for ( int i = 0; i < motion->Controllers->Count; i++ )
+		{
+			auto controller = motion->Controllers[ i ];
+			if ( controller->NodeIndex < 0 || controller->NodeIndex >= mConvertedNodes->Count )
+				continue;
+
+			auto fNode = (FbxNode*)mConvertedNodes[ controller->NodeIndex ].ToPointer();
+			auto keyCount = GatherControllerKeys( controller, times, values );
+			if ( keyCount < 0 )
+			{
+				mSkippedControllers->Add( String::Format( "{0}: {1} controller of node {2} with {3} keys", gcnew String( name ), controller->Type,
+					model->Nodes[ controller->NodeIndex ]->Name, controller->Keys->Format ) );
+				continue;
+			}
+
+			if ( keyCount == 0 )
+				continue;
+
+			switch ( controller->Type )
+			{
+			case ControllerType::Position:
+				ConvertKeysToFbxAnimCurves( fNode->LclTranslation, fAnimLayer, times, values, keyCount, mConfig->KeyReductionTolerance );
+				break;
+
+			case ControllerType::Rotation:
+				ConvertKeysToFbxAnimCurves( fNode->LclRotation, fAnimLayer, times, values, keyCount, mConfig->RotationKeyReductionTolerance );
+				break;
+
+			case ControllerType::Scale:
+				ConvertKeysToFbxAnimCurves( fNode->LclScaling, fAnimLayer, times, values, keyCount, mConfig->KeyReductionTolerance );
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	int FbxModelExporter::GatherControllerKeys( NodeController^ controller, array<int>^ times, array<Vector3>^ values )
+	{
+		auto keys = controller->Keys;
+		if ( keys->Count == 0 )
+			return 0;
+
+		auto isRotation = controller->Type == ControllerType::Rotation;
+		if ( !isRotation && controller->Type != ControllerType::Position && controller->Type != ControllerType::Scale )
+			return 0;
+
+		// Only formats with a known translation, rotation or scale meaning can be converted. The others, e.g. the shape keys of
+		// position controllers or Single5 keys, are reported as skipped rather than exported as empty curves
+		switch ( keys->Format )
+		{
+		case KeyFormat::Vector3:
+			if ( isRotation )
+				return -1;
+
+			keys->CopyVector3ValuesTo( mKeyVectors );
+			break;
+
+		case KeyFormat::Quaternion:
+			if ( !isRotation )
+				return -1;
+
+			keys->CopyQuaternionValuesTo( mKeyRotations );
+			break;
+
+		default:
+			return -1;
+		}
+
+		keys->CopyTimesTo( mKeyTimes );
+
+		// Later keys with the same time replace earlier ones
+		auto indices = keys->GetSortedDistinctIndices();
+		for ( int i = 0; i < indices->Length; i++ )
+		{
+			auto index = indices[ i ];
+			times[ i ] = mKeyTimes[ index ];
+
+			// Key rotations are stored inverted compared to the node rotations
+			values[ i ] = isRotation
+				? Utilities::QuaternionExtensions::ToEulerAngles( Quaternion::Inverse( mKeyRotations[ index ] ) ) * (float)RAD_TO_DEG
+				: mKeyVectors[ index ];
+		}
+
+		auto count = indices->Length;
+		if ( isRotation )
+		{
+			// Keep the euler angles continuous, so interpolation takes the short way around
+			for ( int i = 1; i < count; i++ )
+			{
+				auto delta = values[ i ] - values[ i - 1 ];
+				auto turns = Vector3( (float)Math::Round( delta.X / 360.0 ), (float)Math::Round( delta.Y / 360.0 ), (float)Math::Round( delta.Z / 360.0 ) );
+				values[ i ] = values[ i ] - turns * 360.0f;
+			}
+		}
+
+		return count;
+	}
+
+	List<int>^ FbxModelExporter::ReduceKeys( array<int>^ times, array<Vector3>^ values, int count, float tolerance )
+	{
+		auto keys = gcnew List<int>( count );
+		if ( count == 0 )
+			return keys;
+
+		// Extend each linear segment for as long as every key it skips stays within the tolerance
+		keys->Add( 0 );
+		auto anchor = 0;
+		for ( int candidate = 2; candidate < count; candidate++ )
+		{
+			auto fits = true;
+			for ( int i = anchor + 1; i < candidate && fits; i++ )
+			{
+				auto t = (float)( times[ i ] - times[ anchor ] ) / ( times[ candidate ] - times[ anchor ] );
+				auto error = Vector3::Abs( Vector3::Lerp( values[ anchor ], values[ candidate ], t ) - values[ i ] );
+				fits = error.X <= tolerance && error.Y <= tolerance && error.Z <= tolerance;
+			}
+
+			if ( !fits )
+			{
+				anchor = candidate - 1;
+				keys->Add( anchor );
+			}
+		}
+
+		if ( count > 1 )
+			keys->Add( count - 1 );
+
+		return keys;
+	}
+
+	void FbxModelExporter::ConvertKeysToFbxAnimCurves( FbxProperty& fProperty, FbxAnimLayer* fAnimLayer, array<int>^ times, array<Vector3>^ values,
+		int count, float tolerance )
+	{
+		auto keys = mConfig->ReduceKeys ? ReduceKeys( times, values, count, tolerance ) : nullptr;
+		auto keyCount = keys != nullptr ? keys->Count : count;
+
+		const char* components[] = { FBXSDK_CURVENODE_COMPONENT_X, FBXSDK_CURVENODE_COMPONENT_Y, FBXSDK_CURVENODE_COMPONENT_Z };
+		for ( int c = 0; c < 3; c++ )
+		{
+			auto fCurve = fProperty.GetCurve( fAnimLayer, components[ c ], true );
+			fCurve->KeyModifyBegin();
+
+			// Keys are added in order, so the hint makes every insertion constant time
+			int fLastIndex = 0;
+			for ( int i = 0; i < keyCount; i++ )
+			{
+				auto keyIndex = keys != nullptr ? keys[ i ] : i;
+				auto value = values[ keyIndex ];
+
+				FbxTime fTime;
+				fTime.SetFrame( times[ keyIndex ], FbxTime::EMode::eFrames30 );
+				fLastIndex = fCurve->KeyAdd( fTime, &fLastIndex );
+				fCurve->KeySet( fLastIndex, fTime, c == 0 ? value.X : c == 1 ? value.Y : value.Z, FbxAnimCurveDef::eInterpolationLinear );
+			}
+
+			fCurve->KeyModifyEnd();
+		}
+	}
+
 	FbxDouble3 FbxModelExporter::ConvertNumericsVector3RotationToFbxDouble3( Vector3 rotation )
 	{
 		return FbxDouble3(
@@ -725,6 +1190,12 @@ namespace DDS3ModelLibrary::Models::Conversion
 		return "material_" + model->Materials->IndexOf( material ).ToString( "D2" );
 	}
 
+	String^ FbxModelExporter::FormatObjectName( FieldObject^ obj, int index )
+	{
+		if ( obj->Name == nullptr ) return "object_" + index.ToString( "D2" );
+		return obj->Name;
+	}
+
 	String^ FbxModelExporter::FormatTextureName( TexturePack^ textures, Texture^ texture, int index )
 	{
 		return "texture_" + index.ToString( "D2" );
@@ -795,6 +1266,19 @@ namespace DDS3ModelLibrary::Models::Conversion
 		}
 	}
 
+	void FbxModelExporter::ConvertIndicesToFbxPolygons( FbxMesh* fMesh, array<int>^ indices, int indexStart, int indexCount, int vertexStart, 
+		int materialIndex )
+	{
+		for ( int i = indexStart; i < indexStart + indexCount; i += 3 )
+		{
+			fMesh->BeginPolygon( materialIndex, -1, -1, false );
+			fMesh->AddPolygon( vertexStart + indices[ i ] );
+			fMesh->AddPolygon( vertexStart + indices[ i + 1 ] );
+			fMesh->AddPolygon( vertexStart + indices[ i + 2 ] );
+			fMesh->EndPolygon();
+		}
+	}
+
 	FbxAMatrix FbxModelExporter::ConvertNumericsMatrix4x4ToFbxAMatrix( Matrix4x4& m )
 	{
 		typedef float Matrix4x4Data[ 4 ][ 4 ];
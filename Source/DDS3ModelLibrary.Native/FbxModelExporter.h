@@ -8,19 +8,50 @@ namespace DDS3ModelLibrary::Models::Conversion
 {
 	using namespace Textures;
 	using namespace Materials;
+	using namespace Motions;
+	using namespace Field;
+
+	public enum class FbxMeshMergeMode
+	{
+		None,			// Every mesh is exported as is
+		PerNode,		// Meshes of the same node are merged
+		PerMaterial,	// Meshes using the same material are merged
+		Model,			// All meshes are merged into one
+	};
 
 	public ref class FbxModelExporterConfig
 	{
 	public:
 		property bool ExportMultipleUvLayers;
-		property bool MergeMeshes;
+		property FbxMeshMergeMode MergeMode;
 		property bool ConvertBlendShapesToMeshes;
 
+		// Kept for compatibility, merges the whole model when enabled
+		property bool MergeMeshes
+		{
+			bool get() { return MergeMode != FbxMeshMergeMode::None; }
+			void set( bool value ) { MergeMode = value ? FbxMeshMergeMode::Model : FbxMeshMergeMode::None; }
+		}
+
+		// Store blend shapes as deltas of only the vertices they move, rather than a full copy of the mesh
+		property bool SparseBlendShapes;
+		property float BlendShapeEpsilon;
+
+		// Drop animation keys that can be linearly interpolated from their neighbours within the tolerances
+		property bool ReduceKeys;
+		property float KeyReductionTolerance;
+		property float RotationKeyReductionTolerance; // In degrees
+
 		inline FbxModelExporterConfig()
 		{
 			ExportMultipleUvLayers = true;
-			MergeMeshes = true;
+			MergeMode = FbxMeshMergeMode::Model;
 			ConvertBlendShapesToMeshes = true;
+			SparseBlendShapes = true;
+			BlendShapeEpsilon = 0.00001f;
+			ReduceKeys = false;
+			KeyReductionTolerance = 0.001f;
+			RotationKeyReductionTolerance = 0.05f;
 		}
 	};
 
@@ -38,6 +69,10 @@ namespace DDS3ModelLibrary::Models::Conversion
 	public:
 		int MaterialIndex;
 		array<Triangle>^ Triangles;
+
+		// Range of the mesh indices used instead of the triangles by merged meshes
+		int IndexStart;
+		int IndexCount;
 	};
 
 	ref class GenericMesh
@@ -53,6 +88,7 @@ namespace DDS3ModelLibrary::Models::Conversion
 		array<array<NodeWeight>^>^ Weights;
 		array<GenericPrimitiveGroup>^ Groups;
 		array<GenericBlendShape>^ BlendShapes;
+		array<int>^ Indices;
 	};
 
 	public ref class MeshConversionContext
@@ -78,13 +114,34 @@ namespace DDS3ModelLibrary::Models::Conversion
 
 		void Export( Model^ model, String^ path, FbxModelExporterConfig^ config, TexturePack^ textures ) override;
 
+		// Exports the model along with every motion of the motion packs, each as a separate animation stack
+		void Export( Model^ model, String^ path, FbxModelExporterConfig^ config, TexturePack^ textures, IList<MotionPack^>^ motionPacks );
+
+		// Exports every model object of the field scene into a single file. Each unique model is converted once and instanced
+		// by the nodes of the objects using it, and the textures are shared by all models.
+		void Export( FieldScene^ scene, String^ path, FbxModelExporterConfig^ config, TexturePack^ textures );
+
+		// Descriptions of the motion controllers of the last export whose key format has no animation curve equivalent
+		property IReadOnlyList<String^>^ SkippedControllers
+		{
+			IReadOnlyList<String^>^ get() { return mSkippedControllers; }
+		}
+
 	private:
 		void Reset();
+		void SetupFbxIOSettings();
+		FbxScene* CreateFbxScene();
+		void ExportTextures( TexturePack^ textures );
 		FbxScene* ConvertModelToFbxScene( Model^ model, TexturePack^ textures );
+		MeshConversionContext^ CreateMeshConversionContext( FbxNode* fMeshNode, GenericMesh^ mesh, bool skinned );
+		List<IntPtr>^ ConvertFieldModelToFbxMeshNodes( Model^ model, int modelIndex, TexturePack^ textures, FbxScene* fScene, FbxNode* fParentNode );
+		void InstanceFbxMeshNodes( List<IntPtr>^ meshNodes, FbxScene* fScene, FbxNode* fParentNode );
 		void ConvertBlendShapesToMeshes( System::Collections::Generic::List<DDS3ModelLibrary::Models::Conversion::GenericMesh^>^ meshes, DDS3ModelLibrary::Models::Model^ model );
 		void MergeMeshes( System::Collections::Generic::List<DDS3ModelLibrary::Models::Conversion::GenericMesh^>^& meshes, DDS3ModelLibrary::Models::Model^ model );
+		GenericMesh^ MergeMeshGroup( List<GenericMesh^>^ meshes, Node^ parentNode, Model^ model, int% indexOffset );
 		FbxNode* CreateFbxNodeForMesh( FbxScene* fScene, const char* name );
 		void ConvertProcessedMeshToFbxMesh( Model^ model, GenericMesh^ mesh, MeshConversionContext^ work, int vertexStart );
+		void ConvertBlendShapeToSparseFbxShape( FbxShape* fShape, GenericMesh^ mesh, GenericBlendShape blendShape, int vertexStart, List<int>^ changedIndices );
 		void AddRigidFbxClusterForParentNode( Model^ model, GenericMesh^ mesh, FbxSkin* fSkin, Dictionary<int, IntPtr>^ fClusterLookup, int vertexStart );
 		void ConvertMaterialToFbxSurfacePhong( fbxsdk::FbxScene* fScene, DDS3ModelLibrary::Models::Model^ model, DDS3ModelLibrary::Materials::Material^ mat, DDS3ModelLibrary::Textures::TexturePack^ textures, const size_t& i );
 		
@@ -93,6 +150,13 @@ namespace DDS3ModelLibrary::Models::Conversion
 		FbxDouble3 ConvertNumericsVector3ToFbxDouble3( Vector3 value );
 		FbxDouble3 ConvertNumericsVector3RotationToFbxDouble3( Vector3 rotation );
 
+		void ConvertMotionPacksToFbxAnimStacks( Model^ model, IList<MotionPack^>^ motionPacks, FbxScene* fScene );
+		void ConvertMotionToFbxAnimStack( Model^ model, Motion^ motion, FbxScene* fScene, const char* name );
+		int GatherControllerKeys( NodeController^ controller, array<int>^ times, array<Vector3>^ values );
+		List<int>^ ReduceKeys( array<int>^ times, array<Vector3>^ values, int count, float tolerance );
+		void ConvertKeysToFbxAnimCurves( FbxProperty& fProperty, FbxAnimLayer* fAnimLayer, array<int>^ times, array<Vector3>^ values, int count, float tolerance );
+
+		void ProcessNodeMeshes( Model^ model, Node^ node, List<GenericMesh^>^ processedMeshes );
 		void ProcessMeshList( Model^ model, Node^ node, MeshList^ meshList, List<GenericMesh^>^ processedMeshes );
 		FbxNode* CreateFbxNodeForMesh( Model^ model, Node^ node, const char* name, FbxScene* fScene );
 
@@ -110,12 +174,14 @@ namespace DDS3ModelLibrary::Models::Conversion
 		void ConvertTexCoordsToFbxLayerElementUVDirectArray( FbxLayerElementUV* fElementUV, array<Vector2>^ texCoords, int vertexStart );
 		void ConvertColorsToFbxLayerElementVertexColorsDirectArray( FbxLayerElementVertexColor* fElementColors, array<Color>^ colors, int vertexStart );
 		void ConvertTrianglesToFbxPolygons( FbxMesh* fMesh, array<Triangle>^ triangles, int vertexStart, int materialIndex );
+		void ConvertIndicesToFbxPolygons( FbxMesh* fMesh, array<int>^ indices, int indexStart, int indexCount, int vertexStart, int materialIndex );
 		FbxAMatrix ConvertNumericsMatrix4x4ToFbxAMatrix( Matrix4x4& m );
 		void ConvertNodeWeightsToFbxClusters( array<array<DDS3ModelLibrary::Models::NodeWeight>^>^ weights, System::Collections::Generic::Dictionary<int, 
 			System::IntPtr>^ fClusterLookup, fbxsdk::FbxScene* fScene, FbxNode* fMeshNode, fbxsdk::FbxSkin* fSkin, int vertexStart, Model^ model, GenericMesh^ mesh );
 
 		String^ FormatNodeName( Model^ model, Node^ node );
 		String^ FormatMaterialName( Model^ model, Material^ material );
+		String^ FormatObjectName( FieldObject^ obj, int index );
 		String^ FormatTextureName( TexturePack^ textures, Texture^ texture, int index );
 
 		FbxLayer* GetFbxMeshLayer( fbxsdk::FbxMesh* fMesh, int layer );
@@ -131,6 +197,11 @@ namespace DDS3ModelLibrary::Models::Conversion
 		List<IntPtr>^ mConvertedNodes;
 		Dictionary<int, IntPtr>^ mMaterialCache;
 		Dictionary<int, IntPtr>^ mTextureCache;
+		array<int>^ mIndexArena;
+		array<short>^ mKeyTimes;
+		array<Vector3>^ mKeyVectors;
+		array<Quaternion>^ mKeyRotations;
+		List<String^>^ mSkippedControllers;
 		FbxModelExporterConfig^ mConfig;
 		String^ mOutDir;
 	};
@@ -22,6 +22,14 @@ namespace DDS3ModelLibrary.IO
             }
         }
 
+        public void Load(Stream stream, bool leaveOpen = false, TIOContext context = null)
+        {
+            using (var reader = new EndianBinaryReader(stream, leaveOpen, Endianness.Little))
+            {
+                Read(reader, context);
+            }
+        }
+
         public void Save(string filePath)
         {
             using (var writer = new EndianBinaryWriter(new MemoryStream(), Endianness.Little))
@@ -0,0 +1,325 @@
+﻿using DDS3ModelLibrary.IO.Common;
+using Newtonsoft.Json;
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+
+namespace DDS3ModelLibrary.Materials
+{
+    /// <summary>
+    /// All material presets compiled into a single file, with open addressing hash tables to look up a preset id by preset hash and
+    /// a preset by id and variant. The file is memory mapped, and materials are only read from it when they're requested.
+    /// The bundle records a stamp of the preset directory it was built from, so a stale bundle can be detected.
+    /// </summary>
+    public sealed class MaterialPresetBundle : IDisposable
+    {
+        private const int MAGIC = 0x3142504D; // MPB1
+        private const int VERSION = 2;
+        private const int HEADER_SIZE = 32;
+        private const int PRESET_SLOT_SIZE = 8;
+        private const int VARIANT_SLOT_SIZE = 12;
+        private const int EMPTY = -1;
+
+        private const int VARIANT_TEXTURE = 1 << 0;
+        private const int VARIANT_OVERLAY = 1 << 1;
+
+        private readonly MemoryMappedFile mFile;
+        private readonly MemoryMappedViewAccessor mAccessor;
+        private readonly int mPresetSlotCount;
+        private readonly int mVariantSlotCount;
+        private readonly long mVariantTableOffset;
+
+        /// <summary>
+        /// Gets the number of materials in the bundle.
+        /// </summary>
+        public int Count { get; }
+
+        /// <summary>
+        /// Gets the stamp of the preset directory the bundle was built from, see <see cref="GetSourceStamp"/>.
+        /// </summary>
+        public long SourceStamp { get; }
+
+        private MaterialPresetBundle(MemoryMappedFile file, MemoryMappedViewAccessor accessor)
+        {
+            mFile = file;
+            mAccessor = accessor;
+
+            if (mAccessor.Capacity < HEADER_SIZE || mAccessor.ReadInt32(0) != MAGIC || mAccessor.ReadInt32(4) != VERSION)
+                throw new InvalidDataException("Not a material preset bundle, or of an unsupported version");
+
+            mPresetSlotCount = mAccessor.ReadInt32(8);
+            mVariantSlotCount = mAccessor.ReadInt32(12);
+            Count = mAccessor.ReadInt32(16);
+            SourceStamp = mAccessor.ReadInt64(24);
+            mVariantTableOffset = HEADER_SIZE + (long)mPresetSlotCount * PRESET_SLOT_SIZE;
+        }
+
+        /// <summary>
+        /// Memory maps a bundle.
+        /// </summary>
+        public static MaterialPresetBundle Open(string path)
+        {
+            var file = MemoryMappedFile.CreateFromFile(path, FileMode.Open, null, 0, MemoryMappedFileAccess.Read);
+            try
+            {
+                return new MaterialPresetBundle(file, file.CreateViewAccessor(0, 0, MemoryMappedFileAccess.Read));
+            }
+            catch
+            {
+                file.Dispose();
+                throw;
+            }
+        }
+
+        /// <summary>
+        /// Calculates a stamp of the JSON files in a preset directory, which changes when any file is added, removed or written to.
+        /// </summary>
+        public static long GetSourceStamp(string presetDirectory)
+        {
+            // FNV-1a over the name, size and write time of every file, in a stable order
+            var hash = 14695981039346656037ul;
+            var filePaths = Directory.GetFiles(presetDirectory, "*.json");
+            Array.Sort(filePaths, StringComparer.OrdinalIgnoreCase);
+            foreach (var filePath in filePaths)
+            {
+                var fileInfo = new FileInfo(filePath);
+                foreach (var c in fileInfo.Name.ToLowerInvariant())
+                    hash = HashStep(hash, c);
+
+                hash = HashStep(hash, fileInfo.Length);
+                hash = HashStep(hash, fileInfo.LastWriteTimeUtc.Ticks);
+            }
+
+            return (long)hash;
+        }
+
+        /// <summary>
+        /// Compiles a directory of JSON presets and its index into a bundle.
+        /// </summary>
+        /// <param name="presetDirectory">The directory containing index.json and the {id}[_d][_o].json presets.</param>
+        /// <param name="path">The path of the bundle to create.</param>
+        public static void Build(string presetDirectory, string path)
+        {
+            // Stamp before reading, so presets written during the build make the bundle stale rather than silently missing
+            var sourceStamp = GetSourceStamp(presetDirectory);
+            var hashToId = JsonConvert.DeserializeObject<Dictionary<int, int>>(File.ReadAllText(Path.Combine(presetDirectory, "index.json")));
+
+            // Serialize each variant in its binary form
+            var variants = new List<(int Key, byte[] Data)>();
+            foreach (var presetPath in Directory.EnumerateFiles(presetDirectory, "*.json"))
+            {
+                if (!TryParseVariantKey(Path.GetFileNameWithoutExtension(presetPath), out var key))
+                    continue;
+
+                var material = JsonConvert.DeserializeObject<Material>(File.ReadAllText(presetPath));
+                using (var stream = new MemoryStream())
+                {
+                    using (var writer = new EndianBinaryWriter(stream, true, Endianness.Little))
+                        writer.WriteObject(material, 0);
+
+                    variants.Add((key, stream.ToArray()));
+                }
+            }
+
+            var presetSlotCount = GetSlotCount(hashToId.Count);
+            var variantSlotCount = GetSlotCount(variants.Count);
+            var presetSlots = new int[presetSlotCount * 2];
+            var variantSlots = new int[variantSlotCount * 3];
+            for (int i = 0; i < presetSlotCount; i++)
+                presetSlots[i * 2 + 1] = EMPTY;
+
+            for (int i = 0; i < variantSlotCount; i++)
+                variantSlots[i * 3] = EMPTY;
+
+            foreach (var entry in hashToId)
+            {
+                var slot = FindSlot(entry.Key, presetSlotCount, s => presetSlots[s * 2 + 1] == EMPTY || presetSlots[s * 2] == entry.Key);
+                presetSlots[slot * 2] = entry.Key;
+                presetSlots[slot * 2 + 1] = entry.Value;
+            }
+
+            var dataOffset = HEADER_SIZE + presetSlotCount * PRESET_SLOT_SIZE + variantSlotCount * VARIANT_SLOT_SIZE;
+            foreach (var variant in variants)
+            {
+                var slot = FindSlot(variant.Key, variantSlotCount, s => variantSlots[s * 3] == EMPTY);
+                variantSlots[slot * 3] = variant.Key;
+                variantSlots[slot * 3 + 1] = dataOffset;
+                variantSlots[slot * 3 + 2] = variant.Data.Length;
+                dataOffset += variant.Data.Length;
+            }
+
+            // Write to a temporary file first, so a bundle that's mapped elsewhere is never seen half written.
+            // The name is unique, so processes building the same bundle at the same time don't write to the same file.
+            var tempPath = path + "." + Guid.NewGuid().ToString("N") + ".tmp";
+            using (var writer = new EndianBinaryWriter(tempPath, Endianness.Little))
+            {
+                writer.WriteInt32(MAGIC);
+                writer.WriteInt32(VERSION);
+                writer.WriteInt32(presetSlotCount);
+                writer.WriteInt32(variantSlotCount);
+                writer.WriteInt32(variants.Count);
+                writer.WritePadding(4);
+                writer.WriteInt64(sourceStamp);
+
+                foreach (var value in presetSlots)
+                    writer.WriteInt32(value);
+
+                foreach (var value in variantSlots)
+                    writer.WriteInt32(value);
+
+                foreach (var variant in variants)
+                    writer.WriteBytes(variant.Data);
+            }
+
+            try
+            {
+                if (File.Exists(path))
+                    File.Delete(path);
+
+                File.Move(tempPath, path);
+            }
+            catch
+            {
+                File.Delete(tempPath);
+                throw;
+            }
+        }
+
+        public bool TryGetPresetId(int presetHash, out int id)
+        {
+            var mask = mPresetSlotCount - 1;
+            for (int i = 0, slot = GetSlot(presetHash, mask); i < mPresetSlotCount; i++, slot = (slot + 1) & mask)
+            {
+                var offset = HEADER_SIZE + (long)slot * PRESET_SLOT_SIZE;
+                id = mAccessor.ReadInt32(offset + 4);
+                if (id == EMPTY)
+                    break;
+
+                if (mAccessor.ReadInt32(offset) == presetHash)
+                    return true;
+            }
+
+            id = -1;
+            return false;
+        }
+
+        /// <summary>
+        /// Determines whether any variant of the preset exists.
+        /// </summary>
+        public bool IsValidPresetId(int id)
+        {
+            if (id < 0)
+                return false;
+
+            for (int variant = 0; variant < 4; variant++)
+            {
+                if (FindVariant(GetVariantKey(id, variant), out _, out _))
+                    return true;
+            }
+
+            return false;
+        }
+
+        /// <summary>
+        /// Reads a new instance of a preset.
+        /// </summary>
+        public bool TryGetPreset(int id, bool hasTexture, bool hasOverlay, out Material material)
+        {
+            var variant = (hasTexture ? VARIANT_TEXTURE : 0) | (hasOverlay ? VARIANT_OVERLAY : 0);
+            if (id < 0 || !FindVariant(GetVariantKey(id, variant), out var dataOffset, out var dataSize))
+            {
+                material = null;
+                return false;
+            }
+
+            var data = new byte[dataSize];
+            mAccessor.ReadArray(dataOffset, data, 0, dataSize);
+            using (var reader = new EndianBinaryReader(new MemoryStream(data), Endianness.Little))
+                material = reader.ReadObject<Material>();
+
+            return true;
+        }
+
+        public void Dispose()
+        {
+            mAccessor.Dispose();
+            mFile.Dispose();
+        }
+
+        private bool FindVariant(int key, out long dataOffset, out int dataSize)
+        {
+            var mask = mVariantSlotCount - 1;
+            for (int i = 0, slot = GetSlot(key, mask); i < mVariantSlotCount; i++, slot = (slot + 1) & mask)
+            {
+                var offset = mVariantTableOffset + (long)slot * VARIANT_SLOT_SIZE;
+                var slotKey = mAccessor.ReadInt32(offset);
+                if (slotKey == EMPTY)
+                    break;
+
+                if (slotKey == key)
+                {
+                    dataOffset = mAccessor.ReadInt32(offset + 4);
+                    dataSize = mAccessor.ReadInt32(offset + 8);
+                    return true;
+                }
+            }
+
+            dataOffset = 0;
+            dataSize = 0;
+            return false;
+        }
+
+        private static bool TryParseVariantKey(string name, out int key)
+        {
+            key = 0;
+            var parts = name.Split('_');
+            if (!int.TryParse(parts[0], out var id) || id < 0)
+                return false;
+
+            var variant = 0;
+            for (int i = 1; i < parts.Length; i++)
+            {
+                if (parts[i] == "d")
+                    variant |= VARIANT_TEXTURE;
+                else if (parts[i] == "o")
+                    variant |= VARIANT_OVERLAY;
+                else
+                    return false;
+            }
+
+            key = GetVariantKey(id, variant);
+            return true;
+        }
+
+        private static ulong HashStep(ulong hash, long value) => (hash ^ (ulong)value) * 1099511628211ul;
+
+        private static int GetVariantKey(int id, int variant) => (id << 2) | variant;
+
+        private static int GetSlotCount(int count)
+        {
+            // Keep the load factor at or below 50%, so probe sequences stay short
+            var slotCount = 1;
+            while (slotCount < count * 2)
+                slotCount <<= 1;
+
+            return slotCount;
+        }
+
+        private static int GetSlot(int key, int mask)
+        {
+            var hash = (uint)key * 0x9E3779B1u;
+            return (int)((hash ^ (hash >> 16)) & (uint)mask);
+        }
+
+        private static int FindSlot(int key, int slotCount, Func<int, bool> isAvailable)
+        {
+            var mask = slotCount - 1;
+            var slot = GetSlot(key, mask);
+            while (!isAvailable(slot))
+                slot = (slot + 1) & mask;
+
+            return slot;
+        }
+    }
+}
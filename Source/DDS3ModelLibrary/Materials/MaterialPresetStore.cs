@@ -8,20 +8,94 @@ namespace DDS3ModelLibrary.Materials
 {
     public static class MaterialPresetStore
     {
+        private static MaterialPresetBundle sBundle;
         private static Dictionary<int, int> sMaterialHashToId;
         private static HashSet<int> sValidPresetIds;
 
+        /// <summary>
+        /// Gets a value that changes whenever the presets change, for caches of data that depends on them.
+        /// </summary>
+        public static long Version { get; private set; }
+
         static MaterialPresetStore()
         {
-            LoadIndex();
+            try
+            {
+                LoadBundle();
+            }
+            catch (Exception e) when (e is IOException || e is UnauthorizedAccessException || e is InvalidDataException)
+            {
+                // The bundle can't be built or opened anywhere, so read the presets from the JSON files instead
+                LoadIndex();
+            }
+        }
+
+        private static void LoadBundle()
+        {
+            var presetDirectory = GetPath(string.Empty);
+            var bundlePath = ResourceStore.GetPath("material_presets.bin");
+            if (!File.Exists(GetPath("index.json")))
+            {
+                // Only a prebuilt bundle may be present
+                if (File.Exists(bundlePath))
+                {
+                    sBundle = MaterialPresetBundle.Open(bundlePath);
+                    Version = sBundle.SourceStamp;
+                }
+
+                return;
+            }
+
+            // Compile the JSON presets on first use, or when any of them has been updated since the bundle was built
+            var tempBundlePath = Path.Combine(Path.GetTempPath(), "DDS3ModelStudio_material_presets.bin");
+            Version = MaterialPresetBundle.GetSourceStamp(presetDirectory);
+            sBundle = TryOpenBundle(bundlePath, Version) ?? TryOpenBundle(tempBundlePath, Version);
+            if (sBundle != null)
+                return;
+
+            try
+            {
+                MaterialPresetBundle.Build(presetDirectory, bundlePath);
+            }
+            catch (Exception e) when (e is IOException || e is UnauthorizedAccessException)
+            {
+                // The resources directory isn't writable, so build it somewhere that is
+                bundlePath = tempBundlePath;
+                MaterialPresetBundle.Build(presetDirectory, bundlePath);
+            }
+
+            sBundle = MaterialPresetBundle.Open(bundlePath);
+        }
+
+        private static MaterialPresetBundle TryOpenBundle(string path, long sourceStamp)
+        {
+            if (!File.Exists(path))
+                return null;
+
+            try
+            {
+                var bundle = MaterialPresetBundle.Open(path);
+                if (bundle.SourceStamp == sourceStamp)
+                    return bundle;
+
+                bundle.Dispose();
+            }
+            catch (Exception e) when (e is IOException || e is UnauthorizedAccessException || e is InvalidDataException)
+            {
+                // Bundles of an older version are rebuilt
+            }
+
+            return null;
         }
 
         private static void LoadIndex()
         {
+            sBundle = null;
             sValidPresetIds = new HashSet<int>();
             var hashToIdJsonPath = GetPath("index.json");
             if (File.Exists(hashToIdJsonPath))
             {
+                Version = MaterialPresetBundle.GetSourceStamp(GetPath(string.Empty));
                 sMaterialHashToId = JsonConvert.DeserializeObject<Dictionary<int, int>>(File.ReadAllText(hashToIdJsonPath));
                 foreach (int value in sMaterialHashToId.Values)
                     sValidPresetIds.Add(value);
@@ -34,25 +108,49 @@ namespace DDS3ModelLibrary.Materials
 
         private static string GetPath(string path) => ResourceStore.GetPath("material_presets\\" + path);
 
-        public static bool IsPreset(Material material) => sMaterialHashToId.ContainsKey(material.GetPresetHashCode());
+        public static bool IsPreset(Material material) => TryGetPresetId(material, out _);
+
+        public static int GetPresetId(Material material)
+        {
+            if (!TryGetPresetId(material, out var presetId))
+                throw new KeyNotFoundException("Material does not match any preset");
 
-        public static int GetPresetId(Material material) => sMaterialHashToId[material.GetPresetHashCode()];
+            return presetId;
+        }
 
         public static bool TryGetPresetId(Material material, out int presetId)
         {
-            return sMaterialHashToId.TryGetValue(material.GetPresetHashCode(), out presetId);
+            presetId = -1;
+            if (sBundle == null)
+                return sMaterialHashToId != null && sMaterialHashToId.TryGetValue(material.GetPresetHashCode(), out presetId);
+
+            return sBundle.TryGetPresetId(material.GetPresetHashCode(), out presetId);
         }
 
-        public static bool IsValidPresetId(int id) => sValidPresetIds.Contains(id);
+        public static bool IsValidPresetId(int id)
+        {
+            if (sBundle == null)
+                return sValidPresetIds != null && sValidPresetIds.Contains(id);
+
+            return sBundle.IsValidPresetId(id);
+        }
 
         public static Material GetPreset(int id, bool hasTexture, bool hasOverlay)
         {
+            Material material;
+            if (sBundle != null)
+            {
+                if (!sBundle.TryGetPreset(id, hasTexture, hasOverlay, out material))
+                    throw new ArgumentOutOfRangeException(nameof(id), $"Material preset {id} does not exist");
+
+                return material;
+            }
+
             var path = GetMaterialPresetPath(id, hasTexture, hasOverlay);
             if (!File.Exists(path))
                 throw new ArgumentOutOfRangeException(nameof(id), $"Material preset {id} does not exist");
 
-            var json = File.ReadAllText(path);
-            return JsonConvert.DeserializeObject<Material>(json);
+            return JsonConvert.DeserializeObject<Material>(File.ReadAllText(path));
         }
 
         private static string GetMaterialPresetPath(int id, bool hasTexture, bool hasOverlay)
@@ -67,4 +165,4 @@ namespace DDS3ModelLibrary.Materials
             return GetPath(name + ".json");
         }
     }
-}
+}
\ No newline at end of file
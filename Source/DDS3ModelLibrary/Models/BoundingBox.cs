@@ -1,4 +1,5 @@
 ﻿using DDS3ModelLibrary.IO.Common;
+using DDS3ModelLibrary.Models.Utilities;
 using System;
 using System.Collections.Generic;
 using System.Numerics;
@@ -37,6 +38,16 @@ namespace DDS3ModelLibrary.Models
         {
         }
 
+        /// <summary>
+        /// Gets the center of the box.
+        /// </summary>
+        public Vector3 Center => (Min + Max) * 0.5f;
+
+        /// <summary>
+        /// Gets the half size of the box along each axis.
+        /// </summary>
+        public Vector3 Extents => (Max - Min) * 0.5f;
+
         /// <summary>
         /// Calculates and creates a new <see cref="BoundingBox"/> from vertices.
         /// </summary>
@@ -44,6 +55,14 @@ namespace DDS3ModelLibrary.Models
         /// <returns>A new <see cref="BoundingBox"/> calculated form the specified vertices.</returns>
         public static BoundingBox Calculate(IEnumerable<Vector3> vertices)
         {
+            if (vertices is Vector3[] array)
+            {
+                var min = new Vector3(float.MaxValue);
+                var max = new Vector3(float.MinValue);
+                BoundsHelper.Accumulate(array, ref min, ref max);
+                return new BoundingBox(min, max);
+            }
+
             Vector3 minExtent = new Vector3(float.MaxValue, float.MaxValue, float.MaxValue);
             Vector3 maxExtent = new Vector3(float.MinValue, float.MinValue, float.MinValue);
             foreach (Vector3 vertex in vertices)
@@ -60,6 +79,34 @@ namespace DDS3ModelLibrary.Models
             return new BoundingBox(minExtent, maxExtent);
         }
 
+        /// <summary>
+        /// Creates a new <see cref="BoundingBox"/> that contains both boxes.
+        /// </summary>
+        public static BoundingBox Merge(BoundingBox a, BoundingBox b)
+        {
+            return new BoundingBox(Vector3.Min(a.Min, b.Min), Vector3.Max(a.Max, b.Max));
+        }
+
+        /// <summary>
+        /// Creates a new <see cref="BoundingBox"/> that contains this box after it's transformed by the specified matrix.
+        /// </summary>
+        public BoundingBox Transform(in Matrix4x4 matrix)
+        {
+            BoundsHelper.Transform(Min, Max, matrix, out var min, out var max);
+            return new BoundingBox(min, max);
+        }
+
+        public bool Contains(Vector3 point)
+        {
+            return point.X >= Min.X && point.Y >= Min.Y && point.Z >= Min.Z &&
+                   point.X <= Max.X && point.Y <= Max.Y && point.Z <= Max.Z;
+        }
+
+        public bool Intersects(BoundingBox other)
+        {
+            return BoundsHelper.Intersects(Min, Max, other.Min, other.Max);
+        }
+
         public override bool Equals(object obj)
         {
             if (obj == null || obj.GetType() != typeof(BoundingBox))
@@ -0,0 +1,107 @@
+﻿using DDS3ModelLibrary.Models.Utilities;
+using System;
+using System.Numerics;
+
+namespace DDS3ModelLibrary.Models
+{
+    /// <summary>
+    /// Represents a sphere consisting of a center and radius used for calculation.
+    /// </summary>
+    public struct BoundingSphere : IEquatable<BoundingSphere>
+    {
+        public Vector3 Center;
+
+        public float Radius;
+
+        public BoundingSphere(Vector3 center, float radius)
+        {
+            Center = center;
+            Radius = radius;
+        }
+
+        /// <summary>
+        /// Calculates a sphere centered on the specified center that contains all vertices.
+        /// </summary>
+        /// <param name="vertices">The vertices the sphere should contain.</param>
+        /// <param name="center">The center of the sphere, usually the center of the bounding box of the vertices.</param>
+        public static BoundingSphere Calculate(ReadOnlySpan<Vector3> vertices, Vector3 center)
+        {
+            return new BoundingSphere(center, (float)Math.Sqrt(BoundsHelper.GetMaxDistanceSquared(vertices, center)));
+        }
+
+        /// <summary>
+        /// Creates a sphere that contains the specified box.
+        /// </summary>
+        public static BoundingSphere FromBox(BoundingBox box)
+        {
+            return new BoundingSphere(box.Center, box.Extents.Length());
+        }
+
+        /// <summary>
+        /// Creates the smallest sphere that contains both spheres.
+        /// </summary>
+        public static BoundingSphere Merge(in BoundingSphere a, in BoundingSphere b)
+        {
+            var offset = b.Center - a.Center;
+            var distance = offset.Length();
+            if (distance + b.Radius <= a.Radius)
+                return a;
+
+            if (distance + a.Radius <= b.Radius)
+                return b;
+
+            var radius = (distance + a.Radius + b.Radius) * 0.5f;
+            return new BoundingSphere(a.Center + offset * ((radius - a.Radius) / distance), radius);
+        }
+
+        /// <summary>
+        /// Creates a sphere that contains this sphere after it's transformed by the specified matrix.
+        /// </summary>
+        public BoundingSphere Transform(in Matrix4x4 matrix)
+        {
+            return new BoundingSphere(Vector3.Transform(Center, matrix), Radius * BoundsHelper.GetMaxScale(matrix));
+        }
+
+        public bool Contains(Vector3 point)
+        {
+            return Vector3.DistanceSquared(Center, point) <= Radius * Radius;
+        }
+
+        public bool Intersects(in BoundingSphere other)
+        {
+            var radius = Radius + other.Radius;
+            return Vector3.DistanceSquared(Center, other.Center) <= radius * radius;
+        }
+
+        public bool Intersects(BoundingBox box)
+        {
+            return BoundsHelper.GetDistanceSquared(box.Min, box.Max, Center) <= Radius * Radius;
+        }
+
+        public override bool Equals(object obj)
+        {
+            return obj is BoundingSphere other && Equals(other);
+        }
+
+        public bool Equals(BoundingSphere other)
+        {
+            return Center == other.Center && Radius == other.Radius;
+        }
+
+        public override int GetHashCode()
+        {
+            unchecked
+            {
+                int hash = 11;
+                hash = hash * 33 + Center.GetHashCode();
+                hash = hash * 33 + Radius.GetHashCode();
+                return hash;
+            }
+        }
+
+        public override string ToString()
+        {
+            return $"[{Center.X}, {Center.Y}, {Center.Z}] {Radius}";
+        }
+    }
+}
@@ -0,0 +1,18 @@
+﻿namespace DDS3ModelLibrary.Models.Conversion
+{
+    public sealed partial class GltfModelExporter
+    {
+        public class Config
+        {
+            /// <summary>
+            /// Gets or sets whether the blend shapes of <see cref="MeshType5"/> meshes are exported as morph targets.
+            /// </summary>
+            public bool ExportMorphTargets { get; set; } = true;
+
+            /// <summary>
+            /// Gets or sets whether textures are embedded into the file as PNG images.
+            /// </summary>
+            public bool EmbedTextures { get; set; } = true;
+        }
+    }
+}
@@ -0,0 +1,842 @@
+﻿using DDS3ModelLibrary.Materials;
+using DDS3ModelLibrary.Motions;
+using DDS3ModelLibrary.Textures;
+using DDS3ModelLibrary.Textures.Exchange.PNG;
+using Newtonsoft.Json;
+using Newtonsoft.Json.Linq;
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Numerics;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace DDS3ModelLibrary.Models.Conversion
+{
+    /// <summary>
+    /// Exports models as binary glTF 2.0 (GLB) files, without going through Assimp or the FBX SDK.
+    /// Vertex data is copied from the mesh batches straight into the binary chunk, with one primitive per mesh.
+    /// Like the other exporters the meshes are in model space and skinned to the node hierarchy, so motions move all of the geometry.
+    /// </summary>
+    public sealed partial class GltfModelExporter : ModelExporter<GltfModelExporter, GltfModelExporter.Config>
+    {
+        private const int GLB_MAGIC = 0x46546C67; // glTF
+        private const int GLB_VERSION = 2;
+        private const int GLB_CHUNK_JSON = 0x4E4F534A;
+        private const int GLB_CHUNK_BIN = 0x004E4942;
+
+        private const int COMPONENT_UNSIGNED_SHORT = 5123;
+        private const int COMPONENT_UNSIGNED_INT = 5125;
+        private const int COMPONENT_FLOAT = 5126;
+        private const int TARGET_ARRAY_BUFFER = 34962;
+        private const int TARGET_ELEMENT_ARRAY_BUFFER = 34963;
+
+        private const float FRAMES_PER_SECOND = 30f;
+        private const int MAX_JOINTS_PER_VERTEX = 4;
+
+        private delegate void SkinnedTransform(List<Node> nodes, Span<Vector3> positions, Span<Vector3> normals, Span<NodeWeight> weights);
+
+        public override void Export(Model model, string filepath, Config config, TexturePack textures = null)
+        {
+            Export(model, filepath, config, textures, null);
+        }
+
+        /// <summary>
+        /// Exports the model along with every motion of the motion packs, each as a separate animation.
+        /// </summary>
+        public void Export(Model model, string filepath, Config config, TexturePack textures, IList<MotionPack> motionPacks)
+        {
+            using (var stream = File.Create(filepath))
+                Export(model, stream, config, textures, motionPacks);
+        }
+
+        public void Export(Model model, Stream stream, Config config, TexturePack textures, IList<MotionPack> motionPacks)
+        {
+            config = config ?? new Config();
+
+            // The exporter is shared, so all state lives in the builder
+            var builder = new GltfBuilder();
+            if (textures != null && config.EmbedTextures)
+                ConvertTextures(textures, builder);
+
+            // Materials can only reference textures that were embedded
+            for (int i = 0; i < model.Materials.Count; i++)
+                builder.Materials.Add(ConvertMaterial(model.Materials[i], i, builder.Textures.Count));
+
+            var worldTransforms = new ModelTransformHierarchy(model).CreateSnapshot();
+            ConvertNodes(model, builder);
+
+            var skinIndex = ConvertSkin(model, worldTransforms, builder);
+            ConvertMeshes(model, config, skinIndex, builder);
+
+            if (motionPacks != null)
+                ConvertMotionPacks(model, motionPacks, builder);
+
+            builder.Write(stream);
+        }
+
+        private static void ConvertTextures(TexturePack textures, GltfBuilder builder)
+        {
+            builder.Samplers.Add(new JObject());
+
+            for (int i = 0; i < textures.Count; i++)
+            {
+                // Encoded without GDI+, so exporting with textures also works on headless Linux
+                using (var image = textures[i].GetImage())
+                using (var imageStream = new MemoryStream())
+                {
+                    PNGCodec.Encode(image, imageStream);
+
+                    var bufferView = builder.AddBufferView<byte>(new ReadOnlySpan<byte>(imageStream.GetBuffer(), 0, (int)imageStream.Length), null);
+                    builder.Images.Add(new JObject { ["bufferView"] = bufferView, ["mimeType"] = "image/png", ["name"] = FormatTextureName(i) });
+                    builder.Textures.Add(new JObject { ["sampler"] = 0, ["source"] = i });
+                }
+            }
+        }
+
+        private static JObject ConvertMaterial(Material material, int index, int textureCount)
+        {
+            var pbr = new JObject { ["metallicFactor"] = 0f, ["roughnessFactor"] = 1f };
+            if (material.TextureId != null && material.TextureId.Value < textureCount)
+                pbr["baseColorTexture"] = new JObject { ["index"] = material.TextureId.Value };
+
+            return new JObject { ["name"] = FormatMaterialName(material, index), ["pbrMetallicRoughness"] = pbr };
+        }
+
+        private static void ConvertNodes(Model model, GltfBuilder builder)
+        {
+            var children = new JArray[model.Nodes.Count];
+            var nodeIndices = new Dictionary<Node, int>(model.Nodes.Count);
+            for (int i = 0; i < model.Nodes.Count; i++)
+                nodeIndices[model.Nodes[i]] = i;
+
+            for (int i = 0; i < model.Nodes.Count; i++)
+            {
+                var node = model.Nodes[i];
+                var rotation = Quaternion.CreateFromRotationMatrix(Matrix4x4.CreateRotationX(node.Rotation.X) *
+                                                                   Matrix4x4.CreateRotationY(node.Rotation.Y) *
+                                                                   Matrix4x4.CreateRotationZ(node.Rotation.Z));
+                var gNode = new JObject
+                {
+                    ["name"] = FormatNodeName(node, i),
+                    ["translation"] = ToJArray(node.Position),
+                    ["rotation"] = new JArray(rotation.X, rotation.Y, rotation.Z, rotation.W),
+                    ["scale"] = ToJArray(node.Scale),
+                };
+
+                builder.Nodes.Add(gNode);
+
+                if (node.Parent == null)
+                {
+                    builder.SceneNodes.Add(i);
+                }
+                else
+                {
+                    var parentIndex = nodeIndices[node.Parent];
+                    if (children[parentIndex] == null)
+                        ((JObject)builder.Nodes[parentIndex])["children"] = children[parentIndex] = new JArray();
+
+                    children[parentIndex].Add(i);
+                }
+            }
+        }
+
+        private static int ConvertSkin(Model model, Matrix4x4[] worldTransforms, GltfBuilder builder)
+        {
+            if (model.Nodes.Count == 0)
+                return -1;
+
+            // System.Numerics matrices use row vectors, so their memory layout is already the column major layout of glTF
+            var inverseBindMatrices = new Matrix4x4[worldTransforms.Length];
+            for (int i = 0; i < worldTransforms.Length; i++)
+                Matrix4x4.Invert(worldTransforms[i], out inverseBindMatrices[i]);
+
+            var joints = new JArray();
+            for (int i = 0; i < model.Nodes.Count; i++)
+                joints.Add(i);
+
+            var view = builder.AddBufferView<Matrix4x4>(inverseBindMatrices, null);
+            var accessor = builder.AddAccessor(view, COMPONENT_FLOAT, inverseBindMatrices.Length, "MAT4");
+            builder.Skins.Add(new JObject { ["inverseBindMatrices"] = accessor, ["joints"] = joints });
+            return builder.Skins.Count - 1;
+        }
+
+        private static void ConvertMeshes(Model model, Config config, int skinIndex, GltfBuilder builder)
+        {
+            var data = new PrimitiveData();
+            for (int i = 0; i < model.Nodes.Count; i++)
+            {
+                var node = model.Nodes[i];
+                if (node.Geometry == null)
+                    continue;
+
+                foreach (var meshList in node.Geometry.MeshLists)
+                {
+                    if (meshList == null)
+                        continue;
+
+                    foreach (var mesh in meshList)
+                    {
+                        data.Clear();
+                        if (!GatherMesh(model, node, (short)i, mesh, data))
+                            continue;
+
+                        var primitive = WritePrimitive(data, mesh.MaterialIndex, model.Materials.Count, builder);
+                        var gMesh = new JObject { ["primitives"] = new JArray(primitive) };
+
+                        if (config.ExportMorphTargets && mesh is MeshType5 morphMesh && morphMesh.NodeBatches.Count == 0 && morphMesh.BlendShapes.Count > 1)
+                        {
+                            primitive["targets"] = ConvertMorphTargets(morphMesh, node.WorldTransform, builder);
+                            gMesh["weights"] = new JArray(new float[morphMesh.BlendShapes.Count - 1]);
+                        }
+
+                        builder.Meshes.Add(gMesh);
+
+                        // Skinned mesh nodes ignore their own transform, so they're placed at the root
+                        var gMeshNode = new JObject { ["name"] = $"mesh_{builder.Meshes.Count - 1:D2}", ["mesh"] = builder.Meshes.Count - 1 };
+                        if (skinIndex != -1)
+                            gMeshNode["skin"] = skinIndex;
+
+                        builder.Nodes.Add(gMeshNode);
+                        builder.SceneNodes.Add(builder.Nodes.Count - 1);
+                    }
+                }
+            }
+        }
+
+        private static bool GatherMesh(Model model, Node node, short nodeIndex, Mesh mesh, PrimitiveData data)
+        {
+            var worldTransform = node.WorldTransform;
+            switch (mesh)
+            {
+                case MeshType1 mesh1:
+                    foreach (var batch in mesh1.Batches)
+                    {
+                        var start = data.VertexCount;
+                        AddStaticVertices(data, worldTransform, nodeIndex, batch.Positions, batch.Normals);
+                        data.SetTexCoords(start, batch.VertexCount, batch.TexCoords, batch.TexCoords2);
+                        data.SetColors(start, batch.VertexCount, batch.Colors);
+                        data.AddTriangles(batch.Triangles, start);
+                    }
+                    break;
+
+                case MeshType2 mesh2:
+                    foreach (var batch in mesh2.Batches)
+                    {
+                        var start = data.VertexCount;
+                        AddSkinnedVertices(data, model.Nodes, batch.Transform, batch.VertexCount, batch.UsedNodeCount,
+                                           batch.NodeBatches.Count > 0 && batch.NodeBatches[0].Normals != null);
+                        data.SetTexCoords(start, batch.VertexCount, batch.TexCoords, batch.TexCoords2);
+                        data.SetColors(start, batch.VertexCount, batch.Colors);
+                        data.AddTriangles(batch.Triangles, start);
+                    }
+                    break;
+
+                case MeshType4 mesh4:
+                    AddStaticVertices(data, worldTransform, nodeIndex, mesh4.Positions, mesh4.Normals);
+                    data.AddTriangles(mesh4.Triangles, 0);
+                    break;
+
+                case MeshType5 mesh5:
+                    if (mesh5.NodeBatches.Count > 0)
+                    {
+                        AddSkinnedVertices(data, model.Nodes, mesh5.Transform, mesh5.VertexCount, mesh5.UsedNodeCount,
+                                           mesh5.NodeBatches[0].Normals != null);
+                    }
+                    else if (mesh5.BlendShapes.Count > 0)
+                    {
+                        // The first shape is the base, the others are stored relative to it
+                        AddStaticVertices(data, worldTransform, nodeIndex, mesh5.BlendShapes[0].Positions, mesh5.BlendShapes[0].Normals);
+                    }
+                    else
+                    {
+                        return false;
+                    }
+
+                    data.SetTexCoords(0, data.VertexCount, mesh5.TexCoords, mesh5.TexCoords2);
+                    data.AddTriangles(mesh5.Triangles, 0);
+                    break;
+
+                case MeshType7 mesh7:
+                    foreach (var batch in mesh7.Batches)
+                    {
+                        var start = data.VertexCount;
+                        AddSkinnedVertices(data, model.Nodes, batch.Transform, batch.VertexCount, batch.UsedNodeCount,
+                                           batch.NodeBatches.Count > 0 && batch.NodeBatches[0].Normals != null);
+                        data.SetTexCoords(start, batch.VertexCount, batch.TexCoords, null);
+                    }
+
+                    data.SetTexCoords2(0, data.VertexCount, mesh7.TexCoords2);
+                    data.AddTriangles(mesh7.Triangles, 0);
+                    break;
+
+                case MeshType8 mesh8:
+                    foreach (var batch in mesh8.Batches)
+                    {
+                        var start = data.VertexCount;
+                        AddStaticVertices(data, worldTransform, nodeIndex, batch.Positions, batch.Normals);
+                        data.SetTexCoords(start, batch.VertexCount, batch.TexCoords, null);
+                    }
+
+                    data.SetTexCoords2(0, data.VertexCount, mesh8.TexCoords2);
+                    data.AddTriangles(mesh8.Triangles, 0);
+                    break;
+
+                default:
+                    return false;
+            }
+
+            return data.VertexCount > 0 && data.IndexCount > 0;
+        }
+
+        private static void AddStaticVertices(PrimitiveData data, in Matrix4x4 worldTransform, short nodeIndex, Vector3[] positions, Vector3[] normals)
+        {
+            var start = data.VertexCount;
+            var count = positions?.Length ?? 0;
+            data.Grow(start + count, 0);
+
+            for (int i = 0; i < count; i++)
+                data.Positions[start + i] = Vector3.Transform(positions[i], worldTransform);
+
+            if (data.PrepareNormals(start, count, normals != null))
+            {
+                for (int i = 0; i < count; i++)
+                    data.Normals[start + i] = Vector3.Normalize(Vector3.TransformNormal(normals[i], worldTransform));
+            }
+
+            // Rigidly bound to the node the mesh belongs to
+            for (int i = start; i < start + count; i++)
+            {
+                data.Joints[i * MAX_JOINTS_PER_VERTEX] = (ushort)nodeIndex;
+                data.Joints[i * MAX_JOINTS_PER_VERTEX + 1] = 0;
+                data.Joints[i * MAX_JOINTS_PER_VERTEX + 2] = 0;
+                data.Joints[i * MAX_JOINTS_PER_VERTEX + 3] = 0;
+                data.Weights[i] = Vector4.UnitX;
+            }
+
+            data.VertexCount += count;
+        }
+
+        private static void AddSkinnedVertices(PrimitiveData data, List<Node> nodes, SkinnedTransform transform, int count, int influenceCount, bool hasNormals)
+        {
+            var start = data.VertexCount;
+            data.Grow(start + count, count * influenceCount);
+
+            var normals = data.PrepareNormals(start, count, hasNormals) ? data.Normals.AsSpan(start, count) : Span<Vector3>.Empty;
+            var weights = data.NodeWeights.AsSpan(0, count * influenceCount);
+            transform(nodes, data.Positions.AsSpan(start, count), normals, weights);
+
+            for (int i = 0; i < normals.Length; i++)
+                normals[i] = Vector3.Normalize(normals[i]);
+
+            for (int i = 0; i < count; i++)
+                WriteJointWeights(weights.Slice(i * influenceCount, influenceCount), data.Joints.AsSpan((start + i) * MAX_JOINTS_PER_VERTEX, MAX_JOINTS_PER_VERTEX),
+                                  out data.Weights[start + i]);
+
+            data.VertexCount += count;
+        }
+
+        /// <summary>
+        /// Keeps the strongest influences of a vertex, renormalized so they still add up to 1.
+        /// </summary>
+        private static void WriteJointWeights(Span<NodeWeight> influences, Span<ushort> joints, out Vector4 weights)
+        {
+            // Sort the few influences by descending weight
+            for (int i = 1; i < influences.Length; i++)
+            {
+                var influence = influences[i];
+                var j = i - 1;
+                for (; j >= 0 && influences[j].Weight < influence.Weight; j--)
+                    influences[j + 1] = influences[j];
+
+                influences[j + 1] = influence;
+            }
+
+            Span<float> values = stackalloc float[MAX_JOINTS_PER_VERTEX];
+            var total = 0f;
+            for (int i = 0; i < MAX_JOINTS_PER_VERTEX; i++)
+            {
+                if (i < influences.Length && influences[i].Weight > 0)
+                {
+                    joints[i] = (ushort)influences[i].NodeIndex;
+                    values[i] = influences[i].Weight;
+                    total += values[i];
+                }
+                else
+                {
+                    joints[i] = 0;
+                    values[i] = 0;
+                }
+            }
+
+            if (total <= 0)
+            {
+                joints[0] = influences.Length > 0 ? (ushort)influences[0].NodeIndex : (ushort)0;
+                weights = Vector4.UnitX;
+                return;
+            }
+
+            weights = new Vector4(values[0], values[1], values[2], values[3]) / total;
+        }
+
+        private static JArray ConvertMorphTargets(MeshType5 mesh, Matrix4x4 worldTransform, GltfBuilder builder)
+        {
+            var basePositions = mesh.BlendShapes[0].Positions;
+            var baseNormals = mesh.BlendShapes[0].Normals;
+            var positionDeltas = new Vector3[basePositions.Length];
+            var normalDeltas = new Vector3[basePositions.Length];
+
+            var targets = new JArray();
+            for (int i = 1; i < mesh.BlendShapes.Count; i++)
+            {
+                // Shape positions are offsets from the base, so only the linear part of the transform applies to them
+                var shape = mesh.BlendShapes[i];
+                for (int j = 0; j < basePositions.Length; j++)
+                {
+                    positionDeltas[j] = Vector3.TransformNormal(shape.Positions[j], worldTransform);
+
+                    var baseNormal = Vector3.Normalize(Vector3.TransformNormal(baseNormals[j], worldTransform));
+                    var normal = Vector3.Normalize(Vector3.TransformNormal(Vector3.Normalize(shape.Normals[j] + baseNormals[j]), worldTransform));
+                    normalDeltas[j] = normal - baseNormal;
+                }
+
+                var positionView = builder.AddBufferView<Vector3>(positionDeltas, TARGET_ARRAY_BUFFER);
+                var positionAccessor = builder.AddAccessor(positionView, COMPONENT_FLOAT, positionDeltas.Length, "VEC3");
+                AddBounds(builder.Accessors[positionAccessor], positionDeltas);
+
+                var normalView = builder.AddBufferView<Vector3>(normalDeltas, TARGET_ARRAY_BUFFER);
+                targets.Add(new JObject
+                {
+                    ["POSITION"] = positionAccessor,
+                    ["NORMAL"] = builder.AddAccessor(normalView, COMPONENT_FLOAT, normalDeltas.Length, "VEC3"),
+                });
+            }
+
+            return targets;
+        }
+
+        private static JObject WritePrimitive(PrimitiveData data, int materialIndex, int materialCount, GltfBuilder builder)
+        {
+            var vertexCount = data.VertexCount;
+            var attributes = new JObject();
+
+            var positions = data.Positions.AsSpan(0, vertexCount);
+            var positionAccessor = builder.AddAccessor(builder.AddBufferView<Vector3>(positions, TARGET_ARRAY_BUFFER), COMPONENT_FLOAT, vertexCount, "VEC3");
+            AddBounds(builder.Accessors[positionAccessor], positions);
+            attributes["POSITION"] = positionAccessor;
+
+            if (data.HasNormals)
+            {
+                var view = builder.AddBufferView<Vector3>(data.Normals.AsSpan(0, vertexCount), TARGET_ARRAY_BUFFER);
+                attributes["NORMAL"] = builder.AddAccessor(view, COMPONENT_FLOAT, vertexCount, "VEC3");
+            }
+
+            if (data.HasTexCoords)
+            {
+                var view = builder.AddBufferView<Vector2>(data.TexCoords.AsSpan(0, vertexCount), TARGET_ARRAY_BUFFER);
+                attributes["TEXCOORD_0"] = builder.AddAccessor(view, COMPONENT_FLOAT, vertexCount, "VEC2");
+            }
+
+            if (data.HasTexCoords2)
+            {
+                var view = builder.AddBufferView<Vector2>(data.TexCoords2.AsSpan(0, vertexCount), TARGET_ARRAY_BUFFER);
+                attributes["TEXCOORD_1"] = builder.AddAccessor(view, COMPONENT_FLOAT, vertexCount, "VEC2");
+            }
+
+            if (data.HasColors)
+            {
+                var view = builder.AddBufferView<Vector4>(data.Colors.AsSpan(0, vertexCount), TARGET_ARRAY_BUFFER);
+                attributes["COLOR_0"] = builder.AddAccessor(view, COMPONENT_FLOAT, vertexCount, "VEC4");
+            }
+
+            var jointsView = builder.AddBufferView<ushort>(data.Joints.AsSpan(0, vertexCount * MAX_JOINTS_PER_VERTEX), TARGET_ARRAY_BUFFER);
+            attributes["JOINTS_0"] = builder.AddAccessor(jointsView, COMPONENT_UNSIGNED_SHORT, vertexCount, "VEC4");
+
+            var weightsView = builder.AddBufferView<Vector4>(data.Weights.AsSpan(0, vertexCount), TARGET_ARRAY_BUFFER);
+            attributes["WEIGHTS_0"] = builder.AddAccessor(weightsView, COMPONENT_FLOAT, vertexCount, "VEC4");
+
+            // glTF reserves the largest index value, so short indices only address the first 65535 vertices
+            int indicesAccessor;
+            if (vertexCount > ushort.MaxValue)
+            {
+                var indicesView = builder.AddBufferView<uint>(data.Indices.AsSpan(0, data.IndexCount), TARGET_ELEMENT_ARRAY_BUFFER);
+                indicesAccessor = builder.AddAccessor(indicesView, COMPONENT_UNSIGNED_INT, data.IndexCount, "SCALAR");
+            }
+            else
+            {
+                var indicesView = builder.AddBufferView<ushort>(data.GetShortIndices(), TARGET_ELEMENT_ARRAY_BUFFER);
+                indicesAccessor = builder.AddAccessor(indicesView, COMPONENT_UNSIGNED_SHORT, data.IndexCount, "SCALAR");
+            }
+
+            var primitive = new JObject
+            {
+                ["attributes"] = attributes,
+                ["indices"] = indicesAccessor,
+            };
+
+            if (materialIndex >= 0 && materialIndex < materialCount)
+                primitive["material"] = materialIndex;
+
+            return primitive;
+        }
+
+        private static void ConvertMotionPacks(Model model, IList<MotionPack> motionPacks, GltfBuilder builder)
+        {
+            for (int i = 0; i < motionPacks.Count; i++)
+            {
+                for (int j = 0; j < motionPacks[i].Motions.Count; j++)
+                {
+                    // Unused motion slots are null
+                    var motion = motionPacks[i].Motions[j];
+                    if (motion == null)
+                        continue;
+
+                    var name = motionPacks.Count == 1 ? $"motion_{j}" : $"mp_{i}_motion_{j}";
+                    var animation = ConvertMotion(model, motion, name, builder);
+                    if (animation != null)
+                        builder.Animations.Add(animation);
+                }
+            }
+        }
+
+        private static JObject ConvertMotion(Model model, Motion motion, string name, GltfBuilder builder)
+        {
+            var channels = new JArray();
+            var samplers = new JArray();
+
+            foreach (var controller in motion.Controllers)
+            {
+                var keys = controller.Keys;
+                if (controller.NodeIndex < 0 || controller.NodeIndex >= model.Nodes.Count || keys.Count == 0)
+                    continue;
+
+                string path;
+                if (controller.Type == ControllerType.Position && keys.Format == KeyFormat.Vector3)
+                    path = "translation";
+                else if (controller.Type == ControllerType.Scale && keys.Format == KeyFormat.Vector3)
+                    path = "scale";
+                else if (controller.Type == ControllerType.Rotation && keys.Format == KeyFormat.Quaternion)
+                    path = "rotation";
+                else
+                    continue;
+
+                var indices = keys.GetSortedDistinctIndices();
+                var keyTimes = keys.Times;
+                var times = new float[indices.Length];
+                for (int i = 0; i < indices.Length; i++)
+                    times[i] = keyTimes[indices[i]] / FRAMES_PER_SECOND;
+
+                var inputAccessor = builder.AddAccessor(builder.AddBufferView<float>(times, null), COMPONENT_FLOAT, times.Length, "SCALAR");
+                builder.Accessors[inputAccessor]["min"] = new JArray(times[0]);
+                builder.Accessors[inputAccessor]["max"] = new JArray(times[times.Length - 1]);
+
+                int outputAccessor;
+                if (controller.Type == ControllerType.Rotation)
+                {
+                    // Key rotations are stored inverted compared to the node rotations
+                    var keyValues = keys.GetQuaternionValues();
+                    var values = new Quaternion[indices.Length];
+                    for (int i = 0; i < indices.Length; i++)
+                    {
+                        values[i] = Quaternion.Normalize(Quaternion.Inverse(keyValues[indices[i]]));
+
+                        // Keep consecutive keys in the same hemisphere so the interpolation takes the short way around
+                        if (i > 0 && Quaternion.Dot(values[i - 1], values[i]) < 0)
+                            values[i] = Quaternion.Negate(values[i]);
+                    }
+
+                    outputAccessor = builder.AddAccessor(builder.AddBufferView<Quaternion>(values, null), COMPONENT_FLOAT, values.Length, "VEC4");
+                }
+                else
+                {
+                    var keyValues = keys.GetVector3Values();
+                    var values = new Vector3[indices.Length];
+                    for (int i = 0; i < indices.Length; i++)
+                        values[i] = keyValues[indices[i]];
+
+                    outputAccessor = builder.AddAccessor(builder.AddBufferView<Vector3>(values, null), COMPONENT_FLOAT, values.Length, "VEC3");
+                }
+
+                samplers.Add(new JObject { ["input"] = inputAccessor, ["output"] = outputAccessor, ["interpolation"] = "LINEAR" });
+                channels.Add(new JObject
+                {
+                    ["sampler"] = samplers.Count - 1,
+                    ["target"] = new JObject { ["node"] = controller.NodeIndex, ["path"] = path },
+                });
+            }
+
+            if (channels.Count == 0)
+                return null;
+
+            return new JObject { ["name"] = name, ["channels"] = channels, ["samplers"] = samplers };
+        }
+
+        private static void AddBounds(JToken accessor, ReadOnlySpan<Vector3> values)
+        {
+            var min = new Vector3(float.MaxValue);
+            var max = new Vector3(float.MinValue);
+            for (int i = 0; i < values.Length; i++)
+            {
+                min = Vector3.Min(min, values[i]);
+                max = Vector3.Max(max, values[i]);
+            }
+
+            accessor["min"] = ToJArray(min);
+            accessor["max"] = ToJArray(max);
+        }
+
+        private static JArray ToJArray(Vector3 value) => new JArray(value.X, value.Y, value.Z);
+
+        private static string FormatTextureName(int textureIndex) => $"texture_{textureIndex:D2}";
+
+        private static string FormatMaterialName(Material material, int index)
+        {
+            var name = $"material_{index:D2}";
+            if (MaterialPresetStore.TryGetPresetId(material, out var presetId))
+                name += $"@ps({presetId})";
+
+            return name;
+        }
+
+        private static string FormatNodeName(Node node, int index) => node.Name ?? $"node_{index:D2}";
+
+        /// <summary>
+        /// The vertex streams of a single primitive, reused for every mesh.
+        /// Attributes missing from some of the batches of a mesh are filled with defaults, so every stream covers all vertices.
+        /// </summary>
+        private sealed class PrimitiveData
+        {
+            public Vector3[] Positions = new Vector3[256];
+            public Vector3[] Normals = new Vector3[256];
+            public Vector2[] TexCoords = new Vector2[256];
+            public Vector2[] TexCoords2 = new Vector2[256];
+            public Vector4[] Colors = new Vector4[256];
+            public ushort[] Joints = new ushort[256 * MAX_JOINTS_PER_VERTEX];
+            public Vector4[] Weights = new Vector4[256];
+            public NodeWeight[] NodeWeights = new NodeWeight[256];
+            public uint[] Indices = new uint[768];
+            public ushort[] ShortIndices = new ushort[768];
+            public int VertexCount;
+            public int IndexCount;
+            public bool HasNormals;
+            public bool HasTexCoords;
+            public bool HasTexCoords2;
+            public bool HasColors;
+
+            public void Clear()
+            {
+                VertexCount = IndexCount = 0;
+                HasNormals = HasTexCoords = HasTexCoords2 = HasColors = false;
+            }
+
+            public void Grow(int vertexCount, int nodeWeightCount)
+            {
+                if (vertexCount > Positions.Length)
+                {
+                    var capacity = Math.Max(vertexCount, Positions.Length * 2);
+                    Array.Resize(ref Positions, capacity);
+                    Array.Resize(ref Normals, capacity);
+                    Array.Resize(ref TexCoords, capacity);
+                    Array.Resize(ref TexCoords2, capacity);
+                    Array.Resize(ref Colors, capacity);
+                    Array.Resize(ref Joints, capacity * MAX_JOINTS_PER_VERTEX);
+                    Array.Resize(ref Weights, capacity);
+                }
+
+                if (nodeWeightCount > NodeWeights.Length)
+                    Array.Resize(ref NodeWeights, Math.Max(nodeWeightCount, NodeWeights.Length * 2));
+            }
+
+            public bool PrepareNormals(int start, int count, bool isPresent)
+            {
+                return Prepare(ref HasNormals, Normals, start, count, isPresent, Vector3.UnitY);
+            }
+
+            public void SetTexCoords(int start, int count, Vector2[] texCoords, Vector2[] texCoords2)
+            {
+                if (Prepare(ref HasTexCoords, TexCoords, start, count, texCoords != null, Vector2.Zero))
+                    texCoords.AsSpan(0, count).CopyTo(TexCoords.AsSpan(start));
+
+                SetTexCoords2(start, count, texCoords2);
+            }
+
+            public void SetTexCoords2(int start, int count, Vector2[] texCoords2)
+            {
+                if (Prepare(ref HasTexCoords2, TexCoords2, start, count, texCoords2 != null, Vector2.Zero))
+                    texCoords2.AsSpan(0, count).CopyTo(TexCoords2.AsSpan(start));
+            }
+
+            public void SetColors(int start, int count, Color[] colors)
+            {
+                if (!Prepare(ref HasColors, Colors, start, count, colors != null, Vector4.One))
+                    return;
+
+                // Alpha is stored in the PS2 range, where 0x80 is opaque
+                for (int i = 0; i < count; i++)
+                {
+                    var color = colors[i];
+                    Colors[start + i] = new Vector4(color.R / 255f, color.G / 255f, color.B / 255f, Math.Min(color.A / 128f, 1f));
+                }
+            }
+
+            public void AddTriangles(Triangle[] triangles, int baseVertex)
+            {
+                var count = triangles.Length * 3;
+                if (IndexCount + count > Indices.Length)
+                    Array.Resize(ref Indices, Math.Max(IndexCount + count, Indices.Length * 2));
+
+                // The base vertex can push indices past the range of a ushort, so they're widened
+                for (int i = 0; i < triangles.Length; i++)
+                {
+                    var triangle = triangles[i];
+                    Indices[IndexCount++] = (uint)(triangle.A + baseVertex);
+                    Indices[IndexCount++] = (uint)(triangle.B + baseVertex);
+                    Indices[IndexCount++] = (uint)(triangle.C + baseVertex);
+                }
+            }
+
+            /// <summary>
+            /// Gets the indices narrowed to ushort, for primitives with at most 65535 vertices.
+            /// </summary>
+            public ReadOnlySpan<ushort> GetShortIndices()
+            {
+                if (IndexCount > ShortIndices.Length)
+                    ShortIndices = new ushort[Math.Max(IndexCount, ShortIndices.Length * 2)];
+
+                for (int i = 0; i < IndexCount; i++)
+                    ShortIndices[i] = (ushort)Indices[i];
+
+                return ShortIndices.AsSpan(0, IndexCount);
+            }
+
+            /// <summary>
+            /// Fills in defaults where a stream is used by some vertices but not others, and returns whether the range should be written.
+            /// </summary>
+            private bool Prepare<T>(ref bool isUsed, T[] values, int start, int count, bool isPresent, T fallback)
+            {
+                if (isPresent && !isUsed)
+                {
+                    values.AsSpan(0, start).Fill(fallback);
+                    isUsed = true;
+                }
+                else if (!isPresent && isUsed)
+                {
+                    values.AsSpan(start, count).Fill(fallback);
+                }
+
+                return isPresent;
+            }
+        }
+
+        /// <summary>
+        /// Collects the JSON document and the binary chunk of a GLB file.
+        /// </summary>
+        private sealed class GltfBuilder
+        {
+            private byte[] mBuffer = new byte[64 * 1024];
+            private int mBufferLength;
+
+            public JArray SceneNodes { get; } = new JArray();
+            public JArray Nodes { get; } = new JArray();
+            public JArray Meshes { get; } = new JArray();
+            public JArray Materials { get; } = new JArray();
+            public JArray Textures { get; } = new JArray();
+            public JArray Images { get; } = new JArray();
+            public JArray Samplers { get; } = new JArray();
+            public JArray Skins { get; } = new JArray();
+            public JArray Animations { get; } = new JArray();
+            public JArray Accessors { get; } = new JArray();
+            public JArray BufferViews { get; } = new JArray();
+
+            /// <summary>
+            /// Copies the data into the binary chunk, aligned to 4 bytes as required for every accessor component type.
+            /// </summary>
+            public int AddBufferView<T>(ReadOnlySpan<T> data, int? target) where T : struct
+            {
+                var bytes = MemoryMarshal.AsBytes(data);
+                var offset = (mBufferLength + 3) & ~3;
+                if (offset + bytes.Length > mBuffer.Length)
+                    Array.Resize(ref mBuffer, Math.Max(offset + bytes.Length, mBuffer.Length * 2));
+
+                mBuffer.AsSpan(mBufferLength, offset - mBufferLength).Clear();
+                bytes.CopyTo(mBuffer.AsSpan(offset));
+                mBufferLength = offset + bytes.Length;
+
+                var bufferView = new JObject { ["buffer"] = 0, ["byteOffset"] = offset, ["byteLength"] = bytes.Length };
+                if (target != null)
+                    bufferView["target"] = target.Value;
+
+                BufferViews.Add(bufferView);
+                return BufferViews.Count - 1;
+            }
+
+            public int AddAccessor(int bufferView, int componentType, int count, string type, bool normalized = false)
+            {
+                var accessor = new JObject { ["bufferView"] = bufferView, ["componentType"] = componentType, ["count"] = count, ["type"] = type };
+                if (normalized)
+                    accessor["normalized"] = true;
+
+                Accessors.Add(accessor);
+                return Accessors.Count - 1;
+            }
+
+            public void Write(Stream stream)
+            {
+                var root = new JObject
+                {
+                    ["asset"] = new JObject { ["version"] = "2.0", ["generator"] = "DDS3ModelLibrary" },
+                    ["scene"] = 0,
+                    ["scenes"] = new JArray(new JObject { ["nodes"] = SceneNodes }),
+                };
+
+                AddIfNotEmpty(root, "nodes", Nodes);
+                AddIfNotEmpty(root, "meshes", Meshes);
+                AddIfNotEmpty(root, "materials", Materials);
+                AddIfNotEmpty(root, "textures", Textures);
+                AddIfNotEmpty(root, "images", Images);
+                AddIfNotEmpty(root, "samplers", Samplers);
+                AddIfNotEmpty(root, "skins", Skins);
+                AddIfNotEmpty(root, "animations", Animations);
+                AddIfNotEmpty(root, "accessors", Accessors);
+                AddIfNotEmpty(root, "bufferViews", BufferViews);
+
+                var binLength = (mBufferLength + 3) & ~3;
+                if (mBufferLength > 0)
+                    root["buffers"] = new JArray(new JObject { ["byteLength"] = binLength });
+
+                // Chunks are padded to 4 bytes, the JSON chunk with spaces and the binary chunk with zeroes
+                var json = Encoding.UTF8.GetBytes(root.ToString(Formatting.None));
+                var jsonLength = (json.Length + 3) & ~3;
+                var totalLength = 12 + 8 + jsonLength + (mBufferLength > 0 ? 8 + binLength : 0);
+
+                using (var writer = new BinaryWriter(stream, Encoding.UTF8, true))
+                {
+                    writer.Write(GLB_MAGIC);
+                    writer.Write(GLB_VERSION);
+                    writer.Write(totalLength);
+
+                    writer.Write(jsonLength);
+                    writer.Write(GLB_CHUNK_JSON);
+                    writer.Write(json);
+                    for (int i = json.Length; i < jsonLength; i++)
+                        writer.Write((byte)' ');
+
+                    if (mBufferLength > 0)
+                    {
+                        writer.Write(binLength);
+                        writer.Write(GLB_CHUNK_BIN);
+                        writer.Write(mBuffer, 0, mBufferLength);
+                        for (int i = mBufferLength; i < binLength; i++)
+                            writer.Write((byte)0);
+                    }
+                }
+            }
+
+            private static void AddIfNotEmpty(JObject root, string name, JArray array)
+            {
+                if (array.Count > 0)
+                    root[name] = array;
+            }
+        }
+    }
+}
@@ -0,0 +1,421 @@
+﻿using DDS3ModelLibrary.Models.Utilities;
+using System;
+using System.Collections.Generic;
+using System.Numerics;
+
+namespace DDS3ModelLibrary.Models.Field
+{
+    /// <summary>
+    /// Calculates the bounds of the model objects of a field scene and keeps them in a bounding volume hierarchy for spatial queries.
+    /// Objects sharing a model share its cached bounds. After moving an object or changing its model, call <see cref="Update(FieldObject)"/>
+    /// or <see cref="Invalidate(Model)"/> to refit the hierarchy. Adding or removing objects requires a <see cref="Rebuild"/>.
+    /// </summary>
+    public class FieldSceneBounds
+    {
+        private const int LEAF_SIZE = 4;
+        private const int MAX_DEPTH = 64;
+
+        private readonly Dictionary<Model, ModelBounds> mModelBounds;
+        private readonly Dictionary<FieldObject, int> mObjectIndices;
+        private readonly List<FieldObject> mObjects;
+        private Vector3[] mObjectMin;
+        private Vector3[] mObjectMax;
+        private BoundingSphere[] mObjectSpheres;
+        private int[] mObjectLeaves;
+
+        // Hierarchy nodes are laid out depth first, so the left child of an inner node directly follows it
+        private int mNodeCount;
+        private Vector3[] mNodeMin;
+        private Vector3[] mNodeMax;
+        private int[] mNodeParents;
+        private int[] mNodeRights;
+        private int[] mNodeStarts;
+        private int[] mNodeCounts;
+        private int[] mLeafObjects;
+
+        public FieldScene Scene { get; }
+
+        /// <summary>
+        /// Gets the objects that have bounds, ie. model objects with geometry.
+        /// </summary>
+        public IReadOnlyList<FieldObject> Objects => mObjects;
+
+        /// <summary>
+        /// Gets the bounding box of the scene, or null if no object has bounds.
+        /// </summary>
+        public BoundingBox BoundingBox => mNodeCount == 0 ? null : new BoundingBox(mNodeMin[0], mNodeMax[0]);
+
+        public FieldSceneBounds(FieldScene scene)
+        {
+            Scene = scene;
+            mModelBounds = new Dictionary<Model, ModelBounds>();
+            mObjectIndices = new Dictionary<FieldObject, int>();
+            mObjects = new List<FieldObject>();
+            Rebuild();
+        }
+
+        /// <summary>
+        /// Gets the bounding box of an object in scene space, or null if it has no bounds.
+        /// </summary>
+        public BoundingBox GetBoundingBox(FieldObject obj)
+        {
+            if (!mObjectIndices.TryGetValue(obj, out var index))
+                return null;
+
+            return new BoundingBox(mObjectMin[index], mObjectMax[index]);
+        }
+
+        /// <summary>
+        /// Gets the bounding sphere of an object in scene space.
+        /// </summary>
+        public BoundingSphere GetBoundingSphere(FieldObject obj)
+        {
+            return mObjectIndices.TryGetValue(obj, out var index) ? mObjectSpheres[index] : default;
+        }
+
+        /// <summary>
+        /// Gets the cached bounds of a model used by the scene.
+        /// </summary>
+        public ModelBounds GetModelBounds(Model model)
+        {
+            if (!mModelBounds.TryGetValue(model, out var bounds))
+                mModelBounds[model] = bounds = new ModelBounds(model);
+
+            return bounds;
+        }
+
+        /// <summary>
+        /// Recalculates the bounds of an object that was moved or whose model changed, and refits the hierarchy above it.
+        /// </summary>
+        public void Update(FieldObject obj)
+        {
+            if (!mObjectIndices.TryGetValue(obj, out var index))
+            {
+                // The object may not have had bounds before
+                if (obj.Resource is Model)
+                    Rebuild();
+
+                return;
+            }
+
+            if (!CalculateObjectBounds(index))
+            {
+                Rebuild();
+                return;
+            }
+
+            Refit(mObjectLeaves[index]);
+        }
+
+        /// <summary>
+        /// Marks the geometry of a model as changed, and updates all objects that use it.
+        /// </summary>
+        public void Invalidate(Model model)
+        {
+            GetModelBounds(model).Invalidate();
+            for (int i = 0; i < mObjects.Count; i++)
+            {
+                if (mObjects[i].Resource != model)
+                    continue;
+
+                if (!CalculateObjectBounds(i))
+                {
+                    // The model no longer has any geometry
+                    Rebuild();
+                    return;
+                }
+
+                Refit(mObjectLeaves[i]);
+            }
+        }
+
+        /// <summary>
+        /// Recalculates the bounds of all objects and rebuilds the hierarchy.
+        /// </summary>
+        public void Rebuild()
+        {
+            mObjects.Clear();
+            mObjectIndices.Clear();
+            foreach (var obj in Scene.Objects)
+            {
+                if (obj.Resource is Model model && GetModelBounds(model).GetBoundingBox() != null)
+                {
+                    mObjectIndices[obj] = mObjects.Count;
+                    mObjects.Add(obj);
+                }
+            }
+
+            var count = mObjects.Count;
+            mObjectMin = new Vector3[count];
+            mObjectMax = new Vector3[count];
+            mObjectSpheres = new BoundingSphere[count];
+            mObjectLeaves = new int[count];
+            mLeafObjects = new int[count];
+            for (int i = 0; i < count; i++)
+            {
+                CalculateObjectBounds(i);
+                mLeafObjects[i] = i;
+            }
+
+            // A binary tree with at most one leaf per object
+            var maxNodeCount = Math.Max(1, 2 * count);
+            mNodeMin = new Vector3[maxNodeCount];
+            mNodeMax = new Vector3[maxNodeCount];
+            mNodeParents = new int[maxNodeCount];
+            mNodeRights = new int[maxNodeCount];
+            mNodeStarts = new int[maxNodeCount];
+            mNodeCounts = new int[maxNodeCount];
+            mNodeCount = 0;
+
+            if (count > 0)
+                BuildNode(0, count, -1, new float[count]);
+        }
+
+        /// <summary>
+        /// Finds the objects whose bounding box intersects the specified box.
+        /// </summary>
+        public void Query(BoundingBox box, List<FieldObject> results)
+        {
+            if (mNodeCount == 0)
+                return;
+
+            Span<int> stack = stackalloc int[MAX_DEPTH];
+            var stackCount = 0;
+            stack[stackCount++] = 0;
+            while (stackCount > 0)
+            {
+                var nodeIndex = stack[--stackCount];
+                if (!BoundsHelper.Intersects(mNodeMin[nodeIndex], mNodeMax[nodeIndex], box.Min, box.Max))
+                    continue;
+
+                if (mNodeCounts[nodeIndex] == 0)
+                {
+                    stack[stackCount++] = mNodeRights[nodeIndex];
+                    stack[stackCount++] = nodeIndex + 1;
+                    continue;
+                }
+
+                for (int i = mNodeStarts[nodeIndex]; i < mNodeStarts[nodeIndex] + mNodeCounts[nodeIndex]; i++)
+                {
+                    var objectIndex = mLeafObjects[i];
+                    if (BoundsHelper.Intersects(mObjectMin[objectIndex], mObjectMax[objectIndex], box.Min, box.Max))
+                        results.Add(mObjects[objectIndex]);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Finds the objects whose bounding sphere intersects the specified sphere.
+        /// </summary>
+        public void Query(BoundingSphere sphere, List<FieldObject> results)
+        {
+            if (mNodeCount == 0)
+                return;
+
+            var radiusSquared = sphere.Radius * sphere.Radius;
+            Span<int> stack = stackalloc int[MAX_DEPTH];
+            var stackCount = 0;
+            stack[stackCount++] = 0;
+            while (stackCount > 0)
+            {
+                var nodeIndex = stack[--stackCount];
+                if (BoundsHelper.GetDistanceSquared(mNodeMin[nodeIndex], mNodeMax[nodeIndex], sphere.Center) > radiusSquared)
+                    continue;
+
+                if (mNodeCounts[nodeIndex] == 0)
+                {
+                    stack[stackCount++] = mNodeRights[nodeIndex];
+                    stack[stackCount++] = nodeIndex + 1;
+                    continue;
+                }
+
+                for (int i = mNodeStarts[nodeIndex]; i < mNodeStarts[nodeIndex] + mNodeCounts[nodeIndex]; i++)
+                {
+                    var objectIndex = mLeafObjects[i];
+                    if (mObjectSpheres[objectIndex].Intersects(sphere))
+                        results.Add(mObjects[objectIndex]);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Finds the objects whose bounding box is at least partially in front of all planes, such as the planes of a view frustum.
+        /// </summary>
+        /// <param name="planes">The planes, with their normals facing inwards.</param>
+        /// <param name="results">The list to add the visible objects to.</param>
+        public void Query(ReadOnlySpan<Plane> planes, List<FieldObject> results)
+        {
+            if (mNodeCount == 0)
+                return;
+
+            Span<int> stack = stackalloc int[MAX_DEPTH];
+            var stackCount = 0;
+            stack[stackCount++] = 0;
+            while (stackCount > 0)
+            {
+                var nodeIndex = stack[--stackCount];
+                if (!BoundsHelper.Intersects(mNodeMin[nodeIndex], mNodeMax[nodeIndex], planes))
+                    continue;
+
+                if (mNodeCounts[nodeIndex] == 0)
+                {
+                    stack[stackCount++] = mNodeRights[nodeIndex];
+                    stack[stackCount++] = nodeIndex + 1;
+                    continue;
+                }
+
+                for (int i = mNodeStarts[nodeIndex]; i < mNodeStarts[nodeIndex] + mNodeCounts[nodeIndex]; i++)
+                {
+                    var objectIndex = mLeafObjects[i];
+                    if (BoundsHelper.Intersects(mObjectMin[objectIndex], mObjectMax[objectIndex], planes))
+                        results.Add(mObjects[objectIndex]);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Finds the object whose bounding box is hit first by a ray.
+        /// </summary>
+        /// <param name="origin">The origin of the ray.</param>
+        /// <param name="direction">The direction of the ray.</param>
+        /// <param name="maxDistance">The length of the ray, in units of the direction.</param>
+        /// <param name="distance">The distance at which the ray enters the bounding box of the object.</param>
+        /// <returns>The object, or null if the ray doesn't hit any.</returns>
+        public FieldObject Raycast(Vector3 origin, Vector3 direction, float maxDistance, out float distance)
+        {
+            FieldObject result = null;
+            distance = maxDistance;
+            if (mNodeCount == 0)
+                return null;
+
+            var inverseDirection = Vector3.One / direction;
+            Span<int> stack = stackalloc int[MAX_DEPTH];
+            var stackCount = 0;
+            stack[stackCount++] = 0;
+            while (stackCount > 0)
+            {
+                var nodeIndex = stack[--stackCount];
+                if (!BoundsHelper.Intersects(mNodeMin[nodeIndex], mNodeMax[nodeIndex], origin, inverseDirection, distance, out _))
+                    continue;
+
+                if (mNodeCounts[nodeIndex] == 0)
+                {
+                    stack[stackCount++] = mNodeRights[nodeIndex];
+                    stack[stackCount++] = nodeIndex + 1;
+                    continue;
+                }
+
+                for (int i = mNodeStarts[nodeIndex]; i < mNodeStarts[nodeIndex] + mNodeCounts[nodeIndex]; i++)
+                {
+                    var objectIndex = mLeafObjects[i];
+                    if (BoundsHelper.Intersects(mObjectMin[objectIndex], mObjectMax[objectIndex], origin, inverseDirection, distance, out var hitDistance))
+                    {
+                        result = mObjects[objectIndex];
+                        distance = hitDistance;
+                    }
+                }
+            }
+
+            return result;
+        }
+
+        private bool CalculateObjectBounds(int index)
+        {
+            var obj = mObjects[index];
+            if (!(obj.Resource is Model model))
+                return false;
+
+            var modelBounds = GetModelBounds(model);
+            var box = modelBounds.GetBoundingBox();
+            if (box == null)
+                return false;
+
+            var transform = obj.Transform?.Matrix ?? Matrix4x4.Identity;
+            BoundsHelper.Transform(box.Min, box.Max, transform, out mObjectMin[index], out mObjectMax[index]);
+            mObjectSpheres[index] = modelBounds.GetBoundingSphere().Transform(transform);
+            return true;
+        }
+
+        private int BuildNode(int start, int count, int parent, float[] keys)
+        {
+            var nodeIndex = mNodeCount++;
+            mNodeParents[nodeIndex] = parent;
+
+            // Gather the bounds of the objects and of their centers
+            var min = new Vector3(float.MaxValue);
+            var max = new Vector3(float.MinValue);
+            var centerMin = min;
+            var centerMax = max;
+            for (int i = start; i < start + count; i++)
+            {
+                var objectIndex = mLeafObjects[i];
+                min = Vector3.Min(min, mObjectMin[objectIndex]);
+                max = Vector3.Max(max, mObjectMax[objectIndex]);
+
+                var center = (mObjectMin[objectIndex] + mObjectMax[objectIndex]) * 0.5f;
+                centerMin = Vector3.Min(centerMin, center);
+                centerMax = Vector3.Max(centerMax, center);
+            }
+
+            mNodeMin[nodeIndex] = min;
+            mNodeMax[nodeIndex] = max;
+
+            var centerSize = centerMax - centerMin;
+            if (count <= LEAF_SIZE || centerSize == Vector3.Zero)
+            {
+                mNodeStarts[nodeIndex] = start;
+                mNodeCounts[nodeIndex] = count;
+                for (int i = start; i < start + count; i++)
+                    mObjectLeaves[mLeafObjects[i]] = nodeIndex;
+
+                return nodeIndex;
+            }
+
+            // Split at the median of the object centers along the longest axis
+            var axis = centerSize.X >= centerSize.Y && centerSize.X >= centerSize.Z ? 0 : centerSize.Y >= centerSize.Z ? 1 : 2;
+            for (int i = start; i < start + count; i++)
+            {
+                var objectIndex = mLeafObjects[i];
+                var center = (mObjectMin[objectIndex] + mObjectMax[objectIndex]) * 0.5f;
+                keys[i] = axis == 0 ? center.X : axis == 1 ? center.Y : center.Z;
+            }
+
+            Array.Sort(keys, mLeafObjects, start, count);
+
+            var leftCount = count / 2;
+            mNodeCounts[nodeIndex] = 0;
+            BuildNode(start, leftCount, nodeIndex, keys);
+            mNodeRights[nodeIndex] = BuildNode(start + leftCount, count - leftCount, nodeIndex, keys);
+            return nodeIndex;
+        }
+
+        private void Refit(int nodeIndex)
+        {
+            while (nodeIndex != -1)
+            {
+                var min = new Vector3(float.MaxValue);
+                var max = new Vector3(float.MinValue);
+                if (mNodeCounts[nodeIndex] == 0)
+                {
+                    var left = nodeIndex + 1;
+                    var right = mNodeRights[nodeIndex];
+                    min = Vector3.Min(mNodeMin[left], mNodeMin[right]);
+                    max = Vector3.Max(mNodeMax[left], mNodeMax[right]);
+                }
+                else
+                {
+                    for (int i = mNodeStarts[nodeIndex]; i < mNodeStarts[nodeIndex] + mNodeCounts[nodeIndex]; i++)
+                    {
+                        var objectIndex = mLeafObjects[i];
+                        min = Vector3.Min(min, mObjectMin[objectIndex]);
+                        max = Vector3.Max(max, mObjectMax[objectIndex]);
+                    }
+                }
+
+                mNodeMin[nodeIndex] = min;
+                mNodeMax[nodeIndex] = max;
+                nodeIndex = mNodeParents[nodeIndex];
+            }
+        }
+    }
+}
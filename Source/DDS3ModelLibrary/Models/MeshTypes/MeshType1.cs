@@ -51,13 +51,17 @@ namespace DDS3ModelLibrary.Models
             writer.ScheduleWriteOffset(() =>
             {
                 // Build vif code stream
-                var vif = new VifCodeStreamBuilder();
-                foreach (var batch in Batches)
-                    writer.WriteObject(batch, vif);
+                long vifCodeStreamStart;
+                using (var vif = new VifCodeStreamBuilder())
+                {
+                    foreach (var batch in Batches)
+                        writer.WriteObject(batch, vif);
+
+                    // Write vif code stream
+                    vifCodeStreamStart = writer.Position;
+                    writer.WriteObject(vif);
+                }
 
-                // Write vif code stream
-                var vifCodeStreamStart = writer.Position;
-                writer.WriteObject(vif);
                 var vifCodeStreamEnd = writer.Position;
 
                 // Calculate and write vif code stream size in the header
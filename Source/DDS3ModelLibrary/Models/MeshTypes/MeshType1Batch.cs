@@ -175,7 +175,7 @@ namespace DDS3ModelLibrary.Models
             var nextAddress = 8;
 
             // Triangles
-            vif.Unpack(nextAddress, Triangles.Select(x => new sbyte[] { (sbyte)x.A, (sbyte)x.B, (sbyte)x.C, 0 }).ToArray());
+            vif.Unpack(nextAddress, Triangles);
             nextAddress = AlignmentHelper.Align(nextAddress + ((TriangleCount * 4) * 2), 8);
 
             // Positions
@@ -216,7 +216,7 @@ namespace DDS3ModelLibrary.Models
             }
 
             if (Flags.HasFlag(MeshFlags.Color))
-                vif.Unpack(nextAddress, Colors.Select(x => new[] { (sbyte)x.R, (sbyte)x.G, (sbyte)x.B, (sbyte)x.A }).ToArray());
+                vif.Unpack(nextAddress, Colors);
 
             vif.ActivateMicro((ushort)(RenderMode == MeshBatchRenderMode.Mode1 ? 0x0C : 0x10));
         }
@@ -124,7 +124,7 @@ namespace DDS3ModelLibrary.Models
             if (context.IsLastBatch)
             {
                 // Triangles
-                vif.Unpack(nextAddress, context.Triangles.Select(x => new sbyte[] { (sbyte)x.A, (sbyte)x.B, (sbyte)x.C, 0 }).ToArray());
+                vif.Unpack(nextAddress, context.Triangles);
                 nextAddress = AlignmentHelper.Align(nextAddress + ((context.Triangles.Length * 4) * 2), 8);
             }
 
@@ -169,8 +169,7 @@ namespace DDS3ModelLibrary.Models
 
                 if (Flags.HasFlag(MeshFlags.Color))
                 {
-                    vif.Unpack(nextAddress,
-                                context.Colors.Select(x => new[] { (sbyte)x.R, (sbyte)x.G, (sbyte)x.B, (sbyte)x.A }).ToArray());
+                    vif.Unpack(nextAddress, context.Colors);
                 }
             }
 
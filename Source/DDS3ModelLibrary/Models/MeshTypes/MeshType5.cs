@@ -1,4 +1,5 @@
 ﻿using DDS3ModelLibrary.IO.Common;
+using DDS3ModelLibrary.Models.Utilities;
 using System;
 using System.Collections.Generic;
 using System.Diagnostics;
@@ -106,29 +107,36 @@ namespace DDS3ModelLibrary.Models
         {
             var positions = new Vector3[VertexCount];
             var normals = new Vector3[positions.Length];
-            var weights = new NodeWeight[positions.Length][];
-            for (int i = 0; i < weights.Length; i++)
-                weights[i] = new NodeWeight[UsedNodeCount];
+            var weights = new NodeWeight[positions.Length * UsedNodeCount];
+            Transform(nodes, positions, normals, weights);
+            return (positions, normals, SkinningHelper.ToVertexWeights(weights, UsedNodeCount));
+        }
+
+        /// <summary>
+        /// Transforms the vertices to world space into the given buffers.
+        /// </summary>
+        /// <param name="nodes">The nodes of the model.</param>
+        /// <param name="positions">The buffer to write the positions to.</param>
+        /// <param name="normals">The buffer to write the normals to. May be empty to skip normals.</param>
+        /// <param name="weights">The buffer to write the weights of each vertex to, <see cref="UsedNodeCount"/> per vertex. May be empty to skip weights.</param>
+        public void Transform(List<Node> nodes, Span<Vector3> positions, Span<Vector3> normals, Span<NodeWeight> weights)
+        {
+            positions = positions.Slice(0, VertexCount);
+            positions.Clear();
+            if (!normals.IsEmpty)
+            {
+                normals = normals.Slice(0, VertexCount);
+                normals.Clear();
+            }
 
             for (var nodeBatchIndex = 0; nodeBatchIndex < NodeBatches.Count; nodeBatchIndex++)
             {
                 var nodeBatch = NodeBatches[nodeBatchIndex];
-                var nodeWorldTransform = nodes[nodeBatch.NodeIndex].WorldTransform;
+                SkinningHelper.AccumulateInfluence(nodeBatch.Positions, nodeBatch.Normals, nodes[nodeBatch.NodeIndex].WorldTransform, positions, normals);
 
-                for (int i = 0; i < nodeBatch.Positions.Length; i++)
-                {
-                    var position = new Vector3(nodeBatch.Positions[i].X, nodeBatch.Positions[i].Y,
-                                                nodeBatch.Positions[i].Z);
-                    var weight = nodeBatch.Positions[i].W;
-                    var weightedNodeWorldTransform = nodeWorldTransform * weight;
-                    var weightedWorldPosition = Vector3.Transform(position, weightedNodeWorldTransform);
-                    positions[i] += weightedWorldPosition;
-                    normals[i] += Vector3.TransformNormal(nodeBatch.Normals[i], weightedNodeWorldTransform);
-                    weights[i][nodeBatchIndex] = new NodeWeight(nodeBatch.NodeIndex, weight);
-                }
+                if (!weights.IsEmpty)
+                    SkinningHelper.WriteWeights(nodeBatch.Positions, nodeBatch.NodeIndex, nodeBatchIndex, UsedNodeCount, weights);
             }
-
-            return (positions, normals, weights);
         }
 
         protected override void Read(EndianBinaryReader reader)
@@ -108,17 +108,18 @@ namespace DDS3ModelLibrary.Models
 
             writer.Align(16);
 
-            var vifCmd = new VifCodeStreamBuilder();
-
-            // Writer batches
-            foreach (var batch in Batches)
+            using (var vifCmd = new VifCodeStreamBuilder())
             {
-                // TODO: change this
-                writer.WriteObject(batch, vifCmd);
+                // Writer batches
+                foreach (var batch in Batches)
+                {
+                    // TODO: change this
+                    writer.WriteObject(batch, vifCmd);
+                }
+
+                writer.WriteObject(vifCmd);
             }
 
-            writer.WriteObject(vifCmd);
-
             if (Flags.HasFlag(MeshFlags.TexCoord2))
             {
                 writer.Write(TexCoords2);
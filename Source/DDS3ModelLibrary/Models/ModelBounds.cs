@@ -0,0 +1,383 @@
+﻿using DDS3ModelLibrary.Models.Utilities;
+using System;
+using System.Buffers;
+using System.Collections.Generic;
+using System.Numerics;
+
+namespace DDS3ModelLibrary.Models
+{
+    /// <summary>
+    /// Calculates and caches the bounding boxes and spheres of the meshes and nodes of a model.
+    /// Node transform changes are picked up automatically and only update the affected world bounds. Weighted meshes are
+    /// recalculated as well, as their shape follows the nodes. Geometry changes must be reported with <see cref="Invalidate(int)"/>.
+    /// </summary>
+    public class ModelBounds
+    {
+        private class MeshEntry
+        {
+            public BoundingBox Box;
+            public BoundingSphere Sphere;
+            public bool IsWeighted;
+            public int TransformVersion;
+        }
+
+        private class NodeEntry
+        {
+            public readonly List<Mesh> Meshes = new List<Mesh>();
+            public bool IsDirty = true;
+            public bool IsWeighted;
+            public int TransformVersion;
+            public BoundingBox Box;
+            public BoundingSphere Sphere;
+            public int WorldTransformVersion = -1;
+            public BoundingBox WorldBox;
+            public BoundingSphere WorldSphere;
+        }
+
+        private readonly Dictionary<Mesh, MeshEntry> mMeshes;
+        private readonly List<NodeEntry> mNodes;
+        private int mModelVersion = -1;
+        private bool mIsModelDirty = true;
+        private BoundingBox mModelBox;
+        private BoundingSphere mModelSphere;
+
+        public Model Model { get; }
+
+        public ModelBounds(Model model)
+        {
+            Model = model;
+            mMeshes = new Dictionary<Mesh, MeshEntry>();
+            mNodes = new List<NodeEntry>(model.Nodes.Count);
+        }
+
+        /// <summary>
+        /// Gets the bounding box of a mesh, in the local space of the node it belongs to.
+        /// </summary>
+        public BoundingBox GetMeshBoundingBox(int nodeIndex, Mesh mesh) => GetMeshEntry(nodeIndex, mesh, GetTransformVersion()).Box;
+
+        /// <summary>
+        /// Gets the bounding sphere of a mesh, in the local space of the node it belongs to.
+        /// </summary>
+        public BoundingSphere GetMeshBoundingSphere(int nodeIndex, Mesh mesh) => GetMeshEntry(nodeIndex, mesh, GetTransformVersion()).Sphere;
+
+        /// <summary>
+        /// Gets the bounding box of the geometry of a node in its local space, or null if it has no geometry.
+        /// </summary>
+        public BoundingBox GetBoundingBox(int nodeIndex) => GetNodeEntry(nodeIndex, GetTransformVersion()).Box;
+
+        /// <summary>
+        /// Gets the bounding sphere of the geometry of a node in its local space.
+        /// </summary>
+        public BoundingSphere GetBoundingSphere(int nodeIndex) => GetNodeEntry(nodeIndex, GetTransformVersion()).Sphere;
+
+        /// <summary>
+        /// Gets the bounding box of the geometry of a node in model space, or null if it has no geometry.
+        /// </summary>
+        public BoundingBox GetWorldBoundingBox(int nodeIndex) => GetWorldNodeEntry(nodeIndex, GetTransformVersion()).WorldBox;
+
+        /// <summary>
+        /// Gets the bounding sphere of the geometry of a node in model space.
+        /// </summary>
+        public BoundingSphere GetWorldBoundingSphere(int nodeIndex) => GetWorldNodeEntry(nodeIndex, GetTransformVersion()).WorldSphere;
+
+        /// <summary>
+        /// Gets the bounding box of the model, or null if it has no geometry.
+        /// </summary>
+        public BoundingBox GetBoundingBox()
+        {
+            UpdateModel();
+            return mModelBox;
+        }
+
+        /// <summary>
+        /// Gets the bounding sphere of the model.
+        /// </summary>
+        public BoundingSphere GetBoundingSphere()
+        {
+            UpdateModel();
+            return mModelSphere;
+        }
+
+        /// <summary>
+        /// Marks the geometry of a node as changed.
+        /// </summary>
+        public void Invalidate(int nodeIndex)
+        {
+            if (nodeIndex >= mNodes.Count)
+                return;
+
+            var entry = mNodes[nodeIndex];
+            foreach (var mesh in entry.Meshes)
+                mMeshes.Remove(mesh);
+
+            entry.Meshes.Clear();
+            entry.IsDirty = true;
+            mIsModelDirty = true;
+        }
+
+        /// <summary>
+        /// Marks the geometry of all nodes as changed.
+        /// </summary>
+        public void Invalidate()
+        {
+            mMeshes.Clear();
+            mNodes.Clear();
+            mIsModelDirty = true;
+        }
+
+        /// <summary>
+        /// Stores the bounding boxes in the nodes that have geometry.
+        /// </summary>
+        public void Apply()
+        {
+            var transformVersion = GetTransformVersion();
+            for (int i = 0; i < Model.Nodes.Count; i++)
+            {
+                var box = GetNodeEntry(i, transformVersion).Box;
+                if (box != null)
+                    Model.Nodes[i].BoundingBox = box;
+            }
+        }
+
+        /// <summary>
+        /// Gets a value that changes whenever the transform or parent of a node of the model changes. Every change gives the root
+        /// of the hierarchy a version that is newer than all existing ones, so the newest version of the roots changes as well.
+        /// It's read once per call and passed down, so every entry of a call is checked against the same version.
+        /// </summary>
+        private int GetTransformVersion()
+        {
+            var version = 0;
+            foreach (var node in Model.Nodes)
+            {
+                if (node.Parent == null)
+                    version = Math.Max(version, node.TransformVersion);
+            }
+
+            return version;
+        }
+
+        private NodeEntry GetNodeEntry(int nodeIndex, int transformVersion)
+        {
+            while (mNodes.Count < Model.Nodes.Count)
+                mNodes.Add(new NodeEntry());
+
+            var entry = mNodes[nodeIndex];
+            if (!entry.IsDirty && !(entry.IsWeighted && entry.TransformVersion != transformVersion))
+                return entry;
+
+            entry.Box = null;
+            entry.Sphere = default;
+            entry.IsWeighted = false;
+            entry.Meshes.Clear();
+            entry.TransformVersion = transformVersion;
+
+            var geometry = Model.Nodes[nodeIndex].Geometry;
+            if (geometry != null)
+            {
+                foreach (var meshList in geometry.MeshLists)
+                {
+                    if (meshList == null)
+                        continue;
+
+                    foreach (var mesh in meshList)
+                    {
+                        var meshEntry = GetMeshEntry(nodeIndex, mesh, transformVersion);
+                        entry.Meshes.Add(mesh);
+                        if (meshEntry.Box == null)
+                            continue;
+
+                        entry.IsWeighted |= meshEntry.IsWeighted;
+                        if (entry.Box == null)
+                        {
+                            entry.Box = meshEntry.Box;
+                            entry.Sphere = meshEntry.Sphere;
+                        }
+                        else
+                        {
+                            entry.Box = BoundingBox.Merge(entry.Box, meshEntry.Box);
+                            entry.Sphere = BoundingSphere.Merge(entry.Sphere, meshEntry.Sphere);
+                        }
+                    }
+                }
+            }
+
+            entry.IsDirty = false;
+            entry.WorldTransformVersion = -1;
+            mIsModelDirty = true;
+            return entry;
+        }
+
+        private NodeEntry GetWorldNodeEntry(int nodeIndex, int transformVersion)
+        {
+            var entry = GetNodeEntry(nodeIndex, transformVersion);
+            if (entry.WorldTransformVersion == transformVersion)
+                return entry;
+
+            if (entry.Box != null)
+            {
+                var worldTransform = Model.Nodes[nodeIndex].WorldTransform;
+                entry.WorldBox = entry.Box.Transform(worldTransform);
+                entry.WorldSphere = entry.Sphere.Transform(worldTransform);
+            }
+            else
+            {
+                entry.WorldBox = null;
+                entry.WorldSphere = default;
+            }
+
+            entry.WorldTransformVersion = transformVersion;
+            return entry;
+        }
+
+        private void UpdateModel()
+        {
+            var transformVersion = GetTransformVersion();
+            if (!mIsModelDirty && mModelVersion == transformVersion)
+                return;
+
+            mModelVersion = transformVersion;
+            mModelBox = null;
+            mModelSphere = default;
+            for (int i = 0; i < Model.Nodes.Count; i++)
+            {
+                var entry = GetWorldNodeEntry(i, transformVersion);
+                if (entry.WorldBox == null)
+                    continue;
+
+                if (mModelBox == null)
+                {
+                    mModelBox = entry.WorldBox;
+                    mModelSphere = entry.WorldSphere;
+                }
+                else
+                {
+                    mModelBox = BoundingBox.Merge(mModelBox, entry.WorldBox);
+                    mModelSphere = BoundingSphere.Merge(mModelSphere, entry.WorldSphere);
+                }
+            }
+
+            mIsModelDirty = false;
+        }
+
+        private MeshEntry GetMeshEntry(int nodeIndex, Mesh mesh, int transformVersion)
+        {
+            if (mMeshes.TryGetValue(mesh, out var entry) && !(entry.IsWeighted && entry.TransformVersion != transformVersion))
+                return entry;
+
+            if (entry == null)
+                mMeshes[mesh] = entry = new MeshEntry();
+
+            entry.TransformVersion = transformVersion;
+            entry.IsWeighted = false;
+            entry.Box = null;
+            entry.Sphere = default;
+
+            var vertexCount = mesh is MeshType5 meshType5 && meshType5.NodeBatches.Count == 0
+                ? meshType5.VertexCount * meshType5.BlendShapeCount
+                : mesh.VertexCount;
+
+            if (vertexCount == 0)
+                return entry;
+
+            // Gather the positions in node space, so the sphere can be fitted around the center of the box
+            var buffer = ArrayPool<Vector3>.Shared.Rent(vertexCount);
+            try
+            {
+                var positions = buffer.AsSpan(0, vertexCount);
+                if (!GetLocalPositions(nodeIndex, mesh, positions, out entry.IsWeighted))
+                    return entry;
+
+                var min = new Vector3(float.MaxValue);
+                var max = new Vector3(float.MinValue);
+                BoundsHelper.Accumulate(positions, ref min, ref max);
+                entry.Box = new BoundingBox(min, max);
+                entry.Sphere = BoundingSphere.Calculate(positions, entry.Box.Center);
+            }
+            finally
+            {
+                ArrayPool<Vector3>.Shared.Return(buffer);
+            }
+
+            return entry;
+        }
+
+        private bool GetLocalPositions(int nodeIndex, Mesh mesh, Span<Vector3> positions, out bool isWeighted)
+        {
+            isWeighted = false;
+            var offset = 0;
+            switch (mesh)
+            {
+                case MeshType1 meshType1:
+                    foreach (var batch in meshType1.Batches)
+                    {
+                        batch.Positions.CopyTo(positions.Slice(offset));
+                        offset += batch.Positions.Length;
+                    }
+                    break;
+
+                case MeshType4 meshType4:
+                    meshType4.Positions.CopyTo(positions);
+                    break;
+
+                case MeshType8 meshType8:
+                    foreach (var batch in meshType8.Batches)
+                    {
+                        batch.Positions.CopyTo(positions.Slice(offset));
+                        offset += batch.Positions.Length;
+                    }
+                    break;
+
+                case MeshType5 meshType5 when meshType5.NodeBatches.Count == 0:
+                    // Every blend shape other than the first one is relative to the first one
+                    var basePositions = meshType5.BlendShapes[0].Positions;
+                    basePositions.CopyTo(positions);
+                    offset = basePositions.Length;
+                    for (int i = 1; i < meshType5.BlendShapes.Count; i++)
+                    {
+                        var shapePositions = meshType5.BlendShapes[i].Positions;
+                        for (int j = 0; j < shapePositions.Length; j++)
+                            positions[offset + j] = basePositions[j] + shapePositions[j];
+
+                        offset += shapePositions.Length;
+                    }
+                    break;
+
+                case MeshType5 meshType5:
+                    meshType5.Transform(Model.Nodes, positions, Span<Vector3>.Empty, Span<NodeWeight>.Empty);
+                    isWeighted = true;
+                    break;
+
+                case MeshType2 meshType2:
+                    foreach (var batch in meshType2.Batches)
+                    {
+                        batch.Transform(Model.Nodes, positions.Slice(offset), Span<Vector3>.Empty, Span<NodeWeight>.Empty);
+                        offset += batch.VertexCount;
+                    }
+                    isWeighted = true;
+                    break;
+
+                case MeshType7 meshType7:
+                    foreach (var batch in meshType7.Batches)
+                    {
+                        batch.Transform(Model.Nodes, positions.Slice(offset), Span<Vector3>.Empty, Span<NodeWeight>.Empty);
+                        offset += batch.VertexCount;
+                    }
+                    isWeighted = true;
+                    break;
+
+                default:
+                    return false;
+            }
+
+            if (isWeighted)
+            {
+                // Weighted meshes are skinned to model space, move them into the space of the node they belong to
+                Matrix4x4.Invert(Model.Nodes[nodeIndex].WorldTransform, out var nodeInvWorldTransform);
+                for (int i = 0; i < positions.Length; i++)
+                    positions[i] = Vector3.Transform(positions[i], nodeInvWorldTransform);
+            }
+
+            return true;
+        }
+    }
+}
@@ -0,0 +1,43 @@
+﻿using DDS3ModelLibrary.Models.Utilities;
+
+namespace DDS3ModelLibrary.Models
+{
+    /// <summary>
+    /// Describes the outcome of importing a model with <see cref="ModelPack.Replace"/>.
+    /// </summary>
+    public class ModelImportReport
+    {
+        /// <summary>
+        /// Gets whether the model was loaded from the import cache rather than converted.
+        /// </summary>
+        public bool IsFromCache { get; internal set; }
+
+        /// <summary>
+        /// Gets whether the mesh batches were optimized.
+        /// </summary>
+        public bool IsOptimized { get; internal set; }
+
+        /// <summary>
+        /// Gets the batch statistics of the imported model before optimization.
+        /// Only set when statistics were requested, the batches were optimized and the model wasn't loaded from the cache.
+        /// </summary>
+        public MeshBatchStatistics UnoptimizedStatistics { get; internal set; }
+
+        /// <summary>
+        /// Gets the batch statistics of the imported model, including the batch fill ratio. Only set when statistics were requested.
+        /// </summary>
+        public MeshBatchStatistics Statistics { get; internal set; }
+
+        public override string ToString()
+        {
+            if (Statistics == null)
+                return IsFromCache ? "Loaded from cache" : "No statistics";
+
+            var result = Statistics.ToString();
+            if (UnoptimizedStatistics != null)
+                result += $" (before optimization: {UnoptimizedStatistics.VerticesPerTriangle:F2} per triangle)";
+
+            return IsFromCache ? result + ", loaded from cache" : result;
+        }
+    }
+}
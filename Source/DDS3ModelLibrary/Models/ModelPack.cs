@@ -6,10 +6,10 @@ using DDS3ModelLibrary.Models.Utilities;
 using DDS3ModelLibrary.Motions;
 using DDS3ModelLibrary.Textures;
 using DDS3ModelLibrary.Textures.Utilities;
+using DDS3ModelLibrary.Utilities;
 using System;
 using System.Collections.Generic;
 using System.Diagnostics;
-using System.Drawing;
 using System.IO;
 using System.Linq;
 using System.Numerics;
@@ -19,6 +19,8 @@ namespace DDS3ModelLibrary.Models
 {
     public sealed class ModelPack : AbstractResource<object>
     {
+        private const string IMPORT_CACHE_STAGE = "models";
+
         public ModelPackInfo Info { get; set; }
 
         public TexturePack TexturePack { get; set; }
@@ -50,92 +52,7 @@ namespace DDS3ModelLibrary.Models
                 Read(reader);
         }
 
-        private static int AddTexture(string baseDirectory, string filePath, Dictionary<string, int> textureLookup, TexturePack texturePack, float scale)
-        {
-            if (!textureLookup.TryGetValue(filePath, out var textureId))
-            {
-                var fileExists = true;
-                var path = filePath;
-
-                if (!File.Exists(path))
-                {
-                    // Assume it's a relative path
-                    path = Path.Combine(baseDirectory, path);
-                    if (!File.Exists(path))
-                        fileExists = false;
-                }
-
-                var bitmap = fileExists ? TextureImportHelper.ImportBitmap(path) : new Bitmap(32, 32);
-                if (scale != 1)
-                    bitmap = new Bitmap(bitmap, new Size((int)(bitmap.Width / scale), (int)(bitmap.Height / scale)));
-                var name = Path.GetFileNameWithoutExtension(path);
-                var texture = new Texture(bitmap, PS2.GS.GSPixelFormat.PSMT8, name);
-                textureId = texturePack.Count;
-                texturePack.Add(texture);
-                textureLookup[filePath] = textureId;
-            }
-
-            return textureId;
-        }
-
-        private static void RemoveExcessiveNodeInfluences(int vertexCount, List<short> usedNodeIndices, List<List<(short NodeIndex, float Weight)>> vertexWeights, Dictionary<short, float> nodeScores, int meshWeightLimit)
-        {
-            var excessiveNodeCount = usedNodeIndices.Count - meshWeightLimit;
-            var maxScore = vertexCount;
-
-            for (int i = 4; i < (4 + excessiveNodeCount); i++)
-            {
-                foreach (var weights in vertexWeights)
-                {
-                    if (weights.Any(x => x.NodeIndex == usedNodeIndices[i]))
-                    {
-                        var excessiveWeight = weights.First(x => x.NodeIndex == usedNodeIndices[i]);
-                        weights.Remove(excessiveWeight);
-
-                        for (int j = 0; j < 4; j++)
-                        {
-                            var nodeIndex = usedNodeIndices[j];
-                            var weight = 0f;
-                            var index = -1;
-
-                            // Find existing weight
-                            for (int k = 0; k < weights.Count; k++)
-                            {
-                                if (weights[k].NodeIndex == nodeIndex)
-                                {
-                                    weight = weights[k].Weight;
-                                    index = k;
-                                    break;
-                                }
-                            }
-
-                            var newWeight = weight + excessiveWeight.Weight * (nodeScores[nodeIndex] / (float)maxScore);
-
-                            if (index != -1)
-                                weights[index] = (nodeIndex, newWeight);
-                            else
-                                weights.Add((nodeIndex, newWeight));
-                        }
-                    }
-
-                    var weightSum = weights.Sum(x => x.Weight);
-                    if (weightSum < 1f)
-                    {
-                        var remainder = 1f - weightSum;
-                        for (var k = 0; k < weights.Count; k++)
-                        {
-                            weights[k] = (weights[k].NodeIndex, weights[k].Weight + (remainder / 4f));
-                        }
-                    }
-
-                    //Debug.Assert( weightSum >= 0.998f && weightSum <= 1.002f );
-                }
-            }
-
-            usedNodeIndices.RemoveRange(4, excessiveNodeCount);
-        }
-
-        private static MeshType1 ConvertToMeshType1(Assimp.Scene aiScene, Assimp.Mesh aiMesh, bool hasTexture, Matrix4x4 aiNodeWorldTransform, List<Vector3> localPositions, ref Matrix4x4 nodeInvWorldTransform, int batchVertexLimit)
+        private static MeshType1 ConvertToMeshType1(Assimp.Scene aiScene, Assimp.Mesh aiMesh, bool hasTexture, Matrix4x4 aiNodeWorldTransform, ref Matrix4x4 nodeInvWorldTransform, int batchVertexLimit)
         {
             var mesh = new MeshType1
             {
@@ -163,7 +80,6 @@ namespace DDS3ModelLibrary.Models
                         var worldPosition = Vector3.Transform(position, aiNodeWorldTransform);
                         var localPosition = Vector3.Transform(worldPosition, nodeInvWorldTransform);
                         batch.Positions[j] = localPosition;
-                        localPositions.Add(localPosition);
                     }
                 }
 
@@ -215,7 +131,7 @@ namespace DDS3ModelLibrary.Models
             return mesh;
         }
 
-        private static MeshType7 ConvertToMeshType7(Assimp.Mesh aiMesh, bool hasTexture, List<Node> nodes, Matrix4x4 aiNodeWorldTransform, ref Matrix4x4 nodeInvWorldTransform, List<Vector3> localPositions, int batchVertexLimit)
+        private static MeshType7 ConvertToMeshType7(Assimp.Mesh aiMesh, bool hasTexture, List<Node> nodes, Matrix4x4 aiNodeWorldTransform, ref Matrix4x4 nodeInvWorldTransform, int batchVertexLimit)
         {
             var mesh = new MeshType7
             {
@@ -233,17 +149,22 @@ namespace DDS3ModelLibrary.Models
             if (!hasTexture)
                 mesh.Flags &= ~MeshFlags.TexCoord;
 
+            // Look up the node of each bone once
+            var boneNodeIndices = new Dictionary<Assimp.Bone, short>();
+            foreach (var bone in aiMesh.Bones)
+            {
+                var nodeIndex = nodes.FindIndex(x => CompareNodeName(x, bone.Name));
+                Debug.Assert(nodeIndex != -1);
+                boneNodeIndices[bone] = (short)nodeIndex;
+            }
+
             var aiVertexWeights = aiMesh.GetVertexWeights();
             var vertexWeights = new List<(short NodeIndex, float Weight)>[aiVertexWeights.Length];
             for (int i = 0; i < aiVertexWeights.Length; i++)
             {
-                var weights = new List<(short, float)>();
+                var weights = new List<(short, float)>(aiVertexWeights[i].Count);
                 foreach ((Assimp.Bone bone, float weight) in aiVertexWeights[i])
-                {
-                    var nodeIndex = nodes.FindIndex(x => CompareNodeName(x, bone.Name));
-                    Debug.Assert(nodeIndex != -1);
-                    weights.Add(((short)nodeIndex, weight));
-                }
+                    weights.Add((boneNodeIndices[bone], weight));
 
                 vertexWeights[i] = weights;
             }
@@ -291,7 +212,6 @@ namespace DDS3ModelLibrary.Models
 
                             // Transform position and normal to model space
                             var worldPosition = Vector3.Transform(aiMesh.Vertices[vertexIndex].FromAssimp(), aiNodeWorldTransform);
-                            localPositions.Add(Vector3.Transform(worldPosition, nodeInvWorldTransform));
                             var position = Vector3.Transform(worldPosition, usedNodeWorldTransformInv);
                             var normal = Vector3.TransformNormal(Vector3.TransformNormal(aiMesh.Normals[vertexIndex].FromAssimp(), aiNodeWorldTransform),
                                                                   usedNodeWorldTransformInv);
@@ -320,7 +240,7 @@ namespace DDS3ModelLibrary.Models
             return mesh;
         }
 
-        private static MeshType8 ConvertToMeshType8(Assimp.Mesh aiMesh, bool hasTexture, Matrix4x4 aiNodeWorldTransform, List<Vector3> localPositions, ref Matrix4x4 nodeInvWorldTransform, int batchVertexLimit)
+        private static MeshType8 ConvertToMeshType8(Assimp.Mesh aiMesh, bool hasTexture, Matrix4x4 aiNodeWorldTransform, ref Matrix4x4 nodeInvWorldTransform, int batchVertexLimit)
         {
             var mesh = new MeshType8
             {
@@ -349,7 +269,6 @@ namespace DDS3ModelLibrary.Models
                         var worldPosition = Vector3.Transform(position, aiNodeWorldTransform);
                         var localPosition = Vector3.Transform(worldPosition, nodeInvWorldTransform);
                         batch.Positions[j] = localPosition;
-                        localPositions.Add(localPosition);
                     }
                 }
 
@@ -384,9 +303,42 @@ namespace DDS3ModelLibrary.Models
             return node.Name == name || node.Name.Replace(" ", "_") == name;
         }
 
-        public void Replace(string filePath, float textureScale = 1, bool enableOverlays = false, MeshType weightedMeshType = MeshType.Type7, MeshType unweightedMeshType = MeshType.Type1, int meshWeightLimit = 4, int batchVertexLimit = 24)
+        /// <summary>
+        /// Replaces the geometry, materials and textures of the first model with those of a model file imported through Assimp.
+        /// </summary>
+        /// <param name="optimizeBatches">Whether the triangles and vertices of each batch are reordered for fewer transforms. Off by default, so existing callers get the same output.</param>
+        /// <param name="collectStatistics">Whether batch statistics are calculated for the report.</param>
+        public ModelImportReport Replace(string filePath, float textureScale = 1, bool enableOverlays = false, MeshType weightedMeshType = MeshType.Type7, MeshType unweightedMeshType = MeshType.Type1, int meshWeightLimit = 4, int batchVertexLimit = 24,
+                                         ImportCache cache = null, int mipMapCount = 0, bool optimizeBatches = false, bool collectStatistics = false)
         {
             var baseDirectory = Path.GetDirectoryName(Path.GetFullPath(filePath));
+            var report = new ModelImportReport { IsOptimized = optimizeBatches };
+
+            // The result only depends on the source, the model it's imported into and the options
+            string cacheKey = null;
+            if (cache != null)
+            {
+                using (var modelStream = Models[0].Save())
+                {
+                    cacheKey = ImportCache.CreateKey(ImportCache.GetFileHash(filePath), modelStream.ToArray().GetSHA256(), textureScale, enableOverlays,
+                                                     weightedMeshType, unweightedMeshType, meshWeightLimit, batchVertexLimit, mipMapCount,
+                                                     MaterialPresetStore.Version, optimizeBatches);
+                }
+
+                var cachedModel = new Model();
+                var cachedTexturePack = new TexturePack();
+                if (cache.TryLoad(IMPORT_CACHE_STAGE, cacheKey, cachedModel, cachedTexturePack))
+                {
+                    Models[0] = cachedModel;
+                    TexturePack = cachedTexturePack;
+                    report.IsFromCache = true;
+                    if (collectStatistics)
+                        report.Statistics = MeshBatchStatistics.Calculate(cachedModel, batchVertexLimit);
+
+                    return report;
+                }
+            }
+
             var aiContext = new Assimp.AssimpContext();
             //    aiContext.SetConfig( new Assimp.Configs.FBXPreservePivotsConfig( false ) );
             aiContext.SetConfig(new Assimp.Configs.VertexBoneWeightLimitConfig(4));
@@ -407,28 +359,44 @@ namespace DDS3ModelLibrary.Models
             }
 
             // Convert materials and textures
-            var textureLookup = new Dictionary<string, int>();
-            TexturePack = new TexturePack();
+            // Textures are queued first so they can be imported in parallel
+            var textureQueue = new TextureImportQueue(baseDirectory, textureScale, mipMapCount) { Cache = cache };
+            var materialInfos = new List<(TagName Name, bool IsTextured, bool HasOverlay, int Texture, int OverlayMask, int OverlayTexture)>();
             foreach (var aiMaterial in aiScene.Materials)
             {
                 var materialName = TagName.Parse(aiMaterial.Name);
                 var isTextured = true && aiMaterial.HasTextureDiffuse;
                 var hasOverlay = enableOverlays && materialName["ovl"].Count == 2;
-                int textureId = 0;
-                int overlayMaskId = 0;
-                int overlayTextureId = 0;
+                int texture = -1;
+                int overlayMask = -1;
+                int overlayTexture = -1;
 
                 if (isTextured)
                 {
-                    textureId = AddTexture(baseDirectory, aiMaterial.TextureDiffuse.FilePath, textureLookup, TexturePack, textureScale);
+                    texture = textureQueue.Add(aiMaterial.TextureDiffuse.FilePath);
 
                     if (hasOverlay)
                     {
-                        overlayMaskId = AddTexture(baseDirectory, materialName["ovl"][0], textureLookup, TexturePack, textureScale);
-                        overlayTextureId = AddTexture(baseDirectory, materialName["ovl"][1], textureLookup, TexturePack, textureScale);
+                        overlayMask = textureQueue.Add(materialName["ovl"][0]);
+                        overlayTexture = textureQueue.Add(materialName["ovl"][1]);
                     }
                 }
 
+                materialInfos.Add((materialName, isTextured, hasOverlay, texture, overlayMask, overlayTexture));
+            }
+
+            TexturePack = new TexturePack();
+            var textureIds = textureQueue.Import(TexturePack);
+
+            foreach (var materialInfo in materialInfos)
+            {
+                var materialName = materialInfo.Name;
+                var isTextured = materialInfo.IsTextured;
+                var hasOverlay = materialInfo.HasOverlay;
+                int textureId = isTextured ? textureIds[materialInfo.Texture] : 0;
+                int overlayMaskId = hasOverlay ? textureIds[materialInfo.OverlayMask] : 0;
+                int overlayTextureId = hasOverlay ? textureIds[materialInfo.OverlayTexture] : 0;
+
                 Material material;
 
                 if (materialName["ps"].Count == 1 && int.TryParse(materialName["ps"][0], out var presetId) && MaterialPresetStore.IsValidPresetId(presetId))
@@ -453,8 +421,6 @@ namespace DDS3ModelLibrary.Models
                 model.Materials.Add(material);
             }
 
-            var nodeLocalPositions = new Dictionary<Node, List<Vector3>>();
-
             void RecurseOverNodes(Assimp.Node aiNode, ref Matrix4x4 aiParentNodeWorldTransform)
             {
                 var aiNodeWorldTransform = aiParentNodeWorldTransform * aiNode.Transform.FromAssimp();
@@ -480,8 +446,6 @@ namespace DDS3ModelLibrary.Models
                         var nodeWorldTransform = node.WorldTransform;
                         var nodeInvWorldTransform = nodeWorldTransform.Inverted();
                         var hasTexture = model.Materials[aiMesh.MaterialIndex].TextureId != null;
-                        if (!nodeLocalPositions.TryGetValue(node, out var localPositions))
-                            localPositions = nodeLocalPositions[node] = new List<Vector3>();
 
                         Mesh mesh;
                         if (aiMesh.BoneCount > 1)
@@ -493,7 +457,7 @@ namespace DDS3ModelLibrary.Models
                             switch (weightedMeshType)
                             {
                                 case MeshType.Type1:
-                                    mesh = ConvertToMeshType1(aiScene, aiMesh, hasTexture, aiNodeWorldTransform, localPositions,
+                                    mesh = ConvertToMeshType1(aiScene, aiMesh, hasTexture, aiNodeWorldTransform,
                                                        ref nodeInvWorldTransform, batchVertexLimit);
                                     break;
                                 //case MeshType.Type2:
@@ -506,10 +470,10 @@ namespace DDS3ModelLibrary.Models
                                 //    break;
                                 case MeshType.Type7:
                                     mesh = ConvertToMeshType7(aiMesh, hasTexture, model.Nodes, aiNodeWorldTransform, ref nodeInvWorldTransform,
-                                                               localPositions, batchVertexLimit);
+                                                               batchVertexLimit);
                                     break;
                                 case MeshType.Type8:
-                                    mesh = ConvertToMeshType8(aiMesh, hasTexture, aiNodeWorldTransform, localPositions,
+                                    mesh = ConvertToMeshType8(aiMesh, hasTexture, aiNodeWorldTransform,
                                                        ref nodeInvWorldTransform, batchVertexLimit);
                                     break;
                                 default:
@@ -523,7 +487,7 @@ namespace DDS3ModelLibrary.Models
                             switch (unweightedMeshType)
                             {
                                 case MeshType.Type1:
-                                    mesh = ConvertToMeshType1(aiScene, aiMesh, hasTexture, aiNodeWorldTransform, localPositions,
+                                    mesh = ConvertToMeshType1(aiScene, aiMesh, hasTexture, aiNodeWorldTransform,
                                                        ref nodeInvWorldTransform, batchVertexLimit);
                                     break;
                                 //case MeshType.Type2:
@@ -536,10 +500,10 @@ namespace DDS3ModelLibrary.Models
                                 //    break;
                                 case MeshType.Type7:
                                     mesh = ConvertToMeshType7(aiMesh, hasTexture, model.Nodes, aiNodeWorldTransform, ref nodeInvWorldTransform,
-                                                               localPositions, batchVertexLimit);
+                                                               batchVertexLimit);
                                     break;
                                 case MeshType.Type8:
-                                    mesh = ConvertToMeshType8(aiMesh, hasTexture, aiNodeWorldTransform, localPositions,
+                                    mesh = ConvertToMeshType8(aiMesh, hasTexture, aiNodeWorldTransform,
                                                        ref nodeInvWorldTransform, batchVertexLimit);
                                     break;
                                 default:
@@ -566,15 +530,26 @@ namespace DDS3ModelLibrary.Models
             var identityTransform = Matrix4x4.Identity;
             RecurseOverNodes(aiScene.RootNode, ref identityTransform);
 
-            // Calculate bounding boxes
-            foreach (var kvp in nodeLocalPositions)
+            // Reorder triangles and vertices for fewer transforms
+            if (optimizeBatches)
             {
-                if (kvp.Key.Geometry == null)
-                    continue;
+                if (collectStatistics)
+                    report.UnoptimizedStatistics = MeshBatchStatistics.Calculate(model, batchVertexLimit);
 
-                kvp.Key.BoundingBox = BoundingBox.Calculate(kvp.Value);
-                Debug.Assert(kvp.Key.Geometry != null);
+                MeshBatchOptimizer.Optimize(model);
             }
+
+            if (collectStatistics)
+                report.Statistics = MeshBatchStatistics.Calculate(model, batchVertexLimit);
+
+            // Calculate bounding boxes
+            new ModelBounds(model).Apply();
+
+            // Material libraries aren't part of the key, so they're tracked as dependencies along with the textures.
+            // Textures that weren't found are tracked too, so the entry is discarded once they're added.
+            var dependencies = textureQueue.ImportedFilePaths.Concat(textureQueue.MissingFilePaths).Concat(new[] { Path.ChangeExtension(filePath, ".mtl") });
+            cache?.Store(IMPORT_CACHE_STAGE, cacheKey, dependencies, model, TexturePack);
+            return report;
         }
 
         protected override void Read(EndianBinaryReader reader, object context = null)
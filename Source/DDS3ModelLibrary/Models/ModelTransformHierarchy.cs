@@ -0,0 +1,244 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Numerics;
+
+namespace DDS3ModelLibrary.Models
+{
+    /// <summary>
+    /// Keeps the local and world transforms of a model's nodes in flat arrays, for transform heavy operations such as
+    /// skinning, exporting and motion baking. Nodes are processed in depth first order, so every subtree is a contiguous range
+    /// and changing a node only recomputes the world transforms of its subtree.
+    /// </summary>
+    public class ModelTransformHierarchy
+    {
+        private readonly List<Node> mNodes;
+        private readonly int[] mParentIndices;
+        private readonly int[] mOrder;
+        private readonly int[] mOrderIndices;
+        private readonly int[] mSubtreeEnds;
+        private readonly Matrix4x4[] mLocalTransforms;
+        private readonly Matrix4x4[] mWorldTransforms;
+        private readonly bool[] mIsDirty;
+        private readonly bool[] mIsUpdated;
+        private int mDirtyStart;
+        private int mDirtyEnd;
+
+        /// <summary>
+        /// Gets the number of nodes in the hierarchy.
+        /// </summary>
+        public int Count => mNodes.Count;
+
+        public ModelTransformHierarchy(Model model) : this(model.Nodes)
+        {
+        }
+
+        /// <summary>
+        /// Creates the hierarchy from the current transforms of the nodes.
+        /// </summary>
+        /// <param name="nodes">The nodes. The parent of every node must be in the list as well.</param>
+        public ModelTransformHierarchy(IEnumerable<Node> nodes)
+        {
+            mNodes = new List<Node>(nodes);
+
+            var count = mNodes.Count;
+            mParentIndices = new int[count];
+            mOrder = new int[count];
+            mOrderIndices = new int[count];
+            mSubtreeEnds = new int[count];
+            mLocalTransforms = new Matrix4x4[count];
+            mWorldTransforms = new Matrix4x4[count];
+            mIsDirty = new bool[count];
+            mIsUpdated = new bool[count];
+
+            var nodeIndices = new Dictionary<Node, int>(count);
+            for (int i = 0; i < count; i++)
+                nodeIndices[mNodes[i]] = i;
+
+            // Gather the children of each node as a compressed list, in node order
+            var childStart = new int[count + 1];
+            for (int i = 0; i < count; i++)
+            {
+                var parent = mNodes[i].Parent;
+                if (parent == null)
+                {
+                    mParentIndices[i] = -1;
+                    continue;
+                }
+
+                if (!nodeIndices.TryGetValue(parent, out mParentIndices[i]))
+                    throw new ArgumentException($"The parent of node {mNodes[i].Name} is not part of the hierarchy", nameof(nodes));
+
+                ++childStart[mParentIndices[i] + 1];
+            }
+
+            for (int i = 0; i < count; i++)
+                childStart[i + 1] += childStart[i];
+
+            var children = new int[childStart[count]];
+            var childFill = new int[count];
+            for (int i = 0; i < count; i++)
+            {
+                if (mParentIndices[i] != -1)
+                    children[childStart[mParentIndices[i]] + childFill[mParentIndices[i]]++] = i;
+            }
+
+            // Lay out the nodes depth first, so each subtree is a contiguous range
+            var orderCount = 0;
+            var stack = new Stack<int>();
+            for (int root = 0; root < count; root++)
+            {
+                if (mParentIndices[root] != -1)
+                    continue;
+
+                stack.Push(root);
+                while (stack.Count > 0)
+                {
+                    var nodeIndex = stack.Pop();
+                    mOrderIndices[nodeIndex] = orderCount;
+                    mOrder[orderCount++] = nodeIndex;
+
+                    for (int i = childStart[nodeIndex + 1] - 1; i >= childStart[nodeIndex]; i--)
+                        stack.Push(children[i]);
+                }
+            }
+
+            if (orderCount != count)
+                throw new ArgumentException("The node hierarchy contains a cycle", nameof(nodes));
+
+            // A subtree ends where the subtree of its last child ends
+            for (int i = count - 1; i >= 0; i--)
+            {
+                var nodeIndex = mOrder[i];
+                var end = i + 1;
+                for (int j = childStart[nodeIndex]; j < childStart[nodeIndex + 1]; j++)
+                    end = Math.Max(end, mSubtreeEnds[mOrderIndices[children[j]]]);
+
+                mSubtreeEnds[i] = end;
+            }
+
+            Refresh();
+        }
+
+        /// <summary>
+        /// Gets the index of the parent of the node, or -1 if it has none.
+        /// </summary>
+        public int GetParentIndex(int nodeIndex) => mParentIndices[nodeIndex];
+
+        public Matrix4x4 GetLocalTransform(int nodeIndex) => mLocalTransforms[nodeIndex];
+
+        /// <summary>
+        /// Sets the local transform of a node. The world transforms of the node and its subtree are updated on the next access.
+        /// </summary>
+        public void SetLocalTransform(int nodeIndex, in Matrix4x4 transform)
+        {
+            mLocalTransforms[nodeIndex] = transform;
+            mIsDirty[nodeIndex] = true;
+
+            var orderIndex = mOrderIndices[nodeIndex];
+            mDirtyStart = Math.Min(mDirtyStart, orderIndex);
+            mDirtyEnd = Math.Max(mDirtyEnd, mSubtreeEnds[orderIndex]);
+        }
+
+        public Matrix4x4 GetWorldTransform(int nodeIndex)
+        {
+            Update();
+            return mWorldTransforms[nodeIndex];
+        }
+
+        /// <summary>
+        /// Recomputes the world transforms of all nodes that changed since the last update.
+        /// </summary>
+        public void Update()
+        {
+            if (mDirtyStart >= mDirtyEnd)
+                return;
+
+            // Parents precede their children, so a single pass over the dirty range suffices
+            for (int i = mDirtyStart; i < mDirtyEnd; i++)
+            {
+                var nodeIndex = mOrder[i];
+                var parentIndex = mParentIndices[nodeIndex];
+                var isParentUpdated = parentIndex != -1 && mIsUpdated[parentIndex];
+                if (!mIsDirty[nodeIndex] && !isParentUpdated)
+                    continue;
+
+                mWorldTransforms[nodeIndex] = parentIndex == -1
+                    ? mLocalTransforms[nodeIndex]
+                    : mLocalTransforms[nodeIndex] * mWorldTransforms[parentIndex];
+
+                mIsUpdated[nodeIndex] = true;
+            }
+
+            for (int i = mDirtyStart; i < mDirtyEnd; i++)
+            {
+                var nodeIndex = mOrder[i];
+                mIsDirty[nodeIndex] = false;
+                mIsUpdated[nodeIndex] = false;
+            }
+
+            mDirtyStart = int.MaxValue;
+            mDirtyEnd = 0;
+        }
+
+        /// <summary>
+        /// Computes the world transforms for a complete set of local transforms in a single pass, without touching the
+        /// transforms stored in the hierarchy. Used to evaluate many poses of the same skeleton.
+        /// </summary>
+        /// <param name="localTransforms">The local transforms, indexed by node index.</param>
+        /// <param name="worldTransforms">The buffer that receives the world transforms, indexed by node index.</param>
+        public void ComputeWorldTransforms(ReadOnlySpan<Matrix4x4> localTransforms, Span<Matrix4x4> worldTransforms)
+        {
+            for (int i = 0; i < mOrder.Length; i++)
+            {
+                var nodeIndex = mOrder[i];
+                var parentIndex = mParentIndices[nodeIndex];
+                worldTransforms[nodeIndex] = parentIndex == -1
+                    ? localTransforms[nodeIndex]
+                    : localTransforms[nodeIndex] * worldTransforms[parentIndex];
+            }
+        }
+
+        /// <summary>
+        /// Rereads the local transforms of all nodes.
+        /// </summary>
+        public void Refresh()
+        {
+            for (int i = 0; i < mNodes.Count; i++)
+            {
+                mLocalTransforms[i] = mNodes[i].Transform;
+                mIsDirty[i] = true;
+            }
+
+            mDirtyStart = 0;
+            mDirtyEnd = mNodes.Count;
+            Update();
+        }
+
+        /// <summary>
+        /// Writes the local transforms back to the nodes.
+        /// </summary>
+        public void Apply()
+        {
+            for (int i = 0; i < mNodes.Count; i++)
+                mNodes[i].Transform = mLocalTransforms[i];
+        }
+
+        /// <summary>
+        /// Copies the current world transforms, indexed by node index.
+        /// </summary>
+        public Matrix4x4[] CreateSnapshot()
+        {
+            Update();
+            return (Matrix4x4[])mWorldTransforms.Clone();
+        }
+
+        /// <summary>
+        /// Copies the current world transforms into the given buffer, indexed by node index.
+        /// </summary>
+        public void CopyWorldTransforms(Span<Matrix4x4> worldTransforms)
+        {
+            Update();
+            mWorldTransforms.AsSpan().CopyTo(worldTransforms);
+        }
+    }
+}
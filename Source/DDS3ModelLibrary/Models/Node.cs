@@ -3,12 +3,17 @@ using DDS3ModelLibrary.Models.Utilities;
 using System;
 using System.Collections.Generic;
 using System.Numerics;
+using System.Threading;
 
 namespace DDS3ModelLibrary.Models
 {
     // sdfModelNode_t
     public class Node : IBinarySerializable
     {
+        // Source of unique transform versions. Whenever a node's transform or parent changes, the root of its hierarchy gets
+        // a new version, so cached world transforms are returned as long as nothing in their own hierarchy changed.
+        private static int sTransformVersion;
+
         // For debugging only, only valid when read from a file.
         private int mIndex;
         private int mParentIndex;
@@ -23,6 +28,8 @@ namespace DDS3ModelLibrary.Models
         private bool mWorldTransformDirty;
         private bool mPRSDirty;
         private Matrix4x4 mParentWorldTransform;
+        private int mWorldTransformVersion = -1;
+        private int mHierarchyVersion;
 
         BinarySourceInfo IBinarySerializable.SourceInfo { get; set; }
 
@@ -42,6 +49,7 @@ namespace DDS3ModelLibrary.Models
                 {
                     mParent = value;
                     mWorldTransformDirty = true;
+                    InvalidateTransforms();
                 }
             }
         }
@@ -60,7 +68,8 @@ namespace DDS3ModelLibrary.Models
                 if (mRotation != value)
                 {
                     mRotation = value;
-                    mLocalTransformDirty = true;
+                    mLocalTransformDirty = mWorldTransformDirty = true;
+                    InvalidateTransforms();
                 }
             }
         }
@@ -79,7 +88,8 @@ namespace DDS3ModelLibrary.Models
                 if (mPosition != value)
                 {
                     mPosition = value;
-                    mLocalTransformDirty = true;
+                    mLocalTransformDirty = mWorldTransformDirty = true;
+                    InvalidateTransforms();
                 }
             }
         }
@@ -98,7 +108,8 @@ namespace DDS3ModelLibrary.Models
                 if (mScale != value)
                 {
                     mScale = value;
-                    mLocalTransformDirty = true;
+                    mLocalTransformDirty = mWorldTransformDirty = true;
+                    InvalidateTransforms();
                 }
             }
         }
@@ -145,6 +156,7 @@ namespace DDS3ModelLibrary.Models
                 {
                     mLocalTransform = value;
                     mPRSDirty = mWorldTransformDirty = true;
+                    InvalidateTransforms();
                 }
             }
         }
@@ -152,16 +164,13 @@ namespace DDS3ModelLibrary.Models
         /// <summary>
         /// Gets the world transform of this node.
         /// </summary>
-        public Matrix4x4 WorldTransform
-        {
-            get
-            {
-                if (mWorldTransformDirty || Parent?.WorldTransform != mParentWorldTransform)
-                    UpdateWorldTransform();
+        public Matrix4x4 WorldTransform => GetWorldTransform(TransformVersion);
 
-                return mWorldTransform;
-            }
-        }
+        /// <summary>
+        /// Gets a value that changes whenever the transform or parent of a node in the same hierarchy changes.
+        /// Versions are unique across hierarchies, so a node that moves to another hierarchy never sees a version it has already seen.
+        /// </summary>
+        internal int TransformVersion => Volatile.Read(ref GetRoot().mHierarchyVersion);
 
         public Node()
         {
@@ -187,11 +196,42 @@ namespace DDS3ModelLibrary.Models
             mLocalTransformDirty = false;
         }
 
-        private void UpdateWorldTransform()
+        private Node GetRoot()
+        {
+            var node = this;
+            while (node.mParent != null)
+                node = node.mParent;
+
+            return node;
+        }
+
+        private void InvalidateTransforms()
+        {
+            Volatile.Write(ref GetRoot().mHierarchyVersion, Interlocked.Increment(ref sTransformVersion));
+        }
+
+        /// <summary>
+        /// Gets the world transform for a version of the hierarchy that was read once, so a concurrent change can't make
+        /// the cache store a newer version than the transform was calculated for. The parents share the same root and version.
+        /// </summary>
+        private Matrix4x4 GetWorldTransform(int version)
+        {
+            if (mWorldTransformVersion != version)
+            {
+                if (mWorldTransformDirty || (Parent != null && Parent.GetWorldTransform(version) != mParentWorldTransform))
+                    UpdateWorldTransform(version);
+
+                mWorldTransformVersion = version;
+            }
+
+            return mWorldTransform;
+        }
+
+        private void UpdateWorldTransform(int version)
         {
             mWorldTransform = Transform;
             if (Parent != null)
-                mWorldTransform *= (mParentWorldTransform = Parent.WorldTransform);
+                mWorldTransform *= (mParentWorldTransform = Parent.GetWorldTransform(version));
             else
                 mParentWorldTransform = Matrix4x4.Identity;
 
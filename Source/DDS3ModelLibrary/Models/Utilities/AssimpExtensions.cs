@@ -119,30 +119,25 @@ namespace DDS3ModelLibrary.Models.Utilities
         /// <returns></returns>
         public static List<BoneWeight>[] GetVertexWeights(this Assimp.Mesh mesh)
         {
-            // Map out the vertex weights for each vertex
+            // Map out the vertex weights for each vertex, in bone order
             var vertexWeights = new List<BoneWeight>[mesh.VertexCount];
-            var missingVertexWeights = new List<int>();
-            for (int i = 0; i < mesh.VertexCount; i++)
+            foreach (var bone in mesh.Bones)
             {
-                var weights = new List<BoneWeight>();
-                foreach (var bone in mesh.Bones)
+                foreach (var vertexWeight in bone.VertexWeights)
                 {
-                    foreach (var vertexWeight in bone.VertexWeights)
-                    {
-                        if (vertexWeight.VertexID == i)
-                        {
-                            weights.Add(new BoneWeight() { Bone = bone, Weight = vertexWeight.Weight });
-                        }
-                    }
-                }
+                    var weights = vertexWeights[vertexWeight.VertexID];
+                    if (weights == null)
+                        vertexWeights[vertexWeight.VertexID] = weights = new List<BoneWeight>();
 
-                if (weights.Count == 0)
-                {
-                    missingVertexWeights.Add(i);
-                    continue;
+                    weights.Add(new BoneWeight() { Bone = bone, Weight = vertexWeight.Weight });
                 }
+            }
 
-                vertexWeights[i] = weights;
+            var missingVertexWeights = new List<int>();
+            for (int i = 0; i < mesh.VertexCount; i++)
+            {
+                if (vertexWeights[i] == null)
+                    missingVertexWeights.Add(i);
             }
 
             // Resolve vertices without any weights by finding the closest vertex next to it that does, and taking its weights
@@ -134,8 +134,8 @@ namespace DDS3ModelLibrary.Models.Utilities
 
         /// <summary>
         /// Splits the mesh into submeshes that use <paramref name="maxBoneCount"/> or less bones.
+        /// Faces that use more bones than allowed on their own have their least significant influences removed.
         /// </summary>
-        /// <param name="scene"></param>
         /// <param name="mesh"></param>
         /// <param name="maxBoneCount"></param>
         /// <returns></returns>
@@ -145,57 +145,77 @@ namespace DDS3ModelLibrary.Models.Utilities
                 return new List<Assimp.Mesh> { mesh };
 
             var vertexWeights = mesh.GetVertexWeights();
-            var subMeshes = new List<Assimp.Mesh>();
-            var remainingFaces = mesh.Faces.ToList();
+            var boneIndices = new Dictionary<Bone, int>();
+            for (int i = 0; i < mesh.Bones.Count; i++)
+                boneIndices[mesh.Bones[i]] = i;
+
+            LimitFaceBoneCount(mesh, vertexWeights, boneIndices, maxBoneCount);
 
-            while (remainingFaces.Count > 0)
+            // Build the bone set of every vertex once, and bucket the faces by their bone set
+            var vertexBoneMasks = new BoneMask[mesh.VertexCount];
+            for (int i = 0; i < vertexBoneMasks.Length; i++)
             {
-                var usedBones = new HashSet<Bone>();
-                var faces = new List<Face>();
+                var mask = new BoneMask(mesh.BoneCount);
+                foreach (var weight in vertexWeights[i])
+                    mask.Add(boneIndices[weight.Bone]);
 
-                // Get faces that fit inside the new mesh
-                foreach (var face in remainingFaces)
-                {
-                    var faceUsedBones = face.Indices
-                        .SelectMany(y => vertexWeights[y].Select(z => z.Bone))
-                        .Distinct()
-                        .ToList();
-                    var faceUniqueUsedBoneCount = faceUsedBones.Count(x => !usedBones.Contains(x));
-                    if ((usedBones.Count + faceUniqueUsedBoneCount) > maxBoneCount)
-                    {
-                        // Skip
-                        continue;
-                    }
+                vertexBoneMasks[i] = mask;
+            }
+
+            var faceBuckets = new Dictionary<BoneMask, List<int>>();
+            for (int i = 0; i < mesh.FaceCount; i++)
+            {
+                var mask = new BoneMask(mesh.BoneCount);
+                foreach (var index in mesh.Faces[i].Indices)
+                    mask.UnionWith(vertexBoneMasks[index]);
 
-                    // It does fit ＼(^o^)／
-                    faces.Add(face);
-                    foreach (var node in faceUsedBones)
-                        usedBones.Add(node);
+                Debug.Assert(mask.Count <= maxBoneCount);
+                if (!faceBuckets.TryGetValue(mask, out var bucket))
+                    faceBuckets[mask] = bucket = new List<int>();
 
-                    Debug.Assert(usedBones.Count <= maxBoneCount);
-                }
+                bucket.Add(i);
+            }
 
-                if (faces.Count == 0)
+            // Assign the buckets to clusters, placing the largest bone sets first and preferring the cluster it shares the most bones with
+            var clusterMasks = new List<BoneMask>();
+            var clusterFaces = new List<List<int>>();
+            foreach (var bucket in faceBuckets.OrderByDescending(x => x.Key.Count).ThenBy(x => x.Value[0]))
+            {
+                var bestCluster = -1;
+                var bestGrowth = int.MaxValue;
+                for (int i = 0; i < clusterMasks.Count; i++)
                 {
-                    if (remainingFaces
-                        .All(x => x.Indices.SelectMany(y => vertexWeights[y].Select(z => z.Bone))
-                        .Distinct()
-                        .Count() > maxBoneCount))
-                    {
-                        // Need to reduce weights per face
-                        throw new NotSupportedException("Too many weights per face");
-                    }
-                    else
+                    var unionCount = clusterMasks[i].CountUnion(bucket.Key);
+                    var growth = unionCount - clusterMasks[i].Count;
+                    if (unionCount <= maxBoneCount && growth < bestGrowth)
                     {
-                        throw new Exception("help");
+                        bestCluster = i;
+                        bestGrowth = growth;
                     }
                 }
 
-                // Remove the faces we claimed from the pool
-                foreach (var face in faces)
-                    remainingFaces.Remove(face);
+                if (bestCluster == -1)
+                {
+                    bestCluster = clusterMasks.Count;
+                    clusterMasks.Add(new BoneMask(mesh.BoneCount));
+                    clusterFaces.Add(new List<int>());
+                }
+
+                clusterMasks[bestCluster].UnionWith(bucket.Key);
+                clusterFaces[bestCluster].AddRange(bucket.Value);
+            }
+
+            // Build submeshes, keeping the original face order within each
+            var subMeshes = new List<Assimp.Mesh>();
+            var vertexSubMesh = new int[mesh.VertexCount];
+            var vertexCacheIndex = new int[mesh.VertexCount];
+            for (int i = 0; i < vertexSubMesh.Length; i++)
+                vertexSubMesh[i] = -1;
+
+            foreach (var faces in clusterFaces)
+            {
+                faces.Sort();
 
-                // Build submesh
                 var subMesh = new Assimp.Mesh()
                 {
                     MaterialIndex = mesh.MaterialIndex,
@@ -203,26 +223,22 @@ namespace DDS3ModelLibrary.Models.Utilities
                     Name = mesh.Name + $"_submesh{subMeshes.Count}",
                     PrimitiveType = mesh.PrimitiveType,
                 };
+
                 var vertexCache = new List<Vertex>();
-                foreach (var face in faces)
+                foreach (var faceIndex in faces)
                 {
                     var newFace = new Face();
-
-                    foreach (var index in face.Indices)
+                    foreach (var index in mesh.Faces[faceIndex].Indices)
                     {
-                        var cacheIndex = FindVertexCacheIndex(mesh, index, vertexWeights, vertexCache, out var vertex);
-                        if (cacheIndex == -1)
+                        if (vertexSubMesh[index] != subMeshes.Count)
                         {
                             // This vertex is new
-#if DEBUG
-                            for (int i = 0; i < vertex.Weights.Count; i++)
-                                Debug.Assert(usedBones.Contains(vertex.Weights[i].Bone));
-#endif
-                            cacheIndex = vertexCache.Count;
-                            vertexCache.Add(vertex);
+                            vertexSubMesh[index] = subMeshes.Count;
+                            vertexCacheIndex[index] = vertexCache.Count;
+                            vertexCache.Add(GetVertex(mesh, index, vertexWeights));
                         }
 
-                        newFace.Indices.Add(cacheIndex);
+                        newFace.Indices.Add(vertexCacheIndex[index]);
                     }
 
                     subMesh.Faces.Add(newFace);
@@ -240,6 +256,76 @@ namespace DDS3ModelLibrary.Models.Utilities
             return subMeshes;
         }
 
+        /// <summary>
+        /// Removes the least significant influences from faces that use more than <paramref name="maxBoneCount"/> bones,
+        /// and renormalizes the weights of the affected vertices.
+        /// </summary>
+        private static void LimitFaceBoneCount(Assimp.Mesh mesh, List<BoneWeight>[] vertexWeights, Dictionary<Bone, int> boneIndices, int maxBoneCount)
+        {
+            var boneWeightSums = new float[mesh.BoneCount];
+            var faceBones = new List<int>();
+            foreach (var face in mesh.Faces)
+            {
+                faceBones.Clear();
+                foreach (var index in face.Indices)
+                {
+                    foreach (var weight in vertexWeights[index])
+                    {
+                        var boneIndex = boneIndices[weight.Bone];
+                        if (boneWeightSums[boneIndex] == 0)
+                            faceBones.Add(boneIndex);
+
+                        boneWeightSums[boneIndex] += Math.Max(weight.Weight, float.Epsilon);
+                    }
+                }
+
+                if (faceBones.Count > maxBoneCount)
+                {
+                    // Keep the bones with the most weight across the face
+                    faceBones.Sort((x, y) => boneWeightSums[y].CompareTo(boneWeightSums[x]));
+                    var keptBones = new BoneMask(mesh.BoneCount);
+                    for (int i = 0; i < maxBoneCount; i++)
+                        keptBones.Add(faceBones[i]);
+
+                    foreach (var index in face.Indices)
+                    {
+                        var weights = vertexWeights[index];
+                        if (weights.TrueForAll(x => keptBones.Contains(boneIndices[x.Bone])))
+                            continue;
+
+                        // Lists may be shared between vertices, so replace instead of modifying them
+                        var newWeights = new List<BoneWeight>(weights.Count);
+                        var weightSum = 0f;
+                        foreach (var weight in weights)
+                        {
+                            if (keptBones.Contains(boneIndices[weight.Bone]))
+                            {
+                                newWeights.Add(weight);
+                                weightSum += weight.Weight;
+                            }
+                        }
+
+                        if (newWeights.Count == 0 || weightSum <= 0)
+                        {
+                            newWeights.Clear();
+                            newWeights.Add(new BoneWeight { Bone = mesh.Bones[faceBones[0]], Weight = 1f });
+                        }
+                        else
+                        {
+                            var scale = 1f / weightSum;
+                            for (int i = 0; i < newWeights.Count; i++)
+                                newWeights[i] = new BoneWeight { Bone = newWeights[i].Bone, Weight = newWeights[i].Weight * scale };
+                        }
+
+                        vertexWeights[index] = newWeights;
+                    }
+                }
+
+                foreach (var boneIndex in faceBones)
+                    boneWeightSums[boneIndex] = 0;
+            }
+        }
+
         /// <summary>
         /// Splits the mesh into submeshes that use <paramref name="maxVertexCount"/> or less vertices.
         /// </summary>
@@ -247,15 +333,54 @@ namespace DDS3ModelLibrary.Models.Utilities
         /// <param name="maxVertexCount"></param>
         /// <returns></returns>
         public static List<Assimp.Mesh> SplitMeshByVertexCount(Assimp.Mesh mesh, int maxVertexCount)
+        {
+            return SplitMeshByVertexCount(mesh, maxVertexCount, out _);
+        }
+
+        /// <summary>
+        /// Splits the mesh into submeshes that use <paramref name="maxVertexCount"/> or less vertices.
+        /// </summary>
+        /// <param name="mesh"></param>
+        /// <param name="maxVertexCount"></param>
+        /// <param name="fillRatio">The average number of vertices per submesh relative to <paramref name="maxVertexCount"/>.</param>
+        /// <returns></returns>
+        public static List<Assimp.Mesh> SplitMeshByVertexCount(Assimp.Mesh mesh, int maxVertexCount, out float fillRatio)
         {
             if (mesh.VertexCount <= maxVertexCount)
+            {
+                fillRatio = (float)mesh.VertexCount / maxVertexCount;
                 return new List<Assimp.Mesh> { mesh };
+            }
 
+            // Weld identical vertices once up front
             var vertexWeights = mesh.HasBones ? mesh.GetVertexWeights() : null;
-            var remainingFaces = mesh.Faces.ToList();
-            var subMeshes = new List<Assimp.Mesh>();
+            var uniqueVertices = new List<Vertex>();
+            var uniqueVertexLookup = new Dictionary<Vertex, int>();
+            var vertexRemap = new int[mesh.VertexCount];
+            for (int i = 0; i < vertexRemap.Length; i++)
+            {
+                var vertex = GetVertex(mesh, i, vertexWeights);
+                if (!uniqueVertexLookup.TryGetValue(vertex, out var uniqueIndex))
+                {
+                    uniqueIndex = uniqueVertices.Count;
+                    uniqueVertexLookup[vertex] = uniqueIndex;
+                    uniqueVertices.Add(vertex);
+                }
 
-            while (remainingFaces.Count > 0)
+                vertexRemap[i] = uniqueIndex;
+            }
+
+            var faces = new int[mesh.FaceCount][];
+            for (int i = 0; i < faces.Length; i++)
+            {
+                var indices = mesh.Faces[i].Indices;
+                faces[i] = new int[indices.Count];
+                for (int j = 0; j < indices.Count; j++)
+                    faces[i][j] = vertexRemap[indices[j]];
+            }
+
+            var subMeshes = new List<Assimp.Mesh>();
+            foreach (var batch in MeshBatchPartitioner.Partition(faces, uniqueVertices.Count, maxVertexCount, out fillRatio))
             {
                 // Build submesh
                 var subMesh = new Assimp.Mesh()
@@ -266,51 +391,19 @@ namespace DDS3ModelLibrary.Models.Utilities
                     PrimitiveType = mesh.PrimitiveType,
                 };
 
-                var processedFaces = new List<Face>();
-                var vertexCache = new List<Vertex>();
-
-                // Get faces that fit inside the new mesh
-                foreach (var face in remainingFaces)
+                var index = 0;
+                foreach (var faceIndex in batch.FaceIndices)
                 {
-                    var newVertices = new List<Vertex>();
                     var newFace = new Face();
-                    foreach (var i in face.Indices)
-                    {
-                        var cacheIndex = FindVertexCacheIndex(mesh, i, vertexWeights, vertexCache, out var vertex);
-                        if (cacheIndex == -1)
-                        {
-                            // This vertex is new
-                            cacheIndex = vertexCache.Count + newVertices.Count;
-                            newVertices.Add(vertex);
-                        }
+                    for (int j = 0; j < faces[faceIndex].Length; j++)
+                        newFace.Indices.Add(batch.Indices[index++]);
 
-                        newFace.Indices.Add(cacheIndex);
-                    }
-
-                    if (vertexCache.Count + newVertices.Count > maxVertexCount)
-                    {
-                        // Doesn't fit
-                        continue;
-                    }
-
-                    // It does fit ＼(^o^)／
                     subMesh.Faces.Add(newFace);
-                    processedFaces.Add(face);
-                    foreach (var vertex in newVertices)
-                        vertexCache.Add(vertex);
-
-                    Debug.Assert(vertexCache.Count <= maxVertexCount);
-
-                    if (vertexCache.Count == maxVertexCount)
-                    {
-                        // We're done for sure
-                        break;
-                    }
                 }
 
-                // Remove the faces we processed from the remaining list
-                foreach (var face in processedFaces)
-                    remainingFaces.Remove(face);
+                var vertexCache = new List<Vertex>(batch.Vertices.Count);
+                foreach (var vertexIndex in batch.Vertices)
+                    vertexCache.Add(uniqueVertices[vertexIndex]);
 
                 PopulateSubMeshVertexData(mesh, subMesh, vertexCache);
 
@@ -324,7 +417,7 @@ namespace DDS3ModelLibrary.Models.Utilities
             return subMeshes;
         }
 
-        private static int FindVertexCacheIndex(Assimp.Mesh mesh, int i, List<BoneWeight>[] vertexWeights, List<Vertex> vertexCache, out Vertex vertex)
+        private static Vertex GetVertex(Assimp.Mesh mesh, int i, List<BoneWeight>[] vertexWeights)
         {
             var position = mesh.HasVertices ? mesh.Vertices[i] : new Vector3D();
             var normal = mesh.HasNormals ? mesh.Normals[i] : new Vector3D();
@@ -332,16 +425,12 @@ namespace DDS3ModelLibrary.Models.Utilities
             var texCoord2 = mesh.HasTextureCoords(1) ? mesh.TextureCoordinateChannels[1][i] : new Vector3D();
             var color = mesh.HasVertexColors(0) ? mesh.VertexColorChannels[0][i] : new Color4D();
             var weights = mesh.HasBones ? vertexWeights[i] : new List<BoneWeight>();
-            var cacheIndex = vertexCache.FindIndex(y => y.Position == position && y.Normal == normal && y.TexCoord == texCoord &&
-                                                         y.TexCoord2 == texCoord2 && y.Color == color &&
-                                                         y.Weights.SequenceEqual(weights));
-
-            vertex = new Vertex(position, normal, texCoord, texCoord2, color, weights);
-            return cacheIndex;
+            return new Vertex(position, normal, texCoord, texCoord2, color, weights);
         }
 
         private static void PopulateSubMeshVertexData(Assimp.Mesh mesh, Assimp.Mesh subMesh, List<Vertex> vertexCache)
         {
+            var subMeshBones = new Dictionary<string, Bone>();
             var vertexIndex = 0;
             foreach (var vertex in vertexCache)
             {
@@ -365,8 +454,7 @@ namespace DDS3ModelLibrary.Models.Utilities
                 {
                     foreach (var boneWeight in vertex.Weights)
                     {
-                        var subMeshBone = subMesh.Bones.FirstOrDefault(x => x.Name == boneWeight.Bone.Name);
-                        if (subMeshBone == null)
+                        if (!subMeshBones.TryGetValue(boneWeight.Bone.Name, out var subMeshBone))
                         {
                             subMeshBone = new Bone
                             {
@@ -374,6 +462,7 @@ namespace DDS3ModelLibrary.Models.Utilities
                                 OffsetMatrix = boneWeight.Bone.OffsetMatrix
                             };
                             subMesh.Bones.Add(subMeshBone);
+                            subMeshBones[subMeshBone.Name] = subMeshBone;
                         }
 
                         subMeshBone.VertexWeights.Add(new VertexWeight(vertexIndex, boneWeight.Weight));
@@ -388,18 +477,18 @@ namespace DDS3ModelLibrary.Models.Utilities
         {
             if (subMesh.HasBones)
             {
-                var vertexIndices = Enumerable.Range(0, subMesh.VertexCount).ToList();
+                var hasWeight = new bool[subMesh.VertexCount];
                 foreach (var bone in subMesh.Bones)
                 {
                     foreach (var vertexWeight in bone.VertexWeights)
-                        vertexIndices.Remove(vertexWeight.VertexID);
+                        hasWeight[vertexWeight.VertexID] = true;
                 }
 
-                Debug.Assert(vertexIndices.Count == 0);
+                Debug.Assert(Array.TrueForAll(hasWeight, x => x));
             }
         }
 
-        private struct Vertex
+        private struct Vertex : IEquatable<Vertex>
         {
             public readonly Vector3D Position;
             public readonly Vector3D Normal;
@@ -417,6 +506,37 @@ namespace DDS3ModelLibrary.Models.Utilities
                 Color = color;
                 Weights = weights;
             }
+
+            public bool Equals(Vertex other)
+            {
+                if (Position != other.Position || Normal != other.Normal || TexCoord != other.TexCoord ||
+                    TexCoord2 != other.TexCoord2 || Color != other.Color || Weights.Count != other.Weights.Count)
+                    return false;
+
+                for (int i = 0; i < Weights.Count; i++)
+                {
+                    if (Weights[i].Bone != other.Weights[i].Bone || Weights[i].Weight != other.Weights[i].Weight)
+                        return false;
+                }
+
+                return true;
+            }
+
+            public override bool Equals(object obj) => obj is Vertex other && Equals(other);
+
+            public override int GetHashCode()
+            {
+                unchecked
+                {
+                    var hash = Position.GetHashCode();
+                    hash = hash * 31 + Normal.GetHashCode();
+                    hash = hash * 31 + TexCoord.GetHashCode();
+                    hash = hash * 31 + TexCoord2.GetHashCode();
+                    hash = hash * 31 + Color.GetHashCode();
+                    hash = hash * 31 + Weights.Count;
+                    return hash;
+                }
+            }
         }
     }
 }
@@ -0,0 +1,103 @@
+﻿using System;
+
+namespace DDS3ModelLibrary.Models.Utilities
+{
+    /// <summary>
+    /// A set of bone indices stored as a bitmask.
+    /// </summary>
+    internal sealed class BoneMask : IEquatable<BoneMask>
+    {
+        private readonly ulong[] mWords;
+
+        /// <summary>
+        /// Gets the number of bones in the set.
+        /// </summary>
+        public int Count { get; private set; }
+
+        public BoneMask(int boneCount)
+        {
+            mWords = new ulong[(boneCount + 63) / 64];
+        }
+
+        public BoneMask(BoneMask other)
+        {
+            mWords = (ulong[])other.mWords.Clone();
+            Count = other.Count;
+        }
+
+        public bool Contains(int boneIndex)
+        {
+            return (mWords[boneIndex >> 6] & (1ul << boneIndex)) != 0;
+        }
+
+        public void Add(int boneIndex)
+        {
+            var bit = 1ul << boneIndex;
+            if ((mWords[boneIndex >> 6] & bit) == 0)
+            {
+                mWords[boneIndex >> 6] |= bit;
+                ++Count;
+            }
+        }
+
+        public void UnionWith(BoneMask other)
+        {
+            var count = 0;
+            for (int i = 0; i < mWords.Length; i++)
+            {
+                mWords[i] |= other.mWords[i];
+                count += PopCount(mWords[i]);
+            }
+
+            Count = count;
+        }
+
+        /// <summary>
+        /// Gets the number of bones in the union of both sets without creating it.
+        /// </summary>
+        public int CountUnion(BoneMask other)
+        {
+            var count = 0;
+            for (int i = 0; i < mWords.Length; i++)
+                count += PopCount(mWords[i] | other.mWords[i]);
+
+            return count;
+        }
+
+        public bool Equals(BoneMask other)
+        {
+            if (other == null || other.Count != Count)
+                return false;
+
+            for (int i = 0; i < mWords.Length; i++)
+            {
+                if (mWords[i] != other.mWords[i])
+                    return false;
+            }
+
+            return true;
+        }
+
+        public override bool Equals(object obj) => Equals(obj as BoneMask);
+
+        public override int GetHashCode()
+        {
+            unchecked
+            {
+                var hash = 17;
+                foreach (var word in mWords)
+                    hash = hash * 31 + word.GetHashCode();
+
+                return hash;
+            }
+        }
+
+        private static int PopCount(ulong value)
+        {
+            value -= (value >> 1) & 0x5555555555555555ul;
+            value = (value & 0x3333333333333333ul) + ((value >> 2) & 0x3333333333333333ul);
+            value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0Ful;
+            return (int)((value * 0x0101010101010101ul) >> 56);
+        }
+    }
+}
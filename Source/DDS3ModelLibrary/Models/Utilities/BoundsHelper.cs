@@ -0,0 +1,146 @@
+﻿using System;
+using System.Numerics;
+
+namespace DDS3ModelLibrary.Models.Utilities
+{
+    /// <summary>
+    /// Bounding volume kernels shared by <see cref="BoundingBox"/>, <see cref="BoundingSphere"/> and the bounds caches.
+    /// </summary>
+    public static class BoundsHelper
+    {
+        /// <summary>
+        /// Extends the given bounds to contain all positions.
+        /// Uses the vectorized min/max of <see cref="Vector3"/> with independent accumulators, so the loop isn't bound by their latency.
+        /// </summary>
+        public static void Accumulate(ReadOnlySpan<Vector3> positions, ref Vector3 min, ref Vector3 max)
+        {
+            var min0 = min;
+            var max0 = max;
+            var min1 = min;
+            var max1 = max;
+            var min2 = min;
+            var max2 = max;
+            var min3 = min;
+            var max3 = max;
+
+            var i = 0;
+            for (; i + 4 <= positions.Length; i += 4)
+            {
+                min0 = Vector3.Min(min0, positions[i]);
+                max0 = Vector3.Max(max0, positions[i]);
+                min1 = Vector3.Min(min1, positions[i + 1]);
+                max1 = Vector3.Max(max1, positions[i + 1]);
+                min2 = Vector3.Min(min2, positions[i + 2]);
+                max2 = Vector3.Max(max2, positions[i + 2]);
+                min3 = Vector3.Min(min3, positions[i + 3]);
+                max3 = Vector3.Max(max3, positions[i + 3]);
+            }
+
+            for (; i < positions.Length; i++)
+            {
+                min0 = Vector3.Min(min0, positions[i]);
+                max0 = Vector3.Max(max0, positions[i]);
+            }
+
+            min = Vector3.Min(Vector3.Min(min0, min1), Vector3.Min(min2, min3));
+            max = Vector3.Max(Vector3.Max(max0, max1), Vector3.Max(max2, max3));
+        }
+
+        /// <summary>
+        /// Gets the largest squared distance between the center and any of the positions.
+        /// </summary>
+        public static float GetMaxDistanceSquared(ReadOnlySpan<Vector3> positions, Vector3 center)
+        {
+            var maxDistance = 0f;
+            for (int i = 0; i < positions.Length; i++)
+                maxDistance = Math.Max(maxDistance, Vector3.DistanceSquared(positions[i], center));
+
+            return maxDistance;
+        }
+
+        /// <summary>
+        /// Calculates the axis aligned bounds of a transformed box, without transforming each of its corners.
+        /// </summary>
+        public static void Transform(Vector3 min, Vector3 max, in Matrix4x4 matrix, out Vector3 outMin, out Vector3 outMax)
+        {
+            var center = Vector3.Transform((min + max) * 0.5f, matrix);
+            var extents = (max - min) * 0.5f;
+
+            // The extents along each axis are the extents projected onto the absolute rows of the matrix
+            var transformedExtents = Vector3.Abs(new Vector3(matrix.M11, matrix.M12, matrix.M13)) * extents.X +
+                                     Vector3.Abs(new Vector3(matrix.M21, matrix.M22, matrix.M23)) * extents.Y +
+                                     Vector3.Abs(new Vector3(matrix.M31, matrix.M32, matrix.M33)) * extents.Z;
+
+            outMin = center - transformedExtents;
+            outMax = center + transformedExtents;
+        }
+
+        /// <summary>
+        /// Gets the largest scale factor of the matrix, to scale radii with.
+        /// </summary>
+        public static float GetMaxScale(in Matrix4x4 matrix)
+        {
+            var scaleX = new Vector3(matrix.M11, matrix.M12, matrix.M13).LengthSquared();
+            var scaleY = new Vector3(matrix.M21, matrix.M22, matrix.M23).LengthSquared();
+            var scaleZ = new Vector3(matrix.M31, matrix.M32, matrix.M33).LengthSquared();
+            return (float)Math.Sqrt(Math.Max(scaleX, Math.Max(scaleY, scaleZ)));
+        }
+
+        public static bool Intersects(Vector3 aMin, Vector3 aMax, Vector3 bMin, Vector3 bMax)
+        {
+            return aMin.X <= bMax.X && aMax.X >= bMin.X &&
+                   aMin.Y <= bMax.Y && aMax.Y >= bMin.Y &&
+                   aMin.Z <= bMax.Z && aMax.Z >= bMin.Z;
+        }
+
+        /// <summary>
+        /// Gets the squared distance between a point and the closest point of a box.
+        /// </summary>
+        public static float GetDistanceSquared(Vector3 min, Vector3 max, Vector3 point)
+        {
+            return Vector3.DistanceSquared(Vector3.Clamp(point, min, max), point);
+        }
+
+        /// <summary>
+        /// Determines whether the box is at least partially in front of all planes.
+        /// </summary>
+        public static bool Intersects(Vector3 min, Vector3 max, ReadOnlySpan<Plane> planes)
+        {
+            for (int i = 0; i < planes.Length; i++)
+            {
+                // Test the corner furthest along the plane normal
+                var normal = planes[i].Normal;
+                var corner = new Vector3(normal.X >= 0 ? max.X : min.X,
+                                         normal.Y >= 0 ? max.Y : min.Y,
+                                         normal.Z >= 0 ? max.Z : min.Z);
+
+                if (Plane.DotCoordinate(planes[i], corner) < 0)
+                    return false;
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Intersects a ray with a box.
+        /// </summary>
+        /// <param name="min">The minimum of the box.</param>
+        /// <param name="max">The maximum of the box.</param>
+        /// <param name="origin">The origin of the ray.</param>
+        /// <param name="inverseDirection">The reciprocal of the ray direction.</param>
+        /// <param name="maxDistance">The length of the ray.</param>
+        /// <param name="distance">The distance along the ray at which it enters the box, or 0 if it starts inside.</param>
+        public static bool Intersects(Vector3 min, Vector3 max, Vector3 origin, Vector3 inverseDirection, float maxDistance, out float distance)
+        {
+            var t1 = (min - origin) * inverseDirection;
+            var t2 = (max - origin) * inverseDirection;
+            var tMin = Vector3.Min(t1, t2);
+            var tMax = Vector3.Max(t1, t2);
+
+            var enter = Math.Max(Math.Max(tMin.X, tMin.Y), Math.Max(tMin.Z, 0));
+            var exit = Math.Min(Math.Min(tMax.X, tMax.Y), Math.Min(tMax.Z, maxDistance));
+            distance = enter;
+            return enter <= exit;
+        }
+    }
+}
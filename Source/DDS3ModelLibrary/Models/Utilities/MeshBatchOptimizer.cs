@@ -0,0 +1,477 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Numerics;
+
+namespace DDS3ModelLibrary.Models.Utilities
+{
+    /// <summary>
+    /// Reorders the triangles and vertices of meshes so that vertices are uploaded and transformed in the order they're used,
+    /// and orders batches so that consecutive batches share as many vertices as possible.
+    /// </summary>
+    public static class MeshBatchOptimizer
+    {
+        /// <summary>
+        /// The number of recently transformed vertices considered when ordering triangles.
+        /// </summary>
+        private const int CACHE_SIZE = 12;
+
+        /// <summary>
+        /// Optimizes all meshes in the model.
+        /// </summary>
+        public static void Optimize(Model model)
+        {
+            foreach (var node in model.Nodes)
+            {
+                if (node.Geometry == null)
+                    continue;
+
+                foreach (var meshList in node.Geometry.MeshLists)
+                {
+                    if (meshList == null)
+                        continue;
+
+                    foreach (var mesh in meshList)
+                        Optimize(mesh);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Optimizes the mesh. Mesh types that are not split into batches are left as is.
+        /// </summary>
+        public static void Optimize(Mesh mesh)
+        {
+            switch (mesh)
+            {
+                case MeshType1 meshType1:
+                    Optimize(meshType1);
+                    break;
+                case MeshType2 meshType2:
+                    Optimize(meshType2);
+                    break;
+                case MeshType7 meshType7:
+                    Optimize(meshType7);
+                    break;
+                case MeshType8 meshType8:
+                    Optimize(meshType8);
+                    break;
+            }
+        }
+
+        private static void Optimize(MeshType1 mesh)
+        {
+            foreach (var batch in mesh.Batches)
+            {
+                if (batch.TriangleCount == 0)
+                    continue;
+
+                batch.Triangles = OptimizeTriangles(batch.Triangles, batch.VertexCount, out var newToOld);
+                batch.Positions = Permute(batch.Positions, newToOld);
+                batch.Normals = Permute(batch.Normals, newToOld);
+                batch.TexCoords = Permute(batch.TexCoords, newToOld);
+                batch.TexCoords2 = Permute(batch.TexCoords2, newToOld);
+                batch.Colors = Permute(batch.Colors, newToOld);
+            }
+
+            OrderBatches(mesh.Batches, x => x.Positions);
+        }
+
+        private static void Optimize(MeshType2 mesh)
+        {
+            foreach (var batch in mesh.Batches)
+            {
+                if (batch.TriangleCount == 0)
+                    continue;
+
+                batch.Triangles = OptimizeTriangles(batch.Triangles, batch.VertexCount, out var newToOld);
+                foreach (var nodeBatch in batch.NodeBatches)
+                {
+                    nodeBatch.Positions = Permute(nodeBatch.Positions, newToOld);
+                    nodeBatch.Normals = Permute(nodeBatch.Normals, newToOld);
+                }
+
+                batch.TexCoords = Permute(batch.TexCoords, newToOld);
+                batch.TexCoords2 = Permute(batch.TexCoords2, newToOld);
+                batch.Colors = Permute(batch.Colors, newToOld);
+            }
+
+            // Node local positions are only comparable between batches influenced by the same node
+            OrderBatches(mesh.Batches, x => x.NodeBatches.Count == 0
+                ? Enumerable.Empty<(short, Vector4)>()
+                : x.NodeBatches[0].Positions.Select(y => (x.NodeBatches[0].NodeIndex, y)));
+        }
+
+        private static void Optimize(MeshType7 mesh)
+        {
+            if (mesh.TriangleCount == 0 || mesh.Batches.Count == 0)
+                return;
+
+            // Vertices can only be moved between batches if every batch is influenced by the same nodes
+            var nodeIndices = mesh.Batches[0].NodeBatches.Select(x => x.NodeIndex).ToList();
+            if (!mesh.Batches.TrueForAll(x => x.NodeBatches.Select(y => y.NodeIndex).SequenceEqual(nodeIndices)))
+                return;
+
+            var vertexCount = mesh.VertexCount;
+            if (!TryConcat(mesh.Batches.Select(x => x.TexCoords), vertexCount, out var texCoords) ||
+                (mesh.TexCoords2 != null && mesh.TexCoords2.Length != vertexCount))
+                return;
+
+            var positions = new Vector4[nodeIndices.Count][];
+            var normals = new Vector3[nodeIndices.Count][];
+            for (int i = 0; i < nodeIndices.Count; i++)
+            {
+                if (!TryConcat(mesh.Batches.Select(x => x.NodeBatches[i].Positions), vertexCount, out positions[i]) ||
+                    !TryConcat(mesh.Batches.Select(x => x.NodeBatches[i].Normals), vertexCount, out normals[i]))
+                    return;
+            }
+
+            var batchVertexLimit = mesh.Batches.Max(x => x.VertexCount);
+            mesh.Triangles = OptimizeTriangles(mesh.Triangles, vertexCount, out var newToOld);
+            texCoords = Permute(texCoords, newToOld);
+            for (int i = 0; i < nodeIndices.Count; i++)
+            {
+                positions[i] = Permute(positions[i], newToOld);
+                normals[i] = Permute(normals[i], newToOld);
+            }
+
+            // Split the reordered vertices over the batches again, so each batch holds a consecutive run of used vertices
+            var batchCount = (newToOld.Length + batchVertexLimit - 1) / batchVertexLimit;
+            for (int i = 0; i < batchCount; i++)
+            {
+                var batch = mesh.Batches[i];
+                var start = i * batchVertexLimit;
+                var count = Math.Min(batchVertexLimit, newToOld.Length - start);
+                batch.TexCoords = Slice(texCoords, start, count);
+                for (int j = 0; j < nodeIndices.Count; j++)
+                {
+                    batch.NodeBatches[j].Positions = Slice(positions[j], start, count);
+                    batch.NodeBatches[j].Normals = Slice(normals[j], start, count);
+                }
+            }
+
+            mesh.Batches.RemoveRange(batchCount, mesh.Batches.Count - batchCount);
+            if (mesh.TexCoords2 != null)
+                mesh.TexCoords2 = Permute(mesh.TexCoords2, newToOld);
+        }
+
+        private static void Optimize(MeshType8 mesh)
+        {
+            if (mesh.TriangleCount == 0 || mesh.Batches.Count == 0)
+                return;
+
+            var vertexCount = mesh.VertexCount;
+            if (!TryConcat(mesh.Batches.Select(x => x.Positions), vertexCount, out var positions) ||
+                !TryConcat(mesh.Batches.Select(x => x.Normals), vertexCount, out var normals) ||
+                !TryConcat(mesh.Batches.Select(x => x.TexCoords), vertexCount, out var texCoords) ||
+                (mesh.TexCoords2 != null && mesh.TexCoords2.Length != vertexCount))
+                return;
+
+            var batchVertexLimit = mesh.Batches.Max(x => x.VertexCount);
+            mesh.Triangles = OptimizeTriangles(mesh.Triangles, vertexCount, out var newToOld);
+            positions = Permute(positions, newToOld);
+            normals = Permute(normals, newToOld);
+            texCoords = Permute(texCoords, newToOld);
+
+            // Split the reordered vertices over the batches again, so each batch holds a consecutive run of used vertices
+            var batchCount = (newToOld.Length + batchVertexLimit - 1) / batchVertexLimit;
+            for (int i = 0; i < batchCount; i++)
+            {
+                var batch = mesh.Batches[i];
+                var start = i * batchVertexLimit;
+                var count = Math.Min(batchVertexLimit, newToOld.Length - start);
+                batch.Positions = Slice(positions, start, count);
+                batch.Normals = Slice(normals, start, count);
+                batch.TexCoords = Slice(texCoords, start, count);
+            }
+
+            mesh.Batches.RemoveRange(batchCount, mesh.Batches.Count - batchCount);
+            if (mesh.TexCoords2 != null)
+                mesh.TexCoords2 = Permute(mesh.TexCoords2, newToOld);
+        }
+
+        /// <summary>
+        /// Reorders the triangles and renumbers their vertices in the order they're first used.
+        /// Vertices that aren't used by any triangle are dropped.
+        /// </summary>
+        /// <param name="newToOld">The original index of each vertex after renumbering.</param>
+        private static Triangle[] OptimizeTriangles(Triangle[] triangles, int vertexCount, out int[] newToOld)
+        {
+            var order = OrderTriangles(triangles, vertexCount, CACHE_SIZE);
+            var oldToNew = new int[vertexCount];
+            for (int i = 0; i < oldToNew.Length; i++)
+                oldToNew[i] = -1;
+
+            var newToOldList = new List<int>(vertexCount);
+            int Remap(ushort index)
+            {
+                if (oldToNew[index] == -1)
+                {
+                    oldToNew[index] = newToOldList.Count;
+                    newToOldList.Add(index);
+                }
+
+                return oldToNew[index];
+            }
+
+            var result = new Triangle[triangles.Length];
+            for (int i = 0; i < order.Length; i++)
+            {
+                var triangle = triangles[order[i]];
+                var a = Remap(triangle.A);
+                var b = Remap(triangle.B);
+                var c = Remap(triangle.C);
+                result[i] = new Triangle((ushort)a, (ushort)b, (ushort)c);
+            }
+
+            newToOld = newToOldList.ToArray();
+            return result;
+        }
+
+        /// <summary>
+        /// Orders triangles for vertex reuse in linear time, using the Tipsify algorithm (Sander, Nehab and Barczak 2007).
+        /// Triangles are emitted in fans around a vertex, after which the next fan vertex is picked among the vertices that
+        /// were just used, preferring those that are still within the last <paramref name="cacheSize"/> transformed vertices.
+        /// </summary>
+        /// <returns>The original index of each triangle in the new order.</returns>
+        internal static int[] OrderTriangles(Triangle[] triangles, int vertexCount, int cacheSize)
+        {
+            // Build the vertex to triangle adjacency as a compressed list
+            var adjacencyStart = new int[vertexCount + 1];
+            foreach (var triangle in triangles)
+            {
+                ++adjacencyStart[triangle.A + 1];
+                ++adjacencyStart[triangle.B + 1];
+                ++adjacencyStart[triangle.C + 1];
+            }
+
+            for (int i = 0; i < vertexCount; i++)
+                adjacencyStart[i + 1] += adjacencyStart[i];
+
+            var adjacency = new int[adjacencyStart[vertexCount]];
+            var liveCount = new int[vertexCount];
+            for (int i = 0; i < triangles.Length; i++)
+            {
+                for (int j = 0; j < 3; j++)
+                {
+                    var index = GetIndex(triangles[i], j);
+                    adjacency[adjacencyStart[index] + liveCount[index]++] = i;
+                }
+            }
+
+            // Timestamps start far enough in the past for every vertex to be outside of the cache
+            var cacheTime = new int[vertexCount];
+            var time = cacheSize + 1;
+            var isEmitted = new bool[triangles.Length];
+            var deadEnd = new Stack<int>();
+            var candidates = new List<int>();
+            var order = new int[triangles.Length];
+            var orderCount = 0;
+            var cursor = 0;
+
+            int SkipDeadEnd()
+            {
+                // Prefer recently used vertices, then fall back to the next vertex in input order
+                while (deadEnd.Count > 0)
+                {
+                    var index = deadEnd.Pop();
+                    if (liveCount[index] > 0)
+                        return index;
+                }
+
+                while (cursor < vertexCount)
+                {
+                    if (liveCount[cursor] > 0)
+                        return cursor;
+
+                    ++cursor;
+                }
+
+                return -1;
+            }
+
+            var fanVertex = SkipDeadEnd();
+            while (fanVertex != -1)
+            {
+                candidates.Clear();
+                for (int i = adjacencyStart[fanVertex]; i < adjacencyStart[fanVertex + 1]; i++)
+                {
+                    var triangleIndex = adjacency[i];
+                    if (isEmitted[triangleIndex])
+                        continue;
+
+                    isEmitted[triangleIndex] = true;
+                    order[orderCount++] = triangleIndex;
+                    for (int j = 0; j < 3; j++)
+                    {
+                        var index = GetIndex(triangles[triangleIndex], j);
+                        deadEnd.Push(index);
+                        candidates.Add(index);
+                        --liveCount[index];
+                        if (time - cacheTime[index] > cacheSize)
+                            cacheTime[index] = time++;
+                    }
+                }
+
+                // Pick the vertex that will stay in the cache the longest after its remaining triangles are emitted
+                fanVertex = -1;
+                var bestPriority = -1;
+                foreach (var index in candidates)
+                {
+                    if (liveCount[index] <= 0)
+                        continue;
+
+                    var priority = 0;
+                    if (time - cacheTime[index] + 2 * liveCount[index] <= cacheSize)
+                        priority = time - cacheTime[index];
+
+                    if (priority > bestPriority)
+                    {
+                        bestPriority = priority;
+                        fanVertex = index;
+                    }
+                }
+
+                if (fanVertex == -1)
+                    fanVertex = SkipDeadEnd();
+            }
+
+            Debug.Assert(orderCount == triangles.Length);
+            return order;
+        }
+
+        /// <summary>
+        /// Orders batches greedily so that each batch is followed by the remaining batch it shares the most vertices with.
+        /// Batches that share nothing keep their original relative order.
+        /// </summary>
+        private static void OrderBatches<TBatch, TKey>(List<TBatch> batches, Func<TBatch, IEnumerable<TKey>> vertexSelector)
+        {
+            if (batches.Count <= 2)
+                return;
+
+            var vertexBatches = new Dictionary<TKey, List<int>>();
+            for (int i = 0; i < batches.Count; i++)
+            {
+                foreach (var vertex in vertexSelector(batches[i]))
+                {
+                    if (!vertexBatches.TryGetValue(vertex, out var list))
+                        vertexBatches[vertex] = list = new List<int>();
+
+                    if (list.Count == 0 || list[list.Count - 1] != i)
+                        list.Add(i);
+                }
+            }
+
+            var isOrdered = new bool[batches.Count];
+            var sharedCount = new int[batches.Count];
+            var sharedTag = new int[batches.Count];
+            var ordered = new List<TBatch>(batches.Count);
+            var cursor = 0;
+            var current = 0;
+
+            while (true)
+            {
+                isOrdered[current] = true;
+                ordered.Add(batches[current]);
+                if (ordered.Count == batches.Count)
+                    break;
+
+                // Count the vertices shared with each remaining batch, tagging the counts so they never have to be cleared
+                var next = -1;
+                foreach (var vertex in vertexSelector(batches[current]))
+                {
+                    foreach (var other in vertexBatches[vertex])
+                    {
+                        if (isOrdered[other])
+                            continue;
+
+                        if (sharedTag[other] != ordered.Count)
+                        {
+                            sharedTag[other] = ordered.Count;
+                            sharedCount[other] = 0;
+                        }
+
+                        ++sharedCount[other];
+                        if (next == -1 || sharedCount[other] > sharedCount[next] || (sharedCount[other] == sharedCount[next] && other < next))
+                            next = other;
+                    }
+                }
+
+                if (next == -1)
+                {
+                    while (isOrdered[cursor])
+                        ++cursor;
+
+                    next = cursor;
+                }
+
+                current = next;
+            }
+
+            batches.Clear();
+            batches.AddRange(ordered);
+        }
+
+        private static ushort GetIndex(in Triangle triangle, int corner)
+        {
+            switch (corner)
+            {
+                case 0: return triangle.A;
+                case 1: return triangle.B;
+                default: return triangle.C;
+            }
+        }
+
+        private static T[] Permute<T>(T[] array, int[] newToOld)
+        {
+            if (array == null)
+                return null;
+
+            var result = new T[newToOld.Length];
+            for (int i = 0; i < result.Length; i++)
+                result[i] = array[newToOld[i]];
+
+            return result;
+        }
+
+        private static T[] Slice<T>(T[] array, int start, int count)
+        {
+            if (array == null)
+                return null;
+
+            var result = new T[count];
+            Array.Copy(array, start, result, 0, count);
+            return result;
+        }
+
+        /// <summary>
+        /// Concatenates the per batch arrays. Fails if only some of the batches have the array.
+        /// </summary>
+        private static bool TryConcat<T>(IEnumerable<T[]> arrays, int length, out T[] result)
+        {
+            result = null;
+            var hasNull = false;
+            var offset = 0;
+            foreach (var array in arrays)
+            {
+                if (array == null)
+                {
+                    hasNull = true;
+                    continue;
+                }
+
+                if (result == null)
+                    result = new T[length];
+
+                if (offset + array.Length > length)
+                    return false;
+
+                Array.Copy(array, 0, result, offset, array.Length);
+                offset += array.Length;
+            }
+
+            return result == null || (!hasNull && offset == length);
+        }
+    }
+}
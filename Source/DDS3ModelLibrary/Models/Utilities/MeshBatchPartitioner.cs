@@ -0,0 +1,179 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+
+namespace DDS3ModelLibrary.Models.Utilities
+{
+    /// <summary>
+    /// A group of faces that references at most a fixed number of unique vertices.
+    /// </summary>
+    internal class MeshBatchPartition
+    {
+        /// <summary>
+        /// Gets the indices of the faces in the batch.
+        /// </summary>
+        public List<int> FaceIndices { get; } = new List<int>();
+
+        /// <summary>
+        /// Gets the vertices used by the batch, in the order they're first referenced.
+        /// </summary>
+        public List<int> Vertices { get; } = new List<int>();
+
+        /// <summary>
+        /// Gets the vertex indices of each face relative to <see cref="Vertices"/>, flattened in face order.
+        /// </summary>
+        public List<int> Indices { get; } = new List<int>();
+    }
+
+    /// <summary>
+    /// Partitions faces into batches with a limited number of unique vertices in linear time.
+    /// Batches are grown from a seed face by repeatedly adding the adjacent face that introduces the fewest new vertices,
+    /// which keeps batches spatially coherent and close to full.
+    /// </summary>
+    internal static class MeshBatchPartitioner
+    {
+        /// <summary>
+        /// Partitions the faces into batches.
+        /// </summary>
+        /// <param name="faces">The vertex indices of each face. Identical vertices must share the same index.</param>
+        /// <param name="vertexCount">The number of unique vertices.</param>
+        /// <param name="maxVertexCount">The maximum number of unique vertices in a batch.</param>
+        /// <param name="fillRatio">The average number of vertices per batch relative to <paramref name="maxVertexCount"/>.</param>
+        public static List<MeshBatchPartition> Partition(IReadOnlyList<int[]> faces, int vertexCount, int maxVertexCount, out float fillRatio)
+        {
+            // Build the vertex to face adjacency as a compressed list
+            var maxFaceIndexCount = 0;
+            var vertexFaceStart = new int[vertexCount + 1];
+            foreach (var face in faces)
+            {
+                maxFaceIndexCount = Math.Max(maxFaceIndexCount, face.Length);
+                foreach (var index in face)
+                    ++vertexFaceStart[index + 1];
+            }
+
+            for (int i = 0; i < vertexCount; i++)
+                vertexFaceStart[i + 1] += vertexFaceStart[i];
+
+            var vertexFaces = new int[vertexFaceStart[vertexCount]];
+            var vertexFaceFill = new int[vertexCount];
+            for (int i = 0; i < faces.Count; i++)
+            {
+                foreach (var index in faces[i])
+                    vertexFaces[vertexFaceStart[index] + vertexFaceFill[index]++] = i;
+            }
+
+            // Per vertex state is tagged with the batch it belongs to, so it never has to be cleared
+            var vertexBatch = new int[vertexCount];
+            var vertexLocalIndex = new int[vertexCount];
+            for (int i = 0; i < vertexBatch.Length; i++)
+                vertexBatch[i] = -1;
+
+            var isFaceAssigned = new bool[faces.Count];
+            var frontier = new List<int>[maxFaceIndexCount + 1];
+            for (int i = 0; i < frontier.Length; i++)
+                frontier[i] = new List<int>();
+
+            var batches = new List<MeshBatchPartition>();
+            var seedCursor = 0;
+            var totalVertexCount = 0;
+
+            while (true)
+            {
+                while (seedCursor < faces.Count && isFaceAssigned[seedCursor])
+                    ++seedCursor;
+
+                if (seedCursor == faces.Count)
+                    break;
+
+                var batchIndex = batches.Count;
+                var batch = new MeshBatchPartition();
+                batches.Add(batch);
+
+                int CountNewVertices(int faceIndex)
+                {
+                    var count = 0;
+                    var face = faces[faceIndex];
+                    for (int i = 0; i < face.Length; i++)
+                    {
+                        if (vertexBatch[face[i]] != batchIndex && Array.IndexOf(face, face[i], 0, i) == -1)
+                            ++count;
+                    }
+
+                    return count;
+                }
+
+                void AddFace(int faceIndex)
+                {
+                    isFaceAssigned[faceIndex] = true;
+                    batch.FaceIndices.Add(faceIndex);
+                    foreach (var index in faces[faceIndex])
+                    {
+                        if (vertexBatch[index] != batchIndex)
+                        {
+                            vertexBatch[index] = batchIndex;
+                            vertexLocalIndex[index] = batch.Vertices.Count;
+                            batch.Vertices.Add(index);
+
+                            // Faces sharing the new vertex become cheaper to add
+                            for (int j = vertexFaceStart[index]; j < vertexFaceStart[index + 1]; j++)
+                            {
+                                var neighbour = vertexFaces[j];
+                                if (!isFaceAssigned[neighbour])
+                                    frontier[CountNewVertices(neighbour)].Add(neighbour);
+                            }
+                        }
+
+                        batch.Indices.Add(vertexLocalIndex[index]);
+                    }
+                }
+
+                AddFace(seedCursor);
+
+                while (true)
+                {
+                    var remaining = maxVertexCount - batch.Vertices.Count;
+                    var nextFace = -1;
+
+                    // Take the cheapest adjacent face. Costs only decrease while the batch grows, so entries may be stale but never too low.
+                    for (int cost = 0; cost <= Math.Min(remaining, maxFaceIndexCount) && nextFace == -1; cost++)
+                    {
+                        var bucket = frontier[cost];
+                        while (bucket.Count > 0)
+                        {
+                            var faceIndex = bucket[bucket.Count - 1];
+                            bucket.RemoveAt(bucket.Count - 1);
+                            if (!isFaceAssigned[faceIndex] && CountNewVertices(faceIndex) <= remaining)
+                            {
+                                nextFace = faceIndex;
+                                break;
+                            }
+                        }
+                    }
+
+                    if (nextFace == -1)
+                    {
+                        // Nothing adjacent fits, try to continue with the next unassigned face instead
+                        while (seedCursor < faces.Count && isFaceAssigned[seedCursor])
+                            ++seedCursor;
+
+                        if (seedCursor == faces.Count || CountNewVertices(seedCursor) > remaining)
+                            break;
+
+                        nextFace = seedCursor;
+                    }
+
+                    AddFace(nextFace);
+                }
+
+                foreach (var bucket in frontier)
+                    bucket.Clear();
+
+                Debug.Assert(batch.Vertices.Count <= maxVertexCount);
+                totalVertexCount += batch.Vertices.Count;
+            }
+
+            fillRatio = batches.Count == 0 ? 0 : (float)totalVertexCount / (batches.Count * maxVertexCount);
+            return batches;
+        }
+    }
+}
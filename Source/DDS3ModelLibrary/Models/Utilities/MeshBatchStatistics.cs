@@ -0,0 +1,103 @@
+﻿namespace DDS3ModelLibrary.Models.Utilities
+{
+    /// <summary>
+    /// Describes how much vertex work the meshes of a model take to render.
+    /// </summary>
+    public class MeshBatchStatistics
+    {
+        private int mSplitBatchCount;
+        private int mSplitVertexCount;
+
+        public int MeshCount { get; private set; }
+
+        /// <summary>
+        /// Gets the number of batches uploaded to the VU. Meshes that aren't split into batches count as a single batch.
+        /// </summary>
+        public int BatchCount { get; private set; }
+
+        public int TriangleCount { get; private set; }
+
+        /// <summary>
+        /// Gets the number of vertices transformed, counting vertices that are duplicated across batches once per batch.
+        /// </summary>
+        public int TransformedVertexCount { get; private set; }
+
+        public float VerticesPerTriangle => TriangleCount == 0 ? 0 : (float)TransformedVertexCount / TriangleCount;
+
+        /// <summary>
+        /// Gets the vertex limit of a batch the fill ratio is relative to. 0 if it wasn't given.
+        /// </summary>
+        public int BatchVertexLimit { get; private set; }
+
+        /// <summary>
+        /// Gets the average number of vertices per batch relative to <see cref="BatchVertexLimit"/>, over the meshes that are split into batches.
+        /// </summary>
+        public float BatchFillRatio => mSplitBatchCount == 0 || BatchVertexLimit == 0 ? 0 : (float)mSplitVertexCount / (mSplitBatchCount * BatchVertexLimit);
+
+        /// <summary>
+        /// Calculates the statistics for all meshes in the model.
+        /// </summary>
+        /// <param name="model">The model.</param>
+        /// <param name="batchVertexLimit">The vertex limit the batches were built with, to calculate the fill ratio. 0 to skip it.</param>
+        public static MeshBatchStatistics Calculate(Model model, int batchVertexLimit = 0)
+        {
+            var statistics = new MeshBatchStatistics { BatchVertexLimit = batchVertexLimit };
+            foreach (var node in model.Nodes)
+            {
+                if (node.Geometry == null)
+                    continue;
+
+                foreach (var meshList in node.Geometry.MeshLists)
+                {
+                    if (meshList == null)
+                        continue;
+
+                    foreach (var mesh in meshList)
+                    {
+                        var batchCount = GetBatchCount(mesh, out var isSplit);
+                        statistics.MeshCount++;
+                        statistics.BatchCount += batchCount;
+                        statistics.TriangleCount += mesh.TriangleCount;
+                        statistics.TransformedVertexCount += mesh.VertexCount;
+                        if (isSplit)
+                        {
+                            statistics.mSplitBatchCount += batchCount;
+                            statistics.mSplitVertexCount += mesh.VertexCount;
+                        }
+                    }
+                }
+            }
+
+            return statistics;
+        }
+
+        private static int GetBatchCount(Mesh mesh, out bool isSplit)
+        {
+            isSplit = true;
+            switch (mesh)
+            {
+                case MeshType1 meshType1:
+                    return meshType1.Batches.Count;
+                case MeshType2 meshType2:
+                    return meshType2.Batches.Count;
+                case MeshType7 meshType7:
+                    return meshType7.Batches.Count;
+                case MeshType8 meshType8:
+                    return meshType8.Batches.Count;
+                default:
+                    isSplit = false;
+                    return 1;
+            }
+        }
+
+        public override string ToString()
+        {
+            var result = $"{MeshCount} meshes, {BatchCount} batches, {TriangleCount} triangles, " +
+                         $"{TransformedVertexCount} vertices transformed ({VerticesPerTriangle:F2} per triangle)";
+            if (BatchVertexLimit > 0)
+                result += $", batches {BatchFillRatio:P0} filled";
+
+            return result;
+        }
+    }
+}
@@ -0,0 +1,18 @@
+﻿namespace DDS3ModelLibrary.Models.Utilities
+{
+    /// <summary>
+    /// Options for <see cref="MeshQuantizer"/>.
+    /// </summary>
+    public class MeshQuantizationOptions
+    {
+        /// <summary>
+        /// Gets or sets the largest distance a quantized position may be off from the original position, in model units.
+        /// </summary>
+        public float PositionTolerance { get; set; } = 0.01f;
+
+        /// <summary>
+        /// Gets or sets the largest angle a quantized normal may be off from the original normal, in degrees.
+        /// </summary>
+        public float NormalTolerance { get; set; } = 1f;
+    }
+}
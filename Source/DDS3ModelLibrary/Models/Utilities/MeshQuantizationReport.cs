@@ -0,0 +1,86 @@
+﻿using System.Collections.Generic;
+using System.Linq;
+
+namespace DDS3ModelLibrary.Models.Utilities
+{
+    /// <summary>
+    /// Describes which batches of a model can be stored quantized within the tolerances, and how much smaller they'd be.
+    /// </summary>
+    public class MeshQuantizationReport
+    {
+        /// <summary>
+        /// Describes a batch of a static mesh.
+        /// </summary>
+        public class BatchResult
+        {
+            public int NodeIndex { get; }
+
+            public MeshType MeshType { get; }
+
+            public int BatchIndex { get; }
+
+            public int VertexCount { get; }
+
+            /// <summary>
+            /// Gets the size of the vertex data stored as floats.
+            /// </summary>
+            public int FloatSize { get; }
+
+            /// <summary>
+            /// Gets the size of the vertex data stored quantized.
+            /// </summary>
+            public int QuantizedSize { get; }
+
+            /// <summary>
+            /// Gets the largest position error, in model units.
+            /// </summary>
+            public float PositionError { get; }
+
+            /// <summary>
+            /// Gets the largest normal error, in degrees.
+            /// </summary>
+            public float NormalError { get; }
+
+            /// <summary>
+            /// Gets whether the errors are within the tolerances.
+            /// </summary>
+            public bool IsWithinTolerance { get; }
+
+            internal BatchResult(int nodeIndex, MeshType meshType, int batchIndex, int vertexCount, int floatSize, int quantizedSize,
+                                 float positionError, float normalError, bool isWithinTolerance)
+            {
+                NodeIndex = nodeIndex;
+                MeshType = meshType;
+                BatchIndex = batchIndex;
+                VertexCount = vertexCount;
+                FloatSize = floatSize;
+                QuantizedSize = quantizedSize;
+                PositionError = positionError;
+                NormalError = normalError;
+                IsWithinTolerance = isWithinTolerance;
+            }
+
+            public override string ToString()
+            {
+                return $"Node {NodeIndex} {MeshType} batch {BatchIndex}: {VertexCount} vertices, {FloatSize} -> {QuantizedSize} bytes, " +
+                       $"error {PositionError:F4} / {NormalError:F2} deg{(IsWithinTolerance ? "" : " (exceeds tolerance)")}";
+            }
+        }
+
+        public List<BatchResult> Batches { get; } = new List<BatchResult>();
+
+        public int FloatSize => Batches.Sum(x => x.FloatSize);
+
+        /// <summary>
+        /// Gets the size of the vertex data when batches within the tolerances are quantized and the others are stored as floats.
+        /// </summary>
+        public int QuantizedSize => Batches.Sum(x => x.IsWithinTolerance ? x.QuantizedSize : x.FloatSize);
+
+        public int QuantizableBatchCount => Batches.Count(x => x.IsWithinTolerance);
+
+        public override string ToString()
+        {
+            return $"{QuantizableBatchCount}/{Batches.Count} batches within tolerance, {FloatSize} -> {QuantizedSize} bytes";
+        }
+    }
+}
@@ -0,0 +1,89 @@
+﻿using System;
+using System.Numerics;
+
+namespace DDS3ModelLibrary.Models.Utilities
+{
+    /// <summary>
+    /// Quantizes the vertices of static mesh batches and validates the result against the float vertices.
+    /// </summary>
+    public static class MeshQuantizer
+    {
+        /// <summary>
+        /// Quantizes every batch of the static meshes of the model and reports the errors and sizes.
+        /// </summary>
+        public static MeshQuantizationReport Analyze(Model model, MeshQuantizationOptions options = null)
+        {
+            if (options == null)
+                options = new MeshQuantizationOptions();
+
+            var report = new MeshQuantizationReport();
+            for (int nodeIndex = 0; nodeIndex < model.Nodes.Count; nodeIndex++)
+            {
+                var geometry = model.Nodes[nodeIndex].Geometry;
+                if (geometry == null)
+                    continue;
+
+                foreach (var meshList in geometry.MeshLists)
+                {
+                    if (meshList == null)
+                        continue;
+
+                    foreach (var mesh in meshList)
+                    {
+                        switch (mesh)
+                        {
+                            case MeshType1 meshType1:
+                                for (int i = 0; i < meshType1.Batches.Count; i++)
+                                    AddResult(report, nodeIndex, mesh.Type, i, meshType1.Batches[i].Positions, meshType1.Batches[i].Normals, options);
+                                break;
+
+                            case MeshType8 meshType8:
+                                for (int i = 0; i < meshType8.Batches.Count; i++)
+                                    AddResult(report, nodeIndex, mesh.Type, i, meshType8.Batches[i].Positions, meshType8.Batches[i].Normals, options);
+                                break;
+                        }
+                    }
+                }
+            }
+
+            return report;
+        }
+
+        /// <summary>
+        /// Quantizes the vertices of a batch.
+        /// </summary>
+        /// <returns>True if the errors are within the tolerances.</returns>
+        public static bool TryEncode(MeshType1Batch batch, MeshQuantizationOptions options, out QuantizedVertices vertices)
+        {
+            return TryEncode(batch.Positions, batch.Normals, options, out vertices, out _, out _);
+        }
+
+        /// <summary>
+        /// Quantizes the vertices of a batch.
+        /// </summary>
+        /// <returns>True if the errors are within the tolerances.</returns>
+        public static bool TryEncode(MeshType8Batch batch, MeshQuantizationOptions options, out QuantizedVertices vertices)
+        {
+            return TryEncode(batch.Positions, batch.Normals, options, out vertices, out _, out _);
+        }
+
+        private static bool TryEncode(ReadOnlySpan<Vector3> positions, ReadOnlySpan<Vector3> normals, MeshQuantizationOptions options,
+                                      out QuantizedVertices vertices, out float positionError, out float normalError)
+        {
+            vertices = QuantizedVertices.Encode(positions, normals);
+            vertices.MeasureError(positions, normals, out positionError, out normalError);
+            return positionError <= options.PositionTolerance && normalError <= options.NormalTolerance;
+        }
+
+        private static void AddResult(MeshQuantizationReport report, int nodeIndex, MeshType meshType, int batchIndex, Vector3[] positions,
+                                      Vector3[] normals, MeshQuantizationOptions options)
+        {
+            if (positions == null)
+                return;
+
+            var isWithinTolerance = TryEncode(positions, normals, options, out var vertices, out var positionError, out var normalError);
+            report.Batches.Add(new MeshQuantizationReport.BatchResult(nodeIndex, meshType, batchIndex, vertices.VertexCount, vertices.FloatSize,
+                                                                      vertices.EncodedSize, positionError, normalError, isWithinTolerance));
+        }
+    }
+}
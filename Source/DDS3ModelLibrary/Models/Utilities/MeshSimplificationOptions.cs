@@ -0,0 +1,28 @@
+﻿namespace DDS3ModelLibrary.Models.Utilities
+{
+    /// <summary>
+    /// Options for <see cref="MeshSimplifier"/>.
+    /// </summary>
+    public class MeshSimplificationOptions
+    {
+        /// <summary>
+        /// Gets or sets the number of triangles to reduce the whole model to. 0 to not limit the number of triangles.
+        /// </summary>
+        public int TargetTriangleCount { get; set; }
+
+        /// <summary>
+        /// Gets or sets the number of vertices to reduce the whole model to. 0 to not limit the number of vertices.
+        /// </summary>
+        public int TargetVertexCount { get; set; }
+
+        /// <summary>
+        /// Gets or sets the maximum error of a single edge collapse, relative to the size of the mesh bounds.
+        /// </summary>
+        public float MaxError { get; set; } = 0.02f;
+
+        /// <summary>
+        /// Gets or sets the maximum number of vertices in a batch of the simplified meshes.
+        /// </summary>
+        public int BatchVertexLimit { get; set; } = 24;
+    }
+}
@@ -0,0 +1,104 @@
+﻿using System.Collections.Generic;
+using System.Linq;
+
+namespace DDS3ModelLibrary.Models.Utilities
+{
+    /// <summary>
+    /// Describes the outcome of simplifying the meshes of a model.
+    /// </summary>
+    public class MeshSimplificationReport
+    {
+        /// <summary>
+        /// Describes a mesh that was simplified, and holds its simplified variant.
+        /// </summary>
+        public class MeshResult
+        {
+            public int NodeIndex { get; }
+
+            /// <summary>
+            /// Gets the index of the mesh list in the geometry of the node.
+            /// </summary>
+            public int MeshListIndex { get; }
+
+            /// <summary>
+            /// Gets the index of the mesh in its mesh list.
+            /// </summary>
+            public int MeshIndex { get; }
+
+            /// <summary>
+            /// Gets the mesh that was simplified.
+            /// </summary>
+            public Mesh OriginalMesh { get; }
+
+            /// <summary>
+            /// Gets the simplified variant of the mesh.
+            /// </summary>
+            public Mesh Mesh { get; }
+
+            public MeshType MeshType => OriginalMesh.Type;
+
+            public int OriginalTriangleCount => OriginalMesh.TriangleCount;
+
+            public int TriangleCount => Mesh.TriangleCount;
+
+            public int OriginalVertexCount => OriginalMesh.VertexCount;
+
+            public int VertexCount => Mesh.VertexCount;
+
+            /// <summary>
+            /// Gets the largest distance error of all edge collapses, in model units.
+            /// </summary>
+            public float Error { get; }
+
+            /// <summary>
+            /// Gets the error relative to the size of the mesh bounds.
+            /// </summary>
+            public float RelativeError { get; }
+
+            internal MeshResult(int nodeIndex, int meshListIndex, int meshIndex, Mesh originalMesh, Mesh mesh, float error, float relativeError)
+            {
+                NodeIndex = nodeIndex;
+                MeshListIndex = meshListIndex;
+                MeshIndex = meshIndex;
+                OriginalMesh = originalMesh;
+                Mesh = mesh;
+                Error = error;
+                RelativeError = relativeError;
+            }
+
+            public override string ToString()
+            {
+                return $"Node {NodeIndex} {MeshType}: {OriginalTriangleCount} -> {TriangleCount} triangles, " +
+                       $"{OriginalVertexCount} -> {VertexCount} vertices, error {Error:F4} ({RelativeError:P2})";
+            }
+        }
+
+        public List<MeshResult> Meshes { get; } = new List<MeshResult>();
+
+        public int OriginalTriangleCount => Meshes.Sum(x => x.OriginalTriangleCount);
+
+        public int TriangleCount => Meshes.Sum(x => x.TriangleCount);
+
+        public int OriginalVertexCount => Meshes.Sum(x => x.OriginalVertexCount);
+
+        public int VertexCount => Meshes.Sum(x => x.VertexCount);
+
+        public float MaxRelativeError => Meshes.Count == 0 ? 0 : Meshes.Max(x => x.RelativeError);
+
+        /// <summary>
+        /// Replaces the meshes of the model with their simplified variants.
+        /// The model should be the one that was simplified, or a copy of it with the same structure.
+        /// </summary>
+        public void Apply(Model model)
+        {
+            foreach (var mesh in Meshes)
+                model.Nodes[mesh.NodeIndex].Geometry.MeshLists[mesh.MeshListIndex][mesh.MeshIndex] = mesh.Mesh;
+        }
+
+        public override string ToString()
+        {
+            return $"{Meshes.Count} meshes, {OriginalTriangleCount} -> {TriangleCount} triangles, " +
+                   $"{OriginalVertexCount} -> {VertexCount} vertices, max error {MaxRelativeError:P2}";
+        }
+    }
+}
@@ -0,0 +1,521 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Numerics;
+
+namespace DDS3ModelLibrary.Models.Utilities
+{
+    /// <summary>
+    /// Generates reduced detail variants of model meshes using quadric edge collapse.
+    /// UV seams, mesh borders (and with that material boundaries) are preserved, and vertices only collapse onto vertices
+    /// with the same dominant node influence. Simplified meshes are split into batches again using the given batch limits.
+    /// </summary>
+    public static class MeshSimplifier
+    {
+        /// <summary>
+        /// Creates simplified variants of the meshes of the model, which are returned in the report. The model itself is not modified.
+        /// Mesh types 1, 2, 7 and 8 are supported, others are skipped.
+        /// The triangle and vertex budgets are distributed over the meshes proportionally to their size.
+        /// </summary>
+        public static MeshSimplificationReport Simplify(Model model, MeshSimplificationOptions options)
+        {
+            var report = new MeshSimplificationReport();
+            var meshes = new List<(int NodeIndex, int MeshListIndex, int MeshIndex, Mesh Mesh)>();
+            var totalTriangleCount = 0;
+            var totalVertexCount = 0;
+            for (int i = 0; i < model.Nodes.Count; i++)
+            {
+                var node = model.Nodes[i];
+                if (node.Geometry == null)
+                    continue;
+
+                for (int j = 0; j < node.Geometry.MeshLists.Length; j++)
+                {
+                    var meshList = node.Geometry.MeshLists[j];
+                    if (meshList == null)
+                        continue;
+
+                    for (int k = 0; k < meshList.Count; k++)
+                    {
+                        if (!IsSupported(meshList[k]))
+                            continue;
+
+                        meshes.Add((i, j, k, meshList[k]));
+                        totalTriangleCount += meshList[k].TriangleCount;
+                        totalVertexCount += meshList[k].VertexCount;
+                    }
+                }
+            }
+
+            var triangleRatio = GetRatio(options.TargetTriangleCount, totalTriangleCount);
+            var vertexRatio = GetRatio(options.TargetVertexCount, totalVertexCount);
+            foreach (var (nodeIndex, meshListIndex, meshIndex, mesh) in meshes)
+            {
+                var simplifiedMesh = Simplify(mesh, model.Nodes, triangleRatio, vertexRatio, options, out var error, out var relativeError);
+                report.Meshes.Add(new MeshSimplificationReport.MeshResult(nodeIndex, meshListIndex, meshIndex, mesh, simplifiedMesh, error, relativeError));
+            }
+
+            return report;
+        }
+
+        /// <summary>
+        /// Creates a simplified variant of the mesh.
+        /// </summary>
+        /// <param name="mesh">The mesh to simplify. It is not modified.</param>
+        /// <param name="nodes">The nodes of the model the mesh belongs to.</param>
+        /// <param name="triangleRatio">The fraction of triangles to keep.</param>
+        /// <param name="vertexRatio">The fraction of vertices to keep.</param>
+        /// <param name="options">The simplification options.</param>
+        /// <param name="error">The largest distance error of all edge collapses.</param>
+        /// <param name="relativeError">The error relative to the size of the mesh bounds.</param>
+        public static Mesh Simplify(Mesh mesh, List<Node> nodes, float triangleRatio, float vertexRatio, MeshSimplificationOptions options,
+                                    out float error, out float relativeError)
+        {
+            if (!IsSupported(mesh))
+                throw new NotSupportedException($"Mesh type {mesh.Type} can not be simplified");
+
+            if (mesh.TriangleCount == 0)
+            {
+                error = relativeError = 0;
+                return mesh;
+            }
+
+            var vertices = new VertexBuffer();
+            var indices = new List<int>();
+            short[] nodeIndices = null;
+            switch (mesh)
+            {
+                case MeshType1 meshType1:
+                    foreach (var batch in meshType1.Batches)
+                    {
+                        var batchVertices = new int[batch.VertexCount];
+                        for (int i = 0; i < batchVertices.Length; i++)
+                            batchVertices[i] = vertices.Add(batch.Positions[i], batch.Normals?[i], batch.TexCoords?[i], batch.TexCoords2?[i], batch.Colors?[i], null);
+
+                        AddTriangles(indices, batch.Triangles, batchVertices);
+                    }
+                    break;
+
+                case MeshType2 meshType2:
+                    nodeIndices = meshType2.UsedNodeIndices.ToArray();
+                    foreach (var batch in meshType2.Batches)
+                    {
+                        var positions = new Vector3[batch.VertexCount];
+                        var normals = new Vector3[batch.VertexCount];
+                        var weights = new NodeWeight[batch.VertexCount * batch.UsedNodeCount];
+                        batch.Transform(nodes, positions, normals, weights);
+                        var hasNormals = batch.NodeBatches[0].Normals != null;
+
+                        var batchVertices = new int[batch.VertexCount];
+                        for (int i = 0; i < batchVertices.Length; i++)
+                        {
+                            batchVertices[i] = vertices.Add(positions[i], hasNormals ? normals[i] : (Vector3?)null, batch.TexCoords?[i], batch.TexCoords2?[i],
+                                                            batch.Colors?[i], GetWeights(weights, i, batch.UsedNodeCount));
+                        }
+
+                        AddTriangles(indices, batch.Triangles, batchVertices);
+                    }
+                    break;
+
+                case MeshType7 meshType7:
+                    {
+                        nodeIndices = meshType7.UsedNodeIndices.ToArray();
+                        var meshVertices = new int[meshType7.VertexCount];
+                        var vertexBase = 0;
+                        foreach (var batch in meshType7.Batches)
+                        {
+                            var positions = new Vector3[batch.VertexCount];
+                            var normals = new Vector3[batch.VertexCount];
+                            var weights = new NodeWeight[batch.VertexCount * batch.UsedNodeCount];
+                            batch.Transform(nodes, positions, normals, weights);
+
+                            for (int i = 0; i < batch.VertexCount; i++)
+                            {
+                                meshVertices[vertexBase + i] = vertices.Add(positions[i], normals[i], batch.TexCoords?[i], meshType7.TexCoords2?[vertexBase + i],
+                                                                            null, GetWeights(weights, i, batch.UsedNodeCount));
+                            }
+
+                            vertexBase += batch.VertexCount;
+                        }
+
+                        AddTriangles(indices, meshType7.Triangles, meshVertices);
+                    }
+                    break;
+
+                case MeshType8 meshType8:
+                    {
+                        var meshVertices = new int[meshType8.VertexCount];
+                        var vertexBase = 0;
+                        foreach (var batch in meshType8.Batches)
+                        {
+                            for (int i = 0; i < batch.VertexCount; i++)
+                            {
+                                meshVertices[vertexBase + i] = vertices.Add(batch.Positions[i], batch.Normals?[i], batch.TexCoords?[i],
+                                                                            meshType8.TexCoords2?[vertexBase + i], null, null);
+                            }
+
+                            vertexBase += batch.VertexCount;
+                        }
+
+                        AddTriangles(indices, meshType8.Triangles, meshVertices);
+                    }
+                    break;
+            }
+
+            // Simplify in the space the vertices were gathered in, with the error relative to the bounds
+            var vertexPositions = vertices.Positions.ToArray();
+            var bounds = BoundingBox.Calculate(vertexPositions);
+            var size = (bounds.Max - bounds.Min).Length();
+            var targetTriangleCount = (int)Math.Ceiling(indices.Count / 3 * triangleRatio);
+            var targetVertexCount = (int)Math.Ceiling(vertexPositions.Length * vertexRatio);
+            var skinKeys = vertices.Weights.Count > 0 ? vertices.Weights.Select(GetDominantInfluence).ToArray() : null;
+            var simplifiedIndices = QuadricEdgeCollapse.Simplify(vertexPositions, indices.ToArray(), skinKeys, targetTriangleCount, targetVertexCount,
+                                                                  options.MaxError * size, out error);
+            relativeError = size > 0 ? error / size : 0;
+
+            Mesh result;
+            switch (mesh)
+            {
+                case MeshType1 meshType1:
+                    result = BuildMeshType1(meshType1, vertices, simplifiedIndices, options.BatchVertexLimit);
+                    break;
+                case MeshType2 meshType2:
+                    result = BuildMeshType2(meshType2, vertices, simplifiedIndices, nodes, nodeIndices, options.BatchVertexLimit);
+                    break;
+                case MeshType7 meshType7:
+                    result = BuildMeshType7(meshType7, vertices, simplifiedIndices, nodes, nodeIndices, options.BatchVertexLimit);
+                    break;
+                default:
+                    result = BuildMeshType8((MeshType8)mesh, vertices, simplifiedIndices, options.BatchVertexLimit);
+                    break;
+            }
+
+            MeshBatchOptimizer.Optimize(result);
+            return result;
+        }
+
+        private static bool IsSupported(Mesh mesh)
+        {
+            return mesh is MeshType1 || mesh is MeshType2 || mesh is MeshType7 || mesh is MeshType8;
+        }
+
+        private static float GetRatio(int target, int total)
+        {
+            return target <= 0 || total == 0 ? 1 : Math.Min(1f, (float)target / total);
+        }
+
+        private static void AddTriangles(List<int> indices, Triangle[] triangles, int[] vertices)
+        {
+            foreach (var triangle in triangles)
+            {
+                indices.Add(vertices[triangle.A]);
+                indices.Add(vertices[triangle.B]);
+                indices.Add(vertices[triangle.C]);
+            }
+        }
+
+        /// <summary>
+        /// Gets the weight of every used node of the vertex, as meshes can have any number of used nodes.
+        /// </summary>
+        private static InfluenceWeights GetWeights(NodeWeight[] weights, int vertexIndex, int influenceCount)
+        {
+            var result = new float[influenceCount];
+            for (int i = 0; i < influenceCount; i++)
+                result[i] = weights[vertexIndex * influenceCount + i].Weight;
+
+            return new InfluenceWeights(result);
+        }
+
+        private static int GetDominantInfluence(InfluenceWeights weights)
+        {
+            var dominant = 0;
+            for (int i = 1; i < weights.Count; i++)
+            {
+                if (weights[i] > weights[dominant])
+                    dominant = i;
+            }
+
+            return dominant;
+        }
+
+        private static MeshType1 BuildMeshType1(MeshType1 original, VertexBuffer vertices, int[] indices, int batchVertexLimit)
+        {
+            var template = original.Batches[0];
+            var mesh = new MeshType1 { MaterialIndex = original.MaterialIndex };
+            foreach (var partition in Partition(indices, vertices.Positions.Count, batchVertexLimit))
+            {
+                var batch = new MeshType1Batch
+                {
+                    Flags = template.Flags,
+                    RenderMode = template.RenderMode,
+                    Triangles = ToTriangles(partition.Indices),
+                    Positions = vertices.Gather(vertices.Positions, partition.Vertices),
+                    Normals = template.Normals != null ? vertices.Gather(vertices.Normals, partition.Vertices) : null,
+                    TexCoords = template.TexCoords != null ? vertices.Gather(vertices.TexCoords, partition.Vertices) : null,
+                    TexCoords2 = template.TexCoords2 != null ? vertices.Gather(vertices.TexCoords2, partition.Vertices) : null,
+                    Colors = template.Colors != null ? vertices.Gather(vertices.Colors, partition.Vertices) : null,
+                };
+
+                mesh.Batches.Add(batch);
+            }
+
+            return mesh;
+        }
+
+        private static MeshType2 BuildMeshType2(MeshType2 original, VertexBuffer vertices, int[] indices, List<Node> nodes, short[] nodeIndices,
+                                                int batchVertexLimit)
+        {
+            var template = original.Batches[0];
+            var mesh = new MeshType2 { MaterialIndex = original.MaterialIndex };
+            foreach (var partition in Partition(indices, vertices.Positions.Count, batchVertexLimit))
+            {
+                var batch = new MeshType2Batch
+                {
+                    Triangles = ToTriangles(partition.Indices),
+                    TexCoords = template.TexCoords != null ? vertices.Gather(vertices.TexCoords, partition.Vertices) : null,
+                    TexCoords2 = template.TexCoords2 != null ? vertices.Gather(vertices.TexCoords2, partition.Vertices) : null,
+                    Colors = template.Colors != null ? vertices.Gather(vertices.Colors, partition.Vertices) : null,
+                };
+
+                for (int i = 0; i < nodeIndices.Length; i++)
+                {
+                    var nodeTemplate = template.NodeBatches[i];
+                    BuildInfluence(vertices, partition.Vertices, nodes[nodeIndices[i]].WorldTransform.Inverted(), i, nodeTemplate.Normals != null,
+                                   out var positions, out var normals);
+
+                    batch.NodeBatches.Add(new MeshType2NodeBatch
+                    {
+                        NodeIndex = nodeIndices[i],
+                        Flags = nodeTemplate.Flags,
+                        RenderMode = nodeTemplate.RenderMode,
+                        Positions = positions,
+                        Normals = normals,
+                    });
+                }
+
+                mesh.Batches.Add(batch);
+            }
+
+            return mesh;
+        }
+
+        private static MeshType7 BuildMeshType7(MeshType7 original, VertexBuffer vertices, int[] indices, List<Node> nodes, short[] nodeIndices,
+                                                int batchVertexLimit)
+        {
+            var usedVertices = CompactVertices(indices);
+            var mesh = new MeshType7
+            {
+                MaterialIndex = original.MaterialIndex,
+                Flags = original.Flags,
+                Triangles = ToTriangles(indices),
+            };
+
+            for (int start = 0; start < usedVertices.Count; start += batchVertexLimit)
+            {
+                var batchVertices = usedVertices.GetRange(start, Math.Min(batchVertexLimit, usedVertices.Count - start));
+                var batch = new MeshType7Batch
+                {
+                    TexCoords = original.Batches[0].TexCoords != null ? vertices.Gather(vertices.TexCoords, batchVertices) : null
+                };
+
+                for (int i = 0; i < nodeIndices.Length; i++)
+                {
+                    BuildInfluence(vertices, batchVertices, nodes[nodeIndices[i]].WorldTransform.Inverted(), i, true, out var positions, out var normals);
+                    batch.NodeBatches.Add(new MeshType7NodeBatch
+                    {
+                        NodeIndex = nodeIndices[i],
+                        Positions = positions,
+                        Normals = normals,
+                    });
+                }
+
+                mesh.Batches.Add(batch);
+            }
+
+            if (original.TexCoords2 != null)
+                mesh.TexCoords2 = vertices.Gather(vertices.TexCoords2, usedVertices);
+
+            return mesh;
+        }
+
+        private static MeshType8 BuildMeshType8(MeshType8 original, VertexBuffer vertices, int[] indices, int batchVertexLimit)
+        {
+            var usedVertices = CompactVertices(indices);
+            var template = original.Batches[0];
+            var mesh = new MeshType8
+            {
+                MaterialIndex = original.MaterialIndex,
+                Flags = original.Flags,
+                Triangles = ToTriangles(indices),
+            };
+
+            for (int start = 0; start < usedVertices.Count; start += batchVertexLimit)
+            {
+                var batchVertices = usedVertices.GetRange(start, Math.Min(batchVertexLimit, usedVertices.Count - start));
+                mesh.Batches.Add(new MeshType8Batch
+                {
+                    Positions = vertices.Gather(vertices.Positions, batchVertices),
+                    Normals = template.Normals != null ? vertices.Gather(vertices.Normals, batchVertices) : null,
+                    TexCoords = template.TexCoords != null ? vertices.Gather(vertices.TexCoords, batchVertices) : null,
+                });
+            }
+
+            if (original.TexCoords2 != null)
+                mesh.TexCoords2 = vertices.Gather(vertices.TexCoords2, usedVertices);
+
+            return mesh;
+        }
+
+        private static List<MeshBatchPartition> Partition(int[] indices, int vertexCount, int batchVertexLimit)
+        {
+            var faces = new List<int[]>(indices.Length / 3);
+            for (int i = 0; i < indices.Length; i += 3)
+                faces.Add(new[] { indices[i], indices[i + 1], indices[i + 2] });
+
+            return MeshBatchPartitioner.Partition(faces, vertexCount, batchVertexLimit, out _);
+        }
+
+        /// <summary>
+        /// Renumbers the indices in the order the vertices are first used, and returns the original index of each used vertex.
+        /// </summary>
+        private static List<int> CompactVertices(int[] indices)
+        {
+            var remap = new Dictionary<int, int>();
+            var usedVertices = new List<int>();
+            for (int i = 0; i < indices.Length; i++)
+            {
+                if (!remap.TryGetValue(indices[i], out var newIndex))
+                {
+                    remap[indices[i]] = newIndex = usedVertices.Count;
+                    usedVertices.Add(indices[i]);
+                }
+
+                indices[i] = newIndex;
+            }
+
+            return usedVertices;
+        }
+
+        private static Triangle[] ToTriangles(IReadOnlyList<int> indices)
+        {
+            var triangles = new Triangle[indices.Count / 3];
+            for (int i = 0; i < triangles.Length; i++)
+                triangles[i] = new Triangle((ushort)indices[i * 3], (ushort)indices[i * 3 + 1], (ushort)indices[i * 3 + 2]);
+
+            return triangles;
+        }
+
+        /// <summary>
+        /// Builds the node space positions and normals of one influence, with the weight stored in W like the weighted mesh types expect.
+        /// </summary>
+        private static void BuildInfluence(VertexBuffer vertices, List<int> batchVertices, Matrix4x4 nodeInvWorldTransform, int influenceIndex,
+                                           bool hasNormals, out Vector4[] positions, out Vector3[] normals)
+        {
+            positions = new Vector4[batchVertices.Count];
+            normals = hasNormals ? new Vector3[batchVertices.Count] : null;
+            for (int i = 0; i < batchVertices.Count; i++)
+            {
+                var vertex = batchVertices[i];
+                positions[i] = new Vector4(Vector3.Transform(vertices.Positions[vertex], nodeInvWorldTransform),
+                                           vertices.Weights[vertex][influenceIndex]);
+
+                if (hasNormals)
+                    normals[i] = Vector3.TransformNormal(vertices.Normals[vertex], nodeInvWorldTransform);
+            }
+        }
+
+        /// <summary>
+        /// Welds identical vertices of all batches of a mesh.
+        /// </summary>
+        private class VertexBuffer
+        {
+            private readonly Dictionary<(Vector3, Vector3, Vector2, Vector2, Color, InfluenceWeights), int> mIndices =
+                new Dictionary<(Vector3, Vector3, Vector2, Vector2, Color, InfluenceWeights), int>();
+
+            public List<Vector3> Positions { get; } = new List<Vector3>();
+
+            public List<Vector3> Normals { get; } = new List<Vector3>();
+
+            public List<Vector2> TexCoords { get; } = new List<Vector2>();
+
+            public List<Vector2> TexCoords2 { get; } = new List<Vector2>();
+
+            public List<Color> Colors { get; } = new List<Color>();
+
+            public List<InfluenceWeights> Weights { get; } = new List<InfluenceWeights>();
+
+            public int Add(Vector3 position, Vector3? normal, Vector2? texCoord, Vector2? texCoord2, Color? color, InfluenceWeights? weights)
+            {
+                var key = (position, normal.GetValueOrDefault(), texCoord.GetValueOrDefault(), texCoord2.GetValueOrDefault(), color.GetValueOrDefault(),
+                           weights.GetValueOrDefault());
+                if (!mIndices.TryGetValue(key, out var index))
+                {
+                    mIndices[key] = index = Positions.Count;
+                    Positions.Add(key.Item1);
+                    Normals.Add(key.Item2);
+                    TexCoords.Add(key.Item3);
+                    TexCoords2.Add(key.Item4);
+                    Colors.Add(key.Item5);
+                    if (weights.HasValue)
+                        Weights.Add(key.Item6);
+                }
+
+                return index;
+            }
+
+            public T[] Gather<T>(List<T> attribute, List<int> vertices)
+            {
+                var result = new T[vertices.Count];
+                for (int i = 0; i < result.Length; i++)
+                    result[i] = attribute[vertices[i]];
+
+                return result;
+            }
+        }
+
+        /// <summary>
+        /// The weights of all used nodes of a vertex, compared by value so vertices with equal weights are welded.
+        /// </summary>
+        private struct InfluenceWeights : IEquatable<InfluenceWeights>
+        {
+            private readonly float[] mWeights;
+
+            public int Count => mWeights?.Length ?? 0;
+
+            public float this[int index] => mWeights[index];
+
+            public InfluenceWeights(float[] weights)
+            {
+                mWeights = weights;
+            }
+
+            public bool Equals(InfluenceWeights other)
+            {
+                if (Count != other.Count)
+                    return false;
+
+                for (int i = 0; i < Count; i++)
+                {
+                    if (mWeights[i] != other.mWeights[i])
+                        return false;
+                }
+
+                return true;
+            }
+
+            public override bool Equals(object obj)
+            {
+                return obj is InfluenceWeights other && Equals(other);
+            }
+
+            public override int GetHashCode()
+            {
+                var hash = 17;
+                for (int i = 0; i < Count; i++)
+                    hash = hash * 31 + mWeights[i].GetHashCode();
+
+                return hash;
+            }
+        }
+    }
+}
@@ -0,0 +1,345 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Numerics;
+
+namespace DDS3ModelLibrary.Models.Utilities
+{
+    /// <summary>
+    /// A symmetric 4x4 error quadric (Garland and Heckbert 1997), measuring the weighted mean squared distance to a set of planes.
+    /// </summary>
+    internal struct Quadric
+    {
+        private double mA00, mA01, mA02, mA11, mA12, mA22;
+        private double mB0, mB1, mB2;
+        private double mC;
+        private double mWeight;
+
+        public static Quadric FromPlane(Vector3 normal, float distance, float weight)
+        {
+            double a = normal.X, b = normal.Y, c = normal.Z, d = distance;
+            return new Quadric
+            {
+                mA00 = weight * a * a,
+                mA01 = weight * a * b,
+                mA02 = weight * a * c,
+                mA11 = weight * b * b,
+                mA12 = weight * b * c,
+                mA22 = weight * c * c,
+                mB0 = weight * a * d,
+                mB1 = weight * b * d,
+                mB2 = weight * c * d,
+                mC = weight * d * d,
+                mWeight = weight,
+            };
+        }
+
+        public void Add(in Quadric other)
+        {
+            mA00 += other.mA00;
+            mA01 += other.mA01;
+            mA02 += other.mA02;
+            mA11 += other.mA11;
+            mA12 += other.mA12;
+            mA22 += other.mA22;
+            mB0 += other.mB0;
+            mB1 += other.mB1;
+            mB2 += other.mB2;
+            mC += other.mC;
+            mWeight += other.mWeight;
+        }
+
+        public double Evaluate(Vector3 position)
+        {
+            double x = position.X, y = position.Y, z = position.Z;
+            var error = mA00 * x * x + 2 * mA01 * x * y + 2 * mA02 * x * z + mA11 * y * y + 2 * mA12 * y * z + mA22 * z * z +
+                        2 * (mB0 * x + mB1 * y + mB2 * z) + mC;
+
+            return mWeight > 0 ? Math.Max(0, error) / mWeight : 0;
+        }
+    }
+
+    /// <summary>
+    /// Simplifies an indexed triangle list by collapsing edges onto one of their vertices in order of increasing quadric error.
+    /// Vertices are never moved, so the attributes of the remaining vertices stay valid.
+    /// Vertices on borders and attribute seams are locked, as are collapses between vertices that are influenced by different nodes.
+    /// </summary>
+    internal static class QuadricEdgeCollapse
+    {
+        /// <summary>
+        /// The minimum cosine between the normal of a triangle before and after a collapse.
+        /// </summary>
+        private const float MIN_NORMAL_COSINE = 0.2f;
+
+        private enum VertexKind : byte
+        {
+            Manifold,
+            Locked,
+        }
+
+        /// <summary>
+        /// Simplifies the triangles.
+        /// </summary>
+        /// <param name="positions">The position of each vertex.</param>
+        /// <param name="indices">The vertex indices of each triangle.</param>
+        /// <param name="skinKeys">The dominant influence of each vertex. Vertices may only collapse onto a vertex with the same key. May be null.</param>
+        /// <param name="targetTriangleCount">The number of triangles to reduce to.</param>
+        /// <param name="targetVertexCount">The number of used vertices to reduce to.</param>
+        /// <param name="maxError">The maximum distance error of a single collapse.</param>
+        /// <param name="error">The largest distance error of all collapses that were made.</param>
+        /// <returns>The vertex indices of the remaining triangles, referencing the original vertices.</returns>
+        public static int[] Simplify(Vector3[] positions, int[] indices, int[] skinKeys, int targetTriangleCount, int targetVertexCount, float maxError,
+                                     out float error)
+        {
+            var vertexCount = positions.Length;
+            var maxCost = (double)maxError * maxError;
+            var maxCollapseCost = 0d;
+
+            // Drop degenerate triangles up front
+            var triangles = new List<int>(indices.Length);
+            for (int i = 0; i < indices.Length; i += 3)
+            {
+                var a = indices[i];
+                var b = indices[i + 1];
+                var c = indices[i + 2];
+                if (a != b && b != c && c != a && positions[a] != positions[b] && positions[b] != positions[c] && positions[c] != positions[a])
+                {
+                    triangles.Add(a);
+                    triangles.Add(b);
+                    triangles.Add(c);
+                }
+            }
+
+            // Vertices sharing a position are split by an attribute seam, and are treated as one for topology and error
+            var positionGroups = new Dictionary<Vector3, int>();
+            var vertexGroup = new int[vertexCount];
+            var groupSize = new List<int>();
+            for (int i = 0; i < vertexCount; i++)
+            {
+                if (!positionGroups.TryGetValue(positions[i], out var group))
+                {
+                    positionGroups[positions[i]] = group = groupSize.Count;
+                    groupSize.Add(0);
+                }
+
+                vertexGroup[i] = group;
+                groupSize[group]++;
+            }
+
+            // Lock seams and the vertices of edges only used by a single triangle, which are either open borders or material boundaries
+            var kind = new VertexKind[vertexCount];
+            var edgeUseCount = new Dictionary<long, int>();
+            for (int i = 0; i < triangles.Count; i += 3)
+            {
+                for (int j = 0; j < 3; j++)
+                {
+                    var key = GetEdgeKey(vertexGroup[triangles[i + j]], vertexGroup[triangles[i + (j + 1) % 3]]);
+                    edgeUseCount.TryGetValue(key, out var count);
+                    edgeUseCount[key] = count + 1;
+                }
+            }
+
+            var isGroupLocked = new bool[groupSize.Count];
+            for (int i = 0; i < groupSize.Count; i++)
+                isGroupLocked[i] = groupSize[i] > 1;
+
+            foreach (var kvp in edgeUseCount)
+            {
+                if (kvp.Value != 1)
+                    continue;
+
+                isGroupLocked[(int)(kvp.Key >> 32)] = true;
+                isGroupLocked[(int)(kvp.Key & 0xFFFFFFFF)] = true;
+            }
+
+            for (int i = 0; i < vertexCount; i++)
+                kind[i] = isGroupLocked[vertexGroup[i]] ? VertexKind.Locked : VertexKind.Manifold;
+
+            // Accumulate the area weighted plane quadrics of each position
+            var quadrics = new Quadric[groupSize.Count];
+            for (int i = 0; i < triangles.Count; i += 3)
+            {
+                var p0 = positions[triangles[i]];
+                var normal = Vector3.Cross(positions[triangles[i + 1]] - p0, positions[triangles[i + 2]] - p0);
+                var length = normal.Length();
+                if (length <= float.Epsilon)
+                    continue;
+
+                normal /= length;
+                var quadric = Quadric.FromPlane(normal, -Vector3.Dot(normal, p0), length * 0.5f);
+                for (int j = 0; j < 3; j++)
+                    quadrics[vertexGroup[triangles[i + j]]].Add(quadric);
+            }
+
+            var remap = new int[vertexCount];
+            var isUsed = new bool[vertexCount];
+            var isCollapseLocked = new bool[vertexCount];
+            var candidates = new List<(double Cost, int From, int To)>();
+            var adjacencyStart = new int[vertexCount + 1];
+            var adjacency = new int[0];
+
+            while (true)
+            {
+                var triangleCount = triangles.Count / 3;
+                Array.Clear(isUsed, 0, vertexCount);
+                foreach (var index in triangles)
+                    isUsed[index] = true;
+
+                var usedVertexCount = 0;
+                foreach (var used in isUsed)
+                {
+                    if (used)
+                        ++usedVertexCount;
+                }
+
+                if (triangleCount <= targetTriangleCount && usedVertexCount <= targetVertexCount)
+                    break;
+
+                // Build the vertex to triangle adjacency of the current triangles
+                Array.Clear(adjacencyStart, 0, adjacencyStart.Length);
+                foreach (var index in triangles)
+                    ++adjacencyStart[index + 1];
+
+                for (int i = 0; i < vertexCount; i++)
+                    adjacencyStart[i + 1] += adjacencyStart[i];
+
+                if (adjacency.Length < triangles.Count)
+                    adjacency = new int[triangles.Count];
+
+                var adjacencyFill = new int[vertexCount];
+                for (int i = 0; i < triangles.Count; i++)
+                    adjacency[adjacencyStart[triangles[i]] + adjacencyFill[triangles[i]]++] = i / 3;
+
+                // Find the cost of every allowed collapse
+                candidates.Clear();
+                for (int i = 0; i < triangles.Count; i += 3)
+                {
+                    for (int j = 0; j < 3; j++)
+                    {
+                        var from = triangles[i + j];
+                        var to = triangles[i + (j + 1) % 3];
+                        AddCandidate(from, to);
+                        AddCandidate(to, from);
+                    }
+                }
+
+                void AddCandidate(int from, int to)
+                {
+                    if (kind[from] != VertexKind.Manifold || (skinKeys != null && skinKeys[from] != skinKeys[to]))
+                        return;
+
+                    var quadric = quadrics[vertexGroup[from]];
+                    quadric.Add(quadrics[vertexGroup[to]]);
+                    var cost = quadric.Evaluate(positions[to]);
+                    if (cost <= maxCost)
+                        candidates.Add((cost, from, to));
+                }
+
+                if (candidates.Count == 0)
+                    break;
+
+                candidates.Sort((x, y) => x.Cost.CompareTo(y.Cost));
+
+                // Collapse in order of cost. The neighbourhood of each collapse is locked for the rest of the pass,
+                // so the adjacency stays valid for the remaining flip tests.
+                for (int i = 0; i < vertexCount; i++)
+                    remap[i] = i;
+
+                Array.Clear(isCollapseLocked, 0, vertexCount);
+                var removedTriangleCount = 0;
+                var removedVertexCount = 0;
+                var collapseCount = 0;
+
+                foreach (var (cost, from, to) in candidates)
+                {
+                    if (triangleCount - removedTriangleCount <= targetTriangleCount && usedVertexCount - removedVertexCount <= targetVertexCount)
+                        break;
+
+                    if (isCollapseLocked[from] || isCollapseLocked[to] || !CanCollapse(from, to, out var sharedTriangleCount))
+                        continue;
+
+                    remap[from] = to;
+                    isCollapseLocked[to] = true;
+                    for (int j = adjacencyStart[from]; j < adjacencyStart[from + 1]; j++)
+                    {
+                        var triangle = adjacency[j] * 3;
+                        for (int k = 0; k < 3; k++)
+                            isCollapseLocked[triangles[triangle + k]] = true;
+                    }
+
+                    quadrics[vertexGroup[to]].Add(quadrics[vertexGroup[from]]);
+                    maxCollapseCost = Math.Max(maxCollapseCost, cost);
+                    removedTriangleCount += sharedTriangleCount;
+                    ++removedVertexCount;
+                    ++collapseCount;
+                }
+
+                if (collapseCount == 0)
+                    break;
+
+                // Apply the collapses and drop the triangles that became degenerate
+                var remaining = new List<int>(triangles.Count);
+                for (int i = 0; i < triangles.Count; i += 3)
+                {
+                    var a = remap[triangles[i]];
+                    var b = remap[triangles[i + 1]];
+                    var c = remap[triangles[i + 2]];
+                    if (a != b && b != c && c != a)
+                    {
+                        remaining.Add(a);
+                        remaining.Add(b);
+                        remaining.Add(c);
+                    }
+                }
+
+                triangles = remaining;
+            }
+
+            bool CanCollapse(int from, int to, out int sharedTriangleCount)
+            {
+                sharedTriangleCount = 0;
+                var target = positions[to];
+                for (int i = adjacencyStart[from]; i < adjacencyStart[from + 1]; i++)
+                {
+                    var triangle = adjacency[i] * 3;
+                    var a = triangles[triangle];
+                    var b = triangles[triangle + 1];
+                    var c = triangles[triangle + 2];
+                    if (a == to || b == to || c == to)
+                    {
+                        ++sharedTriangleCount;
+                        continue;
+                    }
+
+                    // Reject the collapse if the triangle would flip or become degenerate
+                    var p0 = positions[a];
+                    var p1 = positions[b];
+                    var p2 = positions[c];
+                    var normal = Vector3.Cross(p1 - p0, p2 - p0);
+                    if (a == from)
+                        p0 = target;
+                    else if (b == from)
+                        p1 = target;
+                    else
+                        p2 = target;
+
+                    var newNormal = Vector3.Cross(p1 - p0, p2 - p0);
+                    var lengths = normal.Length() * newNormal.Length();
+                    if (lengths <= float.Epsilon || Vector3.Dot(normal, newNormal) < MIN_NORMAL_COSINE * lengths)
+                        return false;
+                }
+
+                return sharedTriangleCount > 0;
+            }
+
+            Debug.Assert(triangles.Count % 3 == 0);
+            error = (float)Math.Sqrt(maxCollapseCost);
+            return triangles.ToArray();
+        }
+
+        private static long GetEdgeKey(int a, int b)
+        {
+            return a < b ? ((long)a << 32) | (uint)b : ((long)b << 32) | (uint)a;
+        }
+    }
+}
@@ -0,0 +1,179 @@
+﻿using DDS3ModelLibrary.IO.Common;
+using System;
+using System.Numerics;
+
+namespace DDS3ModelLibrary.Models.Utilities
+{
+    /// <summary>
+    /// The vertices of a batch in a compact encoding: positions as 16 bit integers with a per batch scale and offset,
+    /// and normals as 8 bit integers. Both map directly to the V3-16 and V3-8 VIF unpack formats.
+    /// </summary>
+    public class QuantizedVertices
+    {
+        private const int UNPACK_CODE_SIZE = 4;
+
+        public int VertexCount { get; }
+
+        /// <summary>
+        /// Gets the quantized positions, 3 components per vertex.
+        /// </summary>
+        public short[] Positions { get; }
+
+        /// <summary>
+        /// Gets the size of a single position step along each axis.
+        /// </summary>
+        public Vector3 Scale { get; }
+
+        /// <summary>
+        /// Gets the position that the quantized value 0 maps to.
+        /// </summary>
+        public Vector3 Offset { get; }
+
+        /// <summary>
+        /// Gets the quantized normals, 3 components per vertex. May be null.
+        /// </summary>
+        public sbyte[] Normals { get; }
+
+        /// <summary>
+        /// Gets the size of the vertex data as VIF unpacks, including the scale and offset.
+        /// </summary>
+        public int EncodedSize => GetUnpackSize(VertexCount * 6) + GetUnpackSize(2 * 12) + (Normals != null ? GetUnpackSize(VertexCount * 3) : 0);
+
+        /// <summary>
+        /// Gets the size of the same vertex data as float VIF unpacks.
+        /// </summary>
+        public int FloatSize => GetUnpackSize(VertexCount * 12) + (Normals != null ? GetUnpackSize(VertexCount * 12) : 0);
+
+        private QuantizedVertices(int vertexCount, short[] positions, Vector3 scale, Vector3 offset, sbyte[] normals)
+        {
+            VertexCount = vertexCount;
+            Positions = positions;
+            Scale = scale;
+            Offset = offset;
+            Normals = normals;
+        }
+
+        /// <summary>
+        /// Quantizes the vertices of a batch. The positions are spread over the full 16 bit range around the center of their bounds.
+        /// </summary>
+        /// <param name="positions">The positions.</param>
+        /// <param name="normals">The normals. May be empty.</param>
+        public static QuantizedVertices Encode(ReadOnlySpan<Vector3> positions, ReadOnlySpan<Vector3> normals)
+        {
+            var min = new Vector3(float.MaxValue);
+            var max = new Vector3(float.MinValue);
+            BoundsHelper.Accumulate(positions, ref min, ref max);
+            if (positions.IsEmpty)
+                min = max = Vector3.Zero;
+
+            var offset = (min + max) * 0.5f;
+            var scale = (max - min) / (short.MaxValue * 2);
+
+            // Flat axes still need a valid step
+            scale = new Vector3(scale.X > 0 ? scale.X : 1, scale.Y > 0 ? scale.Y : 1, scale.Z > 0 ? scale.Z : 1);
+
+            var inverseScale = Vector3.One / scale;
+            var quantizedPositions = new short[positions.Length * 3];
+            for (int i = 0; i < positions.Length; i++)
+            {
+                var value = (positions[i] - offset) * inverseScale;
+                quantizedPositions[i * 3 + 0] = ToInt16(value.X);
+                quantizedPositions[i * 3 + 1] = ToInt16(value.Y);
+                quantizedPositions[i * 3 + 2] = ToInt16(value.Z);
+            }
+
+            sbyte[] quantizedNormals = null;
+            if (!normals.IsEmpty)
+            {
+                quantizedNormals = new sbyte[normals.Length * 3];
+                for (int i = 0; i < normals.Length; i++)
+                {
+                    if (normals[i] == Vector3.Zero)
+                        continue;
+
+                    var value = Vector3.Normalize(normals[i]) * sbyte.MaxValue;
+                    quantizedNormals[i * 3 + 0] = ToSByte(value.X);
+                    quantizedNormals[i * 3 + 1] = ToSByte(value.Y);
+                    quantizedNormals[i * 3 + 2] = ToSByte(value.Z);
+                }
+            }
+
+            return new QuantizedVertices(positions.Length, quantizedPositions, scale, offset, quantizedNormals);
+        }
+
+        public Vector3 GetPosition(int index)
+        {
+            return new Vector3(Positions[index * 3], Positions[index * 3 + 1], Positions[index * 3 + 2]) * Scale + Offset;
+        }
+
+        public Vector3 GetNormal(int index)
+        {
+            var normal = new Vector3(Normals[index * 3], Normals[index * 3 + 1], Normals[index * 3 + 2]);
+            return normal == Vector3.Zero ? normal : Vector3.Normalize(normal);
+        }
+
+        /// <summary>
+        /// Decodes the positions into the given buffer.
+        /// </summary>
+        public void DecodePositions(Span<Vector3> positions)
+        {
+            for (int i = 0; i < VertexCount; i++)
+                positions[i] = GetPosition(i);
+        }
+
+        /// <summary>
+        /// Decodes the normals into the given buffer.
+        /// </summary>
+        public void DecodeNormals(Span<Vector3> normals)
+        {
+            for (int i = 0; i < VertexCount; i++)
+                normals[i] = GetNormal(i);
+        }
+
+        /// <summary>
+        /// Measures the error of the encoding compared to the source vertices.
+        /// </summary>
+        /// <param name="positions">The positions the vertices were encoded from.</param>
+        /// <param name="normals">The normals the vertices were encoded from. May be empty.</param>
+        /// <param name="positionError">The largest distance between a source and decoded position.</param>
+        /// <param name="normalError">The largest angle between a source and decoded normal, in degrees.</param>
+        public void MeasureError(ReadOnlySpan<Vector3> positions, ReadOnlySpan<Vector3> normals, out float positionError, out float normalError)
+        {
+            var maxDistanceSquared = 0f;
+            for (int i = 0; i < VertexCount; i++)
+                maxDistanceSquared = Math.Max(maxDistanceSquared, Vector3.DistanceSquared(positions[i], GetPosition(i)));
+
+            positionError = (float)Math.Sqrt(maxDistanceSquared);
+
+            var minCosine = 1f;
+            if (Normals != null && !normals.IsEmpty)
+            {
+                for (int i = 0; i < VertexCount; i++)
+                {
+                    var normal = normals[i];
+                    if (normal == Vector3.Zero)
+                        continue;
+
+                    minCosine = Math.Min(minCosine, Vector3.Dot(Vector3.Normalize(normal), GetNormal(i)));
+                }
+            }
+
+            normalError = (float)(Math.Acos(Math.Max(-1f, Math.Min(1f, minCosine))) * 180 / Math.PI);
+        }
+
+        private static short ToInt16(float value)
+        {
+            return (short)Math.Max(short.MinValue, Math.Min(short.MaxValue, Math.Round(value)));
+        }
+
+        private static sbyte ToSByte(float value)
+        {
+            return (sbyte)Math.Max(-sbyte.MaxValue, Math.Min(sbyte.MaxValue, Math.Round(value)));
+        }
+
+        private static int GetUnpackSize(int dataSize)
+        {
+            return UNPACK_CODE_SIZE + AlignmentHelper.Align(dataSize, 4);
+        }
+    }
+}
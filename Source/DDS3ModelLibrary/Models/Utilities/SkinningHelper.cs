@@ -0,0 +1,71 @@
+﻿using System;
+using System.Numerics;
+
+namespace DDS3ModelLibrary.Models.Utilities
+{
+    /// <summary>
+    /// Skinning kernel shared by the weighted mesh types. Each node batch is one influence stream of weighted positions
+    /// (the weight is stored in W) and normals, which is accumulated into caller supplied buffers.
+    /// </summary>
+    public static class SkinningHelper
+    {
+        /// <summary>
+        /// Accumulates the contribution of one influence stream.
+        /// The matrix is applied once and the result scaled by the weight, rather than scaling the matrix for every vertex.
+        /// </summary>
+        /// <param name="weightedPositions">The positions of the influence, with the weight in W.</param>
+        /// <param name="normals">The normals of the influence. May be null.</param>
+        /// <param name="nodeWorldTransform">The world transform of the influencing node.</param>
+        /// <param name="positions">The buffer the skinned positions are added to.</param>
+        /// <param name="outNormals">The buffer the skinned normals are added to. May be empty to skip normals.</param>
+        public static void AccumulateInfluence(ReadOnlySpan<Vector4> weightedPositions, ReadOnlySpan<Vector3> normals, in Matrix4x4 nodeWorldTransform,
+                                               Span<Vector3> positions, Span<Vector3> outNormals)
+        {
+            var row1 = new Vector4(nodeWorldTransform.M11, nodeWorldTransform.M12, nodeWorldTransform.M13, 0);
+            var row2 = new Vector4(nodeWorldTransform.M21, nodeWorldTransform.M22, nodeWorldTransform.M23, 0);
+            var row3 = new Vector4(nodeWorldTransform.M31, nodeWorldTransform.M32, nodeWorldTransform.M33, 0);
+            var row4 = new Vector4(nodeWorldTransform.M41, nodeWorldTransform.M42, nodeWorldTransform.M43, 0);
+
+            for (int i = 0; i < weightedPositions.Length; i++)
+            {
+                var p = weightedPositions[i];
+                var v = (row1 * p.X + row2 * p.Y + row3 * p.Z + row4) * p.W;
+                positions[i] += new Vector3(v.X, v.Y, v.Z);
+            }
+
+            if (normals.IsEmpty || outNormals.IsEmpty)
+                return;
+
+            for (int i = 0; i < normals.Length; i++)
+            {
+                var n = normals[i];
+                var v = (row1 * n.X + row2 * n.Y + row3 * n.Z) * weightedPositions[i].W;
+                outNormals[i] += new Vector3(v.X, v.Y, v.Z);
+            }
+        }
+
+        /// <summary>
+        /// Writes the weights of one influence stream into a flat weight buffer laid out as vertex * influenceCount + influenceIndex.
+        /// </summary>
+        public static void WriteWeights(ReadOnlySpan<Vector4> weightedPositions, short nodeIndex, int influenceIndex, int influenceCount, Span<NodeWeight> weights)
+        {
+            for (int i = 0; i < weightedPositions.Length; i++)
+                weights[i * influenceCount + influenceIndex] = new NodeWeight(nodeIndex, weightedPositions[i].W);
+        }
+
+        /// <summary>
+        /// Converts a flat weight buffer into one weight array per vertex.
+        /// </summary>
+        public static NodeWeight[][] ToVertexWeights(NodeWeight[] weights, int influenceCount)
+        {
+            var vertexWeights = new NodeWeight[influenceCount == 0 ? 0 : weights.Length / influenceCount][];
+            for (int i = 0; i < vertexWeights.Length; i++)
+            {
+                vertexWeights[i] = new NodeWeight[influenceCount];
+                Array.Copy(weights, i * influenceCount, vertexWeights[i], 0, influenceCount);
+            }
+
+            return vertexWeights;
+        }
+    }
+}
@@ -43,42 +43,18 @@ namespace DDS3ModelLibrary.Motions.Conversion
                 switch (controller.Type)
                 {
                     case ControllerType.Position:
-                        foreach (var key in controller.Keys)
-                        {
-                            switch (key)
-                            {
-                                case Vector3Key positionKey:
-                                    aiChannel.PositionKeys.RemoveAll(x => x.Time == positionKey.Time);
-                                    aiChannel.PositionKeys.Add(new Assimp.VectorKey(positionKey.Time, positionKey.Value.ToAssimp()));
-                                    break;
-                            }
-                        }
+                        if (controller.Keys.Format == KeyFormat.Vector3)
+                            MergeKeys(aiChannel.PositionKeys, ConvertVectorKeys(controller.Keys), x => x.Time);
                         break;
                     case ControllerType.Type1:
                         break;
                     case ControllerType.Scale:
-                        foreach (var key in controller.Keys)
-                        {
-                            switch (key)
-                            {
-                                case Vector3Key scaleKey:
-                                    aiChannel.ScalingKeys.RemoveAll(x => x.Time == scaleKey.Time);
-                                    aiChannel.ScalingKeys.Add(new Assimp.VectorKey(scaleKey.Time, scaleKey.Value.ToAssimp()));
-                                    break;
-                            }
-                        }
+                        if (controller.Keys.Format == KeyFormat.Vector3)
+                            MergeKeys(aiChannel.ScalingKeys, ConvertVectorKeys(controller.Keys), x => x.Time);
                         break;
                     case ControllerType.Rotation:
-                        foreach (var key in controller.Keys)
-                        {
-                            switch (key)
-                            {
-                                case QuaternionKey rotationKey:
-                                    aiChannel.RotationKeys.RemoveAll(x => x.Time == rotationKey.Time);
-                                    aiChannel.RotationKeys.Add(new Assimp.QuaternionKey(rotationKey.Time, Quaternion.Inverse(rotationKey.Value).ToAssimp()));
-                                    break;
-                            }
-                        }
+                        if (controller.Keys.Format == KeyFormat.Quaternion)
+                            MergeKeys(aiChannel.RotationKeys, ConvertQuaternionKeys(controller.Keys), x => x.Time);
                         break;
                     case ControllerType.Morph:
                         break;
@@ -165,5 +141,61 @@ namespace DDS3ModelLibrary.Motions.Conversion
             using (var aiContext = new Assimp.AssimpContext())
                 aiContext.ExportFile(aiScene, filepath, "collada", Assimp.PostProcessSteps.FlipUVs);
         }
+
+        private static List<Assimp.VectorKey> ConvertVectorKeys(KeyframeList keys)
+        {
+            var times = keys.Times;
+            var values = keys.GetVector3Values();
+            var indices = keys.GetSortedDistinctIndices();
+            var aiKeys = new List<Assimp.VectorKey>(indices.Length);
+            foreach (var index in indices)
+                aiKeys.Add(new Assimp.VectorKey(times[index], values[index].ToAssimp()));
+
+            return aiKeys;
+        }
+
+        private static List<Assimp.QuaternionKey> ConvertQuaternionKeys(KeyframeList keys)
+        {
+            var times = keys.Times;
+            var values = keys.GetQuaternionValues();
+            var indices = keys.GetSortedDistinctIndices();
+            var aiKeys = new List<Assimp.QuaternionKey>(indices.Length);
+            foreach (var index in indices)
+                aiKeys.Add(new Assimp.QuaternionKey(times[index], Quaternion.Inverse(values[index]).ToAssimp()));
+
+            return aiKeys;
+        }
+
+        /// <summary>
+        /// Merges sorted keys into a sorted channel in linear time. Keys that are merged in replace existing keys with the same time.
+        /// </summary>
+        private static void MergeKeys<T>(List<T> aiKeys, List<T> newAiKeys, Func<T, double> getTime)
+        {
+            if (aiKeys.Count == 0)
+            {
+                aiKeys.AddRange(newAiKeys);
+                return;
+            }
+
+            var merged = new List<T>(aiKeys.Count + newAiKeys.Count);
+            int i = 0, j = 0;
+            while (i < aiKeys.Count || j < newAiKeys.Count)
+            {
+                if (j == newAiKeys.Count || (i < aiKeys.Count && getTime(aiKeys[i]) < getTime(newAiKeys[j])))
+                {
+                    merged.Add(aiKeys[i++]);
+                }
+                else
+                {
+                    if (i < aiKeys.Count && getTime(aiKeys[i]) == getTime(newAiKeys[j]))
+                        i++;
+
+                    merged.Add(newAiKeys[j++]);
+                }
+            }
+
+            aiKeys.Clear();
+            aiKeys.AddRange(merged);
+        }
     }
 }
\ No newline at end of file
@@ -8,9 +8,15 @@ namespace DDS3ModelLibrary.Motions.Conversion
         {
             public Func<string, int> NodeIndexResolver { get; set; }
 
+            /// <summary>
+            /// Gets or sets the tolerances used to remove redundant keys. Null disables key compression.
+            /// </summary>
+            public KeyframeCompressionOptions Compression { get; set; }
+
             public Config()
             {
                 // Default config
+                Compression = new KeyframeCompressionOptions();
             }
         }
     }
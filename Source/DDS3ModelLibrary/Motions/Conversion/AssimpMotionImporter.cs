@@ -24,49 +24,40 @@ namespace DDS3ModelLibrary.Motions.Conversion
                 if (aiChannel.HasPositionKeys)
                 {
                     var controller = new NodeController(ControllerType.Position, nodeIndex, aiChannel.NodeName);
+                    controller.Keys.EnsureCapacity(aiChannel.PositionKeyCount);
                     foreach (var aiKey in aiChannel.PositionKeys)
-                    {
-                        controller.Keys.Add(new Vector3Key
-                        {
-                            Time = ConvertTime(aiKey.Time, aiAnimation.TicksPerSecond),
-                            Value = aiKey.Value.FromAssimp()
-                        });
-                    }
+                        controller.Keys.Add(ConvertTime(aiKey.Time, aiAnimation.TicksPerSecond), aiKey.Value.FromAssimp());
 
+                    controller.Keys.SortAndDeduplicate();
                     motion.Controllers.Add(controller);
                 }
 
                 if (aiChannel.HasRotationKeys)
                 {
                     var controller = new NodeController(ControllerType.Rotation, nodeIndex, aiChannel.NodeName);
+                    controller.Keys.EnsureCapacity(aiChannel.RotationKeyCount);
                     foreach (var aiKey in aiChannel.RotationKeys)
-                    {
-                        controller.Keys.Add(new QuaternionKey
-                        {
-                            Time = ConvertTime(aiKey.Time, aiAnimation.TicksPerSecond),
-                            Value = Quaternion.Inverse(aiKey.Value.FromAssimp())
-                        });
-                    }
+                        controller.Keys.Add(ConvertTime(aiKey.Time, aiAnimation.TicksPerSecond), Quaternion.Inverse(aiKey.Value.FromAssimp()));
 
+                    controller.Keys.SortAndDeduplicate();
                     motion.Controllers.Add(controller);
                 }
 
                 if (aiChannel.HasScalingKeys)
                 {
                     var controller = new NodeController(ControllerType.Scale, nodeIndex, aiChannel.NodeName);
+                    controller.Keys.EnsureCapacity(aiChannel.ScalingKeyCount);
                     foreach (var aiKey in aiChannel.ScalingKeys)
-                    {
-                        controller.Keys.Add(new Vector3Key
-                        {
-                            Time = ConvertTime(aiKey.Time, aiAnimation.TicksPerSecond),
-                            Value = aiKey.Value.FromAssimp()
-                        });
-                    }
+                        controller.Keys.Add(ConvertTime(aiKey.Time, aiAnimation.TicksPerSecond), aiKey.Value.FromAssimp());
 
+                    controller.Keys.SortAndDeduplicate();
                     motion.Controllers.Add(controller);
                 }
             }
 
+            if (config.Compression != null)
+                KeyframeCompressor.Compress(motion, config.Compression);
+
             return motion;
         }
 
@@ -1,23 +1,23 @@
 ﻿using DDS3ModelLibrary.IO.Common;
 using System;
-using System.Collections.Generic;
-using System.Diagnostics;
-using System.Linq;
+using System.Runtime.InteropServices;
 
 namespace DDS3ModelLibrary.Motions.Internal
 {
     internal class KeyframeTrack : IBinarySerializable
     {
+        private const float FIXED_POINT_12 = 4096f;
+
         BinarySourceInfo IBinarySerializable.SourceInfo { get; set; }
 
-        public List<IKey> Keyframes { get; }
+        public KeyframeList Keyframes { get; }
 
         public KeyframeTrack()
         {
-            Keyframes = new List<IKey>();
+            Keyframes = new KeyframeList();
         }
 
-        public KeyframeTrack(List<IKey> keyframes)
+        public KeyframeTrack(KeyframeList keyframes)
         {
             Keyframes = keyframes ?? throw new ArgumentNullException(nameof(keyframes));
         }
@@ -30,123 +30,48 @@ namespace DDS3ModelLibrary.Motions.Internal
             var keyframeTimings = reader.ReadInt16Array(keyframeCount);
             reader.Align(4);
 
-            var controllerType = (ControllerType)context;
+            var format = GetKeyFormat((ControllerType)context, keyframeSize);
+            Keyframes.SetFormat(format);
+            Keyframes.EnsureCapacity(keyframeCount);
             for (int i = 0; i < keyframeCount; i++)
-            {
-                IKey key;
+                Keyframes.AddUninitialized(keyframeTimings[i]);
 
-                switch (controllerType)
+            // Read the values straight into the value column
+            var values = Keyframes.RawValues;
+            var singles = MemoryMarshal.Cast<uint, float>(values);
+            for (int i = 0; i < keyframeCount; i++)
+            {
+                var offset = i * Keyframes.Stride;
+                switch (format)
                 {
-                    case ControllerType.Position:
-                        switch (keyframeSize)
-                        {
-                            case 4:
-                                key = reader.ReadObject<UInt32Key>();
-                                break;
-
-                            case 8:
-                                key = reader.ReadObject<PositionKeySize8>();
-                                break;
-
-                            case 12:
-                                key = reader.ReadObject<Vector3Key>();
-                                break;
-
-                            default:
-                                throw new NotImplementedException();
-                        }
+                    case KeyFormat.UInt32:
+                        values[offset] = reader.ReadUInt32();
                         break;
 
-                    case ControllerType.Type1:
-                        switch (keyframeSize)
-                        {
-                            case 4:
-                                key = reader.ReadObject<UInt32Key>();
-                                break;
-
-                            default:
-                                throw new NotImplementedException();
-                        }
+                    case KeyFormat.PositionSize8:
+                        values[offset] = (uint)reader.ReadInt32();
+                        singles[offset + 1] = reader.ReadSingle();
                         break;
 
-                    case ControllerType.Scale:
-                        switch (keyframeSize)
-                        {
-                            case 12:
-                                key = reader.ReadObject<Vector3Key>();
-                                break;
-
-                            case 20:
-                                key = reader.ReadObject<Single5Key>();
-                                break;
-
-                            default:
-                                throw new NotImplementedException();
-                        }
+                    case KeyFormat.Vector3:
+                    case KeyFormat.Single5:
+                        for (int j = 0; j < Keyframes.Stride; j++)
+                            singles[offset + j] = reader.ReadSingle();
                         break;
 
-                    case ControllerType.Rotation:
-                        switch (keyframeSize)
-                        {
-                            case 8:
-                                key = reader.ReadObject<QuaternionKey>();
-                                break;
-
-                            case 20:
-                                key = reader.ReadObject<Single5Key>();
-                                break;
-
-                            default:
-                                throw new NotImplementedException();
-                        }
-                        break;
-
-                    case ControllerType.Morph:
-                        switch (keyframeSize)
-                        {
-                            case 1:
-                                key = reader.ReadObject<ByteKey>();
-                                break;
-
-                            case 4:
-                                key = reader.ReadObject<UInt32Key>();
-                                break;
-
-                            default:
-                                throw new NotImplementedException();
-                        }
+                    case KeyFormat.Quaternion:
+                        for (int j = 0; j < 4; j++)
+                            singles[offset + j] = reader.ReadInt16() / FIXED_POINT_12;
                         break;
 
-                    case ControllerType.Type5:
-                        switch (keyframeSize)
-                        {
-                            case 4:
-                                key = reader.ReadObject<SingleKey>();
-                                break;
-
-                            default:
-                                throw new NotImplementedException();
-                        }
+                    case KeyFormat.Byte:
+                        values[offset] = reader.ReadByte();
                         break;
 
-                    case ControllerType.Type8:
-                        switch (keyframeSize)
-                        {
-                            case 4:
-                                key = reader.ReadObject<UInt32Key>();
-                                break;
-
-                            default:
-                                throw new NotImplementedException();
-                        }
+                    case KeyFormat.Single:
+                        singles[offset] = reader.ReadSingle();
                         break;
-
-                    default:
-                        throw new NotImplementedException();
                 }
-
-                key.Time = keyframeTimings[i];
-                Keyframes.Add(key);
             }
 
             reader.Align(4);
@@ -156,16 +81,53 @@ namespace DDS3ModelLibrary.Motions.Internal
         {
             var start = writer.Position;
             var dataSize = 0;
-            var keyframeSize = Keyframes.Count > 0 ? Keyframes[0].Size : 0;
-            Debug.Assert(Keyframes.All(x => x.Size == keyframeSize));
+            var keyframeSize = Keyframes.KeySize;
 
-            var keyframes = Keyframes.OrderBy(x => x.Time);
+            // Keys are written in order of time
+            var order = GetSortedIndices(Keyframes.Times);
             writer.WriteInt32(0); // data size placeholder
             writer.WriteInt16((short)Keyframes.Count);
             writer.WriteInt16((short)keyframeSize);
-            writer.WriteInt16s(keyframes.Select(x => x.Time));
+            foreach (var index in order)
+                writer.WriteInt16(Keyframes.Times[index]);
             writer.Align(4);
-            writer.WriteObjects(keyframes);
+
+            var values = Keyframes.RawValues;
+            var singles = MemoryMarshal.Cast<uint, float>(values);
+            foreach (var index in order)
+            {
+                var offset = index * Keyframes.Stride;
+                switch (Keyframes.Format)
+                {
+                    case KeyFormat.UInt32:
+                        writer.WriteUInt32(values[offset]);
+                        break;
+
+                    case KeyFormat.PositionSize8:
+                        writer.WriteInt32((int)values[offset]);
+                        writer.WriteSingle(singles[offset + 1]);
+                        break;
+
+                    case KeyFormat.Vector3:
+                    case KeyFormat.Single5:
+                        for (int j = 0; j < Keyframes.Stride; j++)
+                            writer.WriteSingle(singles[offset + j]);
+                        break;
+
+                    case KeyFormat.Quaternion:
+                        for (int j = 0; j < 4; j++)
+                            writer.WriteInt16((short)(singles[offset + j] * FIXED_POINT_12));
+                        break;
+
+                    case KeyFormat.Byte:
+                        writer.WriteByte((byte)values[offset]);
+                        break;
+
+                    case KeyFormat.Single:
+                        writer.WriteSingle(singles[offset]);
+                        break;
+                }
+            }
             writer.Align(4);
 
             var end = writer.Position;
@@ -174,5 +136,108 @@ namespace DDS3ModelLibrary.Motions.Internal
             writer.WriteInt32(dataSize);
             writer.SeekBegin(end);
         }
+
+        /// <summary>
+        /// Gets the size of the track as it's written.
+        /// </summary>
+        internal static int GetSize(KeyframeList keyframes)
+        {
+            return 8 + AlignmentHelper.Align(keyframes.Count * 2, 4) + AlignmentHelper.Align(keyframes.Count * keyframes.KeySize, 4);
+        }
+
+        private static int[] GetSortedIndices(Span<short> times)
+        {
+            var indices = new int[times.Length];
+            var isSorted = true;
+            for (int i = 0; i < indices.Length; i++)
+            {
+                indices[i] = i;
+                isSorted &= i == 0 || times[i] >= times[i - 1];
+            }
+
+            if (!isSorted)
+            {
+                // Stable, like the order the keys were added in
+                var sortKeys = new long[times.Length];
+                for (int i = 0; i < sortKeys.Length; i++)
+                    sortKeys[i] = ((long)times[i] << 32) | (uint)i;
+
+                Array.Sort(sortKeys, indices);
+            }
+
+            return indices;
+        }
+
+        private static KeyFormat GetKeyFormat(ControllerType controllerType, int keyframeSize)
+        {
+            switch (controllerType)
+            {
+                case ControllerType.Position:
+                    switch (keyframeSize)
+                    {
+                        case 4:
+                            return KeyFormat.UInt32;
+
+                        case 8:
+                            return KeyFormat.PositionSize8;
+
+                        case 12:
+                            return KeyFormat.Vector3;
+                    }
+                    break;
+
+                case ControllerType.Type1:
+                case ControllerType.Type8:
+                    switch (keyframeSize)
+                    {
+                        case 4:
+                            return KeyFormat.UInt32;
+                    }
+                    break;
+
+                case ControllerType.Scale:
+                    switch (keyframeSize)
+                    {
+                        case 12:
+                            return KeyFormat.Vector3;
+
+                        case 20:
+                            return KeyFormat.Single5;
+                    }
+                    break;
+
+                case ControllerType.Rotation:
+                    switch (keyframeSize)
+                    {
+                        case 8:
+                            return KeyFormat.Quaternion;
+
+                        case 20:
+                            return KeyFormat.Single5;
+                    }
+                    break;
+
+                case ControllerType.Morph:
+                    switch (keyframeSize)
+                    {
+                        case 1:
+                            return KeyFormat.Byte;
+
+                        case 4:
+                            return KeyFormat.UInt32;
+                    }
+                    break;
+
+                case ControllerType.Type5:
+                    switch (keyframeSize)
+                    {
+                        case 4:
+                            return KeyFormat.Single;
+                    }
+                    break;
+            }
+
+            throw new NotImplementedException();
+        }
     }
 }
\ No newline at end of file
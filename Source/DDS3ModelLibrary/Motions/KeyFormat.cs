@@ -0,0 +1,17 @@
+﻿namespace DDS3ModelLibrary.Motions
+{
+    /// <summary>
+    /// The value format of the keys of a controller. Each format matches one of the key types.
+    /// </summary>
+    public enum KeyFormat
+    {
+        None,
+        UInt32,
+        PositionSize8,
+        Vector3,
+        Single5,
+        Quaternion,
+        Byte,
+        Single,
+    }
+}
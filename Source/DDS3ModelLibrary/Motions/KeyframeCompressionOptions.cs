@@ -0,0 +1,23 @@
+﻿namespace DDS3ModelLibrary.Motions
+{
+    /// <summary>
+    /// Options for <see cref="KeyframeCompressor"/>.
+    /// </summary>
+    public class KeyframeCompressionOptions
+    {
+        /// <summary>
+        /// Gets or sets the largest distance a position may be off from the original motion, in model units.
+        /// </summary>
+        public float PositionTolerance { get; set; } = 0.01f;
+
+        /// <summary>
+        /// Gets or sets the largest angle a rotation may be off from the original motion, in degrees.
+        /// </summary>
+        public float RotationTolerance { get; set; } = 0.1f;
+
+        /// <summary>
+        /// Gets or sets the largest difference a scale may be off from the original motion.
+        /// </summary>
+        public float ScaleTolerance { get; set; } = 0.001f;
+    }
+}
@@ -0,0 +1,62 @@
+﻿using System.Collections.Generic;
+using System.Linq;
+
+namespace DDS3ModelLibrary.Motions
+{
+    /// <summary>
+    /// Describes how much smaller the keyframe data of a motion pack became after compression.
+    /// </summary>
+    public class KeyframeCompressionReport
+    {
+        /// <summary>
+        /// Describes a single motion.
+        /// </summary>
+        public class MotionResult
+        {
+            public int MotionIndex { get; }
+
+            public int KeyCountBefore { get; }
+
+            public int KeyCountAfter { get; }
+
+            /// <summary>
+            /// Gets the size of the keyframe data before compression.
+            /// </summary>
+            public int SizeBefore { get; }
+
+            /// <summary>
+            /// Gets the size of the keyframe data after compression.
+            /// </summary>
+            public int SizeAfter { get; }
+
+            internal MotionResult(int motionIndex, int keyCountBefore, int keyCountAfter, int sizeBefore, int sizeAfter)
+            {
+                MotionIndex = motionIndex;
+                KeyCountBefore = keyCountBefore;
+                KeyCountAfter = keyCountAfter;
+                SizeBefore = sizeBefore;
+                SizeAfter = sizeAfter;
+            }
+
+            public override string ToString()
+            {
+                return $"Motion {MotionIndex}: {KeyCountBefore} -> {KeyCountAfter} keys, {SizeBefore} -> {SizeAfter} bytes";
+            }
+        }
+
+        public List<MotionResult> Motions { get; } = new List<MotionResult>();
+
+        public int KeyCountBefore => Motions.Sum(x => x.KeyCountBefore);
+
+        public int KeyCountAfter => Motions.Sum(x => x.KeyCountAfter);
+
+        public int SizeBefore => Motions.Sum(x => x.SizeBefore);
+
+        public int SizeAfter => Motions.Sum(x => x.SizeAfter);
+
+        public override string ToString()
+        {
+            return $"{Motions.Count} motions, {KeyCountBefore} -> {KeyCountAfter} keys, {SizeBefore} -> {SizeAfter} bytes";
+        }
+    }
+}
@@ -0,0 +1,188 @@
+﻿using DDS3ModelLibrary.Motions.Internal;
+using System;
+using System.Collections.Generic;
+using System.Numerics;
+
+namespace DDS3ModelLibrary.Motions
+{
+    /// <summary>
+    /// Removes keys that can be interpolated from their neighbours within the tolerances.
+    /// Rotations are checked after fixed point encoding, so the bound holds for the data that is written.
+    /// </summary>
+    public static class KeyframeCompressor
+    {
+        private const float FIXED_POINT_12 = 4096f;
+        private const double RAD_TO_DEG = 180.0 / Math.PI;
+
+        /// <summary>
+        /// Compresses every motion of the motion pack.
+        /// </summary>
+        public static KeyframeCompressionReport Compress(MotionPack motionPack, KeyframeCompressionOptions options = null)
+        {
+            var report = new KeyframeCompressionReport();
+            for (int i = 0; i < motionPack.Motions.Count; i++)
+            {
+                if (motionPack.Motions[i] != null)
+                    report.Motions.Add(Compress(i, motionPack.Motions[i], options ?? new KeyframeCompressionOptions()));
+            }
+
+            return report;
+        }
+
+        /// <summary>
+        /// Compresses a single motion.
+        /// </summary>
+        public static KeyframeCompressionReport Compress(Motion motion, KeyframeCompressionOptions options = null)
+        {
+            var report = new KeyframeCompressionReport();
+            report.Motions.Add(Compress(0, motion, options ?? new KeyframeCompressionOptions()));
+            return report;
+        }
+
+        /// <summary>
+        /// Gets the size of the keyframe data of the motion, not counting the placeholder tracks of controllers it doesn't use.
+        /// </summary>
+        public static int GetSize(Motion motion)
+        {
+            var size = 4;
+            foreach (var controller in motion.Controllers)
+                size += KeyframeTrack.GetSize(controller.Keys);
+
+            return size;
+        }
+
+        private static KeyframeCompressionReport.MotionResult Compress(int motionIndex, Motion motion, KeyframeCompressionOptions options)
+        {
+            var keyCountBefore = 0;
+            var keyCountAfter = 0;
+            var sizeBefore = GetSize(motion);
+
+            foreach (var controller in motion.Controllers)
+            {
+                var keys = controller.Keys;
+                keyCountBefore += keys.Count;
+                keys.SortAndDeduplicate();
+
+                switch (controller.Type)
+                {
+                    case ControllerType.Position when keys.Format == KeyFormat.Vector3:
+                        keys.Keep(ReduceVectors(keys.Times, keys.GetVector3Values(), options.PositionTolerance));
+                        break;
+
+                    case ControllerType.Scale when keys.Format == KeyFormat.Vector3:
+                        keys.Keep(ReduceVectors(keys.Times, keys.GetVector3Values(), options.ScaleTolerance));
+                        break;
+
+                    case ControllerType.Rotation when keys.Format == KeyFormat.Quaternion:
+                        keys.Keep(ReduceRotations(keys.Times, keys.GetQuaternionValues(), options.RotationTolerance));
+                        break;
+                }
+
+                keyCountAfter += keys.Count;
+            }
+
+            return new KeyframeCompressionReport.MotionResult(motionIndex, keyCountBefore, keyCountAfter, sizeBefore, GetSize(motion));
+        }
+
+        private static List<int> ReduceVectors(ReadOnlySpan<short> times, ReadOnlySpan<Vector3> values, float tolerance)
+        {
+            var keep = new List<int>();
+            if (times.Length == 0)
+                return keep;
+
+            // Extend each linear segment for as long as every key it skips stays within the tolerance
+            keep.Add(0);
+            var anchor = 0;
+            for (int candidate = 2; candidate < times.Length; candidate++)
+            {
+                if (!VectorSegmentFits(times, values, anchor, candidate, tolerance))
+                {
+                    anchor = candidate - 1;
+                    keep.Add(anchor);
+                }
+            }
+
+            if (times.Length > 1)
+                keep.Add(times.Length - 1);
+
+            return keep;
+        }
+
+        private static bool VectorSegmentFits(ReadOnlySpan<short> times, ReadOnlySpan<Vector3> values, int start, int end, float tolerance)
+        {
+            var toleranceSquared = tolerance * tolerance;
+            var duration = (float)(times[end] - times[start]);
+            for (int i = start + 1; i < end; i++)
+            {
+                var value = Vector3.Lerp(values[start], values[end], (times[i] - times[start]) / duration);
+                if (Vector3.DistanceSquared(value, values[i]) > toleranceSquared)
+                    return false;
+            }
+
+            return true;
+        }
+
+        private static List<int> ReduceRotations(ReadOnlySpan<short> times, Span<Quaternion> values, float tolerance)
+        {
+            var keep = new List<int>();
+            if (times.Length == 0)
+                return keep;
+
+            // Interpolate between the rotations as they'll be stored, and compare against the source rotations
+            var encoded = new Quaternion[values.Length];
+            for (int i = 0; i < values.Length; i++)
+                encoded[i] = Encode(values[i]);
+
+            keep.Add(0);
+            var anchor = 0;
+            for (int candidate = 2; candidate < times.Length; candidate++)
+            {
+                if (!RotationSegmentFits(times, values, encoded, anchor, candidate, tolerance))
+                {
+                    anchor = candidate - 1;
+                    keep.Add(anchor);
+                }
+            }
+
+            if (times.Length > 1)
+                keep.Add(times.Length - 1);
+
+            encoded.AsSpan().CopyTo(values);
+            return keep;
+        }
+
+        private static bool RotationSegmentFits(ReadOnlySpan<short> times, ReadOnlySpan<Quaternion> values, Quaternion[] encoded, int start, int end,
+                                                float tolerance)
+        {
+            var duration = (float)(times[end] - times[start]);
+            for (int i = start + 1; i < end; i++)
+            {
+                var value = Quaternion.Slerp(encoded[start], encoded[end], (times[i] - times[start]) / duration);
+                if (GetAngle(value, values[i]) > tolerance)
+                    return false;
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Gets the angle between two rotations, in degrees.
+        /// </summary>
+        private static float GetAngle(Quaternion a, Quaternion b)
+        {
+            var cosine = Math.Abs(Quaternion.Dot(Quaternion.Normalize(a), Quaternion.Normalize(b)));
+            return (float)(2 * Math.Acos(Math.Min(1f, cosine)) * RAD_TO_DEG);
+        }
+
+        /// <summary>
+        /// Rounds the rotation the same way <see cref="QuaternionKey"/> is written.
+        /// </summary>
+        private static Quaternion Encode(Quaternion value)
+        {
+            return new Quaternion((short)(value.X * FIXED_POINT_12) / FIXED_POINT_12,
+                                  (short)(value.Y * FIXED_POINT_12) / FIXED_POINT_12,
+                                  (short)(value.Z * FIXED_POINT_12) / FIXED_POINT_12,
+                                  (short)(value.W * FIXED_POINT_12) / FIXED_POINT_12);
+        }
+    }
+}
@@ -0,0 +1,544 @@
+﻿using System;
+using System.Collections;
+using System.Collections.Generic;
+using System.Numerics;
+using System.Runtime.InteropServices;
+
+namespace DDS3ModelLibrary.Motions
+{
+    /// <summary>
+    /// Stores the keys of a controller in columns: an array of times and an array of values.
+    /// All keys share the same <see cref="KeyFormat"/>, which is determined by the first key that is added.
+    /// The typed views give direct access to the values, and are the fast path for code that processes many keys.
+    /// The <see cref="IKey"/> accessors create a new key on every access, so a changed key is only stored once it's assigned back to the indexer.
+    /// </summary>
+    public class KeyframeList : IList<IKey>, IReadOnlyList<IKey>
+    {
+        private const int DEFAULT_CAPACITY = 4;
+
+        private short[] mTimes;
+        private uint[] mValues;
+        private int mCount;
+        private int mStride;
+
+        /// <summary>
+        /// Gets the format of the values.
+        /// </summary>
+        public KeyFormat Format { get; private set; }
+
+        /// <summary>
+        /// Gets the number of 32 bit words each value takes up.
+        /// </summary>
+        public int Stride => mStride;
+
+        /// <summary>
+        /// Gets the size of a single value in the file.
+        /// </summary>
+        public int KeySize => GetKeySize(Format);
+
+        public int Count => mCount;
+
+        bool ICollection<IKey>.IsReadOnly => false;
+
+        /// <summary>
+        /// Gets the times of the keys.
+        /// </summary>
+        public Span<short> Times => mTimes.AsSpan(0, mCount);
+
+        /// <summary>
+        /// Gets the values of the keys as raw 32 bit words, <see cref="Stride"/> words per key.
+        /// </summary>
+        public Span<uint> RawValues => mValues.AsSpan(0, mCount * mStride);
+
+        public IKey this[int index]
+        {
+            get
+            {
+                CheckIndex(index);
+                return GetKey(index);
+            }
+            set
+            {
+                CheckIndex(index);
+                CheckFormat(value);
+                SetKey(index, value);
+            }
+        }
+
+        public KeyframeList()
+        {
+            mTimes = Array.Empty<short>();
+            mValues = Array.Empty<uint>();
+        }
+
+        public KeyframeList(KeyFormat format, int capacity) : this()
+        {
+            SetFormat(format);
+            EnsureCapacity(capacity);
+        }
+
+        public KeyframeList(IEnumerable<IKey> keys) : this()
+        {
+            foreach (var key in keys)
+                Add(key);
+        }
+
+        /// <summary>
+        /// Gets the values of <see cref="KeyFormat.Vector3"/> keys.
+        /// </summary>
+        public Span<Vector3> GetVector3Values() => MemoryMarshal.Cast<uint, Vector3>(GetValues(KeyFormat.Vector3));
+
+        /// <summary>
+        /// Gets the values of <see cref="KeyFormat.Quaternion"/> keys.
+        /// </summary>
+        public Span<Quaternion> GetQuaternionValues() => MemoryMarshal.Cast<uint, Quaternion>(GetValues(KeyFormat.Quaternion));
+
+        /// <summary>
+        /// Gets the values of <see cref="KeyFormat.Single"/> keys, or of <see cref="KeyFormat.Single5"/> keys with 5 values per key.
+        /// </summary>
+        public Span<float> GetSingleValues() => MemoryMarshal.Cast<uint, float>(GetValues(Format == KeyFormat.Single5 ? KeyFormat.Single5 : KeyFormat.Single));
+
+        /// <summary>
+        /// Gets the values of <see cref="KeyFormat.UInt32"/> or <see cref="KeyFormat.Byte"/> keys.
+        /// </summary>
+        public Span<uint> GetUInt32Values() => GetValues(Format == KeyFormat.Byte ? KeyFormat.Byte : KeyFormat.UInt32);
+
+        /// <summary>
+        /// Copies the times of the keys to an array. Spans can't be used from C++/CLI, so the copy methods give it access to the columns.
+        /// </summary>
+        public void CopyTimesTo(short[] array) => Times.CopyTo(array);
+
+        /// <summary>
+        /// Copies the values of <see cref="KeyFormat.Vector3"/> keys to an array.
+        /// </summary>
+        public void CopyVector3ValuesTo(Vector3[] array) => GetVector3Values().CopyTo(array);
+
+        /// <summary>
+        /// Copies the values of <see cref="KeyFormat.Quaternion"/> keys to an array.
+        /// </summary>
+        public void CopyQuaternionValuesTo(Quaternion[] array) => GetQuaternionValues().CopyTo(array);
+
+        public void Add(short time, Vector3 value)
+        {
+            var index = AddKey(KeyFormat.Vector3, time);
+            MemoryMarshal.Cast<uint, Vector3>(mValues.AsSpan(index * mStride, mStride))[0] = value;
+        }
+
+        public void Add(short time, Quaternion value)
+        {
+            var index = AddKey(KeyFormat.Quaternion, time);
+            MemoryMarshal.Cast<uint, Quaternion>(mValues.AsSpan(index * mStride, mStride))[0] = value;
+        }
+
+        public void Add(short time, float value)
+        {
+            var index = AddKey(KeyFormat.Single, time);
+            MemoryMarshal.Cast<uint, float>(mValues.AsSpan(index, 1))[0] = value;
+        }
+
+        public void Add(short time, uint value)
+        {
+            var index = AddKey(KeyFormat.UInt32, time);
+            mValues[index] = value;
+        }
+
+        public void Add(IKey key)
+        {
+            CheckFormat(key);
+            var index = AddKey(GetKeyFormat(key), key.Time);
+            SetKey(index, key);
+        }
+
+        public void Insert(int index, IKey key)
+        {
+            if ((uint)index > (uint)mCount)
+                throw new ArgumentOutOfRangeException(nameof(index));
+
+            CheckFormat(key);
+            AddKey(GetKeyFormat(key), key.Time);
+            Array.Copy(mTimes, index, mTimes, index + 1, mCount - index - 1);
+            Array.Copy(mValues, index * mStride, mValues, (index + 1) * mStride, (mCount - index - 1) * mStride);
+            SetKey(index, key);
+        }
+
+        public void RemoveAt(int index)
+        {
+            CheckIndex(index);
+            Array.Copy(mTimes, index + 1, mTimes, index, mCount - index - 1);
+            Array.Copy(mValues, (index + 1) * mStride, mValues, index * mStride, (mCount - index - 1) * mStride);
+            mCount--;
+        }
+
+        public bool Remove(IKey key)
+        {
+            var index = IndexOf(key);
+            if (index == -1)
+                return false;
+
+            RemoveAt(index);
+            return true;
+        }
+
+        public void Clear()
+        {
+            mCount = 0;
+        }
+
+        public int IndexOf(IKey key)
+        {
+            if (key == null || mCount == 0 || GetKeyFormat(key) != Format)
+                return -1;
+
+            // Compare the encoded values, so keys match regardless of how they were created
+            Span<uint> values = stackalloc uint[mStride];
+            Encode(key, values);
+            for (int i = 0; i < mCount; i++)
+            {
+                if (mTimes[i] == key.Time && mValues.AsSpan(i * mStride, mStride).SequenceEqual(values))
+                    return i;
+            }
+
+            return -1;
+        }
+
+        public bool Contains(IKey key) => IndexOf(key) != -1;
+
+        public void CopyTo(IKey[] array, int arrayIndex)
+        {
+            for (int i = 0; i < mCount; i++)
+                array[arrayIndex + i] = GetKey(i);
+        }
+
+        public IEnumerator<IKey> GetEnumerator()
+        {
+            for (int i = 0; i < mCount; i++)
+                yield return GetKey(i);
+        }
+
+        IEnumerator IEnumerable.GetEnumerator() => GetEnumerator();
+
+        /// <summary>
+        /// Determines whether the key times are strictly increasing.
+        /// </summary>
+        public bool IsSortedAndDistinct()
+        {
+            for (int i = 1; i < mCount; i++)
+            {
+                if (mTimes[i] <= mTimes[i - 1])
+                    return false;
+            }
+
+            return true;
+        }
+
+        /// <summary>
+        /// Sorts the keys by time and removes keys with duplicate times. Of the duplicates, the key that was added last is kept.
+        /// Runs in linear time when the keys are already in order.
+        /// </summary>
+        public void SortAndDeduplicate()
+        {
+            if (IsSortedAndDistinct())
+                return;
+
+            var order = GetSortedDistinctIndices();
+            var times = new short[Math.Max(order.Length, DEFAULT_CAPACITY)];
+            var values = new uint[times.Length * mStride];
+            for (int i = 0; i < order.Length; i++)
+            {
+                times[i] = mTimes[order[i]];
+                Array.Copy(mValues, order[i] * mStride, values, i * mStride, mStride);
+            }
+
+            mTimes = times;
+            mValues = values;
+            mCount = order.Length;
+        }
+
+        /// <summary>
+        /// Gets the indices of the keys in order of time, skipping keys whose time is repeated by a later key.
+        /// Runs in linear time when the keys are already in order.
+        /// </summary>
+        public int[] GetSortedDistinctIndices()
+        {
+            var indices = new int[mCount];
+            for (int i = 0; i < indices.Length; i++)
+                indices[i] = i;
+
+            if (!IsSorted())
+            {
+                // Sorting on time and index keeps keys with the same time in the order they were added
+                var sortKeys = new long[mCount];
+                for (int i = 0; i < sortKeys.Length; i++)
+                    sortKeys[i] = ((long)mTimes[i] << 32) | (uint)i;
+
+                Array.Sort(sortKeys, indices);
+            }
+
+            var count = 0;
+            for (int i = 0; i < indices.Length; i++)
+            {
+                if (i + 1 < indices.Length && mTimes[indices[i + 1]] == mTimes[indices[i]])
+                    continue;
+
+                indices[count++] = indices[i];
+            }
+
+            Array.Resize(ref indices, count);
+            return indices;
+        }
+
+        /// <summary>
+        /// Removes all keys except the specified ones.
+        /// </summary>
+        /// <param name="indices">The indices of the keys to keep, in ascending order.</param>
+        public void Keep(IReadOnlyList<int> indices)
+        {
+            // Indices only move down, so the keys can be compacted in place
+            for (int i = 0; i < indices.Count; i++)
+            {
+                var index = indices[i];
+                if (i > 0 && index <= indices[i - 1])
+                    throw new ArgumentException("The indices must be in ascending order", nameof(indices));
+
+                CheckIndex(index);
+                mTimes[i] = mTimes[index];
+                Array.Copy(mValues, index * mStride, mValues, i * mStride, mStride);
+            }
+
+            mCount = indices.Count;
+        }
+
+        /// <summary>
+        /// Multiplies the times of all keys by the specified multiplier, truncating the results.
+        /// </summary>
+        /// <returns>The largest time after scaling, or <see cref="short.MinValue"/> if there are no keys.</returns>
+        public short ScaleTimes(float multiplier)
+        {
+            var times = Times;
+            var vectors = MemoryMarshal.Cast<short, Vector<short>>(times);
+            var vectorMultiplier = new Vector<float>(multiplier);
+            var vectorMax = new Vector<short>(short.MinValue);
+            for (int i = 0; i < vectors.Length; i++)
+            {
+                Vector.Widen(vectors[i], out var low, out var high);
+                var scaled = Vector.Narrow(Vector.ConvertToInt32(Vector.ConvertToSingle(low) * vectorMultiplier),
+                                           Vector.ConvertToInt32(Vector.ConvertToSingle(high) * vectorMultiplier));
+                vectors[i] = scaled;
+                vectorMax = Vector.Max(vectorMax, scaled);
+            }
+
+            var max = short.MinValue;
+            for (int i = 0; i < Vector<short>.Count; i++)
+                max = Math.Max(max, vectorMax[i]);
+
+            // Handle the remaining keys that don't fill up a vector
+            for (int i = vectors.Length * Vector<short>.Count; i < times.Length; i++)
+            {
+                times[i] = (short)(times[i] * multiplier);
+                max = Math.Max(max, times[i]);
+            }
+
+            return max;
+        }
+
+        internal void SetFormat(KeyFormat format)
+        {
+            if (Format == format)
+                return;
+
+            if (mCount > 0)
+                throw new InvalidOperationException("The format of a non-empty keyframe list can't be changed");
+
+            Format = format;
+            mStride = GetStride(format);
+            mValues = new uint[mTimes.Length * mStride];
+        }
+
+        internal void EnsureCapacity(int capacity)
+        {
+            if (mTimes.Length >= capacity)
+                return;
+
+            capacity = Math.Max(capacity, Math.Max(DEFAULT_CAPACITY, mTimes.Length * 2));
+            Array.Resize(ref mTimes, capacity);
+            Array.Resize(ref mValues, capacity * mStride);
+        }
+
+        /// <summary>
+        /// Appends a key without a value, for readers that fill in the values through the views.
+        /// </summary>
+        internal int AddUninitialized(short time)
+        {
+            EnsureCapacity(mCount + 1);
+            mTimes[mCount] = time;
+            return mCount++;
+        }
+
+        internal static int GetKeySize(KeyFormat format)
+        {
+            switch (format)
+            {
+                case KeyFormat.UInt32: return 4;
+                case KeyFormat.PositionSize8: return 8;
+                case KeyFormat.Vector3: return 12;
+                case KeyFormat.Single5: return 20;
+                case KeyFormat.Quaternion: return 8;
+                case KeyFormat.Byte: return 1;
+                case KeyFormat.Single: return 4;
+                default: return 0;
+            }
+        }
+
+        private static int GetStride(KeyFormat format)
+        {
+            switch (format)
+            {
+                case KeyFormat.None: return 0;
+                case KeyFormat.PositionSize8: return 2;
+                case KeyFormat.Vector3: return 3;
+                case KeyFormat.Single5: return 5;
+                case KeyFormat.Quaternion: return 4;
+                default: return 1;
+            }
+        }
+
+        private static KeyFormat GetKeyFormat(IKey key)
+        {
+            switch (key)
+            {
+                case UInt32Key _: return KeyFormat.UInt32;
+                case PositionKeySize8 _: return KeyFormat.PositionSize8;
+                case Vector3Key _: return KeyFormat.Vector3;
+                case Single5Key _: return KeyFormat.Single5;
+                case QuaternionKey _: return KeyFormat.Quaternion;
+                case ByteKey _: return KeyFormat.Byte;
+                case SingleKey _: return KeyFormat.Single;
+                default: throw new NotSupportedException($"Unsupported key type: {key.GetType()}");
+            }
+        }
+
+        private bool IsSorted()
+        {
+            for (int i = 1; i < mCount; i++)
+            {
+                if (mTimes[i] < mTimes[i - 1])
+                    return false;
+            }
+
+            return true;
+        }
+
+        private int AddKey(KeyFormat format, short time)
+        {
+            if (Format != format)
+            {
+                if (mCount > 0)
+                    throw new ArgumentException($"Expected a key of format {Format}, got {format}");
+
+                SetFormat(format);
+            }
+
+            return AddUninitialized(time);
+        }
+
+        private Span<uint> GetValues(KeyFormat format)
+        {
+            if (Format != format && mCount > 0)
+                throw new InvalidOperationException($"The keys are of format {Format}, not {format}");
+
+            return mValues.AsSpan(0, mCount * mStride);
+        }
+
+        private void CheckIndex(int index)
+        {
+            if ((uint)index >= (uint)mCount)
+                throw new ArgumentOutOfRangeException(nameof(index));
+        }
+
+        private void CheckFormat(IKey key)
+        {
+            if (key == null)
+                throw new ArgumentNullException(nameof(key));
+
+            var format = GetKeyFormat(key);
+            if (mCount > 0 && format != Format)
+                throw new ArgumentException($"Expected a key of format {Format}, got {format}");
+        }
+
+        private void SetKey(int index, IKey key)
+        {
+            mTimes[index] = key.Time;
+            Encode(key, mValues.AsSpan(index * mStride, mStride));
+        }
+
+        private IKey GetKey(int index)
+        {
+            var time = mTimes[index];
+            var values = mValues.AsSpan(index * mStride, mStride);
+            var singles = MemoryMarshal.Cast<uint, float>(values);
+            switch (Format)
+            {
+                case KeyFormat.UInt32:
+                    return new UInt32Key { Time = time, Value = values[0] };
+
+                case KeyFormat.PositionSize8:
+                    return new PositionKeySize8 { Time = time, ShapeIndex = (int)values[0], BlendAmount = singles[1] };
+
+                case KeyFormat.Vector3:
+                    return new Vector3Key { Time = time, Value = new Vector3(singles[0], singles[1], singles[2]) };
+
+                case KeyFormat.Single5:
+                    return new Single5Key { Time = time, Values = singles.ToArray() };
+
+                case KeyFormat.Quaternion:
+                    return new QuaternionKey { Time = time, Value = new Quaternion(singles[0], singles[1], singles[2], singles[3]) };
+
+                case KeyFormat.Byte:
+                    return new ByteKey { Time = time, Value = (byte)values[0] };
+
+                case KeyFormat.Single:
+                    return new SingleKey { Time = time, Value = singles[0] };
+
+                default:
+                    throw new InvalidOperationException();
+            }
+        }
+
+        private static void Encode(IKey key, Span<uint> values)
+        {
+            var singles = MemoryMarshal.Cast<uint, float>(values);
+            switch (key)
+            {
+                case UInt32Key uint32Key:
+                    values[0] = uint32Key.Value;
+                    break;
+
+                case PositionKeySize8 positionKey:
+                    values[0] = (uint)positionKey.ShapeIndex;
+                    singles[1] = positionKey.BlendAmount;
+                    break;
+
+                case Vector3Key vector3Key:
+                    MemoryMarshal.Cast<uint, Vector3>(values)[0] = vector3Key.Value;
+                    break;
+
+                case Single5Key single5Key:
+                    for (int i = 0; i < 5; i++)
+                        singles[i] = single5Key.Values != null && i < single5Key.Values.Length ? single5Key.Values[i] : 0;
+                    break;
+
+                case QuaternionKey quaternionKey:
+                    MemoryMarshal.Cast<uint, Quaternion>(values)[0] = quaternionKey.Value;
+                    break;
+
+                case ByteKey byteKey:
+                    values[0] = byteKey.Value;
+                    break;
+
+                case SingleKey singleKey:
+                    singles[0] = singleKey.Value;
+                    break;
+            }
+        }
+    }
+}
@@ -10,7 +10,7 @@ namespace DDS3ModelLibrary.Motions
         short Time { get; set; }
     }
 
-    public struct UInt32Key : IKey
+    public class UInt32Key : IKey
     {
         public int Size => 4;
 
@@ -32,7 +32,7 @@ namespace DDS3ModelLibrary.Motions
         }
     }
 
-    public struct PositionKeySize8 : IKey
+    public class PositionKeySize8 : IKey
     {
         public int Size => 8;
 
@@ -58,7 +58,7 @@ namespace DDS3ModelLibrary.Motions
         }
     }
 
-    public struct Vector3Key : IKey
+    public class Vector3Key : IKey
     {
         public int Size => 12;
 
@@ -80,7 +80,7 @@ namespace DDS3ModelLibrary.Motions
         }
     }
 
-    public struct Single5Key : IKey
+    public class Single5Key : IKey
     {
         public int Size => 20;
 
@@ -102,77 +102,41 @@ namespace DDS3ModelLibrary.Motions
         }
     }
 
-    public struct QuaternionKey : IKey
+    public class QuaternionKey : IKey
     {
         private const float FIXED_POINT_12 = 4096f;
 
-        private short mRotationX;
-        private short mRotationY;
-        private short mRotationZ;
-        private short mRotationW;
-        private bool mDecoded;
-        private bool mChanged;
-        private Quaternion mRotation;
-
         public int Size => 8;
 
         public short Time { get; set; }
 
-        public Quaternion Value
-        {
-            get
-            {
-                if (!mChanged && !mDecoded)
-                {
-                    mRotation = new Quaternion(mRotationX / FIXED_POINT_12,
-                                                mRotationY / FIXED_POINT_12,
-                                                mRotationZ / FIXED_POINT_12,
-                                                mRotationW / FIXED_POINT_12);
-
-                    mDecoded = true;
-                }
-
-                return mRotation;
-            }
-            set
-            {
-                mRotation = value;
-                mChanged = true;
-            }
-        }
+        /// <summary>
+        /// Gets or sets the rotation. It's decoded when the key is read; the fixed point components convert to floats
+        /// and back without loss, so unchanged keys are written exactly as they were read.
+        /// </summary>
+        public Quaternion Value { get; set; }
 
         // -- IBinarySerializable --
         BinarySourceInfo IBinarySerializable.SourceInfo { get; set; }
 
-
         void IBinarySerializable.Read(EndianBinaryReader reader, object context)
         {
-            mRotationX = reader.ReadInt16();
-            mRotationY = reader.ReadInt16();
-            mRotationZ = reader.ReadInt16();
-            mRotationW = reader.ReadInt16();
+            Value = new Quaternion(reader.ReadInt16() / FIXED_POINT_12,
+                                   reader.ReadInt16() / FIXED_POINT_12,
+                                   reader.ReadInt16() / FIXED_POINT_12,
+                                   reader.ReadInt16() / FIXED_POINT_12);
         }
 
         void IBinarySerializable.Write(EndianBinaryWriter writer, object context)
         {
-            if (mChanged)
-            {
-                mRotationX = (short)(Value.X * FIXED_POINT_12);
-                mRotationY = (short)(Value.Y * FIXED_POINT_12);
-                mRotationZ = (short)(Value.Z * FIXED_POINT_12);
-                mRotationW = (short)(Value.W * FIXED_POINT_12);
-                mChanged = false;
-                mDecoded = true;
-            }
-
-            writer.Write(mRotationX);
-            writer.Write(mRotationY);
-            writer.Write(mRotationZ);
-            writer.Write(mRotationW);
+            writer.Write((short)(Value.X * FIXED_POINT_12));
+            writer.Write((short)(Value.Y * FIXED_POINT_12));
+            writer.Write((short)(Value.Z * FIXED_POINT_12));
+            writer.Write((short)(Value.W * FIXED_POINT_12));
         }
     }
 
-    public struct ByteKey : IKey
+    public class ByteKey : IKey
     {
         public int Size => 1;
 
@@ -195,7 +159,7 @@ namespace DDS3ModelLibrary.Motions
         }
     }
 
-    public struct SingleKey : IKey
+    public class SingleKey : IKey
     {
         public int Size => 4;
 
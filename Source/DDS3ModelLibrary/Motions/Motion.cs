@@ -74,14 +74,7 @@ namespace DDS3ModelLibrary.Motions
         {
             Duration = (short)Math.Max(Duration * multiplier, 1);
             foreach (var controller in Controllers)
-            {
-                foreach (var keyframe in controller.Keys)
-                {
-                    keyframe.Time = (short)(keyframe.Time * multiplier);
-                    if (keyframe.Time > Duration)
-                        Duration = keyframe.Time;
-                }
-            }
+                Duration = Math.Max(Duration, controller.Keys.ScaleTimes(multiplier));
         }
 
         void IBinarySerializable.Read(EndianBinaryReader reader, object context)
@@ -176,7 +176,7 @@ namespace DDS3ModelLibrary.Motions
                     }
 
                     // Need to add dummy values
-                    var keyframes = new List<IKey>();
+                    var keyframes = new KeyframeList();
 
                     void AddPlaceholderKeyframe(short time)
                     {
@@ -184,27 +184,26 @@ namespace DDS3ModelLibrary.Motions
                         switch (controllerDef.Type)
                         {
                             case ControllerType.Position:
-                                key = new Vector3Key();
+                                key = new Vector3Key { Time = time };
                                 break;
                             case ControllerType.Type1:
                             case ControllerType.Morph:
                             case ControllerType.Type8:
-                                key = new UInt32Key();
+                                key = new UInt32Key { Time = time };
                                 break;
                             case ControllerType.Scale:
-                                key = new Vector3Key { Value = Vector3.One };
+                                key = new Vector3Key { Time = time, Value = Vector3.One };
                                 break;
                             case ControllerType.Rotation:
-                                key = new QuaternionKey { Value = Quaternion.Identity };
+                                key = new QuaternionKey { Time = time, Value = Quaternion.Identity };
                                 break;
                             case ControllerType.Type5:
-                                key = new SingleKey();
+                                key = new SingleKey { Time = time };
                                 break;
                             default:
                                 throw new InvalidOperationException();
                         }
 
-                        key.Time = time;
                         keyframes.Add(key);
                     }
 
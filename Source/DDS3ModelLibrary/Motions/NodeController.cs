@@ -1,6 +1,5 @@
 ﻿using DDS3ModelLibrary.IO.Common;
 using DDS3ModelLibrary.Motions.Internal;
-using System.Collections.Generic;
 
 namespace DDS3ModelLibrary.Motions
 {
@@ -31,11 +30,11 @@ namespace DDS3ModelLibrary.Motions
         /// <summary>
         /// Gets the list of keys associated with this controller.
         /// </summary>
-        public List<IKey> Keys { get; private set; }
+        public KeyframeList Keys { get; private set; }
 
         public NodeController()
         {
-            Keys = new List<IKey>();
+            Keys = new KeyframeList();
         }
 
         public NodeController(ControllerType type, short nodeIndex, string nodeName) : this()
@@ -45,7 +44,7 @@ namespace DDS3ModelLibrary.Motions
             NodeName = nodeName;
         }
 
-        internal NodeController(MotionControllerDefinition definition, List<IKey> keys)
+        internal NodeController(MotionControllerDefinition definition, KeyframeList keys)
         {
             Type = definition.Type;
             NodeIndex = definition.NodeIndex;
@@ -0,0 +1,291 @@
+﻿using DDS3ModelLibrary.Models;
+using System;
+using System.Collections.Generic;
+using System.Numerics;
+
+namespace DDS3ModelLibrary.Motions
+{
+    /// <summary>
+    /// Evaluates a motion on the skeleton of a model, producing the local and world transforms of every node at any time.
+    /// Nodes without keys keep their rest transform. Key times are in frames, at 30 frames per second.
+    /// </summary>
+    public class PoseSampler
+    {
+        // Above this cosine the angle is small enough for a normalized lerp to be indistinguishable from a slerp
+        private const float SLERP_THRESHOLD = 0.9995f;
+
+        private class Channel
+        {
+            public int NodeIndex;
+            public ControllerType Type;
+            public short[] Times;
+            public Vector4[] Values;
+            public int Cursor;
+        }
+
+        private readonly ModelTransformHierarchy mHierarchy;
+        private readonly List<Channel> mChannels;
+        private readonly Vector3[] mRestPositions;
+        private readonly Vector4[] mRestRotations;
+        private readonly Vector3[] mRestScales;
+        private readonly Vector3[] mPositions;
+        private readonly Vector4[] mRotations;
+        private readonly Vector3[] mScales;
+        private readonly Matrix4x4[] mLocalTransforms;
+
+        public Model Model { get; }
+
+        public Motion Motion { get; }
+
+        /// <summary>
+        /// Gets the number of transforms in a pose.
+        /// </summary>
+        public int NodeCount => Model.Nodes.Count;
+
+        public PoseSampler(Model model, Motion motion)
+        {
+            Model = model ?? throw new ArgumentNullException(nameof(model));
+            Motion = motion ?? throw new ArgumentNullException(nameof(motion));
+            mHierarchy = new ModelTransformHierarchy(model);
+
+            var nodeCount = model.Nodes.Count;
+            mRestPositions = new Vector3[nodeCount];
+            mRestRotations = new Vector4[nodeCount];
+            mRestScales = new Vector3[nodeCount];
+            mPositions = new Vector3[nodeCount];
+            mRotations = new Vector4[nodeCount];
+            mScales = new Vector3[nodeCount];
+            mLocalTransforms = new Matrix4x4[nodeCount];
+
+            for (int i = 0; i < nodeCount; i++)
+            {
+                var node = model.Nodes[i];
+                var rotation = Quaternion.CreateFromRotationMatrix(Matrix4x4.CreateRotationX(node.Rotation.X) *
+                                                                   Matrix4x4.CreateRotationY(node.Rotation.Y) *
+                                                                   Matrix4x4.CreateRotationZ(node.Rotation.Z));
+                mRestPositions[i] = node.Position;
+                mRestRotations[i] = new Vector4(rotation.X, rotation.Y, rotation.Z, rotation.W);
+                mRestScales[i] = node.Scale;
+            }
+
+            mChannels = new List<Channel>();
+            foreach (var controller in motion.Controllers)
+            {
+                var channel = CreateChannel(controller, nodeCount);
+                if (channel != null)
+                    mChannels.Add(channel);
+            }
+        }
+
+        /// <summary>
+        /// Evaluates the pose at the specified time.
+        /// </summary>
+        /// <param name="time">The time in frames. Times outside of the keys are clamped to the first or last key.</param>
+        /// <param name="localTransforms">The buffer that receives the local transforms, indexed by node index.</param>
+        /// <param name="worldTransforms">The buffer that receives the world transforms, indexed by node index.</param>
+        public void Sample(float time, Span<Matrix4x4> localTransforms, Span<Matrix4x4> worldTransforms)
+        {
+            SampleLocal(time);
+            mLocalTransforms.AsSpan().CopyTo(localTransforms);
+            mHierarchy.ComputeWorldTransforms(mLocalTransforms, worldTransforms);
+        }
+
+        /// <summary>
+        /// Evaluates the world transforms of the pose at the specified time.
+        /// </summary>
+        public void Sample(float time, Span<Matrix4x4> worldTransforms)
+        {
+            SampleLocal(time);
+            mHierarchy.ComputeWorldTransforms(mLocalTransforms, worldTransforms);
+        }
+
+        /// <summary>
+        /// Evaluates the world transforms of a range of frames.
+        /// </summary>
+        /// <param name="startFrame">The first frame.</param>
+        /// <param name="frameCount">The number of frames.</param>
+        /// <param name="worldTransforms">The buffer that receives the transforms, <see cref="NodeCount"/> transforms per frame.</param>
+        public void SampleRange(int startFrame, int frameCount, Span<Matrix4x4> worldTransforms)
+        {
+            var nodeCount = NodeCount;
+            if (worldTransforms.Length < frameCount * nodeCount)
+                throw new ArgumentException("The buffer is too small for the range", nameof(worldTransforms));
+
+            // Frames are sampled in order, so the key cursors only ever step forward
+            for (int i = 0; i < frameCount; i++)
+                Sample(startFrame + i, worldTransforms.Slice(i * nodeCount, nodeCount));
+        }
+
+        /// <summary>
+        /// Evaluates the world transforms of every frame of the motion, including the last one.
+        /// </summary>
+        public Matrix4x4[] SampleAll()
+        {
+            var frameCount = Math.Max(Motion.Duration, 0) + 1;
+            var worldTransforms = new Matrix4x4[frameCount * NodeCount];
+            SampleRange(0, frameCount, worldTransforms);
+            return worldTransforms;
+        }
+
+        private void SampleLocal(float time)
+        {
+            mRestPositions.AsSpan().CopyTo(mPositions);
+            mRestRotations.AsSpan().CopyTo(mRotations);
+            mRestScales.AsSpan().CopyTo(mScales);
+
+            foreach (var channel in mChannels)
+            {
+                var value = Evaluate(channel, time);
+                switch (channel.Type)
+                {
+                    case ControllerType.Position:
+                        mPositions[channel.NodeIndex] = new Vector3(value.X, value.Y, value.Z);
+                        break;
+
+                    case ControllerType.Rotation:
+                        mRotations[channel.NodeIndex] = value;
+                        break;
+
+                    case ControllerType.Scale:
+                        mScales[channel.NodeIndex] = new Vector3(value.X, value.Y, value.Z);
+                        break;
+                }
+            }
+
+            // Same composition as Node.Transform
+            for (int i = 0; i < mLocalTransforms.Length; i++)
+            {
+                var rotation = mRotations[i];
+                var transform = Matrix4x4.CreateFromQuaternion(new Quaternion(rotation.X, rotation.Y, rotation.Z, rotation.W)) *
+                                Matrix4x4.CreateScale(mScales[i]);
+                transform.Translation = mPositions[i];
+                mLocalTransforms[i] = transform;
+            }
+        }
+
+        private static Vector4 Evaluate(Channel channel, float time)
+        {
+            var times = channel.Times;
+            var values = channel.Values;
+            if (times.Length == 1 || time <= times[0])
+                return values[0];
+
+            if (time >= times[times.Length - 1])
+                return values[values.Length - 1];
+
+            var index = FindKey(channel, time);
+            var t = (time - times[index]) / (times[index + 1] - times[index]);
+            return channel.Type == ControllerType.Rotation
+                ? Slerp(values[index], values[index + 1], t)
+                : Vector4.Lerp(values[index], values[index + 1], t);
+        }
+
+        /// <summary>
+        /// Finds the key at or before the time. The time must lie between the first and last key.
+        /// </summary>
+        private static int FindKey(Channel channel, float time)
+        {
+            var times = channel.Times;
+            var cursor = channel.Cursor;
+
+            // Playback usually stays on the same key or moves to the next one
+            if (times[cursor] <= time)
+            {
+                if (time < times[cursor + 1])
+                    return cursor;
+
+                if (cursor + 2 < times.Length && time < times[cursor + 2])
+                    return channel.Cursor = cursor + 1;
+            }
+
+            var low = 0;
+            var high = times.Length - 2;
+            while (low < high)
+            {
+                var mid = (low + high + 1) >> 1;
+                if (times[mid] <= time)
+                    low = mid;
+                else
+                    high = mid - 1;
+            }
+
+            return channel.Cursor = low;
+        }
+
+        /// <summary>
+        /// Spherically interpolates between two unit quaternions stored as <see cref="Vector4"/>, so the blend runs on the vector units.
+        /// </summary>
+        private static Vector4 Slerp(Vector4 a, Vector4 b, float t)
+        {
+            // Take the shortest path
+            var cosine = Vector4.Dot(a, b);
+            if (cosine < 0)
+            {
+                b = -b;
+                cosine = -cosine;
+            }
+
+            if (cosine > SLERP_THRESHOLD)
+                return Vector4.Normalize(Vector4.Lerp(a, b, t));
+
+            var angle = (float)Math.Acos(cosine);
+            var inverseSine = 1f / (float)Math.Sin(angle);
+            return a * ((float)Math.Sin((1 - t) * angle) * inverseSine) + b * ((float)Math.Sin(t * angle) * inverseSine);
+        }
+
+        private static Channel CreateChannel(NodeController controller, int nodeCount)
+        {
+            if (controller.NodeIndex < 0 || controller.NodeIndex >= nodeCount || controller.Keys.Count == 0)
+                return null;
+
+            var keys = controller.Keys;
+            var indices = keys.GetSortedDistinctIndices();
+            var channel = new Channel
+            {
+                NodeIndex = controller.NodeIndex,
+                Type = controller.Type,
+                Times = new short[indices.Length],
+                Values = new Vector4[indices.Length],
+            };
+
+            var times = keys.Times;
+            for (int i = 0; i < indices.Length; i++)
+                channel.Times[i] = times[indices[i]];
+
+            switch (controller.Type)
+            {
+                case ControllerType.Position:
+                case ControllerType.Scale:
+                    {
+                        if (keys.Format != KeyFormat.Vector3)
+                            return null;
+
+                        var values = keys.GetVector3Values();
+                        for (int i = 0; i < indices.Length; i++)
+                            channel.Values[i] = new Vector4(values[indices[i]], 0);
+                    }
+                    break;
+
+                case ControllerType.Rotation:
+                    {
+                        if (keys.Format != KeyFormat.Quaternion)
+                            return null;
+
+                        // Key rotations are stored inverted compared to the node rotations
+                        var values = keys.GetQuaternionValues();
+                        for (int i = 0; i < indices.Length; i++)
+                        {
+                            var rotation = Quaternion.Normalize(Quaternion.Inverse(values[indices[i]]));
+                            channel.Values[i] = new Vector4(rotation.X, rotation.Y, rotation.Z, rotation.W);
+                        }
+                    }
+                    break;
+
+                default:
+                    return null;
+            }
+
+            return channel;
+        }
+    }
+}
@@ -1,19 +1,26 @@
 ﻿using DDS3ModelLibrary.IO.Common;
+using DDS3ModelLibrary.Models;
 using System;
-using System.Collections;
+using System.Buffers;
+using System.Buffers.Binary;
 using System.Collections.Generic;
 using System.Diagnostics;
+using System.Numerics;
+using System.Runtime.InteropServices;
 
 namespace DDS3ModelLibrary.PS2.VIF
 {
     /// <summary>
     /// Formats and builds vif code into a stream. Write only.
+    /// Codes are encoded directly into a pooled buffer, so the builder should be disposed once it has been written.
     /// </summary>
-    public class VifCodeStreamBuilder : IBinarySerializable, IEnumerable<VifCode>
+    public class VifCodeStreamBuilder : IBinarySerializable, IDisposable
     {
-        private readonly List<VifCode> mTags;
+        private const int INITIAL_CAPACITY = 4096;
 
-        public IReadOnlyList<VifCode> Tags => mTags;
+        private byte[] mBuffer;
+        private int mLength;
+        private readonly List<int> mFlushEndOffsets;
 
         BinarySourceInfo IBinarySerializable.SourceInfo { get; set; }
 
@@ -22,12 +29,17 @@ namespace DDS3ModelLibrary.PS2.VIF
         /// </summary>
         public int Address { get; set; }
 
+        /// <summary>
+        /// Gets the number of bytes of vif code built so far, excluding alignment.
+        /// </summary>
+        public int Length => mLength;
+
         public VifCodeStreamBuilder()
         {
-            mTags = new List<VifCode>();
+            mBuffer = ArrayPool<byte>.Shared.Rent(INITIAL_CAPACITY);
+            mFlushEndOffsets = new List<int>();
         }
 
-
         /// <summary>
         /// Code 0x65. Used to unpack the header contents to VU memory (special configuration).
         /// </summary>
@@ -36,7 +48,11 @@ namespace DDS3ModelLibrary.PS2.VIF
         /// <returns></returns>
         public VifCodeStreamBuilder UnpackHeader(short value1, short value2, uint value3)
         {
-            mTags.Add(new VifPacket(0, new[] { new[] { value1, value2, (short)value3, (short)(value3 >> 16) } }, true));
+            WriteUnpackCode(0, true, true, VifUnpackElementFormat.Short, 4, 1);
+            WriteInt16(value1);
+            WriteInt16(value2);
+            WriteInt16((short)value3);
+            WriteInt16((short)(value3 >> 16));
             return this;
         }
 
@@ -48,41 +64,97 @@ namespace DDS3ModelLibrary.PS2.VIF
         /// <returns></returns>
         public VifCodeStreamBuilder UnpackHeader(short value1, short value2)
         {
-            mTags.Add(new VifPacket(0xFF, new[] { new[] { value1, value2 } }));
+            WriteUnpackCode(0xFF, true, false, VifUnpackElementFormat.Short, 2, 1);
+            WriteInt16(value1);
+            WriteInt16(value2);
             return this;
         }
 
+        /// <summary>
+        /// Code 0x6X. Decompresses data and writes to the current VU memory address, and advances it.
+        /// </summary>
+        public VifCodeStreamBuilder Unpack(float[] elements) => Unpack(NextAddress(), false, elements, true, VifUnpackElementFormat.Float, 1);
+
+        /// <summary>
+        /// Code 0x6X. Decompresses data and writes to the current VU memory address, and advances it.
+        /// </summary>
+        public VifCodeStreamBuilder Unpack(Vector2[] elements) => Unpack(NextAddress(), false, elements, true, VifUnpackElementFormat.Float, 2);
+
+        /// <summary>
+        /// Code 0x6X. Decompresses data and writes to the current VU memory address, and advances it.
+        /// </summary>
+        public VifCodeStreamBuilder Unpack(Vector3[] elements) => Unpack(NextAddress(), false, elements, true, VifUnpackElementFormat.Float, 3);
+
+        /// <summary>
+        /// Code 0x6X. Decompresses data and writes to the current VU memory address, and advances it.
+        /// </summary>
+        public VifCodeStreamBuilder Unpack(Vector4[] elements) => Unpack(NextAddress(), false, elements, true, VifUnpackElementFormat.Float, 4);
+
         /// <summary>
         /// Code 0x6X. Decompresses data and writes to VU memory.
         /// </summary>
-        /// <param name="elements"></param>
-        /// <returns></returns>
-        public VifCodeStreamBuilder Unpack(dynamic elements)
-        {
-            Debug.Assert(Address % 8 == 0);
-            var packet = new VifPacket(Address / 8, elements, false);
-            //var unpackedSize = ( packet.Count * AlignmentHelper.Align( packet.ElementCount * packet.ElementSize, 16 ) ) * usedNodeCount;
-            //mAddress += unpackedSize;
+        public VifCodeStreamBuilder Unpack(int address, float[] elements) => Unpack(SetAddress(address), true, elements, true, VifUnpackElementFormat.Float, 1);
 
-            Address += 0xC0;
-            if (Address > 0x240)
-                Address = 0;
+        /// <summary>
+        /// Code 0x6X. Decompresses data and writes to VU memory.
+        /// </summary>
+        public VifCodeStreamBuilder Unpack(int address, Vector2[] elements) => Unpack(SetAddress(address), true, elements, true, VifUnpackElementFormat.Float, 2);
+
+        /// <summary>
+        /// Code 0x6X. Decompresses data and writes to VU memory.
+        /// </summary>
+        public VifCodeStreamBuilder Unpack(int address, Vector3[] elements) => Unpack(SetAddress(address), true, elements, true, VifUnpackElementFormat.Float, 3);
+
+        /// <summary>
+        /// Code 0x6X. Decompresses data and writes to VU memory.
+        /// </summary>
+        public VifCodeStreamBuilder Unpack(int address, Vector4[] elements) => Unpack(SetAddress(address), true, elements, true, VifUnpackElementFormat.Float, 4);
+
+        /// <summary>
+        /// Code 0x6X. Decompresses data and writes to VU memory.
+        /// </summary>
+        public VifCodeStreamBuilder Unpack(int address, short[] elements) => Unpack(SetAddress(address), true, elements, true, VifUnpackElementFormat.Short, 1);
+
+        /// <summary>
+        /// Code 0x6X. Decompresses data and writes to VU memory.
+        /// </summary>
+        public VifCodeStreamBuilder Unpack(int address, ushort[] elements) => Unpack(SetAddress(address), true, elements, false, VifUnpackElementFormat.Short, 1);
+
+        /// <summary>
+        /// Code 0x6X. Decompresses data and writes to VU memory.
+        /// </summary>
+        public VifCodeStreamBuilder Unpack(int address, sbyte[] elements) => Unpack(SetAddress(address), true, elements, true, VifUnpackElementFormat.Byte, 1);
+
+        /// <summary>
+        /// Code 0x6X. Decompresses data and writes to VU memory.
+        /// </summary>
+        public VifCodeStreamBuilder Unpack(int address, byte[] elements) => Unpack(SetAddress(address), true, elements, false, VifUnpackElementFormat.Byte, 1);
+
+        /// <summary>
+        /// Code 0x6X. Decompresses the triangle indices as signed 4 byte elements and writes them to VU memory.
+        /// </summary>
+        public VifCodeStreamBuilder Unpack(int address, Triangle[] triangles)
+        {
+            WriteUnpackCode(SetAddress(address), true, true, VifUnpackElementFormat.Byte, 4, triangles.Length);
+            var span = Reserve(triangles.Length * 4);
+            for (int i = 0; i < triangles.Length; i++)
+            {
+                span[i * 4 + 0] = (byte)(sbyte)triangles[i].A;
+                span[i * 4 + 1] = (byte)(sbyte)triangles[i].B;
+                span[i * 4 + 2] = (byte)(sbyte)triangles[i].C;
+                span[i * 4 + 3] = 0;
+            }
 
-            mTags.Add(packet);
             return this;
         }
 
         /// <summary>
-        /// Code 0x6X. Decompresses data and writes to VU memory.
+        /// Code 0x6X. Decompresses the colors as signed 4 byte elements and writes them to VU memory.
         /// </summary>
-        /// <param name="elements"></param>
-        /// <returns></returns>
-        public VifCodeStreamBuilder Unpack(int address, dynamic elements)
+        public VifCodeStreamBuilder Unpack(int address, Color[] colors)
         {
-            Address = address;
-            Debug.Assert(Address % 8 == 0);
-            var packet = new VifPacket(Address / 8, elements, true);
-            mTags.Add(packet);
+            WriteUnpackCode(SetAddress(address), true, true, VifUnpackElementFormat.Byte, 4, colors.Length);
+            MemoryMarshal.AsBytes(colors.AsSpan()).CopyTo(Reserve(colors.Length * 4));
             return this;
         }
 
@@ -91,7 +163,7 @@ namespace DDS3ModelLibrary.PS2.VIF
         /// </summary>
         public VifCodeStreamBuilder ActivateMicro(ushort id)
         {
-            mTags.Add(new VifCode(id, 0, (byte)VifCommand.ActMicro));
+            WriteCode(id, 0, (byte)VifCommand.ActMicro);
             return this;
         }
 
@@ -100,7 +172,7 @@ namespace DDS3ModelLibrary.PS2.VIF
         /// </summary>
         public VifCodeStreamBuilder ExecuteMicro()
         {
-            mTags.Add(new VifCode(0, 0, (byte)VifCommand.CntMicro));
+            WriteCode(0, 0, (byte)VifCommand.CntMicro);
             return this;
         }
 
@@ -109,37 +181,132 @@ namespace DDS3ModelLibrary.PS2.VIF
         /// </summary>
         public VifCodeStreamBuilder FlushEnd()
         {
-            mTags.Add(new VifCode(0, 0, (byte)VifCommand.FlushEnd));
+            WriteCode(0, 0, (byte)VifCommand.FlushEnd);
+            mFlushEndOffsets.Add(mLength);
             Address = 0; // TODO: verify
             return this;
         }
 
-        void IBinarySerializable.Read(EndianBinaryReader reader, object context)
+        public void Dispose()
         {
-            throw new NotSupportedException();
+            if (mBuffer != null)
+            {
+                ArrayPool<byte>.Shared.Return(mBuffer);
+                mBuffer = null;
+            }
         }
 
-        void IBinarySerializable.Write(EndianBinaryWriter writer, object context)
+        private int NextAddress()
         {
-            foreach (var tag in Tags)
-            {
-                writer.WriteObject(tag);
+            Debug.Assert(Address % 8 == 0);
+            var address = Address / 8;
+            //var unpackedSize = ( packet.Count * AlignmentHelper.Align( packet.ElementCount * packet.ElementSize, 16 ) ) * usedNodeCount;
+            //mAddress += unpackedSize;
+
+            Address += 0xC0;
+            if (Address > 0x240)
+                Address = 0;
+
+            return address;
+        }
+
+        private int SetAddress(int address)
+        {
+            Address = address;
+            Debug.Assert(Address % 8 == 0);
+            return Address / 8;
+        }
+
+        private VifCodeStreamBuilder Unpack<T>(int address, bool flag, T[] elements, bool sign, VifUnpackElementFormat format, int elementCount) where T : struct
+        {
+            // Elements are stored as little endian, like the model files
+            var bytes = MemoryMarshal.AsBytes(elements.AsSpan());
+            Debug.Assert(bytes.Length == elements.Length * elementCount * GetElementSize(format));
+            WriteUnpackCode(address, sign, flag, format, elementCount, elements.Length);
+            bytes.CopyTo(Reserve(bytes.Length));
+            return this;
+        }
 
-                if (tag.Command == VifCommand.FlushEnd)
-                    writer.Align(16);
+        private void WriteUnpackCode(int address, bool sign, bool flag, VifUnpackElementFormat format, int elementCount, int count)
+        {
+            if (count > byte.MaxValue)
+                throw new ArgumentException(nameof(count));
+
+            var immediate = (ushort)((address & 0x1FF) | (sign ? 1 << 14 : 0) | (flag ? 1 << 15 : 0));
+            var command = (byte)((byte)VifCommand.Unpack | ((elementCount - 1) << 2) | (int)format);
+            WriteCode(immediate, (byte)count, command);
+        }
+
+        private void WriteCode(ushort immediate, byte count, byte command)
+        {
+            var span = Reserve(4);
+            BinaryPrimitives.WriteUInt16LittleEndian(span, immediate);
+            span[2] = count;
+            span[3] = command;
+        }
+
+        private void WriteInt16(short value)
+        {
+            BinaryPrimitives.WriteInt16LittleEndian(Reserve(sizeof(short)), value);
+        }
+
+        private Span<byte> Reserve(int size)
+        {
+            if (mBuffer == null)
+                throw new ObjectDisposedException(nameof(VifCodeStreamBuilder));
+
+            if (mLength + size > mBuffer.Length)
+            {
+                var newBuffer = ArrayPool<byte>.Shared.Rent(Math.Max(mBuffer.Length * 2, mLength + size));
+                Buffer.BlockCopy(mBuffer, 0, newBuffer, 0, mLength);
+                ArrayPool<byte>.Shared.Return(mBuffer);
+                mBuffer = newBuffer;
             }
 
-            writer.Align(16);
+            var span = new Span<byte>(mBuffer, mLength, size);
+            mLength += size;
+            return span;
         }
 
-        public IEnumerator<VifCode> GetEnumerator()
+        private static int GetElementSize(VifUnpackElementFormat format)
         {
-            return ((IEnumerable<VifCode>)mTags).GetEnumerator();
+            switch (format)
+            {
+                case VifUnpackElementFormat.Float:
+                    return sizeof(float);
+                case VifUnpackElementFormat.Short:
+                case VifUnpackElementFormat.RGBA5A1:
+                    return sizeof(short);
+                case VifUnpackElementFormat.Byte:
+                    return sizeof(byte);
+                default:
+                    throw new ArgumentOutOfRangeException(nameof(format));
+            }
+        }
+
+        void IBinarySerializable.Read(EndianBinaryReader reader, object context)
+        {
+            throw new NotSupportedException();
         }
 
-        IEnumerator IEnumerable.GetEnumerator()
+        void IBinarySerializable.Write(EndianBinaryWriter writer, object context)
         {
-            return ((IEnumerable<VifCode>)mTags).GetEnumerator();
+            if (mBuffer == null)
+                throw new ObjectDisposedException(nameof(VifCodeStreamBuilder));
+
+            Debug.Assert(!writer.SwapBytes, "Vif code is always written as little endian");
+
+            // Align after every FlushEnd relative to the actual stream position
+            var start = 0;
+            foreach (var offset in mFlushEndOffsets)
+            {
+                writer.Write(mBuffer, start, offset - start);
+                writer.Align(16);
+                start = offset;
+            }
+
+            writer.Write(mBuffer, start, mLength - start);
+            writer.Align(16);
         }
     }
-}
\ No newline at end of file
+}
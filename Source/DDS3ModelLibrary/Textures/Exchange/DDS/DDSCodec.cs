@@ -6,6 +6,7 @@ using System.Drawing.Imaging;
 using System.IO;
 using System.Linq;
 using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
 using System.Text;
 
 namespace DDS3ModelLibrary.Textures.Exchange.DDS
@@ -98,6 +99,23 @@ namespace DDS3ModelLibrary.Textures.Exchange.DDS
             return outStream;
         }
 
+        /// <summary>
+        /// Decompress a DDS image file and output an <see cref="Rgba32Image"/>.
+        /// </summary>
+        /// <param name="filepath"></param>
+        /// <returns></returns>
+        public static Rgba32Image DecompressImageToRgba32(string filepath)
+        {
+            var image = File.ReadAllBytes(filepath);
+            var header = new DDSHeader(image);
+            var newData = DecompressImageData(image, header.Width, header.Height, header.PixelFormat.FourCC, true);
+
+            // The decompressed data is laid out as BGRA
+            var pixels = MemoryMarshal.Cast<byte, Models.Color>(newData);
+            PixelSwizzleHelper.SwapRedBlue(pixels);
+            return new Rgba32Image(header.Width, header.Height, pixels);
+        }
+
         /// <summary>
         /// Decompress a DDS image and output RGBA data.
         /// </summary>
@@ -0,0 +1,447 @@
+﻿using System;
+using System.IO;
+using System.IO.Compression;
+using System.Runtime.InteropServices;
+using System.Text;
+using Color = DDS3ModelLibrary.Models.Color;
+
+namespace DDS3ModelLibrary.Textures.Exchange.PNG
+{
+    /// <summary>
+    /// PNG codec for decoding and encoding <see cref="Rgba32Image"/> instances without GDI+.
+    /// Supports all non-interlaced color types and bit depths. Images are always encoded as 8 bit RGBA.
+    /// </summary>
+    public static class PNGCodec
+    {
+        private static readonly byte[] sSignature = { 0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A };
+        private static readonly uint[] sCrcTable = CreateCrcTable();
+
+        private const int COLOR_TYPE_GRAYSCALE = 0;
+        private const int COLOR_TYPE_RGB = 2;
+        private const int COLOR_TYPE_INDEXED = 3;
+        private const int COLOR_TYPE_GRAYSCALE_ALPHA = 4;
+        private const int COLOR_TYPE_RGBA = 6;
+
+        /// <summary>
+        /// Decode a PNG image file.
+        /// </summary>
+        public static Rgba32Image Decode(string filepath)
+        {
+            return Decode(File.ReadAllBytes(filepath));
+        }
+
+        /// <summary>
+        /// Decode a PNG image stream.
+        /// </summary>
+        public static Rgba32Image Decode(Stream stream)
+        {
+            using (var memoryStream = new MemoryStream())
+            {
+                stream.CopyTo(memoryStream);
+                return Decode(memoryStream.ToArray());
+            }
+        }
+
+        /// <summary>
+        /// Decode a PNG image.
+        /// </summary>
+        public static Rgba32Image Decode(byte[] data)
+        {
+            for (int i = 0; i < sSignature.Length; i++)
+            {
+                if (data.Length < sSignature.Length || data[i] != sSignature[i])
+                    throw new InvalidDataException("Not a PNG image");
+            }
+
+            int width = 0, height = 0, bitDepth = 0, colorType = 0;
+            Color[] palette = null;
+            byte[] transparency = null;
+            var imageData = new MemoryStream();
+
+            var offset = sSignature.Length;
+            while (offset + 8 <= data.Length)
+            {
+                var length = (int)ReadUInt32(data, offset);
+                var type = Encoding.ASCII.GetString(data, offset + 4, 4);
+                var chunkOffset = offset + 8;
+                offset = chunkOffset + length + 4;
+
+                if (type == "IHDR")
+                {
+                    width = (int)ReadUInt32(data, chunkOffset);
+                    height = (int)ReadUInt32(data, chunkOffset + 4);
+                    bitDepth = data[chunkOffset + 8];
+                    colorType = data[chunkOffset + 9];
+                    if (data[chunkOffset + 12] != 0)
+                        throw new NotSupportedException("Interlaced PNG images are not supported");
+                }
+                else if (type == "PLTE")
+                {
+                    palette = new Color[length / 3];
+                    for (int i = 0; i < palette.Length; i++)
+                        palette[i] = new Color(data[chunkOffset + i * 3], data[chunkOffset + i * 3 + 1], data[chunkOffset + i * 3 + 2]);
+                }
+                else if (type == "tRNS")
+                {
+                    transparency = new byte[length];
+                    Buffer.BlockCopy(data, chunkOffset, transparency, 0, length);
+                }
+                else if (type == "IDAT")
+                {
+                    imageData.Write(data, chunkOffset, length);
+                }
+                else if (type == "IEND")
+                {
+                    break;
+                }
+            }
+
+            if (width == 0 || height == 0)
+                throw new InvalidDataException("PNG image is missing its header");
+
+            var channelCount = GetChannelCount(colorType);
+            var stride = (width * channelCount * bitDepth + 7) / 8;
+            var bytesPerPixel = Math.Max(1, channelCount * bitDepth / 8);
+            var scanlines = Inflate(imageData.ToArray(), (stride + 1) * height);
+
+            var image = new Rgba32Image(width, height);
+            var previous = new byte[stride];
+            var current = new byte[stride];
+            for (int y = 0; y < height; y++)
+            {
+                var rowOffset = y * (stride + 1);
+                Buffer.BlockCopy(scanlines, rowOffset + 1, current, 0, stride);
+                Unfilter(scanlines[rowOffset], current, previous, bytesPerPixel);
+                DecodeRow(current, image.GetRow(y), colorType, bitDepth, palette, transparency);
+
+                var temp = previous;
+                previous = current;
+                current = temp;
+            }
+
+            return image;
+        }
+
+        /// <summary>
+        /// Encode an image as PNG to a file.
+        /// </summary>
+        public static void Encode(Rgba32Image image, string filepath)
+        {
+            using (var stream = File.Create(filepath))
+                Encode(image, stream);
+        }
+
+        /// <summary>
+        /// Encode an image as PNG to a stream.
+        /// </summary>
+        public static void Encode(Rgba32Image image, Stream stream)
+        {
+            stream.Write(sSignature, 0, sSignature.Length);
+
+            var header = new byte[13];
+            WriteUInt32(header, 0, (uint)image.Width);
+            WriteUInt32(header, 4, (uint)image.Height);
+            header[8] = 8;
+            header[9] = COLOR_TYPE_RGBA;
+            WriteChunk(stream, "IHDR", header, header.Length);
+
+            var stride = image.Width * 4;
+            var scanlines = new byte[(stride + 1) * image.Height];
+            var previous = new byte[stride];
+            var current = new byte[stride];
+            var filtered = new byte[stride];
+            var bestFiltered = new byte[stride];
+            for (int y = 0; y < image.Height; y++)
+            {
+                MemoryMarshal.AsBytes(image.GetRow(y)).CopyTo(current);
+
+                // Pick the filter with the smallest sum of absolute differences, as suggested by the specification
+                var bestFilter = 0;
+                var bestScore = long.MaxValue;
+                for (int filter = 0; filter < 5; filter++)
+                {
+                    Filter(filter, current, previous, filtered, 4);
+
+                    long score = 0;
+                    foreach (var value in filtered)
+                        score += (sbyte)value < 0 ? -(sbyte)value : value;
+
+                    if (score < bestScore)
+                    {
+                        bestScore = score;
+                        bestFilter = filter;
+                        Buffer.BlockCopy(filtered, 0, bestFiltered, 0, stride);
+                    }
+                }
+
+                var rowOffset = y * (stride + 1);
+                scanlines[rowOffset] = (byte)bestFilter;
+                Buffer.BlockCopy(bestFiltered, 0, scanlines, rowOffset + 1, stride);
+
+                var temp = previous;
+                previous = current;
+                current = temp;
+            }
+
+            var compressed = Deflate(scanlines);
+            WriteChunk(stream, "IDAT", compressed, compressed.Length);
+            WriteChunk(stream, "IEND", Array.Empty<byte>(), 0);
+        }
+
+        private static int GetChannelCount(int colorType)
+        {
+            switch (colorType)
+            {
+                case COLOR_TYPE_GRAYSCALE:
+                case COLOR_TYPE_INDEXED:
+                    return 1;
+                case COLOR_TYPE_GRAYSCALE_ALPHA:
+                    return 2;
+                case COLOR_TYPE_RGB:
+                    return 3;
+                case COLOR_TYPE_RGBA:
+                    return 4;
+                default:
+                    throw new InvalidDataException($"Invalid PNG color type {colorType}");
+            }
+        }
+
+        private static void DecodeRow(byte[] row, Span<Color> pixels, int colorType, int bitDepth, Color[] palette, byte[] transparency)
+        {
+            for (int x = 0; x < pixels.Length; x++)
+            {
+                switch (colorType)
+                {
+                    case COLOR_TYPE_GRAYSCALE:
+                        {
+                            var value = ReadSample(row, x, bitDepth);
+                            var gray = ScaleSample(value, bitDepth);
+                            var alpha = transparency != null && transparency.Length >= 2 && value == ((transparency[0] << 8) | transparency[1]) ? (byte)0 : (byte)255;
+                            pixels[x] = new Color(gray, gray, gray, alpha);
+                        }
+                        break;
+
+                    case COLOR_TYPE_RGB:
+                        {
+                            var r = ReadSample(row, x * 3, bitDepth);
+                            var g = ReadSample(row, x * 3 + 1, bitDepth);
+                            var b = ReadSample(row, x * 3 + 2, bitDepth);
+                            var isTransparent = transparency != null && transparency.Length >= 6 &&
+                                                r == ((transparency[0] << 8) | transparency[1]) &&
+                                                g == ((transparency[2] << 8) | transparency[3]) &&
+                                                b == ((transparency[4] << 8) | transparency[5]);
+                            pixels[x] = new Color(ScaleSample(r, bitDepth), ScaleSample(g, bitDepth), ScaleSample(b, bitDepth), isTransparent ? (byte)0 : (byte)255);
+                        }
+                        break;
+
+                    case COLOR_TYPE_INDEXED:
+                        {
+                            var index = ReadSample(row, x, bitDepth);
+                            var color = palette != null && index < palette.Length ? palette[index] : Color.Black;
+                            if (transparency != null && index < transparency.Length)
+                                color.A = transparency[index];
+
+                            pixels[x] = color;
+                        }
+                        break;
+
+                    case COLOR_TYPE_GRAYSCALE_ALPHA:
+                        {
+                            var gray = ScaleSample(ReadSample(row, x * 2, bitDepth), bitDepth);
+                            pixels[x] = new Color(gray, gray, gray, ScaleSample(ReadSample(row, x * 2 + 1, bitDepth), bitDepth));
+                        }
+                        break;
+
+                    case COLOR_TYPE_RGBA:
+                        pixels[x] = new Color(ScaleSample(ReadSample(row, x * 4, bitDepth), bitDepth),
+                                              ScaleSample(ReadSample(row, x * 4 + 1, bitDepth), bitDepth),
+                                              ScaleSample(ReadSample(row, x * 4 + 2, bitDepth), bitDepth),
+                                              ScaleSample(ReadSample(row, x * 4 + 3, bitDepth), bitDepth));
+                        break;
+                }
+            }
+        }
+
+        private static int ReadSample(byte[] row, int sampleIndex, int bitDepth)
+        {
+            switch (bitDepth)
+            {
+                case 8:
+                    return row[sampleIndex];
+                case 16:
+                    return (row[sampleIndex * 2] << 8) | row[sampleIndex * 2 + 1];
+                default:
+                    {
+                        var bitOffset = sampleIndex * bitDepth;
+                        var shift = 8 - bitDepth - (bitOffset & 7);
+                        return (row[bitOffset >> 3] >> shift) & ((1 << bitDepth) - 1);
+                    }
+            }
+        }
+
+        private static byte ScaleSample(int value, int bitDepth)
+        {
+            switch (bitDepth)
+            {
+                case 8:
+                    return (byte)value;
+                case 16:
+                    return (byte)(value >> 8);
+                default:
+                    return (byte)(value * 255 / ((1 << bitDepth) - 1));
+            }
+        }
+
+        private static void Unfilter(int filter, byte[] current, byte[] previous, int bytesPerPixel)
+        {
+            for (int i = 0; i < current.Length; i++)
+            {
+                int left = i >= bytesPerPixel ? current[i - bytesPerPixel] : 0;
+                int up = previous[i];
+                int upLeft = i >= bytesPerPixel ? previous[i - bytesPerPixel] : 0;
+
+                switch (filter)
+                {
+                    case 0: break;
+                    case 1: current[i] += (byte)left; break;
+                    case 2: current[i] += (byte)up; break;
+                    case 3: current[i] += (byte)((left + up) >> 1); break;
+                    case 4: current[i] += (byte)Paeth(left, up, upLeft); break;
+                    default: throw new InvalidDataException($"Invalid PNG filter type {filter}");
+                }
+            }
+        }
+
+        private static void Filter(int filter, byte[] current, byte[] previous, byte[] filtered, int bytesPerPixel)
+        {
+            for (int i = 0; i < current.Length; i++)
+            {
+                int left = i >= bytesPerPixel ? current[i - bytesPerPixel] : 0;
+                int up = previous[i];
+                int upLeft = i >= bytesPerPixel ? previous[i - bytesPerPixel] : 0;
+
+                switch (filter)
+                {
+                    case 0: filtered[i] = current[i]; break;
+                    case 1: filtered[i] = (byte)(current[i] - left); break;
+                    case 2: filtered[i] = (byte)(current[i] - up); break;
+                    case 3: filtered[i] = (byte)(current[i] - ((left + up) >> 1)); break;
+                    case 4: filtered[i] = (byte)(current[i] - Paeth(left, up, upLeft)); break;
+                }
+            }
+        }
+
+        private static int Paeth(int a, int b, int c)
+        {
+            var p = a + b - c;
+            var pa = Math.Abs(p - a);
+            var pb = Math.Abs(p - b);
+            var pc = Math.Abs(p - c);
+            if (pa <= pb && pa <= pc) return a;
+            if (pb <= pc) return b;
+            return c;
+        }
+
+        private static byte[] Inflate(byte[] zlibData, int expectedLength)
+        {
+            // Skip the 2 byte zlib header, DeflateStream only handles the raw deflate data
+            var result = new byte[expectedLength];
+            using (var stream = new DeflateStream(new MemoryStream(zlibData, 2, zlibData.Length - 2), CompressionMode.Decompress))
+            {
+                var read = 0;
+                while (read < expectedLength)
+                {
+                    var count = stream.Read(result, read, expectedLength - read);
+                    if (count == 0)
+                        throw new InvalidDataException("PNG image data is truncated");
+
+                    read += count;
+                }
+            }
+
+            return result;
+        }
+
+        private static byte[] Deflate(byte[] data)
+        {
+            using (var output = new MemoryStream())
+            {
+                output.WriteByte(0x78);
+                output.WriteByte(0x9C);
+
+                using (var stream = new DeflateStream(output, CompressionLevel.Optimal, true))
+                    stream.Write(data, 0, data.Length);
+
+                var adler = Adler32(data);
+                output.WriteByte((byte)(adler >> 24));
+                output.WriteByte((byte)(adler >> 16));
+                output.WriteByte((byte)(adler >> 8));
+                output.WriteByte((byte)adler);
+                return output.ToArray();
+            }
+        }
+
+        private static void WriteChunk(Stream stream, string type, byte[] data, int length)
+        {
+            var header = new byte[8];
+            WriteUInt32(header, 0, (uint)length);
+            Encoding.ASCII.GetBytes(type, 0, 4, header, 4);
+            stream.Write(header, 0, header.Length);
+            stream.Write(data, 0, length);
+
+            var crc = UpdateCrc(0xFFFFFFFF, header, 4, 4);
+            crc = UpdateCrc(crc, data, 0, length) ^ 0xFFFFFFFF;
+            var crcBytes = new byte[4];
+            WriteUInt32(crcBytes, 0, crc);
+            stream.Write(crcBytes, 0, crcBytes.Length);
+        }
+
+        private static uint ReadUInt32(byte[] data, int offset)
+        {
+            return (uint)((data[offset] << 24) | (data[offset + 1] << 16) | (data[offset + 2] << 8) | data[offset + 3]);
+        }
+
+        private static void WriteUInt32(byte[] data, int offset, uint value)
+        {
+            data[offset] = (byte)(value >> 24);
+            data[offset + 1] = (byte)(value >> 16);
+            data[offset + 2] = (byte)(value >> 8);
+            data[offset + 3] = (byte)value;
+        }
+
+        private static uint Adler32(byte[] data)
+        {
+            uint a = 1, b = 0;
+            foreach (var value in data)
+            {
+                a = (a + value) % 65521;
+                b = (b + a) % 65521;
+            }
+
+            return (b << 16) | a;
+        }
+
+        private static uint UpdateCrc(uint crc, byte[] data, int offset, int length)
+        {
+            for (int i = offset; i < offset + length; i++)
+                crc = sCrcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+            return crc;
+        }
+
+        private static uint[] CreateCrcTable()
+        {
+            var table = new uint[256];
+            for (uint n = 0; n < table.Length; n++)
+            {
+                var c = n;
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) != 0 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+
+                table[n] = c;
+            }
+
+            return table;
+        }
+    }
+}
@@ -0,0 +1,198 @@
+﻿using System;
+using System.IO;
+using System.Runtime.InteropServices;
+using Color = DDS3ModelLibrary.Models.Color;
+
+namespace DDS3ModelLibrary.Textures.Exchange.TGA
+{
+    /// <summary>
+    /// TGA codec for decoding and encoding <see cref="Rgba32Image"/> instances without GDI+.
+    /// Supports color mapped, true color and grayscale images with or without RLE compression. Images are always encoded as
+    /// uncompressed 32 bit true color.
+    /// </summary>
+    public static class TGACodec
+    {
+        private const int HEADER_SIZE = 18;
+
+        private const int IMAGE_TYPE_COLOR_MAPPED = 1;
+        private const int IMAGE_TYPE_TRUE_COLOR = 2;
+        private const int IMAGE_TYPE_GRAYSCALE = 3;
+        private const int IMAGE_TYPE_RLE_FLAG = 8;
+
+        /// <summary>
+        /// Decode a TGA image file.
+        /// </summary>
+        public static Rgba32Image Decode(string filepath)
+        {
+            return Decode(File.ReadAllBytes(filepath));
+        }
+
+        /// <summary>
+        /// Decode a TGA image stream.
+        /// </summary>
+        public static Rgba32Image Decode(Stream stream)
+        {
+            using (var memoryStream = new MemoryStream())
+            {
+                stream.CopyTo(memoryStream);
+                return Decode(memoryStream.ToArray());
+            }
+        }
+
+        /// <summary>
+        /// Decode a TGA image.
+        /// </summary>
+        public static Rgba32Image Decode(byte[] data)
+        {
+            if (data.Length < HEADER_SIZE)
+                throw new InvalidDataException("Not a TGA image");
+
+            var idLength = data[0];
+            var imageType = data[2];
+            var colorMapStart = data[3] | (data[4] << 8);
+            var colorMapLength = data[5] | (data[6] << 8);
+            var colorMapDepth = data[7];
+            var width = data[12] | (data[13] << 8);
+            var height = data[14] | (data[15] << 8);
+            var pixelDepth = data[16];
+            var descriptor = data[17];
+
+            var isRle = (imageType & IMAGE_TYPE_RLE_FLAG) != 0;
+            var baseType = imageType & ~IMAGE_TYPE_RLE_FLAG;
+            if (baseType != IMAGE_TYPE_COLOR_MAPPED && baseType != IMAGE_TYPE_TRUE_COLOR && baseType != IMAGE_TYPE_GRAYSCALE)
+                throw new NotSupportedException($"TGA image type {imageType} is not supported");
+
+            var offset = HEADER_SIZE + idLength;
+
+            // Alpha is only used when the descriptor declares attribute bits, which apply to the color map of a color mapped image
+            var hasAlpha = (descriptor & 0x0F) != 0;
+
+            Color[] colorMap = null;
+            if (data[1] != 0)
+            {
+                var entrySize = (colorMapDepth + 7) / 8;
+                colorMap = new Color[colorMapStart + colorMapLength];
+                for (int i = 0; i < colorMapLength; i++)
+                    colorMap[colorMapStart + i] = ReadColor(data, offset + i * entrySize, colorMapDepth, hasAlpha);
+
+                offset += colorMapLength * entrySize;
+            }
+
+            var bytesPerPixel = (pixelDepth + 7) / 8;
+            var pixels = new Color[width * height];
+            var pixelIndex = 0;
+            while (pixelIndex < pixels.Length)
+            {
+                var count = 1;
+                var isRepeat = false;
+                if (isRle)
+                {
+                    var packet = data[offset++];
+                    count = (packet & 0x7F) + 1;
+                    isRepeat = (packet & 0x80) != 0;
+                }
+
+                for (int i = 0; i < count && pixelIndex < pixels.Length; i++)
+                {
+                    pixels[pixelIndex++] = ReadPixel(data, offset, baseType, pixelDepth, hasAlpha, colorMap);
+                    if (!isRepeat)
+                        offset += bytesPerPixel;
+                }
+
+                if (isRepeat)
+                    offset += bytesPerPixel;
+            }
+
+            // Images are stored bottom to top unless the origin is at the top, and left to right unless the origin is at the right
+            var isBottomUp = (descriptor & 0x20) == 0;
+            var isRightToLeft = (descriptor & 0x10) != 0;
+            var image = new Rgba32Image(width, height);
+            for (int y = 0; y < height; y++)
+            {
+                var sourceRow = pixels.AsSpan((isBottomUp ? height - 1 - y : y) * width, width);
+                var destRow = image.GetRow(y);
+                sourceRow.CopyTo(destRow);
+                if (isRightToLeft)
+                    destRow.Reverse();
+            }
+
+            return image;
+        }
+
+        /// <summary>
+        /// Encode an image as TGA to a file.
+        /// </summary>
+        public static void Encode(Rgba32Image image, string filepath)
+        {
+            using (var stream = File.Create(filepath))
+                Encode(image, stream);
+        }
+
+        /// <summary>
+        /// Encode an image as TGA to a stream.
+        /// </summary>
+        public static void Encode(Rgba32Image image, Stream stream)
+        {
+            var header = new byte[HEADER_SIZE];
+            header[2] = IMAGE_TYPE_TRUE_COLOR;
+            header[12] = (byte)image.Width;
+            header[13] = (byte)(image.Width >> 8);
+            header[14] = (byte)image.Height;
+            header[15] = (byte)(image.Height >> 8);
+            header[16] = 32;
+            header[17] = 0x28; // 8 alpha bits, top left origin
+            stream.Write(header, 0, header.Length);
+
+            var pixels = image.ToArray();
+            Processing.PixelSwizzleHelper.SwapRedBlue(pixels);
+
+            var bytes = new byte[pixels.Length * 4];
+            MemoryMarshal.AsBytes(pixels.AsSpan()).CopyTo(bytes);
+            stream.Write(bytes, 0, bytes.Length);
+        }
+
+        private static Color ReadPixel(byte[] data, int offset, int baseType, int pixelDepth, bool hasAlpha, Color[] colorMap)
+        {
+            switch (baseType)
+            {
+                case IMAGE_TYPE_COLOR_MAPPED:
+                    {
+                        var index = pixelDepth == 16 ? data[offset] | (data[offset + 1] << 8) : data[offset];
+                        return colorMap != null && index < colorMap.Length ? colorMap[index] : Color.Black;
+                    }
+
+                case IMAGE_TYPE_GRAYSCALE:
+                    return new Color(data[offset], data[offset], data[offset], pixelDepth == 16 ? data[offset + 1] : byte.MaxValue);
+
+                default:
+                    return ReadColor(data, offset, pixelDepth, hasAlpha);
+            }
+        }
+
+        private static Color ReadColor(byte[] data, int offset, int depth, bool hasAlpha)
+        {
+            switch (depth)
+            {
+                case 15:
+                case 16:
+                    {
+                        var value = data[offset] | (data[offset + 1] << 8);
+                        var alpha = depth == 16 && hasAlpha && (value & 0x8000) == 0 ? (byte)0 : byte.MaxValue;
+                        return new Color((byte)(((value >> 10) & 0x1F) * 255 / 31),
+                                         (byte)(((value >> 5) & 0x1F) * 255 / 31),
+                                         (byte)((value & 0x1F) * 255 / 31),
+                                         alpha);
+                    }
+
+                case 24:
+                    return new Color(data[offset + 2], data[offset + 1], data[offset]);
+
+                case 32:
+                    return new Color(data[offset + 2], data[offset + 1], data[offset], hasAlpha ? data[offset + 3] : byte.MaxValue);
+
+                default:
+                    throw new NotSupportedException($"TGA color depth {depth} is not supported");
+            }
+        }
+    }
+}
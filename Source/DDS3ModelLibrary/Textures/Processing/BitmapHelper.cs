@@ -147,21 +147,16 @@ namespace DDS3ModelLibrary.Textures.Processing
 
             unsafe
             {
+                // Rows are copied as is and swizzled afterwards, instead of converting every pixel separately
                 byte* p = (byte*)bitmapData.Scan0;
-                Parallel.For(0, height, y =>
+                for (int y = 0; y < height; y++)
                 {
-                    for (int x = 0; x < width; x++)
-                    {
-                        int offset = (x * 4) + y * bitmapData.Stride;
-                        colors[x + y * width] = new Color
-                        (
-                            p[offset + 2], p[offset + 1], p[offset], p[offset + 3]
-                        );
-                    }
-                });
+                    new Span<Color>(p + y * bitmapData.Stride, width).CopyTo(colors.AsSpan(y * width, width));
+                }
             }
             bitmap.UnlockBits(bitmapData);
 
+            PixelSwizzleHelper.SwapRedBlue(colors);
             return colors;
         }
 
@@ -210,6 +205,55 @@ namespace DDS3ModelLibrary.Textures.Processing
             indices = GetIndices(quantBitmap);
         }
 
+        /// <summary>
+        /// Encodes an array of pixel colors into per-pixel palette color indices using a specified number of colors in the palette.
+        /// Unlike <see cref="QuantizeBitmap"/> this does not use GDI+, and is safe to call from multiple threads.
+        /// </summary>
+        /// <param name="colors">The pixel colors to encode.</param>
+        /// <param name="paletteColorCount">The number of colors to be present in the palette.</param>
+        /// <param name="indices">The per-pixel palette color indices.</param>
+        /// <param name="palette">The <see cref="Color"/> array containing the palette colors.</param>
+        public static void QuantizeColors(ReadOnlySpan<Color> colors, int paletteColorCount, out byte[] indices, out Color[] palette)
+        {
+            var quantizer = new WuQuantizer.WuQuantizer();
+            var quantizedPalette = quantizer.QuantizePixels(colors, paletteColorCount, 0, 1);
+
+            palette = new Color[paletteColorCount];
+            for (int i = 0; i < Math.Min(paletteColorCount, quantizedPalette.Colors.Count); i++)
+                palette[i] = quantizedPalette.Colors[i];
+
+            // Unassigned pixels use the transparent color at the end of the palette, like the bitmap path does
+            var transparentIndex = (byte)(quantizedPalette.Colors.Count - 1);
+            indices = new byte[colors.Length];
+            for (int i = 0; i < indices.Length; i++)
+            {
+                var index = quantizedPalette.PixelIndex[i];
+                indices[i] = index == -1 ? transparentIndex : (byte)index;
+            }
+        }
+
+        /// <summary>
+        /// Quantizes a histogram of distinct colors, each weighted by the number of pixels that use it.
+        /// </summary>
+        /// <param name="indices">The palette index of each histogram color.</param>
+        public static void QuantizeHistogram(ReadOnlySpan<Color> colors, ReadOnlySpan<int> counts, int paletteColorCount, out byte[] indices, out Color[] palette)
+        {
+            var quantizer = new WuQuantizer.WuQuantizer();
+            var quantizedPalette = quantizer.QuantizeHistogram(colors, counts, paletteColorCount, 0, 1);
+
+            palette = new Color[paletteColorCount];
+            for (int i = 0; i < Math.Min(paletteColorCount, quantizedPalette.Colors.Count); i++)
+                palette[i] = quantizedPalette.Colors[i];
+
+            var transparentIndex = (byte)(quantizedPalette.Colors.Count - 1);
+            indices = new byte[colors.Length];
+            for (int i = 0; i < indices.Length; i++)
+            {
+                var index = quantizedPalette.PixelIndex[i];
+                indices[i] = index == -1 ? transparentIndex : (byte)index;
+            }
+        }
+
         private static Bitmap ConvertTo32Bpp(Image img)
         {
             var bmp = new Bitmap(img.Width, img.Height, PixelFormat.Format32bppArgb);
@@ -0,0 +1,81 @@
+﻿using System;
+using System.Numerics;
+using Color = DDS3ModelLibrary.Models.Color;
+
+namespace DDS3ModelLibrary.Textures.Processing
+{
+    /// <summary>
+    /// Contains helper methods for resizing <see cref="Rgba32Image"/> instances.
+    /// </summary>
+    public static class ImageResampleHelper
+    {
+        /// <summary>
+        /// Resizes an image. Downscaling averages all covered source pixels, upscaling interpolates bilinearly.
+        /// </summary>
+        /// <param name="image">The image to resize.</param>
+        /// <param name="width">The new width.</param>
+        /// <param name="height">The new height.</param>
+        /// <returns>A new image with the given dimensions.</returns>
+        public static Rgba32Image Resize(Rgba32Image image, int width, int height)
+        {
+            if (width == image.Width && height == image.Height)
+                return image.Clone();
+
+            var source = new Vector4[image.PixelCount];
+            var pixels = image.Pixels;
+            for (int i = 0; i < source.Length; i++)
+                source[i] = ToVector(pixels[i]);
+
+            // Resize horizontally first, then vertically
+            var temp = new Vector4[width * image.Height];
+            for (int y = 0; y < image.Height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                    temp[x + y * width] = Sample(source, y * image.Width, 1, image.Width, width, x);
+            }
+
+            var result = new Rgba32Image(width, height);
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                    result[x, y] = ToColor(Sample(temp, x, width, image.Height, height, y));
+            }
+
+            return result;
+        }
+
+        private static Vector4 Sample(Vector4[] source, int offset, int stride, int sourceSize, int destSize, int index)
+        {
+            var ratio = (float)sourceSize / destSize;
+            if (ratio <= 1f)
+            {
+                var position = Math.Max(0f, (index + 0.5f) * ratio - 0.5f);
+                var i0 = Math.Min((int)position, sourceSize - 1);
+                var i1 = Math.Min(i0 + 1, sourceSize - 1);
+                return Vector4.Lerp(source[offset + i0 * stride], source[offset + i1 * stride], position - i0);
+            }
+
+            var start = index * ratio;
+            var end = start + ratio;
+            var sum = Vector4.Zero;
+            for (int i = (int)start; i < end && i < sourceSize; i++)
+            {
+                var weight = Math.Min(i + 1, end) - Math.Max(i, start);
+                sum += source[offset + i * stride] * weight;
+            }
+
+            return sum / ratio;
+        }
+
+        internal static Vector4 ToVector(Color color)
+        {
+            return new Vector4(color.R, color.G, color.B, color.A);
+        }
+
+        internal static Color ToColor(Vector4 value)
+        {
+            value = Vector4.Clamp(value + new Vector4(0.5f), Vector4.Zero, new Vector4(255f));
+            return new Color((byte)value.X, (byte)value.Y, (byte)value.Z, (byte)value.W);
+        }
+    }
+}
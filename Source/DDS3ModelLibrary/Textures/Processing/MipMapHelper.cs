@@ -0,0 +1,164 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Numerics;
+using Color = DDS3ModelLibrary.Models.Color;
+
+namespace DDS3ModelLibrary.Textures.Processing
+{
+    /// <summary>
+    /// Contains helper methods for generating mipmap chains that fit the layout used by <see cref="Texture"/> and the limits of the GS.
+    /// </summary>
+    public static class MipMapHelper
+    {
+        /// <summary>
+        /// The maximum number of mipmap levels the GS supports in addition to the base level (MXL).
+        /// </summary>
+        public const int MAX_MIPMAP_COUNT = 6;
+
+        /// <summary>
+        /// The smallest width or height of a mipmap level. Smaller levels cost a full page in VRAM anyway.
+        /// </summary>
+        public const int MIN_MIPMAP_DIMENSION = 8;
+
+        /// <summary>
+        /// Requests as many mipmap levels as the dimensions of a texture allow, see <see cref="GetMaxMipMapCount"/>.
+        /// </summary>
+        public const int AUTO_MIPMAP_COUNT = -1;
+
+        private const int LINEAR_TO_SRGB_TABLE_SIZE = 4096;
+        private const int LOD_REFERENCE_DIMENSION = 64;
+
+        private static readonly float[] sSrgbToLinearTable;
+        private static readonly byte[] sLinearToSrgbTable;
+
+        static MipMapHelper()
+        {
+            sSrgbToLinearTable = new float[256];
+            for (int i = 0; i < sSrgbToLinearTable.Length; i++)
+            {
+                var value = i / 255d;
+                sSrgbToLinearTable[i] = (float)(value <= 0.04045 ? value / 12.92 : Math.Pow((value + 0.055) / 1.055, 2.4));
+            }
+
+            sLinearToSrgbTable = new byte[LINEAR_TO_SRGB_TABLE_SIZE + 1];
+            for (int i = 0; i < sLinearToSrgbTable.Length; i++)
+            {
+                var value = (double)i / LINEAR_TO_SRGB_TABLE_SIZE;
+                var srgb = value <= 0.0031308 ? value * 12.92 : 1.055 * Math.Pow(value, 1 / 2.4) - 0.055;
+                sLinearToSrgbTable[i] = (byte)Math.Round(Math.Min(1, Math.Max(0, srgb)) * 255);
+            }
+        }
+
+        /// <summary>
+        /// Gets the number of mipmap levels that can be generated for a texture of the given dimensions.
+        /// Every level must have power of two dimensions of at least <see cref="MIN_MIPMAP_DIMENSION"/> that evenly divide the base level.
+        /// </summary>
+        public static int GetMaxMipMapCount(int width, int height)
+        {
+            var count = 0;
+            while (count < MAX_MIPMAP_COUNT)
+            {
+                var level = count + 1;
+                var mipWidth = Texture.GetMipDimension(width, level);
+                var mipHeight = Texture.GetMipDimension(height, level);
+                if (!IsValidMipDimension(width, mipWidth) || !IsValidMipDimension(height, mipHeight))
+                    break;
+
+                count = level;
+            }
+
+            return count;
+        }
+
+        /// <summary>
+        /// Generates the mipmap levels of an image. Pixels are filtered in linear space, and color is weighted by alpha
+        /// so transparent texels don't bleed into the visible ones.
+        /// </summary>
+        /// <param name="image">The base level.</param>
+        /// <param name="mipMapCount">The requested number of mipmap levels. It is clamped to <see cref="GetMaxMipMapCount"/>.</param>
+        /// <returns>The generated levels, excluding the base level. The caller owns the returned images.</returns>
+        public static List<Rgba32Image> GenerateMipMaps(Rgba32Image image, int mipMapCount)
+        {
+            mipMapCount = Math.Min(mipMapCount, GetMaxMipMapCount(image.Width, image.Height));
+
+            var levels = new List<Rgba32Image>(Math.Max(0, mipMapCount));
+            if (mipMapCount <= 0)
+                return levels;
+
+            // Convert to premultiplied linear once, every level is filtered directly from the base level
+            var source = new Vector4[image.PixelCount];
+            var pixels = image.Pixels;
+            for (int i = 0; i < source.Length; i++)
+                source[i] = ToPremultipliedLinear(pixels[i]);
+
+            for (int i = 1; i <= mipMapCount; i++)
+                levels.Add(Downsample(source, image.Width, image.Height, Texture.GetMipDimension(image.Width, i), Texture.GetMipDimension(image.Height, i)));
+
+            return levels;
+        }
+
+        /// <summary>
+        /// Calculates the packed LOD parameters for a texture with the given dimensions. L selects the slope of the
+        /// LOD curve and K its bias as a signed 1.7.4 fixed point value, as in the TEX1 register.
+        /// The GS calculates LOD = (log2(1/|Q|) &lt;&lt; L) + K, so textures larger than 64 texels get a positive bias and switch to their
+        /// smaller levels sooner, which is where they cost the most fill rate.
+        /// </summary>
+        public static ushort CalculateMipKL(int width, int height)
+        {
+            const int L = 0;
+            var maxDimension = Math.Max(1, Math.Max(width, height));
+            var k = Math.Log(maxDimension, 2) - Math.Log(LOD_REFERENCE_DIMENSION, 2);
+            var kFixed = (int)Math.Round(Math.Min(127.9375, Math.Max(-128, k)) * 16);
+            return (ushort)((kFixed & 0xFFF) | (L << 12));
+        }
+
+        private static bool IsValidMipDimension(int baseDimension, int mipDimension)
+        {
+            return mipDimension >= MIN_MIPMAP_DIMENSION &&
+                   (mipDimension & (mipDimension - 1)) == 0 &&
+                   baseDimension % mipDimension == 0;
+        }
+
+        private static Rgba32Image Downsample(Vector4[] source, int sourceWidth, int sourceHeight, int width, int height)
+        {
+            var factorX = sourceWidth / width;
+            var factorY = sourceHeight / height;
+            var result = new Rgba32Image(width, height);
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    var sum = Vector4.Zero;
+                    for (int sy = 0; sy < factorY; sy++)
+                    {
+                        var rowOffset = (y * factorY + sy) * sourceWidth + x * factorX;
+                        for (int sx = 0; sx < factorX; sx++)
+                            sum += source[rowOffset + sx];
+                    }
+
+                    result[x, y] = FromPremultipliedLinear(sum / (factorX * factorY));
+                }
+            }
+
+            return result;
+        }
+
+        private static Vector4 ToPremultipliedLinear(Color color)
+        {
+            var alpha = color.A / 255f;
+            return new Vector4(sSrgbToLinearTable[color.R] * alpha, sSrgbToLinearTable[color.G] * alpha, sSrgbToLinearTable[color.B] * alpha, alpha);
+        }
+
+        private static Color FromPremultipliedLinear(Vector4 value)
+        {
+            if (value.W <= 0)
+                return new Color(0, 0, 0, 0);
+
+            var linear = Vector4.Clamp(value / value.W, Vector4.Zero, Vector4.One) * LINEAR_TO_SRGB_TABLE_SIZE + new Vector4(0.5f);
+            return new Color(sLinearToSrgbTable[(int)linear.X],
+                             sLinearToSrgbTable[(int)linear.Y],
+                             sLinearToSrgbTable[(int)linear.Z],
+                             (byte)Math.Min(255, (int)(value.W * 255 + 0.5f)));
+        }
+    }
+}
@@ -0,0 +1,91 @@
+﻿using System;
+using System.Numerics;
+using System.Runtime.InteropServices;
+using Color = DDS3ModelLibrary.Models.Color;
+
+namespace DDS3ModelLibrary.Textures.Processing
+{
+    /// <summary>
+    /// Contains vectorized helper methods for converting pixel data in place.
+    /// </summary>
+    public static class PixelSwizzleHelper
+    {
+        // Added before truncation so products that land just below a whole number due to rounding still
+        // produce the same results as GSHelper. Exact fractions are always at least 1/255 away from one.
+        private const float ROUNDING_BIAS = 0.001f;
+
+        private static readonly Vector<float> sToGSAlphaScale = CreateAlphaVector(128f / 255f, 1f);
+        private static readonly Vector<float> sFromGSAlphaScale = CreateAlphaVector(255f / 128f, 1f);
+        private static readonly Vector<float> sAlphaBias = CreateAlphaVector(ROUNDING_BIAS, 0f);
+        private static readonly Vector<float> sMaxChannelValue = new Vector<float>(255f);
+
+        /// <summary>
+        /// Swaps the red and blue channels of each pixel, converting between BGRA and RGBA in place.
+        /// </summary>
+        public static void SwapRedBlue(Span<Color> pixels)
+        {
+            // Vector<T> has no shuffles or shifts, so swap within each pixel using 32 bit word operations instead
+            var words = MemoryMarshal.Cast<Color, uint>(pixels);
+            for (int i = 0; i < words.Length; i++)
+            {
+                var value = words[i];
+                words[i] = (value & 0xFF00FF00) | ((value >> 16) & 0xFF) | ((value & 0xFF) << 16);
+            }
+        }
+
+        /// <summary>
+        /// Scales the alpha channel of each pixel from the 0-255 range to the GS 0-128 range in place.
+        /// Produces the same results as <see cref="PS2.GS.GSHelper.AlphaToGSAlpha(byte)"/>.
+        /// </summary>
+        public static void ScaleAlphaToGS(Span<Color> pixels)
+        {
+            ScaleAlpha(pixels, sToGSAlphaScale, PS2.GS.GSHelper.AlphaToGSAlpha);
+        }
+
+        /// <summary>
+        /// Scales the alpha channel of each pixel from the GS 0-128 range to the 0-255 range in place.
+        /// Produces the same results as <see cref="PS2.GS.GSHelper.AlphaFromGSAlpha(byte)"/>.
+        /// </summary>
+        public static void ScaleAlphaFromGS(Span<Color> pixels)
+        {
+            ScaleAlpha(pixels, sFromGSAlphaScale, PS2.GS.GSHelper.AlphaFromGSAlpha);
+        }
+
+        private static void ScaleAlpha(Span<Color> pixels, Vector<float> scale, Func<byte, byte> scaler)
+        {
+            var bytes = MemoryMarshal.AsBytes(pixels);
+            var vectors = MemoryMarshal.Cast<byte, Vector<byte>>(bytes);
+
+            for (int i = 0; i < vectors.Length; i++)
+            {
+                Vector.Widen(vectors[i], out var low, out var high);
+                Vector.Widen(low, out var w0, out var w1);
+                Vector.Widen(high, out var w2, out var w3);
+
+                vectors[i] = Vector.Narrow(
+                    Vector.Narrow(ScaleChannels(w0, scale), ScaleChannels(w1, scale)),
+                    Vector.Narrow(ScaleChannels(w2, scale), ScaleChannels(w3, scale)));
+            }
+
+            // Handle the remaining pixels that don't fill up a vector
+            for (int i = vectors.Length * Vector<byte>.Count / 4; i < pixels.Length; i++)
+                pixels[i].A = scaler(pixels[i].A);
+        }
+
+        private static Vector<uint> ScaleChannels(Vector<uint> channels, Vector<float> scale)
+        {
+            var value = Vector.ConvertToSingle(Vector.AsVectorInt32(channels)) * scale + sAlphaBias;
+            return Vector.AsVectorUInt32(Vector.ConvertToInt32(Vector.Min(value, sMaxChannelValue)));
+        }
+
+        private static Vector<float> CreateAlphaVector(float alphaValue, float colorValue)
+        {
+            // Lanes map to consecutive channel bytes, and the lane count is always a multiple of 4
+            var values = new float[Vector<float>.Count];
+            for (int i = 0; i < values.Length; i++)
+                values[i] = (i % 4) == 3 ? alphaValue : colorValue;
+
+            return new Vector<float>(values);
+        }
+    }
+}
@@ -0,0 +1,269 @@
+﻿using DDS3ModelLibrary.PS2.GS;
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using Color = DDS3ModelLibrary.Models.Color;
+
+namespace DDS3ModelLibrary.Textures.Processing
+{
+    /// <summary>
+    /// Requantizes the indexed textures of a texture pack so that groups of similar textures share a single palette.
+    /// Textures in a group get identical palettes and the same <see cref="Texture.UserClutId"/>, so the CLUT only has to be
+    /// uploaded once for the whole group.
+    /// Textures are compared by their color histograms, so the cost of grouping doesn't depend on the texture dimensions.
+    /// </summary>
+    public class SharedPaletteQuantizer
+    {
+        private class Candidate
+        {
+            public int TextureIndex;
+            public Texture Texture;
+
+            /// <summary>
+            /// The number of pixels of all levels that use each color of the palette.
+            /// </summary>
+            public int[] Counts;
+            public int PixelCount;
+        }
+
+        private class PaletteGroup
+        {
+            public readonly List<Candidate> Members = new List<Candidate>();
+
+            /// <summary>
+            /// The number of pixels of all members that use each distinct color.
+            /// </summary>
+            public readonly Dictionary<Color, int> Histogram = new Dictionary<Color, int>();
+            public Color[] Palette;
+
+            /// <summary>
+            /// The shared palette index of each histogram color.
+            /// </summary>
+            public Dictionary<Color, byte> PaletteIndices;
+            public float[] Errors;
+        }
+
+        /// <summary>
+        /// Gets or sets the maximum root mean square error per color channel a texture may have after being requantized.
+        /// </summary>
+        public float MaxError { get; set; } = 4f;
+
+        /// <summary>
+        /// Gets or sets the maximum number of shared palettes created for each palette size.
+        /// </summary>
+        public int MaxPaletteCount { get; set; } = 8;
+
+        /// <summary>
+        /// Groups the indexed textures in the pack by palette similarity and replaces their palettes with a shared one.
+        /// Textures that can't share a palette within the error budget are left untouched.
+        /// </summary>
+        /// <param name="textures">The texture pack. It is modified in place.</param>
+        /// <returns>A report listing the error of each requantized texture and the number of CLUT bytes saved.</returns>
+        public SharedPaletteReport Quantize(TexturePack textures)
+        {
+            var report = new SharedPaletteReport();
+            var candidates = new List<Candidate>();
+            for (int i = 0; i < textures.Count; i++)
+            {
+                var texture = textures[i];
+                report.ClutSizeBefore += GetClutSize(texture);
+                if (IsCandidate(texture))
+                    candidates.Add(CreateCandidate(i, texture));
+            }
+
+            var nextClutId = textures.Count == 0 ? 0 : textures.Max(x => x.UserClutId) + 1;
+            foreach (var sizeGroup in candidates.GroupBy(x => x.Texture.PaletteColorCount))
+            {
+                var paletteColorCount = sizeGroup.Key;
+                var groups = BuildGroups(sizeGroup.OrderByDescending(x => x.PixelCount).ThenBy(x => x.TextureIndex), paletteColorCount);
+
+                foreach (var group in groups.Where(x => x.Members.Count > 1))
+                {
+                    var clutId = nextClutId++;
+                    for (int i = 0; i < group.Members.Count; i++)
+                    {
+                        var member = group.Members[i];
+                        member.Texture.ReplacePalette(group.Palette, RemapIndices(member.Texture, group.PaletteIndices));
+                        member.Texture.UserClutId = clutId;
+
+                        report.Textures.Add(new SharedPaletteReport.TextureResult(member.TextureIndex, clutId, group.Errors[i]));
+                    }
+
+                    report.SharedPaletteCount++;
+                }
+            }
+
+            report.Textures.Sort((x, y) => x.TextureIndex.CompareTo(y.TextureIndex));
+
+            // Textures sharing a CLUT id only upload their palette once
+            var uploadedCluts = new HashSet<int>();
+            foreach (var result in report.Textures)
+                uploadedCluts.Add(result.ClutId);
+
+            var sharedTextureIndices = new HashSet<int>(report.Textures.Select(x => x.TextureIndex));
+            for (int i = 0; i < textures.Count; i++)
+            {
+                var texture = textures[i];
+                if (!sharedTextureIndices.Contains(i) || uploadedCluts.Remove(texture.UserClutId))
+                    report.ClutSizeAfter += GetClutSize(texture);
+            }
+
+            return report;
+        }
+
+        private List<PaletteGroup> BuildGroups(IEnumerable<Candidate> candidates, int paletteColorCount)
+        {
+            var groups = new List<PaletteGroup>();
+            foreach (var candidate in candidates)
+            {
+                // Join the group that accommodates the texture with the least error
+                PaletteGroup bestGroup = null;
+                PaletteGroup bestTrial = null;
+                var bestError = float.MaxValue;
+                foreach (var group in groups)
+                {
+                    var trial = CreateGroup(group, candidate, paletteColorCount);
+                    var maxError = trial.Errors.Max();
+                    if (maxError <= MaxError && maxError < bestError)
+                    {
+                        bestGroup = group;
+                        bestTrial = trial;
+                        bestError = maxError;
+                    }
+                }
+
+                if (bestGroup != null)
+                {
+                    groups[groups.IndexOf(bestGroup)] = bestTrial;
+                }
+                else if (groups.Count < MaxPaletteCount)
+                {
+                    var group = CreateGroup(null, candidate, paletteColorCount);
+                    if (group.Errors[0] <= MaxError)
+                        groups.Add(group);
+                }
+            }
+
+            return groups;
+        }
+
+        /// <summary>
+        /// Creates a group of the members of an existing group and a new member, with a palette quantized from their merged histograms.
+        /// </summary>
+        private static PaletteGroup CreateGroup(PaletteGroup baseGroup, Candidate candidate, int paletteColorCount)
+        {
+            var group = new PaletteGroup();
+            if (baseGroup != null)
+            {
+                group.Members.AddRange(baseGroup.Members);
+                foreach (var entry in baseGroup.Histogram)
+                    group.Histogram.Add(entry.Key, entry.Value);
+            }
+
+            group.Members.Add(candidate);
+            var palette = candidate.Texture.Palettes[0];
+            for (int i = 0; i < candidate.Counts.Length; i++)
+            {
+                if (candidate.Counts[i] == 0)
+                    continue;
+
+                group.Histogram.TryGetValue(palette[i], out var count);
+                group.Histogram[palette[i]] = count + candidate.Counts[i];
+            }
+
+            var colors = new Color[group.Histogram.Count];
+            var counts = new int[colors.Length];
+            var colorIndex = 0;
+            foreach (var entry in group.Histogram)
+            {
+                colors[colorIndex] = entry.Key;
+                counts[colorIndex++] = entry.Value;
+            }
+
+            BitmapHelper.QuantizeHistogram(colors, counts, paletteColorCount, out var indices, out group.Palette);
+            group.PaletteIndices = new Dictionary<Color, byte>(colors.Length);
+            for (int i = 0; i < colors.Length; i++)
+                group.PaletteIndices[colors[i]] = indices[i];
+
+            group.Errors = new float[group.Members.Count];
+            for (int i = 0; i < group.Members.Count; i++)
+                group.Errors[i] = CalculateError(group.Members[i], group);
+
+            return group;
+        }
+
+        private static float CalculateError(Candidate candidate, PaletteGroup group)
+        {
+            var palette = candidate.Texture.Palettes[0];
+            double sum = 0;
+            for (int i = 0; i < candidate.Counts.Length; i++)
+            {
+                if (candidate.Counts[i] == 0)
+                    continue;
+
+                var a = palette[i];
+                var b = group.Palette[group.PaletteIndices[a]];
+                var dr = a.R - b.R;
+                var dg = a.G - b.G;
+                var db = a.B - b.B;
+                var da = a.A - b.A;
+                sum += (double)(dr * dr + dg * dg + db * db + da * da) * candidate.Counts[i];
+            }
+
+            return candidate.PixelCount == 0 ? 0 : (float)Math.Sqrt(sum / (candidate.PixelCount * 4.0));
+        }
+
+        private static List<byte[]> RemapIndices(Texture texture, Dictionary<Color, byte> paletteIndices)
+        {
+            // Unused palette colors aren't part of the histogram, and no pixel refers to them
+            var palette = texture.Palettes[0];
+            var remap = new byte[palette.Length];
+            for (int i = 0; i < palette.Length; i++)
+            {
+                if (paletteIndices.TryGetValue(palette[i], out var index))
+                    remap[i] = index;
+            }
+
+            var pixelIndices = new List<byte[]>(texture.PixelIndices.Count);
+            foreach (var levelIndices in texture.PixelIndices)
+            {
+                var newLevelIndices = new byte[levelIndices.Length];
+                for (int i = 0; i < newLevelIndices.Length; i++)
+                    newLevelIndices[i] = remap[levelIndices[i]];
+
+                pixelIndices.Add(newLevelIndices);
+            }
+
+            return pixelIndices;
+        }
+
+        private static bool IsCandidate(Texture texture)
+        {
+            return texture.IsIndexed && texture.PaletteCount == 1 && texture.PaletteFormat == GSPixelFormat.PSMTC32;
+        }
+
+        private static Candidate CreateCandidate(int textureIndex, Texture texture)
+        {
+            // Colors stay in the GS alpha range, which is also what the shared palette is stored in
+            var counts = new int[texture.Palettes[0].Length];
+            var pixelCount = 0;
+            foreach (var levelIndices in texture.PixelIndices)
+            {
+                for (int i = 0; i < levelIndices.Length; i++)
+                    counts[levelIndices[i]]++;
+
+                pixelCount += levelIndices.Length;
+            }
+
+            return new Candidate { TextureIndex = textureIndex, Texture = texture, Counts = counts, PixelCount = pixelCount };
+        }
+
+        private static long GetClutSize(Texture texture)
+        {
+            if (!texture.IsIndexed)
+                return 0;
+
+            return texture.PaletteCount * texture.PaletteColorCount * (GSPixelFormatHelper.GetPixelFormatDepth(texture.PaletteFormat) / 8);
+        }
+    }
+}
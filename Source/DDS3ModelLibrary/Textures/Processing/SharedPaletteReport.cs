@@ -0,0 +1,59 @@
+﻿using System.Collections.Generic;
+
+namespace DDS3ModelLibrary.Textures.Processing
+{
+    /// <summary>
+    /// Describes the outcome of quantizing a texture pack with shared palettes.
+    /// </summary>
+    public class SharedPaletteReport
+    {
+        /// <summary>
+        /// Describes a texture that was requantized to a shared palette.
+        /// </summary>
+        public class TextureResult
+        {
+            public int TextureIndex { get; }
+
+            public int ClutId { get; }
+
+            /// <summary>
+            /// Gets the root mean square error per color channel of the requantized texture.
+            /// </summary>
+            public float Error { get; }
+
+            internal TextureResult(int textureIndex, int clutId, float error)
+            {
+                TextureIndex = textureIndex;
+                ClutId = clutId;
+                Error = error;
+            }
+
+            public override string ToString()
+            {
+                return $"Texture {TextureIndex}: CLUT {ClutId}, error {Error:F2}";
+            }
+        }
+
+        public List<TextureResult> Textures { get; } = new List<TextureResult>();
+
+        public int SharedPaletteCount { get; internal set; }
+
+        /// <summary>
+        /// Gets the number of CLUT bytes uploaded to the GS for all textures before quantization.
+        /// </summary>
+        public long ClutSizeBefore { get; internal set; }
+
+        /// <summary>
+        /// Gets the number of CLUT bytes uploaded to the GS for all textures after quantization, counting each shared CLUT once.
+        /// </summary>
+        public long ClutSizeAfter { get; internal set; }
+
+        public long ClutBytesSaved => ClutSizeBefore - ClutSizeAfter;
+
+        public override string ToString()
+        {
+            return $"{Textures.Count} textures share {SharedPaletteCount} palettes, " +
+                   $"CLUT size: {ClutSizeBefore} -> {ClutSizeAfter} bytes ({ClutBytesSaved} saved)";
+        }
+    }
+}
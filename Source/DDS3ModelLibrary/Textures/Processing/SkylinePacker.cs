@@ -0,0 +1,143 @@
+﻿using System.Collections.Generic;
+
+namespace DDS3ModelLibrary.Textures.Processing
+{
+    /// <summary>
+    /// Bottom-left skyline rectangle packer used to lay out sub-images on a fixed size page.
+    /// </summary>
+    internal class SkylinePacker
+    {
+        private struct SkylineNode
+        {
+            public int X;
+            public int Y;
+            public int Width;
+
+            public SkylineNode(int x, int y, int width)
+            {
+                X = x;
+                Y = y;
+                Width = width;
+            }
+        }
+
+        private readonly List<SkylineNode> mSkyline;
+
+        public int Width { get; }
+
+        public int Height { get; }
+
+        /// <summary>
+        /// Gets the right-most edge of all packed rectangles.
+        /// </summary>
+        public int UsedWidth { get; private set; }
+
+        /// <summary>
+        /// Gets the bottom-most edge of all packed rectangles.
+        /// </summary>
+        public int UsedHeight { get; private set; }
+
+        public SkylinePacker(int width, int height)
+        {
+            Width = width;
+            Height = height;
+            mSkyline = new List<SkylineNode> { new SkylineNode(0, 0, width) };
+        }
+
+        /// <summary>
+        /// Attempts to find a place for a rectangle of the given size. The packer is only modified on success.
+        /// </summary>
+        public bool TryPack(int width, int height, out int x, out int y)
+        {
+            var bestIndex = -1;
+            var bestBottom = int.MaxValue;
+            var bestWidth = int.MaxValue;
+            x = y = 0;
+
+            for (int i = 0; i < mSkyline.Count; i++)
+            {
+                if (!TryFit(i, width, height, out var fitY))
+                    continue;
+
+                var bottom = fitY + height;
+                if (bottom < bestBottom || (bottom == bestBottom && mSkyline[i].Width < bestWidth))
+                {
+                    bestIndex = i;
+                    bestBottom = bottom;
+                    bestWidth = mSkyline[i].Width;
+                    x = mSkyline[i].X;
+                    y = fitY;
+                }
+            }
+
+            if (bestIndex == -1)
+                return false;
+
+            Insert(bestIndex, x, y, width, height);
+            if (x + width > UsedWidth) UsedWidth = x + width;
+            if (y + height > UsedHeight) UsedHeight = y + height;
+            return true;
+        }
+
+        private bool TryFit(int index, int width, int height, out int y)
+        {
+            var x = mSkyline[index].X;
+            y = 0;
+
+            if (x + width > Width)
+                return false;
+
+            var remaining = width;
+            for (int i = index; remaining > 0; i++)
+            {
+                if (mSkyline[i].Y > y)
+                    y = mSkyline[i].Y;
+
+                if (y + height > Height)
+                    return false;
+
+                remaining -= mSkyline[i].Width;
+            }
+
+            return true;
+        }
+
+        private void Insert(int index, int x, int y, int width, int height)
+        {
+            mSkyline.Insert(index, new SkylineNode(x, y + height, width));
+
+            // Shrink or remove the nodes now covered by the new node
+            for (int i = index + 1; i < mSkyline.Count; i++)
+            {
+                var previous = mSkyline[i - 1];
+                var node = mSkyline[i];
+                var overlap = previous.X + previous.Width - node.X;
+                if (overlap <= 0)
+                    break;
+
+                node.X += overlap;
+                node.Width -= overlap;
+                if (node.Width > 0)
+                {
+                    mSkyline[i] = node;
+                    break;
+                }
+
+                mSkyline.RemoveAt(i--);
+            }
+
+            // Merge neighbouring nodes at the same height
+            for (int i = 0; i < mSkyline.Count - 1; i++)
+            {
+                if (mSkyline[i].Y != mSkyline[i + 1].Y)
+                    continue;
+
+                var node = mSkyline[i];
+                node.Width += mSkyline[i + 1].Width;
+                mSkyline[i] = node;
+                mSkyline.RemoveAt(i + 1);
+                i--;
+            }
+        }
+    }
+}
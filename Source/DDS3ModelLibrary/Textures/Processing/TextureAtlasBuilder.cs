@@ -0,0 +1,442 @@
+﻿using DDS3ModelLibrary.Models;
+using DDS3ModelLibrary.Models.Field;
+using DDS3ModelLibrary.PS2.GS;
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Numerics;
+using Color = DDS3ModelLibrary.Models.Color;
+
+namespace DDS3ModelLibrary.Textures.Processing
+{
+    /// <summary>
+    /// Packs small indexed textures used by a field scene into shared PSMT8 pages to reduce the number of GS texture switches.
+    /// Only textures that don't repeat and are sampled within the unit square are packed, as repeating would sample the neighbouring textures.
+    /// </summary>
+    public class TextureAtlasBuilder
+    {
+        private const float UV_EPSILON = 0.001f;
+
+        private class TextureUsage
+        {
+            public readonly HashSet<Vector2[]> TexCoords = new HashSet<Vector2[]>();
+            public bool IsReferenced;
+            public bool IsRewritable = true;
+        }
+
+        private class AtlasEntry
+        {
+            public int TextureIndex;
+            public Texture Texture;
+            public byte[] IndexRemap;
+            public int X;
+            public int Y;
+        }
+
+        private class AtlasPage
+        {
+            public SkylinePacker Packer;
+            public readonly List<Color> Palette = new List<Color>(256);
+            public readonly Dictionary<Color, int> PaletteLookup = new Dictionary<Color, int>();
+            public readonly List<AtlasEntry> Entries = new List<AtlasEntry>();
+        }
+
+        /// <summary>
+        /// Gets or sets the maximum width of a page.
+        /// </summary>
+        public int PageWidth { get; set; } = 256;
+
+        /// <summary>
+        /// Gets or sets the maximum height of a page.
+        /// </summary>
+        public int PageHeight { get; set; } = 256;
+
+        /// <summary>
+        /// Gets or sets the maximum width of a texture to be considered for packing.
+        /// </summary>
+        public int MaxTextureWidth { get; set; } = 64;
+
+        /// <summary>
+        /// Gets or sets the maximum height of a texture to be considered for packing.
+        /// </summary>
+        public int MaxTextureHeight { get; set; } = 64;
+
+        /// <summary>
+        /// Gets or sets the number of gutter texels added around each packed texture to avoid filtering bleed.
+        /// The gutter repeats the edge texels of the texture.
+        /// </summary>
+        public int Padding { get; set; } = 2;
+
+        /// <summary>
+        /// Gets or sets the maximum root mean square error per color channel that is allowed when a texture's colors
+        /// have to be approximated by an already full page palette.
+        /// </summary>
+        public float MaxPaletteError { get; set; } = 2f;
+
+        /// <summary>
+        /// Packs the textures referenced by the models in the scene into atlas pages, and rewrites the texture coordinates
+        /// and texture ids of the affected meshes and materials. The texture pack is assumed to be used by this scene only.
+        /// </summary>
+        /// <param name="scene">The scene whose models reference the textures.</param>
+        /// <param name="textures">The texture pack used by the scene. It is modified in place.</param>
+        /// <returns>A report describing the reduction in texture count and upload size.</returns>
+        public TextureAtlasReport Build(FieldScene scene, TexturePack textures)
+        {
+            var report = new TextureAtlasReport
+            {
+                TextureCountBefore = textures.Count,
+                UploadSizeBefore = textures.Sum(x => (long)EstimateUploadSize(x))
+            };
+
+            var models = scene.Objects.Select(x => x.Resource).OfType<Model>().Distinct().ToList();
+            var usages = CollectUsages(models, textures.Count);
+
+            // Place the largest textures first for a tighter packing
+            var candidates = Enumerable.Range(0, textures.Count)
+                                       .Where(x => IsCandidate(textures[x], usages[x]))
+                                       .OrderByDescending(x => Math.Max(textures[x].Width, textures[x].Height))
+                                       .ThenByDescending(x => textures[x].Width * textures[x].Height)
+                                       .ThenBy(x => x)
+                                       .ToList();
+
+            var pages = new List<AtlasPage>();
+            foreach (var index in candidates)
+            {
+                var placed = false;
+                foreach (var page in pages)
+                {
+                    if (TryAddToPage(page, index, textures[index]))
+                    {
+                        placed = true;
+                        break;
+                    }
+                }
+
+                if (!placed)
+                {
+                    var page = new AtlasPage { Packer = new SkylinePacker(PageWidth, PageHeight) };
+                    if (TryAddToPage(page, index, textures[index]))
+                        pages.Add(page);
+                }
+            }
+
+            // A page holding a single texture saves nothing
+            pages.RemoveAll(x => x.Entries.Count < 2);
+
+            var isAtlased = new bool[textures.Count];
+            foreach (var entry in pages.SelectMany(x => x.Entries))
+                isAtlased[entry.TextureIndex] = true;
+
+            var textureIdRemap = new int[textures.Count];
+            var newTextures = new List<Texture>();
+            for (int i = 0; i < textures.Count; i++)
+            {
+                if (isAtlased[i])
+                    continue;
+
+                textureIdRemap[i] = newTextures.Count;
+                newTextures.Add(textures[i]);
+            }
+
+            foreach (var page in pages)
+            {
+                var pageTextureId = newTextures.Count;
+                var pageTexture = CreatePageTexture(page, $"atlas_{pages.IndexOf(page):D2}");
+                newTextures.Add(pageTexture);
+
+                foreach (var entry in page.Entries)
+                {
+                    textureIdRemap[entry.TextureIndex] = pageTextureId;
+                    RemapTexCoords(usages[entry.TextureIndex], entry, pageTexture.Width, pageTexture.Height);
+                }
+            }
+
+            foreach (var material in models.SelectMany(x => x.Materials))
+            {
+                if (material.TextureId.HasValue && material.TextureId.Value < textureIdRemap.Length)
+                    material.TextureId = textureIdRemap[material.TextureId.Value];
+
+                if (material.OverlayTextureIds != null)
+                {
+                    material.OverlayTextureIds = material.OverlayTextureIds
+                                                         .Select(x => x >= 0 && x < textureIdRemap.Length ? (short)textureIdRemap[x] : x)
+                                                         .ToArray();
+                }
+            }
+
+            textures.Clear();
+            foreach (var texture in newTextures)
+                textures.Add(texture);
+
+            report.TextureCountAfter = textures.Count;
+            report.UploadSizeAfter = textures.Sum(x => (long)EstimateUploadSize(x));
+            report.PageCount = pages.Count;
+            report.AtlasedTextureCount = isAtlased.Count(x => x);
+            return report;
+        }
+
+        /// <summary>
+        /// Estimates the number of bytes that have to be uploaded to the GS for the texture, including mipmaps and palettes.
+        /// </summary>
+        internal static int EstimateUploadSize(Texture texture)
+        {
+            var size = 0;
+            for (int i = 0; i <= texture.MipMapCount; i++)
+            {
+                size += GSPixelFormatHelper.GetTexelDataSize(texture.PixelFormat, Texture.GetMipDimension(texture.Width, i),
+                                                            Texture.GetMipDimension(texture.Height, i));
+            }
+
+            if (texture.IsIndexed)
+                size += texture.PaletteCount * texture.PaletteColorCount * (GSPixelFormatHelper.GetPixelFormatDepth(texture.PaletteFormat) / 8);
+
+            return size;
+        }
+
+        private static TextureUsage[] CollectUsages(List<Model> models, int textureCount)
+        {
+            var usages = new TextureUsage[textureCount];
+            for (int i = 0; i < usages.Length; i++)
+                usages[i] = new TextureUsage();
+
+            foreach (var model in models)
+            {
+                foreach (var node in model.Nodes)
+                {
+                    if (node.Geometry == null)
+                        continue;
+
+                    foreach (var meshList in node.Geometry.MeshLists)
+                    {
+                        if (meshList == null)
+                            continue;
+
+                        foreach (var mesh in meshList)
+                        {
+                            if (mesh.MaterialIndex < 0 || mesh.MaterialIndex >= model.Materials.Count)
+                                continue;
+
+                            var textureId = model.Materials[mesh.MaterialIndex].TextureId;
+                            if (!textureId.HasValue || textureId.Value < 0 || textureId.Value >= textureCount)
+                                continue;
+
+                            var usage = usages[textureId.Value];
+                            usage.IsReferenced = true;
+                            if (!TryCollectTexCoords(mesh, usage.TexCoords))
+                                usage.IsRewritable = false;
+                        }
+                    }
+                }
+
+                // Overlay textures are sampled with the secondary texture coordinates, which we don't rewrite
+                foreach (var material in model.Materials.Where(x => x.OverlayTextureIds != null))
+                {
+                    foreach (var id in material.OverlayTextureIds)
+                    {
+                        if (id >= 0 && id < textureCount)
+                            usages[id].IsRewritable = false;
+                    }
+                }
+            }
+
+            return usages;
+        }
+
+        private static bool TryCollectTexCoords(Mesh mesh, HashSet<Vector2[]> texCoords)
+        {
+            switch (mesh)
+            {
+                case MeshType1 mesh1:
+                    texCoords.UnionWith(mesh1.Batches.Where(x => x.TexCoords != null).Select(x => x.TexCoords));
+                    return true;
+                case MeshType2 mesh2:
+                    texCoords.UnionWith(mesh2.Batches.Where(x => x.TexCoords != null).Select(x => x.TexCoords));
+                    return true;
+                case MeshType4 _:
+                    return true;
+                case MeshType5 mesh5:
+                    if (mesh5.TexCoords != null) texCoords.Add(mesh5.TexCoords);
+                    return true;
+                case MeshType7 mesh7:
+                    texCoords.UnionWith(mesh7.Batches.Where(x => x.TexCoords != null).Select(x => x.TexCoords));
+                    return true;
+                case MeshType8 mesh8:
+                    texCoords.UnionWith(mesh8.Batches.Where(x => x.TexCoords != null).Select(x => x.TexCoords));
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        private bool IsCandidate(Texture texture, TextureUsage usage)
+        {
+            if (!usage.IsReferenced || !usage.IsRewritable)
+                return false;
+
+            if (!texture.IsIndexed || texture.PaletteCount != 1 || texture.MipMapCount != 0)
+                return false;
+
+            // The page is clamped, so repeating textures can't keep their wrap mode. Textures with the default wrap mode are
+            // packed, as the coordinate check below makes sure they're never wrapped and the gutters extrude their edges
+            if (texture.WrapModeX == TextureWrapMode.Repeat || texture.WrapModeY == TextureWrapMode.Repeat)
+                return false;
+
+            if (texture.Width > MaxTextureWidth || texture.Height > MaxTextureHeight ||
+                 texture.Width + Padding * 2 > PageWidth || texture.Height + Padding * 2 > PageHeight)
+                return false;
+
+            // Coordinates outside of the unit square would sample neighbouring textures on the page instead of
+            // repeating or clamping, so only textures that are never sampled outside of it can be packed
+            foreach (var texCoords in usage.TexCoords)
+            {
+                foreach (var uv in texCoords)
+                {
+                    if (uv.X < -UV_EPSILON || uv.X > 1 + UV_EPSILON || uv.Y < -UV_EPSILON || uv.Y > 1 + UV_EPSILON)
+                        return false;
+                }
+            }
+
+            return true;
+        }
+
+        private bool TryAddToPage(AtlasPage page, int textureIndex, Texture texture)
+        {
+            var palette = texture.Palettes[0];
+            var indices = texture.PixelIndices[0];
+
+            var histogram = new int[256];
+            foreach (var index in indices)
+                histogram[index]++;
+
+            // Map the colors used by the texture onto the page palette, adding new colors while there is room
+            var remap = new byte[256];
+            var newColors = new List<Color>();
+            var newColorLookup = new Dictionary<Color, int>();
+            long error = 0;
+            for (int i = 0; i < histogram.Length; i++)
+            {
+                if (histogram[i] == 0)
+                    continue;
+
+                var color = palette[i];
+                if (page.PaletteLookup.TryGetValue(color, out var pageIndex) || newColorLookup.TryGetValue(color, out pageIndex))
+                {
+                    remap[i] = (byte)pageIndex;
+                }
+                else if (page.Palette.Count + newColors.Count < 256)
+                {
+                    pageIndex = page.Palette.Count + newColors.Count;
+                    newColors.Add(color);
+                    newColorLookup[color] = pageIndex;
+                    remap[i] = (byte)pageIndex;
+                }
+                else
+                {
+                    pageIndex = FindNearestColor(page.Palette, newColors, color, out var distance);
+                    remap[i] = (byte)pageIndex;
+                    error += (long)distance * histogram[i];
+                }
+            }
+
+            var rmsError = Math.Sqrt(error / (indices.Length * 4.0));
+            if (rmsError > MaxPaletteError)
+                return false;
+
+            if (!page.Packer.TryPack(texture.Width + Padding * 2, texture.Height + Padding * 2, out var x, out var y))
+                return false;
+
+            foreach (var color in newColors)
+            {
+                page.PaletteLookup[color] = page.Palette.Count;
+                page.Palette.Add(color);
+            }
+
+            page.Entries.Add(new AtlasEntry { TextureIndex = textureIndex, Texture = texture, IndexRemap = remap, X = x, Y = y });
+            return true;
+        }
+
+        private static int FindNearestColor(List<Color> palette, List<Color> newColors, Color color, out int distance)
+        {
+            var bestIndex = 0;
+            distance = int.MaxValue;
+            for (int i = 0; i < palette.Count + newColors.Count; i++)
+            {
+                var other = i < palette.Count ? palette[i] : newColors[i - palette.Count];
+                var dr = color.R - other.R;
+                var dg = color.G - other.G;
+                var db = color.B - other.B;
+                var da = color.A - other.A;
+                var d = dr * dr + dg * dg + db * db + da * da;
+                if (d < distance)
+                {
+                    distance = d;
+                    bestIndex = i;
+                }
+            }
+
+            return bestIndex;
+        }
+
+        private Texture CreatePageTexture(AtlasPage page, string comment)
+        {
+            var width = NextPowerOfTwo(Math.Max(page.Packer.UsedWidth, 16));
+            var height = NextPowerOfTwo(Math.Max(page.Packer.UsedHeight, 16));
+            var indices = new byte[width * height];
+
+            foreach (var entry in page.Entries)
+            {
+                var texture = entry.Texture;
+                var sourceIndices = texture.PixelIndices[0];
+
+                // Extrude the edges into the gutter, so filtering at the edges matches the clamped texture
+                for (int y = -Padding; y < texture.Height + Padding; y++)
+                {
+                    var sourceY = ClampCoordinate(y, texture.Height);
+                    var destY = entry.Y + Padding + y;
+
+                    for (int x = -Padding; x < texture.Width + Padding; x++)
+                    {
+                        var sourceX = ClampCoordinate(x, texture.Width);
+                        var destX = entry.X + Padding + x;
+                        indices[destX + destY * width] = entry.IndexRemap[sourceIndices[sourceX + sourceY * texture.Width]];
+                    }
+                }
+            }
+
+            var palette = new Color[256];
+            page.Palette.CopyTo(palette);
+
+            return new Texture(width, height, palette, indices, GSPixelFormat.PSMT8, comment)
+            {
+                WrapModeX = TextureWrapMode.Clamp,
+                WrapModeY = TextureWrapMode.Clamp
+            };
+        }
+
+        private void RemapTexCoords(TextureUsage usage, AtlasEntry entry, int pageWidth, int pageHeight)
+        {
+            var offset = new Vector2((float)(entry.X + Padding) / pageWidth, (float)(entry.Y + Padding) / pageHeight);
+            var scale = new Vector2((float)entry.Texture.Width / pageWidth, (float)entry.Texture.Height / pageHeight);
+
+            foreach (var texCoords in usage.TexCoords)
+            {
+                for (int i = 0; i < texCoords.Length; i++)
+                    texCoords[i] = offset + Vector2.Clamp(texCoords[i], Vector2.Zero, Vector2.One) * scale;
+            }
+        }
+
+        private static int ClampCoordinate(int value, int size)
+        {
+            return Math.Min(Math.Max(value, 0), size - 1);
+        }
+
+        private static int NextPowerOfTwo(int value)
+        {
+            var result = 1;
+            while (result < value)
+                result <<= 1;
+
+            return result;
+        }
+    }
+}
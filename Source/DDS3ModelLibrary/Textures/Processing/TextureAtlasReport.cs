@@ -0,0 +1,32 @@
+﻿namespace DDS3ModelLibrary.Textures.Processing
+{
+    /// <summary>
+    /// Describes the outcome of building texture atlases for a scene.
+    /// </summary>
+    public class TextureAtlasReport
+    {
+        public int TextureCountBefore { get; internal set; }
+
+        public int TextureCountAfter { get; internal set; }
+
+        /// <summary>
+        /// Gets the estimated number of bytes uploaded to the GS for all textures before atlasing.
+        /// </summary>
+        public long UploadSizeBefore { get; internal set; }
+
+        /// <summary>
+        /// Gets the estimated number of bytes uploaded to the GS for all textures after atlasing.
+        /// </summary>
+        public long UploadSizeAfter { get; internal set; }
+
+        public int PageCount { get; internal set; }
+
+        public int AtlasedTextureCount { get; internal set; }
+
+        public override string ToString()
+        {
+            return $"Textures: {TextureCountBefore} -> {TextureCountAfter} ({AtlasedTextureCount} packed into {PageCount} pages), " +
+                   $"upload size: {UploadSizeBefore} -> {UploadSizeAfter} bytes";
+        }
+    }
+}
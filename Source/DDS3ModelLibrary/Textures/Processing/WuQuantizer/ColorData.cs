@@ -17,6 +17,7 @@ namespace DDS3ModelLibrary.Textures.Processing.WuQuantizer
             pixelsCount = bitmapWidth * bitmapHeight;
             pixels = new Pixel[pixelsCount];
             quantizedPixels = new int[pixelsCount];
+            pixelWeights = new int[pixelsCount];
         }
 
         public long[,,,] Weights { get; private set; }
@@ -28,16 +29,19 @@ namespace DDS3ModelLibrary.Textures.Processing.WuQuantizer
 
         public IList<int> QuantizedPixels { get { return quantizedPixels; } }
         public IList<Pixel> Pixels { get { return pixels; } }
+        public IList<int> PixelWeights { get { return pixelWeights; } }
 
         public int PixelsCount { get { return pixels.Length; } }
-        public void AddPixel(Pixel pixel, int quantizedPixel)
+        public void AddPixel(Pixel pixel, int quantizedPixel, int weight)
         {
             pixels[pixelFillingCounter] = pixel;
+            pixelWeights[pixelFillingCounter] = weight;
             quantizedPixels[pixelFillingCounter++] = quantizedPixel;
         }
 
         private Pixel[] pixels;
         private int[] quantizedPixels;
+        private int[] pixelWeights;
         private int pixelsCount;
         private int pixelFillingCounter;
     }
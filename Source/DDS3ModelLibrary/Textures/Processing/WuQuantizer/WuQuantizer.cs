@@ -18,14 +18,15 @@ namespace DDS3ModelLibrary.Textures.Processing.WuQuantizer
                 quantizedPixels[index] = lookups.Tags[indexParts[Alpha], indexParts[Red], indexParts[Green], indexParts[Blue]];
             }
 
-            var alphas = new int[colorCount + 1];
-            var reds = new int[colorCount + 1];
-            var greens = new int[colorCount + 1];
-            var blues = new int[colorCount + 1];
-            var sums = new int[colorCount + 1];
+            var alphas = new long[colorCount + 1];
+            var reds = new long[colorCount + 1];
+            var greens = new long[colorCount + 1];
+            var blues = new long[colorCount + 1];
+            var sums = new long[colorCount + 1];
             var palette = new QuantizedPalette(imageSize);
 
             IList<Pixel> pixels = data.Pixels;
+            IList<int> pixelWeights = data.PixelWeights;
             int pixelsCount = data.PixelsCount;
             IList<Lookup> lookupsList = lookups.Lookups;
             int lookupsCount = lookupsList.Count;
@@ -68,11 +69,12 @@ namespace DDS3ModelLibrary.Textures.Processing.WuQuantizer
                     cachedMaches[argb] = bestMatch;
                 }
 
-                alphas[bestMatch] += pixel.Alpha;
-                reds[bestMatch] += pixel.Red;
-                greens[bestMatch] += pixel.Green;
-                blues[bestMatch] += pixel.Blue;
-                sums[bestMatch]++;
+                var weight = pixelWeights[pixelIndex];
+                alphas[bestMatch] += pixel.Alpha * (long)weight;
+                reds[bestMatch] += pixel.Red * (long)weight;
+                greens[bestMatch] += pixel.Green * (long)weight;
+                blues[bestMatch] += pixel.Blue * (long)weight;
+                sums[bestMatch] += weight;
 
                 palette.PixelIndex[pixelIndex] = bestMatch;
             }
@@ -87,7 +89,7 @@ namespace DDS3ModelLibrary.Textures.Processing.WuQuantizer
                     blues[paletteIndex] /= sums[paletteIndex];
                 }
 
-                var color = Color.FromArgb(alphas[paletteIndex], reds[paletteIndex], greens[paletteIndex], blues[paletteIndex]);
+                var color = Color.FromArgb((int)alphas[paletteIndex], (int)reds[paletteIndex], (int)greens[paletteIndex], (int)blues[paletteIndex]);
                 palette.Colors.Add(color);
             }
 
@@ -4,6 +4,7 @@ using System.Drawing;
 using System.Drawing.Imaging;
 using System.Linq;
 using System.Runtime.InteropServices;
+using ModelColor = DDS3ModelLibrary.Models.Color;
 
 namespace DDS3ModelLibrary.Textures.Processing.WuQuantizer
 {
@@ -47,6 +48,32 @@ namespace DDS3ModelLibrary.Textures.Processing.WuQuantizer
             return ProcessImagePixels(image, palette);
         }
 
+        /// <summary>
+        /// Quantizes the given pixels without going through <see cref="Bitmap"/>.
+        /// Transparent pixels below the alpha threshold are assigned an index of -1.
+        /// </summary>
+        public QuantizedPalette QuantizePixels(ReadOnlySpan<ModelColor> pixels, int maxColorCount, int alphaThreshold, int alphaFader)
+        {
+            var colorCount = maxColorCount;
+            var data = BuildHistogram(pixels, alphaThreshold, alphaFader);
+            data = CalculateMoments(data);
+            var cubes = SplitData(ref colorCount, data);
+            return GetQuantizedPalette(colorCount, data, cubes, alphaThreshold);
+        }
+
+        /// <summary>
+        /// Quantizes a histogram of distinct colors, each weighted by the number of pixels that use it.
+        /// The resulting pixel indices map each histogram color to its palette color.
+        /// </summary>
+        public QuantizedPalette QuantizeHistogram(ReadOnlySpan<ModelColor> colors, ReadOnlySpan<int> counts, int maxColorCount, int alphaThreshold, int alphaFader)
+        {
+            var colorCount = maxColorCount;
+            var data = BuildHistogram(colors, counts, alphaThreshold, alphaFader);
+            data = CalculateMoments(data);
+            var cubes = SplitData(ref colorCount, data);
+            return GetQuantizedPalette(colorCount, data, cubes, alphaThreshold);
+        }
+
         private static Bitmap ProcessImagePixels(Image sourceImage, QuantizedPalette palette)
         {
             var result = new Bitmap(sourceImage.Width, sourceImage.Height, PixelFormat.Format8bppIndexed);
@@ -132,34 +159,7 @@ namespace DDS3ModelLibrary.Textures.Processing.WuQuantizer
                         for (var valueIndex = 0; valueIndex < byteCount; valueIndex++)
                             value[valueIndex] = buffer[offset + valueIndex + indexOffset];
 
-                        var indexAlpha = (byte)((value[Alpha] >> 3) + 1);
-                        var indexRed = (byte)((value[Red] >> 3) + 1);
-                        var indexGreen = (byte)((value[Green] >> 3) + 1);
-                        var indexBlue = (byte)((value[Blue] >> 3) + 1);
-
-                        if (value[Alpha] > alphaThreshold)
-                        {
-                            if (value[Alpha] < 255)
-                            {
-                                var alpha = value[Alpha] + (value[Alpha] % alphaFader);
-                                value[Alpha] = (byte)(alpha > 255 ? 255 : alpha);
-                                indexAlpha = (byte)((value[Alpha] >> 3) + 1);
-                            }
-
-                            colorData.Weights[indexAlpha, indexRed, indexGreen, indexBlue]++;
-                            colorData.MomentsRed[indexAlpha, indexRed, indexGreen, indexBlue] += value[Red];
-                            colorData.MomentsGreen[indexAlpha, indexRed, indexGreen, indexBlue] += value[Green];
-                            colorData.MomentsBlue[indexAlpha, indexRed, indexGreen, indexBlue] += value[Blue];
-                            colorData.MomentsAlpha[indexAlpha, indexRed, indexGreen, indexBlue] += value[Alpha];
-                            colorData.Moments[indexAlpha, indexRed, indexGreen, indexBlue] += (value[Alpha] * value[Alpha]) +
-                                                                                              (value[Red] * value[Red]) +
-                                                                                              (value[Green] * value[Green]) +
-                                                                                              (value[Blue] * value[Blue]);
-                        }
-
-                        colorData.AddPixel(
-                            new Pixel(value[Alpha], value[Red], value[Green], value[Blue]),
-                            BitConverter.ToInt32(new[] { indexAlpha, indexRed, indexGreen, indexBlue }, 0));
+                        AddHistogramPixel(colorData, value[Alpha], value[Red], value[Green], value[Blue], alphaThreshold, alphaFader, 1);
                         index += bitDepth;
                     }
 
@@ -173,6 +173,64 @@ namespace DDS3ModelLibrary.Textures.Processing.WuQuantizer
             return colorData;
         }
 
+        private static ColorData BuildHistogram(ReadOnlySpan<ModelColor> pixels, int alphaThreshold, int alphaFader)
+        {
+            var colorData = new ColorData(MaxSideIndex, pixels.Length, 1);
+            for (int i = 0; i < pixels.Length; i++)
+            {
+                var pixel = pixels[i];
+                AddHistogramPixel(colorData, pixel.A, pixel.R, pixel.G, pixel.B, alphaThreshold, alphaFader, 1);
+            }
+
+            return colorData;
+        }
+
+        private static ColorData BuildHistogram(ReadOnlySpan<ModelColor> colors, ReadOnlySpan<int> counts, int alphaThreshold, int alphaFader)
+        {
+            var colorData = new ColorData(MaxSideIndex, colors.Length, 1);
+            for (int i = 0; i < colors.Length; i++)
+            {
+                var color = colors[i];
+                AddHistogramPixel(colorData, color.A, color.R, color.G, color.B, alphaThreshold, alphaFader, counts[i]);
+            }
+
+            return colorData;
+        }
+
+        private static void AddHistogramPixel(ColorData colorData, byte alpha, byte red, byte green, byte blue, int alphaThreshold, int alphaFader, int weight)
+        {
+            var indexAlpha = (byte)((alpha >> 3) + 1);
+            var indexRed = (byte)((red >> 3) + 1);
+            var indexGreen = (byte)((green >> 3) + 1);
+            var indexBlue = (byte)((blue >> 3) + 1);
+
+            if (alpha > alphaThreshold)
+            {
+                if (alpha < 255)
+                {
+                    var fadedAlpha = alpha + (alpha % alphaFader);
+                    alpha = (byte)(fadedAlpha > 255 ? 255 : fadedAlpha);
+                    indexAlpha = (byte)((alpha >> 3) + 1);
+                }
+
+                colorData.Weights[indexAlpha, indexRed, indexGreen, indexBlue] += weight;
+                colorData.MomentsRed[indexAlpha, indexRed, indexGreen, indexBlue] += red * (long)weight;
+                colorData.MomentsGreen[indexAlpha, indexRed, indexGreen, indexBlue] += green * (long)weight;
+                colorData.MomentsBlue[indexAlpha, indexRed, indexGreen, indexBlue] += blue * (long)weight;
+                colorData.MomentsAlpha[indexAlpha, indexRed, indexGreen, indexBlue] += alpha * (long)weight;
+                colorData.Moments[indexAlpha, indexRed, indexGreen, indexBlue] += ((alpha * alpha) +
+                                                                                   (red * red) +
+                                                                                   (green * green) +
+                                                                                   (blue * blue)) * (float)weight;
+            }
+
+            // Same layout as the little endian byte sequence { alpha, red, green, blue } that GetQuantizedPalette unpacks
+            colorData.AddPixel(
+                new Pixel(alpha, red, green, blue),
+                indexAlpha | (indexRed << 8) | (indexGreen << 16) | (indexBlue << 24),
+                weight);
+        }
+
         private static ColorData CalculateMoments(ColorData data)
         {
             for (var alphaIndex = 1; alphaIndex <= MaxSideIndex; ++alphaIndex)
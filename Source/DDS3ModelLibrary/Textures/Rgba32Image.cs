@@ -0,0 +1,96 @@
+﻿using DDS3ModelLibrary.Textures.Processing;
+using System;
+using System.Buffers;
+using System.Drawing;
+using System.Runtime.InteropServices;
+using System.Threading;
+using Color = DDS3ModelLibrary.Models.Color;
+
+namespace DDS3ModelLibrary.Textures
+{
+    /// <summary>
+    /// Represents a 32 bit RGBA image whose pixel storage is rented from a shared pool. Unlike <see cref="Bitmap"/> it does not
+    /// depend on GDI+, so separate instances can be processed concurrently. An instance itself is not synchronized.
+    /// </summary>
+    public sealed class Rgba32Image : IDisposable
+    {
+        private Color[] mBuffer;
+
+        public int Width { get; }
+
+        public int Height { get; }
+
+        public int PixelCount => Width * Height;
+
+        /// <summary>
+        /// Gets the pixels of the image, stored row by row from the top left.
+        /// </summary>
+        public Span<Color> Pixels => new Span<Color>(GetBuffer(), 0, PixelCount);
+
+        /// <summary>
+        /// Gets the pixels of the image as raw RGBA bytes.
+        /// </summary>
+        public Span<byte> Bytes => MemoryMarshal.AsBytes(Pixels);
+
+        public ref Color this[int x, int y] => ref GetBuffer()[x + y * Width];
+
+        /// <summary>
+        /// Creates a new image with all pixels set to transparent black.
+        /// </summary>
+        public Rgba32Image(int width, int height)
+        {
+            if (width <= 0) throw new ArgumentOutOfRangeException(nameof(width));
+            if (height <= 0) throw new ArgumentOutOfRangeException(nameof(height));
+
+            Width = width;
+            Height = height;
+            mBuffer = ArrayPool<Color>.Shared.Rent(width * height);
+            Pixels.Clear();
+        }
+
+        /// <summary>
+        /// Creates a new image with a copy of the given pixels.
+        /// </summary>
+        public Rgba32Image(int width, int height, ReadOnlySpan<Color> pixels) : this(width, height)
+        {
+            if (pixels.Length != PixelCount)
+                throw new ArgumentException("Pixel count does not match the image dimensions.", nameof(pixels));
+
+            pixels.CopyTo(Pixels);
+        }
+
+        public Span<Color> GetRow(int y) => Pixels.Slice(y * Width, Width);
+
+        public Color[] ToArray() => Pixels.ToArray();
+
+        public Rgba32Image Clone() => new Rgba32Image(Width, Height, Pixels);
+
+        /// <summary>
+        /// Creates an image from a <see cref="Bitmap"/>. Only intended for interoperability with existing code.
+        /// </summary>
+        public static Rgba32Image FromBitmap(Bitmap bitmap)
+        {
+            return new Rgba32Image(bitmap.Width, bitmap.Height, BitmapHelper.GetColors(bitmap));
+        }
+
+        /// <summary>
+        /// Creates a <see cref="Bitmap"/> from the image. Only intended for interoperability with existing code.
+        /// </summary>
+        public Bitmap ToBitmap()
+        {
+            return BitmapHelper.Create(ToArray(), Width, Height);
+        }
+
+        public void Dispose()
+        {
+            var buffer = Interlocked.Exchange(ref mBuffer, null);
+            if (buffer != null)
+                ArrayPool<Color>.Shared.Return(buffer);
+        }
+
+        private Color[] GetBuffer()
+        {
+            return mBuffer ?? throw new ObjectDisposedException(nameof(Rgba32Image));
+        }
+    }
+}
@@ -116,6 +116,92 @@ namespace DDS3ModelLibrary.Textures
             }
         }
 
+        /// <summary>
+        /// Creates a new texture from an <see cref="Rgba32Image"/>. Unlike the <see cref="Bitmap"/> overload this does not use GDI+,
+        /// so textures can be created on multiple threads at once.
+        /// </summary>
+        public Texture(Rgba32Image image, GSPixelFormat pixelFormat = GSPixelFormat.PSMT8, string comment = "")
+            : this(image, pixelFormat, 0, comment)
+        {
+        }
+
+        /// <summary>
+        /// Creates a new texture from an <see cref="Rgba32Image"/> with a generated mipmap chain.
+        /// The number of levels is limited to what the texture layout and the GS allow, see <see cref="MipMapHelper.GetMaxMipMapCount"/>.
+        /// Indexed textures share a single palette across all levels.
+        /// </summary>
+        public Texture(Rgba32Image image, GSPixelFormat pixelFormat, int mipMapCount, string comment = "")
+        {
+            Width = (ushort)image.Width;
+            Height = (ushort)image.Height;
+            PixelFormat = pixelFormat;
+            mWrapModes = byte.MaxValue;
+            UserComment = comment;
+
+            var levels = new List<Rgba32Image> { image };
+            levels.AddRange(MipMapHelper.GenerateMipMaps(image, mipMapCount));
+            if (levels.Count > 1)
+                MipKL = MipMapHelper.CalculateMipKL(Width, Height);
+
+            try
+            {
+                switch (pixelFormat)
+                {
+                    case GSPixelFormat.PSMTC32:
+                    case GSPixelFormat.PSMTC24:
+                    case GSPixelFormat.PSMTC16:
+                    case GSPixelFormat.PSMTC16S: // Non-indexed
+                        PaletteFormat = 0;
+                        Pixels = new List<Color[]>();
+                        foreach (var level in levels)
+                        {
+                            var pixels = level.ToArray();
+                            PixelSwizzleHelper.ScaleAlphaToGS(pixels);
+                            Pixels.Add(pixels);
+                        }
+                        break;
+                    case GSPixelFormat.PSMT8:
+                    case GSPixelFormat.PSMT8H:
+                        SetupIndexedPixels(levels, 256);
+                        break;
+                    case GSPixelFormat.PSMT4:
+                    case GSPixelFormat.PSMT4HL:
+                    case GSPixelFormat.PSMT4HH:
+                        SetupIndexedPixels(levels, 16);
+                        break;
+                    default:
+                        throw new ArgumentException("This pixel format is not supported for encoding.");
+                }
+            }
+            finally
+            {
+                for (int i = 1; i < levels.Count; i++)
+                    levels[i].Dispose();
+            }
+        }
+
+        /// <summary>
+        /// Creates a new indexed texture from an existing palette and per-pixel palette indices.
+        /// The palette colors are expected to already be in the GS alpha range.
+        /// </summary>
+        public Texture(int width, int height, Color[] palette, byte[] indices, GSPixelFormat pixelFormat = GSPixelFormat.PSMT8, string comment = "")
+        {
+            if (!GSPixelFormatHelper.IsIndexedPixelFormat(pixelFormat))
+                throw new ArgumentException("Pixel format must be an indexed pixel format.", nameof(pixelFormat));
+
+            if (indices.Length != width * height)
+                throw new ArgumentException("Index count does not match the texture dimensions.", nameof(indices));
+
+            Width = (ushort)width;
+            Height = (ushort)height;
+            PixelFormat = pixelFormat;
+            PaletteFormat = GSPixelFormat.PSMTC32;
+            mWrapModes = byte.MaxValue;
+            UserComment = comment;
+            Palettes = new List<Color[]>() { palette };
+            PixelIndices = new List<byte[]>() { indices };
+        }
+
         public Color[] GetPixels()
         {
             if (IsIndexed && Pixels == null)
@@ -139,6 +225,30 @@ namespace DDS3ModelLibrary.Textures
             return mBitmap;
         }
 
+        /// <summary>
+        /// Gets the pixels of the texture as an <see cref="Rgba32Image"/> without going through GDI+. The caller owns the returned image.
+        /// </summary>
+        public Rgba32Image GetImage(int paletteIndex = 0, int mipLevel = 0)
+        {
+            var image = new Rgba32Image(GetMipDimension(Width, mipLevel), GetMipDimension(Height, mipLevel));
+            var pixels = image.Pixels;
+
+            if (IsIndexed)
+            {
+                var palette = Palettes[paletteIndex];
+                var indices = PixelIndices[mipLevel];
+                for (int i = 0; i < pixels.Length; i++)
+                    pixels[i] = palette[indices[i]];
+            }
+            else
+            {
+                Pixels[mipLevel].AsSpan(0, pixels.Length).CopyTo(pixels);
+            }
+
+            PixelSwizzleHelper.ScaleAlphaFromGS(pixels);
+            return image;
+        }
+
         private void SetupIndexedBitmap(Bitmap bitmap, int paletteColorCount)
         {
             BitmapHelper.QuantizeBitmap(bitmap, paletteColorCount, out var indices, out var palette);
@@ -147,7 +257,70 @@ namespace DDS3ModelLibrary.Textures
             PaletteFormat = GSPixelFormat.PSMTC32;
         }
 
-        private static int GetMipDimension(int dim, int mipIdx)
+        private void SetupIndexedPixels(List<Rgba32Image> levels, int paletteColorCount)
+        {
+            if (levels.Count == 1)
+            {
+                BitmapHelper.QuantizeColors(levels[0].Pixels, paletteColorCount, out var indices, out var palette);
+                PixelSwizzleHelper.ScaleAlphaToGS(palette);
+                Palettes = new List<Color[]>() { palette };
+                PixelIndices = new List<byte[]>() { indices };
+            }
+            else
+            {
+                // Quantize all levels at once so they can share one palette
+                var totalPixelCount = 0;
+                foreach (var level in levels)
+                    totalPixelCount += level.PixelCount;
+
+                var colors = new Color[totalPixelCount];
+                var offset = 0;
+                foreach (var level in levels)
+                {
+                    level.Pixels.CopyTo(colors.AsSpan(offset));
+                    offset += level.PixelCount;
+                }
+
+                BitmapHelper.QuantizeColors(colors, paletteColorCount, out var indices, out var palette);
+                PixelSwizzleHelper.ScaleAlphaToGS(palette);
+                Palettes = new List<Color[]>() { palette };
+                PixelIndices = new List<byte[]>();
+
+                offset = 0;
+                foreach (var level in levels)
+                {
+                    var levelIndices = new byte[level.PixelCount];
+                    Array.Copy(indices, offset, levelIndices, 0, levelIndices.Length);
+                    PixelIndices.Add(levelIndices);
+                    offset += level.PixelCount;
+                }
+            }
+
+            PaletteFormat = GSPixelFormat.PSMTC32;
+        }
+
+        /// <summary>
+        /// Replaces the palette and the palette indices of all mipmap levels of an indexed texture.
+        /// The palette colors are expected to already be in the GS alpha range.
+        /// </summary>
+        internal void ReplacePalette(Color[] palette, List<byte[]> pixelIndices)
+        {
+            if (!IsIndexed)
+                throw new InvalidOperationException("Texture is not indexed.");
+
+            if (pixelIndices.Count != PixelIndices.Count)
+                throw new ArgumentException("Mipmap level count does not match the texture.", nameof(pixelIndices));
+
+            Palettes = new List<Color[]>() { palette };
+            PixelIndices = pixelIndices;
+            Pixels = null;
+            mBitmap = null;
+        }
+
+        /// <summary>
+        /// Gets the dimension of a mipmap level as laid out in the texture data.
+        /// </summary>
+        internal static int GetMipDimension(int dim, int mipIdx)
         {
             if (mipIdx == 0)
                 return dim;
@@ -221,8 +394,7 @@ namespace DDS3ModelLibrary.Textures
                 {
                     for (int i = 0; i < mipMapCount; i++)
                     {
-                        int div = 2 * (2 * (i + 1));
-                        PixelIndices.Add(GSPixelFormatHelper.ReadPixelData<byte>(PixelFormat, reader, Width / div, Height / div));
+                        PixelIndices.Add(GSPixelFormatHelper.ReadPixelData<byte>(PixelFormat, reader, GetMipDimension(Width, i + 1), GetMipDimension(Height, i + 1)));
                     }
                 }
             }
@@ -234,8 +406,7 @@ namespace DDS3ModelLibrary.Textures
                 {
                     for (int i = 0; i < mipMapCount; i++)
                     {
-                        int div = 2 * (2 * (i + 1));
-                        Pixels.Add(GSPixelFormatHelper.ReadPixelData<Color>(PixelFormat, reader, Width / div, Height / div));
+                        Pixels.Add(GSPixelFormatHelper.ReadPixelData<Color>(PixelFormat, reader, GetMipDimension(Width, i + 1), GetMipDimension(Height, i + 1)));
                     }
                 }
             }
@@ -271,8 +442,7 @@ namespace DDS3ModelLibrary.Textures
 
                 for (int i = 0; i < PixelIndices.Count; i++)
                 {
-                    int div = i == 0 ? 1 : 2 * (2 * i);
-                    GSPixelFormatHelper.WritePixelData(PixelFormat, writer, Width / div, Height / div, PixelIndices[i]);
+                    GSPixelFormatHelper.WritePixelData(PixelFormat, writer, GetMipDimension(Width, i), GetMipDimension(Height, i), PixelIndices[i]);
                 }
 
             }
@@ -280,8 +450,7 @@ namespace DDS3ModelLibrary.Textures
             {
                 for (int i = 0; i < Pixels.Count; i++)
                 {
-                    int div = i == 0 ? 1 : 2 * (2 * i);
-                    GSPixelFormatHelper.WritePixelData(PixelFormat, writer, Width / div, Height / div, Pixels[i]);
+                    GSPixelFormatHelper.WritePixelData(PixelFormat, writer, GetMipDimension(Width, i), GetMipDimension(Height, i), Pixels[i]);
                 }
             }
         }
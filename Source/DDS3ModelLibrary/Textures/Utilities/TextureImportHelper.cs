@@ -1,4 +1,6 @@
 ﻿using DDS3ModelLibrary.Textures.Exchange.DDS;
+using DDS3ModelLibrary.Textures.Exchange.PNG;
+using DDS3ModelLibrary.Textures.Exchange.TGA;
 using System;
 using System.Drawing;
 using System.IO;
@@ -7,6 +9,8 @@ namespace DDS3ModelLibrary.Textures.Utilities
 {
     public static class TextureImportHelper
     {
+        private static readonly object sBitmapLock = new object();
+
         public static Bitmap ImportBitmap(string path)
         {
             try
@@ -26,10 +30,43 @@ namespace DDS3ModelLibrary.Textures.Utilities
             }
         }
 
+        /// <summary>
+        /// Imports an image without going through GDI+ when its format is supported, so it can be called from multiple threads.
+        /// Other formats, and files the codecs fail to decode, fall back to <see cref="ImportBitmap"/>.
+        /// </summary>
+        public static Rgba32Image ImportImage(string path)
+        {
+            try
+            {
+                var ext = Path.GetExtension(path).ToLowerInvariant();
+                switch (ext)
+                {
+                    case ".png":
+                        return PNGCodec.Decode(path);
+                    case ".tga":
+                        return TGACodec.Decode(path);
+                    case ".dds":
+                        return DDSCodec.DecompressImageToRgba32(path);
+                }
+            }
+            catch (Exception)
+            {
+                // Fall back to GDI+ for files the codecs don't handle, eg. interlaced PNGs. Files that are damaged
+                // end up as a placeholder there, like before, rather than failing the whole import
+            }
+
+            // libgdiplus is not thread-safe
+            lock (sBitmapLock)
+            {
+                using (var bitmap = ImportBitmap(path))
+                    return Rgba32Image.FromBitmap(bitmap);
+            }
+        }
+
         public static Texture ImportTexture(string path)
         {
-            var bitmap = ImportBitmap(path);
-            return new Texture(bitmap, PS2.GS.GSPixelFormat.PSMT8, Path.GetFileNameWithoutExtension(path));
+            using (var image = ImportImage(path))
+                return new Texture(image, PS2.GS.GSPixelFormat.PSMT8, Path.GetFileNameWithoutExtension(path));
         }
     }
 }
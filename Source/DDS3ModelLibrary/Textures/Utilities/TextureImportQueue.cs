@@ -0,0 +1,213 @@
+﻿using DDS3ModelLibrary.PS2.GS;
+using DDS3ModelLibrary.Textures.Processing;
+using DDS3ModelLibrary.Utilities;
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Threading.Tasks;
+
+namespace DDS3ModelLibrary.Textures.Utilities
+{
+    /// <summary>
+    /// Collects texture file references, and imports them all at once. Paths are resolved up front and files with identical
+    /// contents are only imported once. Decoding, resizing and quantization run in parallel, while the resulting texture ids
+    /// only depend on the order in which the references were added.
+    /// </summary>
+    internal class TextureImportQueue
+    {
+        private const string MISSING_CONTENT_KEY = "<missing>";
+        private const string CACHE_STAGE = "textures";
+
+        private readonly string mBaseDirectory;
+        private readonly float mScale;
+        private readonly List<string> mFilePaths;
+        private readonly Dictionary<string, int> mFilePathLookup;
+
+        /// <summary>
+        /// Gets or sets the maximum number of textures imported at the same time.
+        /// </summary>
+        public int MaxDegreeOfParallelism { get; set; } = Environment.ProcessorCount;
+
+        /// <summary>
+        /// Gets or sets the number of mipmap levels to generate for each texture. Defaults to none.
+        /// <see cref="MipMapHelper.AUTO_MIPMAP_COUNT"/> generates as many levels as the dimensions of each texture allow.
+        /// </summary>
+        public int MipMapCount { get; set; }
+
+        /// <summary>
+        /// Gets or sets the cache imported textures are looked up in and stored to. May be null to always import.
+        /// </summary>
+        public ImportCache Cache { get; set; }
+
+        /// <summary>
+        /// Gets the paths of the texture files that were found during the last import.
+        /// </summary>
+        public IReadOnlyList<string> ImportedFilePaths { get; private set; } = new string[0];
+
+        /// <summary>
+        /// Gets the paths that were looked for but not found during the last import, for references that couldn't be resolved.
+        /// </summary>
+        public IReadOnlyList<string> MissingFilePaths { get; private set; } = new string[0];
+
+        /// <param name="baseDirectory">The directory relative paths are resolved against.</param>
+        /// <param name="scale">The factor each texture's dimensions are divided by.</param>
+        /// <param name="mipMapCount">The number of mipmap levels to generate for each texture.</param>
+        public TextureImportQueue(string baseDirectory, float scale, int mipMapCount = 0)
+        {
+            mBaseDirectory = baseDirectory;
+            mScale = scale;
+            MipMapCount = mipMapCount;
+            mFilePaths = new List<string>();
+            mFilePathLookup = new Dictionary<string, int>();
+        }
+
+        /// <summary>
+        /// Adds a texture reference to the queue.
+        /// </summary>
+        /// <returns>A handle that can be used to look up the texture id after importing.</returns>
+        public int Add(string filePath)
+        {
+            if (!mFilePathLookup.TryGetValue(filePath, out var handle))
+            {
+                handle = mFilePaths.Count;
+                mFilePaths.Add(filePath);
+                mFilePathLookup[filePath] = handle;
+            }
+
+            return handle;
+        }
+
+        /// <summary>
+        /// Imports all queued textures into the texture pack.
+        /// </summary>
+        /// <returns>The texture id of each handle returned by <see cref="Add"/>.</returns>
+        public int[] Import(TexturePack texturePack)
+        {
+            // Resolve paths and hash file contents, reading every distinct file only once
+            var resolvedPaths = new string[mFilePaths.Count];
+            var distinctPaths = new List<string>();
+            var missingPaths = new List<string>();
+            var distinctPathLookup = new Dictionary<string, int>(StringComparer.OrdinalIgnoreCase);
+            for (int i = 0; i < mFilePaths.Count; i++)
+            {
+                var path = ResolvePath(mFilePaths[i]);
+                resolvedPaths[i] = path;
+                if (path == null)
+                    missingPaths.AddRange(GetCandidatePaths(mFilePaths[i]));
+                else if (!distinctPathLookup.ContainsKey(path))
+                {
+                    distinctPathLookup[path] = distinctPaths.Count;
+                    distinctPaths.Add(path);
+                }
+            }
+
+            var contentKeys = new string[distinctPaths.Count];
+            Parallel.For(0, distinctPaths.Count, CreateParallelOptions(), i =>
+            {
+                contentKeys[i] = File.ReadAllBytes(distinctPaths[i]).GetSHA256();
+            });
+
+            // Assign texture ids in order of first reference
+            var textureIds = new int[mFilePaths.Count];
+            var contentLookup = new Dictionary<string, int>();
+            var importPaths = new List<string>();
+            var importNames = new List<string>();
+            var importContentKeys = new List<string>();
+            for (int i = 0; i < mFilePaths.Count; i++)
+            {
+                var contentKey = resolvedPaths[i] != null ? contentKeys[distinctPathLookup[resolvedPaths[i]]] : MISSING_CONTENT_KEY;
+                if (!contentLookup.TryGetValue(contentKey, out var index))
+                {
+                    index = importPaths.Count;
+                    contentLookup[contentKey] = index;
+                    importPaths.Add(resolvedPaths[i]);
+                    importNames.Add(Path.GetFileNameWithoutExtension(resolvedPaths[i] ?? mFilePaths[i]));
+                    importContentKeys.Add(contentKey);
+                }
+
+                textureIds[i] = texturePack.Count + index;
+            }
+
+            var textures = new Texture[importPaths.Count];
+            Parallel.For(0, importPaths.Count, CreateParallelOptions(), i =>
+            {
+                textures[i] = ImportTexture(importPaths[i], importNames[i], importContentKeys[i]);
+            });
+
+            ImportedFilePaths = distinctPaths;
+            MissingFilePaths = missingPaths;
+
+            foreach (var texture in textures)
+                texturePack.Add(texture);
+
+            return textureIds;
+        }
+
+        private string ResolvePath(string filePath)
+        {
+            foreach (var path in GetCandidatePaths(filePath))
+            {
+                if (File.Exists(path))
+                    return Path.GetFullPath(path);
+            }
+
+            return null;
+        }
+
+        private IEnumerable<string> GetCandidatePaths(string filePath)
+        {
+            yield return filePath;
+
+            // Assume it's a relative path
+            yield return Path.Combine(mBaseDirectory, filePath);
+        }
+
+        private Texture ImportTexture(string path, string name, string contentKey)
+        {
+            // Textures with identical contents and import options are reused, only the name may differ
+            var cacheKey = Cache != null && path != null ? ImportCache.CreateKey(contentKey, mScale, MipMapCount, GSPixelFormat.PSMT8) : null;
+            if (cacheKey != null)
+            {
+                var cachedTexture = new Texture();
+                if (Cache.TryLoad(CACHE_STAGE, cacheKey, cachedTexture))
+                {
+                    cachedTexture.UserComment = name;
+                    return cachedTexture;
+                }
+            }
+
+            var texture = ImportTexture(path, name);
+            if (cacheKey != null)
+                Cache.Store(CACHE_STAGE, cacheKey, Enumerable.Empty<string>(), texture);
+
+            return texture;
+        }
+
+        private Texture ImportTexture(string path, string name)
+        {
+            var image = path != null ? TextureImportHelper.ImportImage(path) : new Rgba32Image(32, 32);
+            try
+            {
+                if (mScale != 1)
+                {
+                    var scaledImage = ImageResampleHelper.Resize(image, Math.Max(1, (int)(image.Width / mScale)), Math.Max(1, (int)(image.Height / mScale)));
+                    image.Dispose();
+                    image = scaledImage;
+                }
+
+                var mipMapCount = MipMapCount == MipMapHelper.AUTO_MIPMAP_COUNT ? MipMapHelper.GetMaxMipMapCount(image.Width, image.Height) : MipMapCount;
+                return new Texture(image, GSPixelFormat.PSMT8, mipMapCount, name);
+            }
+            finally
+            {
+                image.Dispose();
+            }
+        }
+
+        private ParallelOptions CreateParallelOptions()
+        {
+            return new ParallelOptions { MaxDegreeOfParallelism = Math.Max(1, MaxDegreeOfParallelism) };
+        }
+    }
+}
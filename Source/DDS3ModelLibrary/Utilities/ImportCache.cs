@@ -0,0 +1,228 @@
+﻿using DDS3ModelLibrary.IO;
+using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.IO;
+using System.Linq;
+using System.Text;
+
+namespace DDS3ModelLibrary.Utilities
+{
+    /// <summary>
+    /// A persistent cache of imported resources, so repeated imports of unchanged sources can skip conversion.
+    /// Entries are grouped by import stage and keyed by a hash of the source contents and the options that affect the result.
+    /// An entry can list additional files it was built from, and is discarded once any of them change.
+    /// Files that were missing are recorded as well, and the entry is discarded once any of them appear.
+    /// </summary>
+    public class ImportCache
+    {
+        private const uint MAGIC = 0x43493344; // D3IC
+        private const int FORMAT_VERSION = 2;
+        private const long MISSING_LENGTH = -1;
+
+        /// <summary>
+        /// Gets the default cache directory, in the local application data folder.
+        /// </summary>
+        public static string DefaultDirectoryPath =>
+            Path.Combine(Environment.GetFolderPath(Environment.SpecialFolder.LocalApplicationData), "DDS3ModelStudio", "ImportCache");
+
+        public string DirectoryPath { get; }
+
+        public ImportCache(string directoryPath)
+        {
+            DirectoryPath = Path.GetFullPath(directoryPath);
+        }
+
+        /// <summary>
+        /// Creates a cache key from the given values. The key also changes whenever the library is rebuilt,
+        /// so entries created by a different version of the conversion code are never used.
+        /// </summary>
+        public static string CreateKey(params object[] values)
+        {
+            var builder = new StringBuilder();
+            builder.Append(FORMAT_VERSION).Append('|');
+            builder.Append(typeof(ImportCache).Assembly.ManifestModule.ModuleVersionId).Append('|');
+            foreach (var value in values)
+                builder.Append(Convert.ToString(value, CultureInfo.InvariantCulture)).Append('|');
+
+            return Encoding.UTF8.GetBytes(builder.ToString()).GetSHA256();
+        }
+
+        /// <summary>
+        /// Gets the content hash of a file, for use in a cache key.
+        /// </summary>
+        public static string GetFileHash(string filePath)
+        {
+            return File.ReadAllBytes(filePath).GetSHA256();
+        }
+
+        /// <summary>
+        /// Tries to load a cache entry into the given resources, in the order they were stored.
+        /// </summary>
+        /// <returns>True if the entry exists and none of the files it was built from have changed.</returns>
+        public bool TryLoad(string stage, string key, params Resource[] resources)
+        {
+            var path = GetEntryPath(stage, key);
+            if (!File.Exists(path))
+                return false;
+
+            try
+            {
+                using (var reader = new BinaryReader(File.OpenRead(path)))
+                {
+                    if (reader.ReadUInt32() != MAGIC || reader.ReadInt32() != FORMAT_VERSION)
+                        return false;
+
+                    var dependencyCount = reader.ReadInt32();
+                    for (int i = 0; i < dependencyCount; i++)
+                    {
+                        var dependencyPath = reader.ReadString();
+                        var lastWriteTime = reader.ReadInt64();
+                        var length = reader.ReadInt64();
+                        var hash = reader.ReadString();
+                        if (!IsDependencyUnchanged(dependencyPath, lastWriteTime, length, hash))
+                            return false;
+                    }
+
+                    if (reader.ReadInt32() != resources.Length)
+                        return false;
+
+                    foreach (var resource in resources)
+                    {
+                        var data = reader.ReadBytes(reader.ReadInt32());
+                        resource.Load(new MemoryStream(data));
+                    }
+                }
+
+                return true;
+            }
+            catch (Exception)
+            {
+                // A corrupt or partially written entry can fail in any way while it's deserialized. The cache must never
+                // fail an import, so the entry is treated as missing and removed
+                DeleteEntry(path);
+                return false;
+            }
+        }
+
+        /// <summary>
+        /// Stores the resources as a cache entry.
+        /// </summary>
+        /// <param name="stage">The import stage the entry belongs to.</param>
+        /// <param name="key">The key created with <see cref="CreateKey"/>.</param>
+        /// <param name="dependencies">The paths of files the resources were built from that aren't part of the key, including files that were looked for but not found.</param>
+        /// <param name="resources">The resources to store.</param>
+        public void Store(string stage, string key, IEnumerable<string> dependencies, params Resource[] resources)
+        {
+            var path = GetEntryPath(stage, key);
+            Directory.CreateDirectory(Path.GetDirectoryName(path));
+
+            // Write to a temporary file first, so concurrent imports never see a partial entry
+            var tempPath = path + "." + Guid.NewGuid().ToString("N") + ".tmp";
+            using (var writer = new BinaryWriter(File.Create(tempPath)))
+            {
+                writer.Write(MAGIC);
+                writer.Write(FORMAT_VERSION);
+
+                var dependencyPaths = dependencies.Select(GetFullPathOrNull).Where(x => x != null).Distinct(StringComparer.OrdinalIgnoreCase).ToList();
+                writer.Write(dependencyPaths.Count);
+                foreach (var dependencyPath in dependencyPaths)
+                {
+                    writer.Write(dependencyPath);
+                    if (File.Exists(dependencyPath))
+                    {
+                        var fileInfo = new FileInfo(dependencyPath);
+                        writer.Write(fileInfo.LastWriteTimeUtc.Ticks);
+                        writer.Write(fileInfo.Length);
+                        writer.Write(GetFileHash(dependencyPath));
+                    }
+                    else
+                    {
+                        // The file must still be missing for the entry to be valid
+                        writer.Write(0L);
+                        writer.Write(MISSING_LENGTH);
+                        writer.Write(string.Empty);
+                    }
+                }
+
+                writer.Write(resources.Length);
+                foreach (var resource in resources)
+                {
+                    using (var stream = resource.Save())
+                    {
+                        writer.Write((int)stream.Length);
+                        stream.CopyTo(writer.BaseStream);
+                    }
+                }
+            }
+
+            try
+            {
+                if (File.Exists(path))
+                    File.Delete(path);
+
+                File.Move(tempPath, path);
+            }
+            catch (IOException)
+            {
+                // Another import stored the same entry first
+                File.Delete(tempPath);
+            }
+        }
+
+        /// <summary>
+        /// Removes all cache entries.
+        /// </summary>
+        public void Clear()
+        {
+            if (Directory.Exists(DirectoryPath))
+                Directory.Delete(DirectoryPath, true);
+        }
+
+        private string GetEntryPath(string stage, string key)
+        {
+            return Path.Combine(DirectoryPath, stage, key + ".bin");
+        }
+
+        private static void DeleteEntry(string path)
+        {
+            try
+            {
+                File.Delete(path);
+            }
+            catch (Exception e) when (e is IOException || e is UnauthorizedAccessException)
+            {
+                // Another import may be using or replacing it, it'll be overwritten when it's stored again
+            }
+        }
+
+        private static string GetFullPathOrNull(string path)
+        {
+            try
+            {
+                return Path.GetFullPath(path);
+            }
+            catch (Exception e) when (e is ArgumentException || e is NotSupportedException || e is PathTooLongException)
+            {
+                // A path that isn't valid can never appear, so there's nothing to track
+                return null;
+            }
+        }
+
+        private static bool IsDependencyUnchanged(string path, long lastWriteTime, long length, string hash)
+        {
+            if (length == MISSING_LENGTH)
+                return !File.Exists(path);
+
+            if (!File.Exists(path))
+                return false;
+
+            // Only rehash files that were touched
+            var fileInfo = new FileInfo(path);
+            if (fileInfo.Length != length)
+                return false;
+
+            return fileInfo.LastWriteTimeUtc.Ticks == lastWriteTime || GetFileHash(path) == hash;
+        }
+    }
+}
@@ -1,5 +1,6 @@
 ﻿using AtlusFileSystemLibrary;
 using AtlusFileSystemLibrary.FileSystems.LB;
+using DDS3ModelLibrary.Materials;
 using DDS3ModelLibrary.Models;
 using DDS3ModelLibrary.Models.Conversion;
 using DDS3ModelLibrary.Models.Field;
@@ -9,6 +10,7 @@ using Newtonsoft.Json;
 using System;
 using System.Collections.Concurrent;
 using System.Collections.Generic;
+using System.Diagnostics;
 using System.IO;
 using System.Linq;
 using System.Numerics;
@@ -511,7 +513,9 @@ namespace DDS3ModelLibraryCLI
                             var mesh = (MeshType2)_mesh;
                             foreach (var batch in mesh.Batches)
                             {
-                                (Vector3[] positions, Vector3[] normals, _) = batch.Transform(model.Nodes);
+                                var positions = new Vector3[batch.VertexCount];
+                                var normals = new Vector3[positions.Length];
+                                batch.Transform(model.Nodes, positions, normals, Span<NodeWeight>.Empty);
                                 WritePositions(streamWriter, positions);
                                 WriteNormals(streamWriter, normals);
                                 WriteTexCoords(streamWriter, batch.TexCoords ?? new Vector2[positions.Length]);
@@ -553,7 +557,9 @@ namespace DDS3ModelLibraryCLI
                             var mesh = (MeshType7)_mesh;
                             foreach (var batch in mesh.Batches)
                             {
-                                (Vector3[] positions, Vector3[] normals, _) = batch.Transform(model.Nodes);
+                                var positions = new Vector3[batch.VertexCount];
+                                var normals = new Vector3[positions.Length];
+                                batch.Transform(model.Nodes, positions, normals, Span<NodeWeight>.Empty);
 
                                 WritePositions(streamWriter, positions);
                                 WriteNormals(streamWriter, normals);
@@ -1050,6 +1056,7 @@ namespace DDS3ModelLibraryCLI
             }
 
             File.WriteAllText("material_presets\\index.json", JsonConvert.SerializeObject(materialIdLookup, Formatting.Indented));
+            MaterialPresetBundle.Build("material_presets", "material_presets.bin");
         }
 
         private static void ReplaceModelTest()
@@ -1058,5 +1065,58 @@ namespace DDS3ModelLibraryCLI
             modelPack.Replace("player_a_test.fbx");
             modelPack.Save(@"D:\Modding\DDS3\Nocturne\_HostRoot\dds3data\model\field\player_a.PB");
         }
+
+        private static void PoseSamplerBenchmark()
+        {
+            var modelPack = new ModelPack(@"..\..\..\..\Resources\player_a.PB");
+            var model = modelPack.Models[0];
+            var motions = modelPack.MotionPacks.SelectMany(x => x.Motions).Where(x => x != null).ToList();
+            var worldTransforms = new Matrix4x4[model.Nodes.Count];
+
+            // Sample every motion frame by frame, like a playback preview would
+            var poseCount = 0;
+            var stopwatch = Stopwatch.StartNew();
+            while (stopwatch.ElapsedMilliseconds < 5000)
+            {
+                foreach (var motion in motions)
+                {
+                    var sampler = new PoseSampler(model, motion);
+                    for (int i = 0; i <= motion.Duration; i++)
+                        sampler.Sample(i, worldTransforms);
+
+                    poseCount += motion.Duration + 1;
+                }
+            }
+
+            stopwatch.Stop();
+            Console.WriteLine($"{poseCount} poses of {model.Nodes.Count} nodes in {stopwatch.ElapsedMilliseconds}ms, " +
+                              $"{poseCount / stopwatch.Elapsed.TotalSeconds:F0} poses per second");
+        }
+
+        private static void GltfExporterBenchmark()
+        {
+            var modelPack = new ModelPack(@"..\..\..\..\Resources\player_a.PB");
+            var model = modelPack.Models[0];
+
+            void Measure(string name, Action export)
+            {
+                // Warm up once so JIT and native library loading aren't measured
+                export();
+
+                const int iterations = 20;
+                var stopwatch = Stopwatch.StartNew();
+                for (int i = 0; i < iterations; i++)
+                    export();
+
+                stopwatch.Stop();
+                Console.WriteLine($"{name}: {stopwatch.ElapsedMilliseconds / (double)iterations:F1}ms per export");
+            }
+
+            Measure("glb", () => GltfModelExporter.Instance.Export(model, "player_a.glb", new GltfModelExporter.Config(), modelPack.TexturePack,
+                                                                   modelPack.MotionPacks));
+            Measure("assimp dae", () => AssimpModelExporter.Instance.Export(model, "player_a.dae", modelPack.TexturePack));
+            Measure("fbx", () => FbxModelExporter.Instance.Export(model, "player_a.fbx", new FbxModelExporterConfig(), modelPack.TexturePack,
+                                                                 modelPack.MotionPacks));
+        }
     }
 }